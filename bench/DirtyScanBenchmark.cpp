@@ -0,0 +1,179 @@
+// Replays a synthetic stream of constant buffer updates through the dirty-window scanner and through a full
+// rescan of every update (the scanner before dirty tracking), and reports the windows and bytes each tested and the
+// time taken.
+//
+//   DirtyScanBenchmark [--frames N] [--objects N] [--seed N]
+#include "Camera/BufferScanner.h"
+#include "Camera/MatrixScanner.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace Camera;
+
+namespace {
+    struct Update {
+        uint64_t handle;
+        std::vector<uint8_t> bytes;
+    };
+
+    struct Options {
+        int frames = 300;
+        int objects = 200;
+        unsigned seed = 1;
+    };
+
+    void WriteRowMajor(float* m, float angle, float x, float y, float z) {
+        float c = std::cos(angle), s = std::sin(angle);
+        const float rows[16] = { c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, x, y, z, 1 };
+        memcpy(m, rows, sizeof(rows));
+    }
+
+    void WriteProjection(float* m) {
+        const float rows[16] = { 1.2f, 0, 0, 0, 0, 2.1f, 0, 0, 0, 0, 1.0001f, 1, 0, 0, -0.1f, 0 };
+        memcpy(m, rows, sizeof(rows));
+    }
+
+    // One frame of a typical forward renderer: a camera buffer (time constant, view and projection), per-object
+    // buffers rewritten every frame though most objects stand still, a bone palette of which a quarter moves, and
+    // material buffers without matrices that never change
+    std::vector<Update> BuildStream(const Options& options) {
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> any(-100.0f, 100.0f);
+
+        std::vector<float> camera(256, 0.5f);
+        std::vector<std::vector<float>> objects(options.objects, std::vector<float>(64, 0.25f));
+        std::vector<float> bones(4096, 0.0f);
+        std::vector<std::vector<float>> materials(50, std::vector<float>(128));
+        for (auto& material : materials) {
+            for (float& value : material) value = any(rng) + 10.0f * (value < 0 ? -1.0f : 1.0f);
+        }
+        for (size_t i = 0; i < objects.size(); ++i) WriteRowMajor(objects[i].data(), 0.1f * i, any(rng), any(rng), any(rng));
+        WriteProjection(camera.data() + 80);
+        for (size_t b = 0; b < bones.size(); ++b) bones[b] = any(rng) + 5.0f; // 3x4 rows, never [x x x 0/1]
+
+        auto bytesOf = [](const std::vector<float>& floats) {
+            std::vector<uint8_t> bytes(floats.size() * sizeof(float));
+            memcpy(bytes.data(), floats.data(), bytes.size());
+            return bytes;
+        };
+
+        std::vector<Update> stream;
+        for (int frame = 0; frame < options.frames; ++frame) {
+            camera[0] = (float)frame / 60.0f;
+            WriteRowMajor(camera.data() + 64, 0.01f * frame, 0.0f, 1.8f, (float)frame * 0.1f);
+            stream.push_back({ 1, bytesOf(camera) });
+
+            for (size_t i = 0; i < objects.size(); ++i) {
+                if (i % 8 == 0) WriteRowMajor(objects[i].data(), 0.1f * i + 0.02f * frame, any(rng), any(rng), any(rng));
+                stream.push_back({ 0x1000 + i * 64, bytesOf(objects[i]) });
+            }
+
+            for (size_t b = 0; b < bones.size() / 4; ++b) bones[(frame * 64 + b) % bones.size()] = any(rng) + 5.0f;
+            stream.push_back({ 2, bytesOf(bones) });
+
+            for (size_t m = 0; m < materials.size(); ++m) stream.push_back({ 0x100000 + m * 64, bytesOf(materials[m]) });
+        }
+        return stream;
+    }
+
+    struct Result {
+        double milliseconds = 0.0;
+        uint64_t updates = 0;
+        uint64_t windows = 0;
+        std::unordered_map<uint64_t, std::pair<int, int>> offsets; // Last view/projection offset per buffer
+    };
+
+    // Every update copied and rescanned from the start
+    Result RunFull(const std::vector<Update>& stream) {
+        Result result;
+        std::unordered_map<uint64_t, std::vector<uint8_t>> shadows;
+        ScanStats stats;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const Update& update : stream) {
+            std::vector<uint8_t>& shadow = shadows[update.handle];
+            shadow.resize(update.bytes.size());
+            memcpy(shadow.data(), update.bytes.data(), update.bytes.size());
+
+            const float* floats = (const float*)update.bytes.data();
+            size_t candidateEnd = update.bytes.size() / sizeof(float) - 16 + 1;
+            bool transposed = false;
+            int view = BufferScanner::FindViewMatrix(stats, floats, 0, candidateEnd, &transposed);
+            int projection = BufferScanner::FindProjectionMatrix(stats, floats, 0, candidateEnd);
+            result.offsets[update.handle] = { view, projection };
+            result.updates++;
+        }
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.windows = stats.windowsScanned;
+        return result;
+    }
+
+    Result RunDirty(const std::vector<Update>& stream, ScanStats* outStats) {
+        Result result;
+        BufferCache cache;
+        ScanStats stats;
+
+        auto start = std::chrono::steady_clock::now();
+        for (const Update& update : stream) {
+            ConstantBufferState* state = cache.FindOrInsert(update.handle);
+            if (!state) continue;
+            BufferScanner::Update(cache, *state, stats, update.bytes.data(), update.bytes.size());
+            result.updates++;
+        }
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.windows = stats.windowsScanned;
+
+        for (const Update& update : stream) {
+            const ConstantBufferState* state = cache.Find(update.handle);
+            result.offsets[update.handle] = state ? std::make_pair(state->viewMatrixOffset, state->projMatrixOffset) : std::make_pair(-1, -1);
+        }
+        *outStats = stats;
+        return result;
+    }
+
+    void Print(const char* name, const Result& result) {
+        // A candidate window advances 16 bytes; windows x 16 is the buffer span the predicates covered
+        printf("%-6s %10llu updates %12llu windows %14llu bytes %10.2f ms %8.1f ns/update\n", name,
+               (unsigned long long)result.updates, (unsigned long long)result.windows, (unsigned long long)(result.windows * 16),
+               result.milliseconds, result.updates ? result.milliseconds * 1e6 / (double)result.updates : 0.0);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--frames") == 0) options.frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--objects") == 0) options.objects = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed") == 0) options.seed = (unsigned)atoi(argv[i + 1]);
+    }
+
+    std::vector<Update> stream = BuildStream(options);
+    printf("Scanner path %s, %d frames, %zu updates\n", MatrixScanner::GetPathName(MatrixScanner::GetActivePath()), options.frames, stream.size());
+
+    Result full = RunFull(stream);
+    ScanStats stats;
+    Result dirty = RunDirty(stream, &stats);
+    Print("full", full);
+    Print("dirty", dirty);
+    printf("dirty: %llu full scans, %llu negative cache hits, %.1f%% of full-rescan windows tested\n",
+           (unsigned long long)stats.fullScans, (unsigned long long)stats.negativeCacheHits,
+           stats.windowsTotal ? 100.0 * (double)stats.windowsScanned / (double)stats.windowsTotal : 0.0);
+
+    // Both must end up tracking the same matrices wherever the dirty path kept the buffer
+    int mismatches = 0;
+    for (const auto& [handle, offsets] : dirty.offsets) {
+        if (offsets.first < 0 && offsets.second < 0) continue; // Negative cached
+        if (full.offsets[handle] != offsets) mismatches++;
+    }
+    if (mismatches) {
+        printf("%d buffers disagree between the two paths\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+// Encodes synthetic NV12 frames through SoftwareBackend into a fragmented MP4 and reports the frame rate the encoder
+// sustains, the time the caller spends per frame (what the present thread would see) and the queue's drops and blocks.
+// With --tiles the same frames are encoded once as a single session and once split into CxR tiles, for comparison.
+//
+//   EncoderBenchmark [--width N] [--height N] [--frames N] [--codec x264|x265|svtav1] [--preset P] [--depth N]
+//                    [--policy block|drop_oldest|drop_newest] [--tiles CxR] [--output PATH]
+#include "Video/SoftwareBackend.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <string>
+#include <vector>
+
+using namespace Video;
+
+namespace {
+    constexpr int kSkipped = 77; // CTest's skip code for this driver
+
+    struct Options {
+        int width = 3840;
+        int height = 1920;
+        int frames = 300;
+        SoftwareCodec codec = SoftwareCodec::X264;
+        std::string preset;
+        uint32_t depth = 3;
+        QueuePolicy policy = QueuePolicy::Block;
+        uint32_t tileColumns = 1;
+        uint32_t tileRows = 1;
+        std::string output = (std::filesystem::temp_directory_path() / "widecapture_encoder_benchmark.mp4").string();
+    };
+
+    // A moving gradient with some noise: the encoder sees motion and texture, like a game would give it
+    void FillFrame(int index, int width, int height, std::vector<uint8_t>& y, std::vector<uint8_t>& uv) {
+        uint32_t noise = (uint32_t)index * 2654435761u + 1;
+        for (int row = 0; row < height; ++row) {
+            for (int x = 0; x < width; ++x) {
+                noise = noise * 1664525u + 1013904223u;
+                y[(size_t)row * width + x] = (uint8_t)(x / 4 + row / 4 + index * 3 + (noise >> 29));
+            }
+        }
+        for (int row = 0; row < height / 2; ++row) {
+            for (int x = 0; x < width; ++x) uv[(size_t)row * width + x] = (uint8_t)(128 + ((x / 8 + row / 4 + index) & 31));
+        }
+    }
+
+    struct Frames {
+        std::vector<std::vector<uint8_t>> ys, uvs;
+    };
+
+    struct Result {
+        bool initialized = false;
+        uint64_t encoded = 0;
+        double fps = 0.0;
+        double callerSeconds = 0.0;
+        FrameQueueStats queue;
+    };
+
+    // Encodes options.frames frames cycled from frames, split into columns x rows tiles
+    Result Encode(const Options& options, Frames& frames, uint32_t columns, uint32_t rows) {
+        EncoderConfig config;
+        config.width = options.width;
+        config.height = options.height;
+        config.fps = 60;
+        config.timeBase = 60;
+        config.bitRate = 50000000;
+        config.filename = options.output;
+
+        Result result;
+        SoftwareBackend encoder(options.codec, options.preset);
+        encoder.SetQueue(options.depth, options.policy);
+        encoder.SetTiles(columns, rows);
+        if (!encoder.Initialize(config)) return result;
+        result.initialized = true;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.frames; ++i) {
+            size_t pattern = (size_t)i % frames.ys.size();
+            FrameDesc frame;
+            frame.format = PixelFormat::NV12;
+            frame.width = options.width;
+            frame.height = options.height;
+            frame.planes[0] = frames.ys[pattern].data();
+            frame.planes[1] = frames.uvs[pattern].data();
+            frame.strides[0] = (size_t)options.width;
+            frame.strides[1] = (size_t)options.width;
+
+            auto callStart = std::chrono::steady_clock::now();
+            encoder.EncodeFrame(frame, i);
+            result.callerSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - callStart).count();
+        }
+        result.queue = encoder.GetQueueStats();
+        encoder.Finish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        result.encoded = result.queue.submitted - result.queue.droppedOldest - result.queue.droppedNewest;
+        result.fps = seconds > 0.0 ? (double)result.encoded / seconds : 0.0;
+        return result;
+    }
+
+    void Print(const Options& options, const Result& result) {
+        printf("encoded   %8llu frames  %8.1f fps  %8.1f MP/s\n", (unsigned long long)result.encoded, result.fps,
+               result.fps * options.width * options.height / 1e6);
+        printf("caller    %8.2f ms/frame\n", options.frames ? result.callerSeconds * 1000.0 / options.frames : 0.0);
+        printf("queue     %8llu dropped oldest, %llu dropped newest, %llu blocks, max depth %u\n",
+               (unsigned long long)result.queue.droppedOldest, (unsigned long long)result.queue.droppedNewest,
+               (unsigned long long)result.queue.blocks, result.queue.maxDepth);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--width") == 0) options.width = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--height") == 0) options.height = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--frames") == 0) options.frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--preset") == 0) options.preset = argv[i + 1];
+        else if (strcmp(argv[i], "--depth") == 0) options.depth = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--output") == 0) options.output = argv[i + 1];
+        else if (strcmp(argv[i], "--codec") == 0) {
+            if (strcmp(argv[i + 1], "x265") == 0) options.codec = SoftwareCodec::X265;
+            else if (strcmp(argv[i + 1], "svtav1") == 0) options.codec = SoftwareCodec::SvtAv1;
+        } else if (strcmp(argv[i], "--policy") == 0) {
+            if (strcmp(argv[i + 1], "drop_oldest") == 0) options.policy = QueuePolicy::DropOldest;
+            else if (strcmp(argv[i + 1], "drop_newest") == 0) options.policy = QueuePolicy::DropNewest;
+        } else if (strcmp(argv[i], "--tiles") == 0) {
+            if (sscanf(argv[i + 1], "%ux%u", &options.tileColumns, &options.tileRows) != 2) options.tileColumns = options.tileRows = 1;
+        }
+    }
+    // Whole chroma samples
+    options.width &= ~1;
+    options.height &= ~1;
+
+    // Frames are generated up front so only the encoder is timed
+    const int patterns = 8;
+    Frames frames;
+    frames.ys.resize(patterns);
+    frames.uvs.resize(patterns);
+    for (int i = 0; i < patterns; ++i) {
+        frames.ys[i].resize((size_t)options.width * options.height);
+        frames.uvs[i].resize((size_t)options.width * options.height / 2);
+        FillFrame(i, options.width, options.height, frames.ys[i], frames.uvs[i]);
+    }
+
+    // One session, then the tiled layout when one was asked for
+    std::vector<std::pair<uint32_t, uint32_t>> layouts = { { 1, 1 } };
+    if (options.tileColumns * options.tileRows > 1) layouts.push_back({ options.tileColumns, options.tileRows });
+
+    printf("%dx%d, %d frames, queue depth %u\n", options.width, options.height, options.frames, options.depth);
+    double singleFps = 0.0;
+    for (const auto& layout : layouts) {
+        if (layouts.size() > 1) printf("\n%ux%u tiles\n", layout.first, layout.second);
+        Result result = Encode(options, frames, layout.first, layout.second);
+        if (!result.initialized) {
+            printf("Encoder failed to initialize (no software encoder in this FFmpeg build?)\n");
+            return kSkipped;
+        }
+        Print(options, result);
+        if (layout.first * layout.second == 1) singleFps = result.fps;
+        else if (singleFps > 0.0) printf("speedup   %8.2fx over 1x1\n", result.fps / singleFps);
+    }
+
+    std::error_code error;
+    std::filesystem::remove(options.output, error);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Projects a synthetic cube into each output layout through the scalar reference (NV12Converter::ProjectCube) and
+// every CpuProjector path the CPU supports, checks that all outputs agree and reports megapixels per second.
+//
+//   ProjectorBenchmark [--face N] [--width N] [--frames N] [--threads N]
+#include "Compute/CpuProjector.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace Compute;
+
+namespace {
+    struct Options {
+        uint32_t faceSize = 1024;
+        uint32_t width = 3840; // Equirect height is half of it; 3x2 layouts keep the same pixels per face edge
+        int frames = 20;
+        uint32_t threads = 0;
+    };
+
+    struct Output {
+        std::vector<uint8_t> y, uv;
+        Output(uint32_t width, uint32_t height) : y((size_t)width * height), uv((size_t)width * height / 2) {}
+    };
+
+    template<typename Project>
+    double MegapixelsPerSecond(int frames, uint32_t width, uint32_t height, Project project) {
+        project(); // Warm the caches and the worker pool
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i) project();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds > 0.0 ? (double)width * height * frames / seconds / 1e6 : 0.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--face") == 0) options.faceSize = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--width") == 0) options.width = (uint32_t)atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--frames") == 0) options.frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0) options.threads = (uint32_t)atoi(argv[i + 1]);
+    }
+    // Even equirect height; the 3x2 layouts use width / 4 as tile edge, even so NV12 chroma covers whole tiles
+    options.width = std::max(8u, options.width & ~3u);
+    uint32_t tile = (options.width / 4) & ~1u;
+
+    // Smooth gradients with noise, so the bilinear filter sees realistic neighbourhoods
+    std::mt19937 rng(1);
+    std::vector<uint8_t> texels[6];
+    NV12Converter::CubeFaces cube;
+    cube.faceSize = options.faceSize;
+    cube.stride = (size_t)options.faceSize * 4;
+    for (int f = 0; f < 6; ++f) {
+        texels[f].resize((size_t)options.faceSize * options.faceSize * 4);
+        for (uint32_t y = 0; y < options.faceSize; ++y) {
+            for (uint32_t x = 0; x < options.faceSize; ++x) {
+                uint8_t* texel = &texels[f][((size_t)y * options.faceSize + x) * 4];
+                texel[0] = (uint8_t)(x * 255 / options.faceSize + (rng() & 7));
+                texel[1] = (uint8_t)(y * 255 / options.faceSize + (rng() & 7));
+                texel[2] = (uint8_t)(f * 40 + (rng() & 7));
+                texel[3] = 255;
+            }
+        }
+        cube.faces[f] = texels[f].data();
+        cube.faceScale[f] = 1.0f;
+    }
+
+    CpuProjector projector(options.threads);
+    printf("Face %u, %d frames, %u threads, best path %s\n", options.faceSize, options.frames, projector.GetThreadCount(),
+           CpuProjector::GetPathName(CpuProjector::GetActivePath()));
+
+    struct Layout {
+        const char* name;
+        ProjectionLayout layout;
+        uint32_t width, height;
+    };
+    const Layout layouts[] = {
+        { "equirect", ProjectionLayout::Equirect, options.width, options.width / 2 },
+        { "cube3x2", ProjectionLayout::Cube3x2, tile * 3, tile * 2 },
+        { "eac3x2", ProjectionLayout::EAC3x2, tile * 3, tile * 2 },
+    };
+
+    std::vector<CpuProjector::Path> paths = { CpuProjector::Path::Scalar };
+    if (CpuProjector::GetActivePath() != CpuProjector::Path::Scalar) paths.push_back(CpuProjector::Path::SSE2);
+    if (CpuProjector::GetActivePath() == CpuProjector::Path::AVX2) paths.push_back(CpuProjector::Path::AVX2);
+
+    int mismatches = 0;
+    for (const Layout& layout : layouts) {
+        uint32_t width = layout.width, height = layout.height;
+        ProjectionLut lut;
+        lut.Build(layout.layout, width, height, 6.2831853f);
+
+        Output reference(width, height);
+        double referenceRate = MegapixelsPerSecond(options.frames, width, height, [&] {
+            NV12Converter::ProjectCube(cube, lut, reference.y.data(), width, reference.uv.data(), width);
+        });
+        printf("%-9s %5ux%-5u reference   %9.1f MP/s\n", layout.name, width, height, referenceRate);
+
+        for (CpuProjector::Path path : paths) {
+            projector.SetPath(path);
+            Output output(width, height);
+            double rate = MegapixelsPerSecond(options.frames, width, height, [&] {
+                projector.ProjectToNV12(cube, lut, output.y.data(), width, output.uv.data(), width);
+            });
+            bool exact = output.y == reference.y && output.uv == reference.uv;
+            if (!exact) mismatches++;
+            printf("%-9s %5ux%-5u %-6s x%-3u %9.1f MP/s %6.1fx%s\n", layout.name, width, height, CpuProjector::GetPathName(path),
+                   projector.GetThreadCount(), rate, referenceRate > 0.0 ? rate / referenceRate : 0.0, exact ? "" : "  MISMATCH");
+        }
+    }
+
+    if (mismatches) {
+        printf("%d outputs differ from the reference\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include "BufferCache.h"
+#include <new>
+
+namespace Camera {
+
+    BufferCache::BufferCache(size_t budgetBytes, uint32_t maxEntries) {
+        if (maxEntries == 0) maxEntries = 1;
+        m_maxEntries = maxEntries;
+
+        // Power-of-two table at least twice the entry pool keeps the load factor <= 0.5
+        uint32_t tableSize = 2;
+        while (tableSize < maxEntries * 2) tableSize <<= 1;
+        m_tableMask = tableSize - 1;
+
+        m_table.assign(tableSize, kInvalid);
+        m_entries.resize(maxEntries);
+        for (uint32_t i = 0; i < maxEntries; ++i) {
+            m_entries[i].nextFree = (i + 1 < maxEntries) ? i + 1 : kInvalid;
+        }
+        m_freeEntry = 0;
+
+        // At least one page per size class so every buffer size stays cacheable
+        m_maxPages = budgetBytes / kPageBytes;
+        if (m_maxPages < kClassCount) m_maxPages = kClassCount;
+        m_pages.reserve(m_maxPages);
+
+        for (uint32_t c = 0; c < kClassCount; ++c) m_partialPages[c] = kInvalid;
+    }
+
+    BufferCache::~BufferCache() {
+        for (Page& page : m_pages) {
+            ::operator delete(page.base, std::align_val_t(64));
+        }
+    }
+
+    uint32_t BufferCache::Hash(uint64_t handle) const {
+        // Handles are pointers; Fibonacci hashing spreads the aligned low bits
+        return (uint32_t)((handle * 0x9E3779B97F4A7C15ull) >> 32) & m_tableMask;
+    }
+
+    uint32_t BufferCache::SizeClassFor(size_t size) {
+        uint32_t sizeClass = 0;
+        while (((size_t)1 << (kMinClassShift + sizeClass)) < size) ++sizeClass;
+        return sizeClass;
+    }
+
+    uint32_t BufferCache::FindSlot(uint64_t handle) const {
+        for (uint32_t slot = Hash(handle);; slot = (slot + 1) & m_tableMask) {
+            uint32_t index = m_table[slot];
+            if (index == kInvalid) return kInvalid;
+            if (m_entries[index].handle == handle) return slot;
+        }
+    }
+
+    ConstantBufferState* BufferCache::Find(uint64_t handle) {
+        uint32_t slot = FindSlot(handle);
+        if (slot == kInvalid) return nullptr;
+
+        Entry& entry = m_entries[m_table[slot]];
+        entry.referenced = true;
+        return &entry.state;
+    }
+
+    ConstantBufferState* BufferCache::FindOrInsert(uint64_t handle) {
+        if (ConstantBufferState* existing = Find(handle)) return existing;
+
+        if (m_freeEntry == kInvalid && !EvictOne(nullptr, false)) return nullptr;
+
+        uint32_t index = m_freeEntry;
+        Entry& entry = m_entries[index];
+        m_freeEntry = entry.nextFree;
+
+        entry.handle = handle;
+        entry.state = ConstantBufferState();
+        entry.referenced = true;
+        entry.nextFree = kInvalid;
+
+        // Load factor stays <= 0.5, so an empty slot always exists
+        uint32_t slot = Hash(handle);
+        while (m_table[slot] != kInvalid) slot = (slot + 1) & m_tableMask;
+        m_table[slot] = index;
+
+        m_stats.entries++;
+        return &entry.state;
+    }
+
+    void BufferCache::RemoveSlot(uint32_t slot) {
+        // Backward-shift deletion keeps probe chains intact without tombstones
+        const uint32_t mask = m_tableMask;
+        uint32_t hole = slot;
+        m_table[hole] = kInvalid;
+
+        for (uint32_t next = (hole + 1) & mask; m_table[next] != kInvalid; next = (next + 1) & mask) {
+            uint32_t ideal = Hash(m_entries[m_table[next]].handle);
+            bool reachable = (hole <= next) ? (hole < ideal && ideal <= next) : (hole < ideal || ideal <= next);
+            if (!reachable) {
+                m_table[hole] = m_table[next];
+                m_table[next] = kInvalid;
+                hole = next;
+            }
+        }
+    }
+
+    void BufferCache::FreeEntry(uint32_t entryIndex) {
+        Entry& entry = m_entries[entryIndex];
+        ReleasePayload(entry.state);
+        entry.handle = 0;
+        entry.state = ConstantBufferState();
+        entry.referenced = false;
+        entry.nextFree = m_freeEntry;
+        m_freeEntry = entryIndex;
+        m_stats.entries--;
+    }
+
+    void BufferCache::Erase(uint64_t handle) {
+        uint32_t slot = FindSlot(handle);
+        if (slot == kInvalid) return;
+
+        uint32_t index = m_table[slot];
+        RemoveSlot(slot);
+        FreeEntry(index);
+        m_stats.purges++;
+    }
+
+    bool BufferCache::EvictOne(const ConstantBufferState* pinned, bool needPayload) {
+        // CLOCK: referenced entries get a second chance. Camera entries age out like any other; the live camera buffer is
+        // updated every frame, so it stays referenced and an evicted one is rescanned on its next update.
+        for (uint32_t step = 0; step < m_maxEntries * 2; ++step) {
+            uint32_t index = m_clockHand;
+            m_clockHand = (m_clockHand + 1) % m_maxEntries;
+
+            Entry& entry = m_entries[index];
+            if (entry.handle == 0 || &entry.state == pinned) continue;
+            if (needPayload && !entry.state.data) continue;
+            if (entry.referenced) {
+                entry.referenced = false;
+                continue;
+            }
+
+            RemoveSlot(FindSlot(entry.handle));
+            FreeEntry(index);
+            m_stats.evictions++;
+            return true;
+        }
+        return false;
+    }
+
+    bool BufferCache::AllocatePayload(ConstantBufferState& state, size_t size) {
+        if (size == 0 || size > kMaxPayloadBytes) {
+            ReleasePayload(state);
+            return false;
+        }
+
+        uint32_t sizeClass = SizeClassFor(size);
+        if (state.data && m_pages[state.payloadPage].sizeClass == (int)sizeClass) {
+            state.size = (uint32_t)size;
+            return true;
+        }
+
+        ReleasePayload(state);
+
+        uint32_t page = kInvalid;
+        uint8_t* block = AllocateBlock(sizeClass, &page, &state);
+        if (!block) return false;
+
+        state.data = block;
+        state.size = (uint32_t)size;
+        state.payloadPage = page;
+        return true;
+    }
+
+    void BufferCache::ReleasePayload(ConstantBufferState& state) {
+        if (!state.data) return;
+        FreeBlock(state.data, state.payloadPage);
+        state.data = nullptr;
+        state.size = 0;
+        state.payloadPage = 0;
+    }
+
+    uint8_t* BufferCache::AllocateBlock(uint32_t sizeClass, uint32_t* outPage, const ConstantBufferState* pinned) {
+        for (;;) {
+            uint32_t pageIndex = m_partialPages[sizeClass];
+            if (pageIndex == kInvalid) pageIndex = AcquirePage(sizeClass);
+
+            if (pageIndex != kInvalid) {
+                Page& page = m_pages[pageIndex];
+                size_t blockSize = (size_t)1 << (kMinClassShift + sizeClass);
+                uint8_t* block = page.base + page.freeHead * blockSize;
+
+                page.freeHead = *(uint32_t*)block;
+                page.used++;
+                if (page.freeHead == kInvalid) UnlinkPartial(pageIndex);
+
+                m_stats.residentBytes += blockSize;
+                *outPage = pageIndex;
+                return block;
+            }
+
+            // Over budget: evict until a block of this class or an empty page frees up
+            if (!EvictOne(pinned, true)) return nullptr;
+        }
+    }
+
+    void BufferCache::FreeBlock(uint8_t* block, uint32_t pageIndex) {
+        Page& page = m_pages[pageIndex];
+        size_t blockSize = (size_t)1 << (kMinClassShift + page.sizeClass);
+
+        *(uint32_t*)block = page.freeHead;
+        page.freeHead = (uint32_t)((block - page.base) / blockSize);
+        if (page.used == page.capacity) LinkPartial(pageIndex);
+        page.used--;
+        m_stats.residentBytes -= blockSize;
+
+        if (page.used == 0) {
+            // Return empty pages to the shared pool so other size classes can reuse them
+            UnlinkPartial(pageIndex);
+            page.sizeClass = -1;
+            page.nextPartial = m_freePage;
+            m_freePage = pageIndex;
+        }
+    }
+
+    uint32_t BufferCache::AcquirePage(uint32_t sizeClass) {
+        uint32_t pageIndex = m_freePage;
+        if (pageIndex != kInvalid) {
+            m_freePage = m_pages[pageIndex].nextPartial;
+        } else {
+            if (m_pages.size() >= m_maxPages) return kInvalid;
+            Page page;
+            page.base = (uint8_t*)::operator new(kPageBytes, std::align_val_t(64));
+            m_pages.push_back(page);
+            pageIndex = (uint32_t)(m_pages.size() - 1);
+            m_stats.committedBytes += kPageBytes;
+        }
+
+        Page& page = m_pages[pageIndex];
+        size_t blockSize = (size_t)1 << (kMinClassShift + sizeClass);
+        page.sizeClass = (int)sizeClass;
+        page.capacity = (uint32_t)(kPageBytes / blockSize);
+        page.used = 0;
+        page.freeHead = 0;
+        for (uint32_t b = 0; b < page.capacity; ++b) {
+            *(uint32_t*)(page.base + b * blockSize) = (b + 1 < page.capacity) ? b + 1 : kInvalid;
+        }
+
+        page.prevPartial = kInvalid;
+        page.nextPartial = kInvalid;
+        LinkPartial(pageIndex);
+        return pageIndex;
+    }
+
+    void BufferCache::LinkPartial(uint32_t pageIndex) {
+        Page& page = m_pages[pageIndex];
+        uint32_t& head = m_partialPages[page.sizeClass];
+        page.prevPartial = kInvalid;
+        page.nextPartial = head;
+        if (head != kInvalid) m_pages[head].prevPartial = pageIndex;
+        head = pageIndex;
+    }
+
+    void BufferCache::UnlinkPartial(uint32_t pageIndex) {
+        Page& page = m_pages[pageIndex];
+        if (page.prevPartial != kInvalid) m_pages[page.prevPartial].nextPartial = page.nextPartial;
+        else m_partialPages[page.sizeClass] = page.nextPartial;
+        if (page.nextPartial != kInvalid) m_pages[page.nextPartial].prevPartial = page.prevPartial;
+        page.prevPartial = kInvalid;
+        page.nextPartial = kInvalid;
+    }
+}
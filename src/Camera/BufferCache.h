@@ -0,0 +1,110 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Camera {
+
+    struct ConstantBufferState {
+        // Shadow copy of the buffer contents, owned by BufferCache (nullptr while negative cached or untracked)
+        uint8_t* data = nullptr;
+        uint32_t size = 0;
+        uint32_t payloadPage = 0;
+
+        bool isCamera = false;
+        int viewMatrixOffset = -1;
+        int projMatrixOffset = -1;
+        bool viewTransposed = false;
+        // Negative cache: buffers without any matrix candidate are skipped for this many updates
+        uint32_t updatesUntilRecheck = 0;
+    };
+
+    struct BufferCacheStats {
+        uint64_t entries = 0;
+        uint64_t residentBytes = 0;  // Payload bytes in use (size-class rounded)
+        uint64_t committedBytes = 0; // Arena pages allocated
+        uint64_t evictions = 0;
+        uint64_t purges = 0;         // Entries dropped because the resource was destroyed
+    };
+
+    // Memory-budgeted shadow cache of constant buffer contents.
+    // Open-addressing hash table (linear probing, backward-shift deletion) keyed by resource handle, fixed entry pool,
+    // payloads in power-of-two size classes carved from 64 KB arena pages. When the entry pool or the page budget is
+    // exhausted, entries are evicted in CLOCK order. Not thread-safe; callers serialize access.
+    class BufferCache {
+    public:
+        static constexpr size_t kMaxPayloadBytes = 65536; // D3D11 constant buffer limit (4096 * 16 bytes)
+        static constexpr size_t kDefaultBudgetBytes = 32 * 1024 * 1024;
+        static constexpr uint32_t kDefaultMaxEntries = 16384;
+
+        explicit BufferCache(size_t budgetBytes = kDefaultBudgetBytes, uint32_t maxEntries = kDefaultMaxEntries);
+        ~BufferCache();
+
+        BufferCache(const BufferCache&) = delete;
+        BufferCache& operator=(const BufferCache&) = delete;
+
+        ConstantBufferState* Find(uint64_t handle);
+        // Returns nullptr when the entry pool is full and nothing can be evicted
+        ConstantBufferState* FindOrInsert(uint64_t handle);
+
+        // (Re)allocates state.data for size bytes, evicting other entries if needed.
+        // Returns false (state left without payload) if size exceeds kMaxPayloadBytes or the budget cannot be met.
+        bool AllocatePayload(ConstantBufferState& state, size_t size);
+        void ReleasePayload(ConstantBufferState& state);
+
+        // Drops the entry and its payload immediately (resource destruction)
+        void Erase(uint64_t handle);
+
+        BufferCacheStats GetStats() const { return m_stats; }
+
+    private:
+        static constexpr size_t kPageBytes = 65536;
+        static constexpr uint32_t kMinClassShift = 6; // 64 bytes
+        static constexpr uint32_t kClassCount = 11;   // 64 B .. 64 KB
+        static constexpr uint32_t kInvalid = 0xFFFFFFFF;
+
+        struct Entry {
+            uint64_t handle = 0;
+            ConstantBufferState state;
+            bool referenced = false;
+            uint32_t nextFree = kInvalid;
+        };
+
+        struct Page {
+            uint8_t* base = nullptr;
+            int sizeClass = -1;   // -1 while in the free page pool
+            uint32_t used = 0;
+            uint32_t capacity = 0;
+            uint32_t freeHead = kInvalid; // Block index; next index is stored in the free block itself
+            uint32_t prevPartial = kInvalid;
+            uint32_t nextPartial = kInvalid;
+        };
+
+        uint32_t Hash(uint64_t handle) const;
+        static uint32_t SizeClassFor(size_t size);
+        uint32_t FindSlot(uint64_t handle) const;
+        void RemoveSlot(uint32_t slot);
+        void FreeEntry(uint32_t entryIndex);
+        bool EvictOne(const ConstantBufferState* pinned, bool needPayload);
+
+        uint8_t* AllocateBlock(uint32_t sizeClass, uint32_t* outPage, const ConstantBufferState* pinned);
+        void FreeBlock(uint8_t* block, uint32_t pageIndex);
+        uint32_t AcquirePage(uint32_t sizeClass);
+        void LinkPartial(uint32_t pageIndex);
+        void UnlinkPartial(uint32_t pageIndex);
+
+        std::vector<uint32_t> m_table;  // Entry index per slot, kInvalid when empty
+        std::vector<Entry> m_entries;   // Fixed pool, stable addresses
+        uint32_t m_maxEntries = 0;
+        uint32_t m_tableMask = 0;
+        uint32_t m_freeEntry = kInvalid;
+        uint32_t m_clockHand = 0;
+
+        std::vector<Page> m_pages;
+        size_t m_maxPages = 0;
+        uint32_t m_freePage = kInvalid;                // Pool of empty pages (linked through nextPartial)
+        uint32_t m_partialPages[kClassCount];          // Pages with free blocks, per size class
+
+        BufferCacheStats m_stats;
+    };
+}
@@ -0,0 +1,123 @@
+#include "BufferScanner.h"
+#include "MatrixScanner.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Camera {
+
+    bool BufferScanner::Update(BufferCache& cache, ConstantBufferState& state, ScanStats& stats, const void* data, size_t size) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        const float* floatData = (const float*)data;
+        size_t floatCount = size / sizeof(float);
+        size_t candidateEnd = floatCount - 16 + 1; // Exclusive end for candidate float offsets
+        uint64_t windowCount = (candidateEnd + 3) / 4;
+
+        stats.updates++;
+        stats.windowsTotal += windowCount;
+
+        // Negative cache: buffers that had no candidates are only rechecked every kNegativeRecheckInterval updates.
+        // Their shadow copy is dropped meanwhile, so the recheck always becomes a full scan.
+        if (state.updatesUntilRecheck > 0) {
+            state.updatesUntilRecheck--;
+            stats.negativeCacheHits++;
+            return false;
+        }
+
+        // Find the dirty byte range by diffing against the cached copy in kDirtyWindowBytes windows.
+        // Only the changed windows are copied into the cache.
+        bool fullScan = (!state.data || state.size != size);
+        size_t dirtyBegin = 0;
+        size_t dirtyEnd = size;
+
+        if (fullScan) {
+            state.viewMatrixOffset = -1;
+            state.projMatrixOffset = -1;
+            state.isCamera = false;
+            if (!cache.AllocatePayload(state, size)) return false; // Over budget, stays untracked
+            memcpy(state.data, bytes, size);
+        } else {
+            uint8_t* shadow = state.data;
+            dirtyBegin = size;
+            dirtyEnd = 0;
+            for (size_t w = 0; w < size; w += kDirtyWindowBytes) {
+                size_t n = std::min(kDirtyWindowBytes, size - w);
+                if (memcmp(shadow + w, bytes + w, n) != 0) {
+                    memcpy(shadow + w, bytes + w, n);
+                    if (dirtyBegin > w) dirtyBegin = w;
+                    dirtyEnd = w + n;
+                }
+            }
+        }
+
+        if (dirtyBegin < dirtyEnd) {
+            // Candidate offsets (in floats) whose 64-byte matrix overlaps the dirty range
+            size_t scanBegin = fullScan ? 0 : (dirtyBegin >= 48 ? (dirtyBegin - 48) / sizeof(float) : 0);
+            size_t scanEnd = fullScan ? candidateEnd : std::min(candidateEnd, (dirtyEnd + sizeof(float) - 1) / sizeof(float));
+            if (fullScan) stats.fullScans++;
+
+            // Offsets keep "first match in buffer" semantics: an existing hit is revalidated if its window changed
+            // (falling back to a full rescan when it no longer matches), otherwise only lower dirty offsets can replace it.
+            auto isDirty = [&](int offset) {
+                return offset >= 0 && (size_t)offset >= scanBegin && (size_t)offset < scanEnd;
+            };
+
+            if (isDirty(state.viewMatrixOffset)) {
+                bool transposed = false;
+                stats.windowsScanned++;
+                if (MatrixScanner::IsViewMatrix(floatData + state.viewMatrixOffset, &transposed)) {
+                    state.viewTransposed = transposed;
+                    int lower = FindViewMatrix(stats, floatData, scanBegin, (size_t)state.viewMatrixOffset, &transposed);
+                    if (lower >= 0) { state.viewMatrixOffset = lower; state.viewTransposed = transposed; }
+                } else {
+                    state.viewMatrixOffset = FindViewMatrix(stats, floatData, 0, candidateEnd, &transposed);
+                    state.viewTransposed = transposed;
+                }
+            } else {
+                bool transposed = false;
+                size_t end = state.viewMatrixOffset >= 0 ? std::min(scanEnd, (size_t)state.viewMatrixOffset) : scanEnd;
+                int found = FindViewMatrix(stats, floatData, scanBegin, end, &transposed);
+                if (found >= 0) { state.viewMatrixOffset = found; state.viewTransposed = transposed; }
+            }
+
+            if (isDirty(state.projMatrixOffset)) {
+                stats.windowsScanned++;
+                if (MatrixScanner::IsProjectionMatrix(floatData + state.projMatrixOffset)) {
+                    int lower = FindProjectionMatrix(stats, floatData, scanBegin, (size_t)state.projMatrixOffset);
+                    if (lower >= 0) state.projMatrixOffset = lower;
+                } else {
+                    state.projMatrixOffset = FindProjectionMatrix(stats, floatData, 0, candidateEnd);
+                }
+            } else {
+                size_t end = state.projMatrixOffset >= 0 ? std::min(scanEnd, (size_t)state.projMatrixOffset) : scanEnd;
+                int found = FindProjectionMatrix(stats, floatData, scanBegin, end);
+                if (found >= 0) state.projMatrixOffset = found;
+            }
+
+            state.isCamera = (state.viewMatrixOffset >= 0 || state.projMatrixOffset >= 0);
+            if (!state.isCamera) {
+                state.updatesUntilRecheck = kNegativeRecheckInterval;
+                cache.ReleasePayload(state);
+                return false;
+            }
+        }
+        return dirtyBegin < dirtyEnd;
+    }
+
+    int BufferScanner::FindViewMatrix(ScanStats& stats, const float* data, size_t beginFloat, size_t endFloat, bool* outIsTransposed) {
+        int found = MatrixScanner::FindViewMatrix(data, beginFloat, endFloat, outIsTransposed);
+        stats.windowsScanned += CountWindows(beginFloat, found >= 0 ? (size_t)found + 1 : endFloat);
+        return found;
+    }
+
+    int BufferScanner::FindProjectionMatrix(ScanStats& stats, const float* data, size_t beginFloat, size_t endFloat) {
+        int found = MatrixScanner::FindProjectionMatrix(data, beginFloat, endFloat);
+        stats.windowsScanned += CountWindows(beginFloat, found >= 0 ? (size_t)found + 1 : endFloat);
+        return found;
+    }
+
+    uint64_t BufferScanner::CountWindows(size_t beginFloat, size_t endFloat) {
+        size_t first = (beginFloat + 3) / 4;
+        size_t last = (endFloat + 3) / 4;
+        return last > first ? last - first : 0;
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "BufferCache.h"
+
+namespace Camera {
+
+    // Counters for the incremental scanner (candidate windows = 4-float aligned 64-byte matrix positions)
+    struct ScanStats {
+        uint64_t updates = 0;
+        uint64_t fullScans = 0;
+        uint64_t negativeCacheHits = 0;
+        uint64_t windowsTotal = 0;   // Windows a full rescan of every update would have tested
+        uint64_t windowsScanned = 0; // Windows actually tested
+    };
+
+    // Incremental view/projection matrix search over constant buffer updates. Each update is diffed against the
+    // buffer's shadow copy in 64-byte windows and only candidates overlapping changed windows are tested; buffers
+    // without any candidate are negative cached.
+    class BufferScanner {
+    public:
+        // Dirty tracking granularity (one matrix) and negative cache recheck period (in updates)
+        static constexpr size_t kDirtyWindowBytes = 64;
+        static constexpr uint32_t kNegativeRecheckInterval = 256;
+
+        // Applies an update of size bytes (64 .. BufferCache::kMaxPayloadBytes) to the buffer's state and shadow copy.
+        // Returns true when the contents changed; state.isCamera tells whether a matrix is tracked.
+        static bool Update(BufferCache& cache, ConstantBufferState& state, ScanStats& stats, const void* data, size_t size);
+
+        // Returns the first matching float offset in [beginFloat, endFloat) stepping by 4, or -1
+        static int FindViewMatrix(ScanStats& stats, const float* data, size_t beginFloat, size_t endFloat, bool* outIsTransposed);
+        static int FindProjectionMatrix(ScanStats& stats, const float* data, size_t beginFloat, size_t endFloat);
+        static uint64_t CountWindows(size_t beginFloat, size_t endFloat);
+    };
+}
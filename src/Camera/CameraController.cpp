@@ -1,186 +1,232 @@
-#include "pch.h"
 #include "CameraController.h"
+#include "MatrixScanner.h"
+#include "FacePayloads.h"
 #include "../Core/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 namespace Camera {
 
-    CameraController::CameraController() {}
+    CameraController::CameraController() {
+        LOG_INFO("Matrix scanner path: ", MatrixScanner::GetPathName(MatrixScanner::GetActivePath()));
+    }
 
-    void CameraController::OnUpdateBuffer(reshade::api::resource resource, const void* data, uint64_t size) {
+    void CameraController::OnUpdateBuffer(uint64_t handle, const void* data, uint64_t size) {
         if (size < 64) return; // Too small for a matrix
+        if (size > BufferCache::kMaxPayloadBytes) return; // Larger than any constant buffer
 
-        std::lock_guard<std::mutex> lock(m_mutex);
-        
-        uint64_t handle = resource.handle;
-        auto& state = m_bufferCache[handle];
-        
-        // Update cache
-        if (state.data.size() != size) state.data.resize(size);
-        memcpy(state.data.data(), data, size);
-
-        const float* floatData = (const float*)data;
-        size_t floatCount = size / sizeof(float);
-
-        // Heuristic detection if not already detected
-        // Note: In ReShade we might want to re-verify occasionally, but for now stick to "once detected, stick to it"
-        // unless we want to support camera switching. Let's re-scan if it *was* a camera to update matrices.
-        
-        bool foundView = false;
-        bool foundProj = false;
-
-        // Scan for View Matrix
-        for (size_t i = 0; i <= floatCount - 16; i += 4) {
-            bool transposed = false;
-            if (IsViewMatrix(floatData + i, &transposed)) {
-                state.viewMatrixOffset = (int)i;
-                state.isCamera = true;
-
-                m_isTransposed = transposed;
-                DirectX::XMMATRIX viewMat = DirectX::XMLoadFloat4x4((const DirectX::XMFLOAT4X4*)(floatData + i));
-                if (transposed) viewMat = DirectX::XMMatrixTranspose(viewMat);
-
-                m_lastGameView = viewMat;
-
-                if (!m_upDetected) {
-                    DetectWorldUp(viewMat);
-                }
+        Shard& shard = GetShard(handle);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        ConstantBufferState* cached = shard.cache.FindOrInsert(handle);
+        if (!cached) return; // Nothing evictable
+        auto& state = *cached;
+
+        bool changed = BufferScanner::Update(shard.cache, state, shard.stats, data, (size_t)size);
+
+        // Publish on content changes, and when another camera buffer was active so the most recently updated one wins
+        if (state.isCamera && (changed || m_cameraHandle.load(std::memory_order_relaxed) != handle)) {
+            PublishCameraState(state, handle);
+        }
+    }
+
+    CameraController::Shard& CameraController::GetShard(uint64_t handle) {
+        // Top bits of a Fibonacci hash; BufferCache uses lower bits of the same product for its table
+        return m_shards[(handle * 0x9E3779B97F4A7C15ull) >> 60];
+    }
+
+    void CameraController::PublishCameraState(const ConstantBufferState& state, uint64_t handle) {
+        const float* floatData = (const float*)state.data;
+
+        std::lock_guard<std::mutex> lock(m_publishMutex);
 
-                m_cameraBuffer = resource; // Set as active camera buffer
-                foundView = true;
-                break; // Assume one view matrix per buffer for simplicity
+        if (state.viewMatrixOffset >= 0) {
+            m_camera.isTransposed = state.viewTransposed;
+            Float4x4 viewMat;
+            memcpy(&viewMat, floatData + state.viewMatrixOffset, sizeof(viewMat));
+            if (state.viewTransposed) viewMat = MatrixMath::Transpose(viewMat);
+
+            m_camera.view = viewMat;
+
+            if (!m_camera.upDetected) {
+                DetectWorldUp(viewMat, m_camera);
             }
         }
 
-        // Scan for Projection Matrix
-        for (size_t i = 0; i <= floatCount - 16; i += 4) {
-            if (IsProjectionMatrix(floatData + i)) {
-                state.projMatrixOffset = (int)i;
-                state.isCamera = true;
+        if (state.projMatrixOffset >= 0) {
+            m_camera.isRH = IsRightHandedProjection(floatData + state.projMatrixOffset);
+            memcpy(&m_camera.proj, floatData + state.projMatrixOffset, sizeof(m_camera.proj));
+        }
+
+        m_camera.bufferHandle = handle; // Set as active camera buffer
+        m_camera.version++;
+        m_snapshot.Write(m_camera);
+        m_cameraHandle.store(handle, std::memory_order_release);
+    }
 
-                m_isRH = IsRightHandedProjection(floatData + i);
-                m_lastGameProj = DirectX::XMLoadFloat4x4((const DirectX::XMFLOAT4X4*)(floatData + i));
+    void CameraController::OnDestroyResource(uint64_t handle) {
+        {
+            Shard& shard = GetShard(handle);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.cache.Erase(handle);
+        }
 
-                m_cameraBuffer = resource;
-                foundProj = true;
-                break;
+        if (m_cameraHandle.load(std::memory_order_acquire) == handle) {
+            std::lock_guard<std::mutex> lock(m_publishMutex);
+            if (m_camera.bufferHandle == handle) {
+                m_camera.bufferHandle = 0;
+                m_camera.version++;
+                m_snapshot.Write(m_camera);
+                m_cameraHandle.store(0, std::memory_order_release);
             }
         }
     }
 
-    bool CameraController::GetModifiedBufferData(CubeFace face, std::vector<uint8_t>& outputData) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_cameraBuffer.handle == 0) return false;
+    BufferCacheStats CameraController::GetCacheStats() {
+        BufferCacheStats total;
+        for (Shard& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            BufferCacheStats stats = shard.cache.GetStats();
+            total.entries += stats.entries;
+            total.residentBytes += stats.residentBytes;
+            total.committedBytes += stats.committedBytes;
+            total.evictions += stats.evictions;
+            total.purges += stats.purges;
+        }
+        return total;
+    }
 
-        auto it = m_bufferCache.find(m_cameraBuffer.handle);
-        if (it == m_bufferCache.end()) return false;
+    ScanStats CameraController::GetScanStats() {
+        ScanStats total;
+        for (Shard& shard : m_shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total.updates += shard.stats.updates;
+            total.fullScans += shard.stats.fullScans;
+            total.negativeCacheHits += shard.stats.negativeCacheHits;
+            total.windowsTotal += shard.stats.windowsTotal;
+            total.windowsScanned += shard.stats.windowsScanned;
+        }
+        return total;
+    }
 
-        auto& state = it->second;
-        outputData = state.data; // Copy original data
+    bool CameraController::BuildFacePayloads(FacePayloads& payloads) {
+        CameraSnapshot camera = m_snapshot.Read();
+        if (camera.bufferHandle == 0) return false;
 
-        float* outFloats = (float*)outputData.data();
-        size_t floatCount = outputData.size() / sizeof(float);
+        Shard& shard = GetShard(camera.bufferHandle);
+        std::lock_guard<std::mutex> lock(shard.mutex);
 
-        // Replace View Matrix
-        if (state.viewMatrixOffset >= 0 && (size_t)(state.viewMatrixOffset + 16) <= floatCount) {
-            DirectX::XMMATRIX newView = GetViewMatrixForFace(face);
-            if (m_isTransposed) newView = DirectX::XMMatrixTranspose(newView);
+        // Publishing happens under the same shard lock, so a re-read now matches the shadow copy exactly
+        camera = m_snapshot.Read();
+        if (&GetShard(camera.bufferHandle) != &shard) return false; // Camera moved to another buffer meanwhile
 
-            DirectX::XMStoreFloat4x4((DirectX::XMFLOAT4X4*)(outFloats + state.viewMatrixOffset), newView);
+        ConstantBufferState* cached = shard.cache.Find(camera.bufferHandle);
+        if (!cached || !cached->data) return false;
+
+        auto& state = *cached;
+        payloads.Prepare(state.size);
+
+        // Matrices are identical for every draw of this version; build them once (skipped faces are left stale)
+        const uint32_t activeFaces = payloads.GetActiveFaces();
+        Float4x4 faceViews[FacePayloads::kFaceCount];
+        if (state.viewMatrixOffset >= 0) {
+            for (uint32_t i = 0; i < FacePayloads::kFaceCount; ++i) {
+                if ((activeFaces & (1u << i)) == 0) continue;
+                Float4x4 newView = BuildViewMatrixForFace((CubeFace)i, camera);
+                faceViews[i] = camera.isTransposed ? MatrixMath::Transpose(newView) : newView;
+            }
+        }
+
+        // Force 90 degree FOV
+        Float4x4 faceProj = MatrixMath::PerspectiveFov(MatrixMath::kPiDiv2, 1.0f, 0.1f, 1000.0f, camera.isRH);
+
+        // Clip-to-clip transforms for single-pass rendering: undo the game view/projection, apply the face view and 90 degree projection
+        payloads.m_hasFaceClip = false;
+        if (state.viewMatrixOffset >= 0 && state.projMatrixOffset >= 0) {
+            float det;
+            Float4x4 invProj = MatrixMath::Inverse(camera.proj, &det);
+            if (std::abs(det) > 1e-12f) {
+                Float4x4 invView = MatrixMath::Inverse(camera.view, &det);
+                Float4x4 clipToWorld = MatrixMath::Multiply(invProj, invView);
+                for (uint32_t i = 0; i < FacePayloads::kFaceCount; ++i) {
+                    if ((activeFaces & (1u << i)) == 0) continue;
+                    Float4x4 faceView = BuildViewMatrixForFace((CubeFace)i, camera);
+                    payloads.m_faceClip[i] = MatrixMath::Multiply(clipToWorld, MatrixMath::Multiply(faceView, faceProj));
+                }
+                payloads.m_hasFaceClip = true;
+            }
         }
 
-        // Replace Projection Matrix (Force 90 degree FOV)
-        if (state.projMatrixOffset >= 0 && (size_t)(state.projMatrixOffset + 16) <= floatCount) {
-            DirectX::XMMATRIX newProj;
-            if (m_isRH) {
-                newProj = DirectX::XMMatrixPerspectiveFovRH(DirectX::XM_PIDIV2, 1.0f, 0.1f, 1000.0f);
-            } else {
-                newProj = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, 0.1f, 1000.0f);
+        for (uint32_t i = 0; i < FacePayloads::kFaceCount; ++i) {
+            if ((activeFaces & (1u << i)) == 0) continue;
+            uint8_t* face = payloads.GetFaceData(i);
+            memcpy(face, state.data, state.size);
+
+            float* outFloats = (float*)face;
+            if (state.viewMatrixOffset >= 0) {
+                memcpy(outFloats + state.viewMatrixOffset, &faceViews[i], sizeof(faceViews[i]));
+            }
+            if (state.projMatrixOffset >= 0) {
+                memcpy(outFloats + state.projMatrixOffset, &faceProj, sizeof(faceProj));
             }
-            DirectX::XMStoreFloat4x4((DirectX::XMFLOAT4X4*)(outFloats + state.projMatrixOffset), newProj);
         }
 
+        payloads.m_generation = camera.version;
         return true;
     }
 
-    DirectX::XMMATRIX CameraController::GetViewMatrixForFace(CubeFace face) {
-        DirectX::XMVECTOR det;
-        DirectX::XMMATRIX invView = DirectX::XMMatrixInverse(&det, m_lastGameView);
-        DirectX::XMVECTOR eyePos = invView.r[3];
+    Float4x4 CameraController::GetViewMatrixForFace(CubeFace face) {
+        return BuildViewMatrixForFace(face, m_snapshot.Read());
+    }
+
+    Float4x4 CameraController::BuildViewMatrixForFace(CubeFace face, const CameraSnapshot& camera) {
+        float det;
+        Float4x4 invView = MatrixMath::Inverse(camera.view, &det);
+        Float4 eyePos = { invView.m[3][0], invView.m[3][1], invView.m[3][2], invView.m[3][3] };
+        Float4 worldUp = camera.worldUp;
 
-        bool isZUp = (std::abs(DirectX::XMVectorGetZ(m_worldUp)) > 0.9f);
+        bool isZUp = (std::abs(worldUp.z) > 0.9f);
 
-        DirectX::XMVECTOR vRight, vLeft, vUp, vDown, vFront, vBack;
+        Float4 vRight, vLeft, vUp, vDown, vFront, vBack;
 
         if (isZUp) {
              // Z-Up System
-             vRight = DirectX::XMVectorSet(1, 0, 0, 0);
-             vLeft  = DirectX::XMVectorSet(-1, 0, 0, 0);
-             vUp    = DirectX::XMVectorSet(0, 0, 1, 0);
-             vDown  = DirectX::XMVectorSet(0, 0, -1, 0);
-             vFront = DirectX::XMVectorSet(0, 1, 0, 0);
-             vBack  = DirectX::XMVectorSet(0, -1, 0, 0);
+             vRight = { 1, 0, 0, 0 };
+             vLeft  = { -1, 0, 0, 0 };
+             vUp    = { 0, 0, 1, 0 };
+             vDown  = { 0, 0, -1, 0 };
+             vFront = { 0, 1, 0, 0 };
+             vBack  = { 0, -1, 0, 0 };
         } else {
              // Y-Up System
-             vRight = DirectX::XMVectorSet(1, 0, 0, 0);
-             vLeft  = DirectX::XMVectorSet(-1, 0, 0, 0);
-             vUp    = DirectX::XMVectorSet(0, 1, 0, 0);
-             vDown  = DirectX::XMVectorSet(0, -1, 0, 0);
-             if (m_isRH) {
-                 vFront = DirectX::XMVectorSet(0, 0, -1, 0);
-                 vBack  = DirectX::XMVectorSet(0, 0, 1, 0);
+             vRight = { 1, 0, 0, 0 };
+             vLeft  = { -1, 0, 0, 0 };
+             vUp    = { 0, 1, 0, 0 };
+             vDown  = { 0, -1, 0, 0 };
+             if (camera.isRH) {
+                 vFront = { 0, 0, -1, 0 };
+                 vBack  = { 0, 0, 1, 0 };
              } else {
-                 vFront = DirectX::XMVectorSet(0, 0, 1, 0);
-                 vBack  = DirectX::XMVectorSet(0, 0, -1, 0);
+                 vFront = { 0, 0, 1, 0 };
+                 vBack  = { 0, 0, -1, 0 };
              }
         }
 
-        DirectX::XMVECTOR targetDir;
-        DirectX::XMVECTOR upDir = m_worldUp;
+        Float4 targetDir = vFront;
+        Float4 upDir = worldUp;
 
         switch (face) {
             case CubeFace::Right: targetDir = vRight; break;
             case CubeFace::Left:  targetDir = vLeft; break;
             case CubeFace::Up:    targetDir = vUp; upDir = vFront; break;
-            case CubeFace::Down:  targetDir = vDown; upDir = DirectX::XMVectorNegate(vFront); break;
+            case CubeFace::Down:  targetDir = vDown; upDir = { -vFront.x, -vFront.y, -vFront.z, 0 }; break;
             case CubeFace::Front: targetDir = vFront; break;
             case CubeFace::Back:  targetDir = vBack; break;
         }
 
-        if (m_isRH) return DirectX::XMMatrixLookAtRH(eyePos, DirectX::XMVectorAdd(eyePos, targetDir), upDir);
-        else        return DirectX::XMMatrixLookAtLH(eyePos, DirectX::XMVectorAdd(eyePos, targetDir), upDir);
-    }
-
-    bool CameraController::IsProjectionMatrix(const float* data) {
-        const float epsilon = 0.1f;
-        // Check for projection patterns (0s in specific spots)
-        // [ x 0 0 0 ]
-        // [ 0 x 0 0 ]
-        // [ 0 0 x x ]
-        // [ 0 0 x 0 ]
-        if (std::abs(data[1]) > epsilon || std::abs(data[2]) > epsilon || std::abs(data[3]) > epsilon) return false;
-        if (std::abs(data[4]) > epsilon || std::abs(data[6]) > epsilon || std::abs(data[7]) > epsilon) return false;
-        if (std::abs(data[15]) > epsilon) return false;
-        
-        // Check w components
-        if (std::abs(data[11] - 1.0f) > epsilon && std::abs(data[11] + 1.0f) > epsilon) return false;
-
-        return true;
-    }
-
-    bool CameraController::IsViewMatrix(const float* data, bool* outIsTransposed) {
-        const float epsilon = 0.1f;
-        // Row Major: [x x x 0], [x x x 0], [x x x 0], [x x x 1]
-        bool rowMajor = (std::abs(data[3]) < epsilon && std::abs(data[7]) < epsilon && std::abs(data[11]) < epsilon && std::abs(data[15] - 1.0f) < epsilon);
-        // Col Major (Transposed): [x x x x], [x x x x], [x x x x], [0 0 0 1]
-        bool colMajor = (std::abs(data[12]) < epsilon && std::abs(data[13]) < epsilon && std::abs(data[14]) < epsilon && std::abs(data[15] - 1.0f) < epsilon);
-
-        if (outIsTransposed) *outIsTransposed = colMajor;
-
-        // To distinguish from World Matrix, we check if it is orthogonal (rotation part).
-        // View Matrix rotation part is orthogonal. World Matrix can be scaled.
-        // For now, heuristic is weak but matches original code intent.
-
-        return rowMajor || colMajor;
+        Float4 focus = { eyePos.x + targetDir.x, eyePos.y + targetDir.y, eyePos.z + targetDir.z, eyePos.w };
+        return MatrixMath::LookAt(eyePos, focus, upDir, camera.isRH);
     }
 
     bool CameraController::IsRightHandedProjection(const float* data) {
@@ -188,24 +234,23 @@ namespace Camera {
         return (data[11] < -0.9f);
     }
 
-    void CameraController::DetectWorldUp(DirectX::XMMATRIX viewMat) {
-        DirectX::XMVECTOR det;
-        DirectX::XMMATRIX invView = DirectX::XMMatrixInverse(&det, viewMat);
-        DirectX::XMVECTOR up = invView.r[1];
-        up = DirectX::XMVector3Normalize(up);
+    void CameraController::DetectWorldUp(const Float4x4& viewMat, CameraSnapshot& camera) {
+        float det;
+        Float4x4 invView = MatrixMath::Inverse(viewMat, &det);
 
-        float y = DirectX::XMVectorGetY(up);
-        float z = DirectX::XMVectorGetZ(up);
+        // Only the sign and relative size of the components matter, so the up row needs no normalizing
+        float y = invView.m[1][1];
+        float z = invView.m[1][2];
 
         if (std::abs(z) > std::abs(y)) {
-            if (z > 0) m_worldUp = DirectX::XMVectorSet(0, 0, 1, 0);
-            else       m_worldUp = DirectX::XMVectorSet(0, 0, -1, 0);
+            if (z > 0) camera.worldUp = { 0, 0, 1, 0 };
+            else       camera.worldUp = { 0, 0, -1, 0 };
             LOG_INFO("Detected Z-Up World");
         } else {
-            if (y > 0) m_worldUp = DirectX::XMVectorSet(0, 1, 0, 0);
-            else       m_worldUp = DirectX::XMVectorSet(0, -1, 0, 0);
+            if (y > 0) camera.worldUp = { 0, 1, 0, 0 };
+            else       camera.worldUp = { 0, -1, 0, 0 };
             LOG_INFO("Detected Y-Up World");
         }
-        m_upDetected = true;
+        camera.upDetected = true;
     }
 }
@@ -1,10 +1,11 @@
 #pragma once
-#include <reshade.hpp>
-#include <d3d11.h>
-#include <DirectXMath.h>
 #include <vector>
 #include <mutex>
-#include <map>
+#include <atomic>
+#include "BufferCache.h"
+#include "BufferScanner.h"
+#include "MatrixMath.h"
+#include "../Core/SeqLock.h"
 
 namespace Camera {
 
@@ -17,44 +18,66 @@ namespace Camera {
         Back = 5
     };
 
-    struct ConstantBufferState {
-        std::vector<uint8_t> data;
-        bool isCamera = false;
-        int viewMatrixOffset = -1;
-        int projMatrixOffset = -1;
+    // Camera state published to readers (render thread) through a SeqLock, so they never take a lock
+    struct CameraSnapshot {
+        uint64_t bufferHandle = 0;
+        uint64_t version = 0; // Bumped whenever the active camera buffer or its contents change
+        Float4x4 view = {};
+        Float4x4 proj = {};
+        Float4 worldUp = { 0, 1, 0, 0 };
+        bool upDetected = false;
+        bool isRH = false; // Right-Handed
+        bool isTransposed = false; // Matrix layout in buffer
     };
 
+    class FacePayloads;
+
+    // Tracks constant buffer updates by resource handle (reshade::api::resource::handle) and publishes the detected
+    // camera. Has no graphics API dependency, so it builds and is tested on any platform.
     class CameraController {
     public:
         CameraController();
         
-        void OnUpdateBuffer(reshade::api::resource resource, const void* data, uint64_t size);
+        void OnUpdateBuffer(uint64_t handle, const void* data, uint64_t size);
+        void OnDestroyResource(uint64_t handle);
         
-        // Returns the handle of the buffer detected as the camera constant buffer
-        reshade::api::resource GetCameraBuffer() const { return m_cameraBuffer; }
+        // Returns the handle of the buffer detected as the camera constant buffer (lock-free)
+        uint64_t GetCameraBuffer() const { return m_cameraHandle.load(std::memory_order_acquire); }
+        CameraSnapshot GetSnapshot() const { return m_snapshot.Read(); }
         
         // Calculates the View Matrix for a specific face based on the last detected game view
-        DirectX::XMMATRIX GetViewMatrixForFace(CubeFace face);
+        Float4x4 GetViewMatrixForFace(CubeFace face);
+
+        // Builds all six face copies of the camera buffer (view/projection replaced) from one consistent snapshot.
+        // Returns false if no camera buffer is tracked.
+        bool BuildFacePayloads(FacePayloads& payloads);
 
-        // Fills the provided buffer with the modified constant buffer data for the given face
-        // Returns true if successful (and outputData is filled)
-        bool GetModifiedBufferData(CubeFace face, std::vector<uint8_t>& outputData);
+        ScanStats GetScanStats();
+        BufferCacheStats GetCacheStats();
 
     private:
-        bool IsProjectionMatrix(const float* data);
-        bool IsViewMatrix(const float* data, bool* outIsTransposed);
-        bool IsRightHandedProjection(const float* data);
-        void DetectWorldUp(DirectX::XMMATRIX viewMat);
-
-        reshade::api::resource m_cameraBuffer = { 0 };
-        std::mutex m_mutex;
-        std::map<uint64_t, ConstantBufferState> m_bufferCache; // Key is resource handle value
-
-        DirectX::XMMATRIX m_lastGameView;
-        DirectX::XMMATRIX m_lastGameProj;
-        DirectX::XMVECTOR m_worldUp = DirectX::XMVectorSet(0, 1, 0, 0);
-        bool m_upDetected = false;
-        bool m_isRH = false; // Right-Handed
-        bool m_isTransposed = false; // Matrix layout in buffer
+        // Buffer state is split across independently locked shards so updates from different threads rarely collide
+        static constexpr uint32_t kShardCount = 16;
+
+        struct alignas(64) Shard {
+            std::mutex mutex;
+            BufferCache cache{ BufferCache::kDefaultBudgetBytes / kShardCount, BufferCache::kDefaultMaxEntries / kShardCount };
+            ScanStats stats;
+        };
+
+        Shard& GetShard(uint64_t handle);
+
+        void PublishCameraState(const ConstantBufferState& state, uint64_t handle);
+
+        static Float4x4 BuildViewMatrixForFace(CubeFace face, const CameraSnapshot& camera);
+        static bool IsRightHandedProjection(const float* data);
+        static void DetectWorldUp(const Float4x4& viewMat, CameraSnapshot& camera);
+
+        Shard m_shards[kShardCount];
+
+        std::mutex m_publishMutex;          // Serializes camera writers
+        CameraSnapshot m_camera;            // Writer-side state, guarded by m_publishMutex
+        SeqLock<CameraSnapshot> m_snapshot; // Reader-side copy
+        std::atomic<uint64_t> m_cameraHandle{ 0 };
     };
 }
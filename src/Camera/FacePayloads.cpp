@@ -0,0 +1,29 @@
+#include "FacePayloads.h"
+#include <new>
+
+namespace Camera {
+
+    FacePayloads::~FacePayloads() {
+        if (m_storage) ::operator delete(m_storage, std::align_val_t(kAlignment));
+    }
+
+    bool FacePayloads::Refresh(CameraController& controller) {
+        if (m_generation != 0 && controller.GetSnapshot().version == m_generation) return true;
+
+        if (!controller.BuildFacePayloads(*this)) {
+            m_generation = 0;
+            return false;
+        }
+        m_rebuilds++;
+        return true;
+    }
+
+    uint8_t* FacePayloads::Prepare(uint32_t size) {
+        if (!m_storage) {
+            m_storage = (uint8_t*)::operator new(kFaceCount * BufferCache::kMaxPayloadBytes, std::align_val_t(kAlignment));
+        }
+        m_size = size;
+        m_stride = (uint32_t)((size + kAlignment - 1) & ~(kAlignment - 1));
+        return m_storage;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "CameraController.h"
+
+namespace Camera {
+
+    // The six per-face copies of the camera constant buffer (view/projection patched), rebuilt only when the
+    // published camera version changes. Faces live in one contiguous block, each starting on a kAlignment boundary.
+    // Owned and read by the render thread; CameraController fills it under the camera buffer's shard lock.
+    class FacePayloads {
+    public:
+        static constexpr size_t kAlignment = 256; // D3D11.1 constant buffer offsets are in 256-byte units
+        static constexpr uint32_t kFaceCount = 6;
+
+        FacePayloads() = default;
+        ~FacePayloads();
+
+        FacePayloads(const FacePayloads&) = delete;
+        FacePayloads& operator=(const FacePayloads&) = delete;
+
+        // Brings the payloads up to date with the controller's camera snapshot.
+        // Returns false when no camera buffer is tracked.
+        bool Refresh(CameraController& controller);
+        void Invalidate() { m_generation = 0; }
+
+        // Faces (bit per CubeFace) that get payloads; inactive faces are not rebuilt and must not be bound
+        void SetActiveFaces(uint32_t mask) {
+            if (mask != m_activeFaces) Invalidate();
+            m_activeFaces = mask;
+        }
+        uint32_t GetActiveFaces() const { return m_activeFaces; }
+
+        const uint8_t* GetFace(CubeFace face) const { return m_storage + (size_t)face * m_stride; }
+        const uint8_t* GetData() const { return m_storage; }
+        uint32_t GetSize() const { return m_size; }     // Bytes per face
+        uint32_t GetStride() const { return m_stride; } // Distance between faces
+
+        // Row-vector transforms from the game's clip space to each face's clip space (game view/projection undone,
+        // face view and 90 degree projection applied). Only valid when the camera buffer holds both matrices.
+        bool HasFaceClipTransforms() const { return m_hasFaceClip; }
+        const Float4x4* GetFaceClipTransforms() const { return m_faceClip; }
+
+        // Camera snapshot version the payloads were built from (0 = none)
+        uint64_t GetGeneration() const { return m_generation; }
+        uint64_t GetRebuildCount() const { return m_rebuilds; }
+
+    private:
+        friend class CameraController;
+
+        // Sizes the faces for a buffer of size bytes; storage is allocated once for the largest constant buffer
+        uint8_t* Prepare(uint32_t size);
+        uint8_t* GetFaceData(uint32_t face) { return m_storage + (size_t)face * m_stride; }
+
+        uint8_t* m_storage = nullptr;
+        uint32_t m_size = 0;
+        uint32_t m_stride = 0;
+        Float4x4 m_faceClip[kFaceCount] = {};
+        bool m_hasFaceClip = false;
+        uint32_t m_activeFaces = (1u << kFaceCount) - 1;
+        uint64_t m_generation = 0;
+        uint64_t m_rebuilds = 0;
+    };
+}
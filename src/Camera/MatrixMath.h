@@ -1,30 +1,118 @@
 #pragma once
-#include <DirectXMath.h>
+#include <cmath>
 
 namespace Camera {
-    using namespace DirectX;
 
-    // Helper class for matrix operations
+    // Row-major 4x4 matrix in DirectXMath's row-vector convention and XMFLOAT4X4 layout, so it is copied into camera
+    // buffers and D3D structures byte for byte
+    struct Float4x4 {
+        float m[4][4];
+    };
+
+    struct Float4 {
+        float x, y, z, w;
+    };
+
+    // Matrix operations of the camera path. Same conventions and formulas as the DirectXMath functions of the same
+    // name, without the SDK, so the camera module builds on any platform.
     class MatrixMath {
     public:
-        static bool IsProjectionMatrix(const DirectX::XMMATRIX& mat) {
-            // Heuristic to check if a matrix is a projection matrix
-            // Check if column 4 is (0, 0, 1, 0) - Typical for perspective projection
-            DirectX::XMFLOAT4X4 m;
-            DirectX::XMStoreFloat4x4(&m, mat);
-            
-            // Allow some epsilon for floats
-            const float e = 1e-4f;
-            return (std::abs(m._14) < e && std::abs(m._24) < e && 
-                    std::abs(m._34 - 1.0f) < e && std::abs(m._44) < e);
+        static constexpr float kPiDiv2 = 1.570796327f;
+
+        static Float4x4 Identity() {
+            Float4x4 r = {};
+            for (int i = 0; i < 4; ++i) r.m[i][i] = 1.0f;
+            return r;
+        }
+
+        static Float4x4 Multiply(const Float4x4& a, const Float4x4& b) {
+            Float4x4 r;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) {
+                    r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+                }
+            }
+            return r;
+        }
+
+        static Float4x4 Transpose(const Float4x4& a) {
+            Float4x4 r;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 4; ++j) r.m[i][j] = a.m[j][i];
+            }
+            return r;
+        }
+
+        // Inverse through the adjugate; *outDeterminant tells whether it exists (the result is not finite when it is 0)
+        static Float4x4 Inverse(const Float4x4& a, float* outDeterminant) {
+            const float* m = &a.m[0][0];
+            float inv[16];
+            inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+            inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+            inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+            inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+            inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+            inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+            inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+            inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+            inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+            inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+            inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+            inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+            inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+            inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+            inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+            inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+            float determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+            *outDeterminant = determinant;
+            Float4x4 r;
+            for (int i = 0; i < 16; ++i) (&r.m[0][0])[i] = inv[i] / determinant;
+            return r;
+        }
+
+        // XMMatrixLookAtLH / XMMatrixLookAtRH (w of the vectors is ignored)
+        static Float4x4 LookAt(const Float4& eye, const Float4& focus, const Float4& up, bool rightHanded) {
+            Float4 forward = { focus.x - eye.x, focus.y - eye.y, focus.z - eye.z, 0.0f };
+            if (rightHanded) forward = { -forward.x, -forward.y, -forward.z, 0.0f };
+            Float4 z = Normalize(forward);
+            Float4 x = Normalize(Cross(up, z));
+            Float4 y = Cross(z, x);
+
+            Float4x4 r = {};
+            const Float4* axes[3] = { &x, &y, &z };
+            for (int i = 0; i < 3; ++i) {
+                r.m[0][i] = axes[i]->x;
+                r.m[1][i] = axes[i]->y;
+                r.m[2][i] = axes[i]->z;
+                r.m[3][i] = -(axes[i]->x * eye.x + axes[i]->y * eye.y + axes[i]->z * eye.z);
+            }
+            r.m[3][3] = 1.0f;
+            return r;
+        }
+
+        // XMMatrixPerspectiveFovLH / XMMatrixPerspectiveFovRH
+        static Float4x4 PerspectiveFov(float fovY, float aspectRatio, float nearZ, float farZ, bool rightHanded) {
+            float height = std::cos(fovY * 0.5f) / std::sin(fovY * 0.5f);
+            float range = rightHanded ? farZ / (nearZ - farZ) : farZ / (farZ - nearZ);
+            Float4x4 r = {};
+            r.m[0][0] = height / aspectRatio;
+            r.m[1][1] = height;
+            r.m[2][2] = range;
+            r.m[2][3] = rightHanded ? -1.0f : 1.0f;
+            r.m[3][2] = rightHanded ? range * nearZ : -range * nearZ;
+            return r;
         }
 
-        static DirectX::XMMATRIX CreateViewMatrix(DirectX::FXMVECTOR eye, DirectX::FXMVECTOR focus, DirectX::FXMVECTOR up) {
-            return DirectX::XMMatrixLookAtLH(eye, focus, up); // Assuming LH coordinate system as default for many DX engines
+    private:
+        static Float4 Cross(const Float4& a, const Float4& b) {
+            return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x, 0.0f };
         }
 
-        static DirectX::XMMATRIX CreateProjectionMatrix(float fov, float aspectRatio, float nearZ, float farZ) {
-            return DirectX::XMMatrixPerspectiveFovLH(fov, aspectRatio, nearZ, farZ);
+        static Float4 Normalize(const Float4& v) {
+            float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+            if (length <= 0.0f) return v;
+            return { v.x / length, v.y / length, v.z / length, 0.0f };
         }
     };
 }
@@ -0,0 +1,376 @@
+#include "MatrixScanner.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WC_SCANNER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define WC_TARGET_AVX2
+#else
+#define WC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace Camera {
+
+    namespace {
+        const float kEpsilon = 0.1f;
+
+        // Per-block (4 consecutive floats) feature bits. A candidate matrix at block b spans blocks b..b+3,
+        // so both predicates reduce to AND/OR of one feature bit from each of its four rows.
+        enum : uint8_t {
+            kColMajorRow = 1 << 0, // [0 0 0 1]: last row of a transposed view matrix
+            kZeroW       = 1 << 1, // |w| < eps: rows 0-2 of a row-major view matrix
+            kOneW        = 1 << 2, // |w - 1| < eps: row 3 of a row-major view matrix
+            kProjRow0    = 1 << 3, // [x 0 0 0]
+            kProjRow1    = 1 << 4, // [0 x 0 0]
+            kProjRow2    = 1 << 5, // [x x x +-1]
+            kProjRow3    = 1 << 6, // [x x x 0]
+        };
+
+        // Candidate blocks classified per pass; features need 3 blocks of look-ahead plus padding for wide loads
+        const size_t kChunkBlocks = 256;
+        const size_t kFeaturePadding = 3 + 32;
+
+        typedef void (*ClassifyFn)(const float* data, size_t blockCount, uint8_t* outFeatures);
+        typedef int (*CombineFn)(const uint8_t* features, size_t candidateCount, bool view);
+
+        // Comparisons mirror the scalar predicates exactly, including NaN behavior:
+        // "< eps" tests require an ordered compare, "not > eps" tests pass on NaN.
+        uint8_t ClassifyBlock(const float* r) {
+            float a0 = std::abs(r[0]), a1 = std::abs(r[1]), a2 = std::abs(r[2]), a3 = std::abs(r[3]);
+            float oneDist = std::abs(r[3] - 1.0f);
+            float negOneDist = std::abs(r[3] + 1.0f);
+
+            uint8_t f = 0;
+            if (a0 < kEpsilon && a1 < kEpsilon && a2 < kEpsilon && oneDist < kEpsilon) f |= kColMajorRow;
+            if (a3 < kEpsilon) f |= kZeroW;
+            if (oneDist < kEpsilon) f |= kOneW;
+            if (!(a1 > kEpsilon) && !(a2 > kEpsilon) && !(a3 > kEpsilon)) f |= kProjRow0;
+            if (!(a0 > kEpsilon) && !(a2 > kEpsilon) && !(a3 > kEpsilon)) f |= kProjRow1;
+            if (!(oneDist > kEpsilon) || !(negOneDist > kEpsilon)) f |= kProjRow2;
+            if (!(a3 > kEpsilon)) f |= kProjRow3;
+            return f;
+        }
+
+        bool MatchView(const uint8_t* f) {
+            return (f[3] & kColMajorRow) || ((f[0] & f[1] & f[2] & kZeroW) && (f[3] & kOneW));
+        }
+
+        bool MatchProjection(const uint8_t* f) {
+            return (f[0] & kProjRow0) && (f[1] & kProjRow1) && (f[2] & kProjRow2) && (f[3] & kProjRow3);
+        }
+
+        void ClassifyScalar(const float* data, size_t blockCount, uint8_t* outFeatures) {
+            for (size_t b = 0; b < blockCount; ++b) outFeatures[b] = ClassifyBlock(data + b * 4);
+        }
+
+        int CombineScalar(const uint8_t* features, size_t candidateCount, bool view) {
+            for (size_t i = 0; i < candidateCount; ++i) {
+                if (view ? MatchView(features + i) : MatchProjection(features + i)) return (int)i;
+            }
+            return -1;
+        }
+
+#if WC_SCANNER_X86
+        // ---- SSE2 (baseline on x64): 16 blocks classified and 16 candidates combined per iteration ----
+
+        inline unsigned CountTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return (unsigned)index;
+#else
+            return (unsigned)__builtin_ctz(mask);
+#endif
+        }
+
+        // Classifies 4 blocks held transposed (c[k] = lane k of each block) into 4 int32 feature words
+        inline __m128i ClassifyTransposedSSE(__m128 c0, __m128 c1, __m128 c2, __m128 c3) {
+            const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+            const __m128 eps = _mm_set1_ps(kEpsilon);
+            const __m128 one = _mm_set1_ps(1.0f);
+
+            __m128 a0 = _mm_and_ps(c0, absMask), a1 = _mm_and_ps(c1, absMask);
+            __m128 a2 = _mm_and_ps(c2, absMask), a3 = _mm_and_ps(c3, absMask);
+            __m128 oneDist = _mm_and_ps(_mm_sub_ps(c3, one), absMask);
+            __m128 negOneDist = _mm_and_ps(_mm_add_ps(c3, one), absMask);
+
+            __m128 lt0 = _mm_cmplt_ps(a0, eps), lt1 = _mm_cmplt_ps(a1, eps), lt2 = _mm_cmplt_ps(a2, eps), lt3 = _mm_cmplt_ps(a3, eps);
+            __m128 gt0 = _mm_cmpgt_ps(a0, eps), gt1 = _mm_cmpgt_ps(a1, eps), gt2 = _mm_cmpgt_ps(a2, eps), gt3 = _mm_cmpgt_ps(a3, eps);
+            __m128 oneLt = _mm_cmplt_ps(oneDist, eps);
+            __m128 oneGt = _mm_cmpgt_ps(oneDist, eps);
+            __m128 negOneGt = _mm_cmpgt_ps(negOneDist, eps);
+
+            __m128 col = _mm_and_ps(_mm_and_ps(lt0, lt1), _mm_and_ps(lt2, oneLt));
+            __m128 p0 = _mm_or_ps(_mm_or_ps(gt1, gt2), gt3);   // inverted
+            __m128 p1 = _mm_or_ps(_mm_or_ps(gt0, gt2), gt3);   // inverted
+            __m128 p2 = _mm_and_ps(oneGt, negOneGt);           // inverted
+
+            __m128i f = _mm_and_si128(_mm_castps_si128(col), _mm_set1_epi32(kColMajorRow));
+            f = _mm_or_si128(f, _mm_and_si128(_mm_castps_si128(lt3), _mm_set1_epi32(kZeroW)));
+            f = _mm_or_si128(f, _mm_and_si128(_mm_castps_si128(oneLt), _mm_set1_epi32(kOneW)));
+            f = _mm_or_si128(f, _mm_andnot_si128(_mm_castps_si128(p0), _mm_set1_epi32(kProjRow0)));
+            f = _mm_or_si128(f, _mm_andnot_si128(_mm_castps_si128(p1), _mm_set1_epi32(kProjRow1)));
+            f = _mm_or_si128(f, _mm_andnot_si128(_mm_castps_si128(p2), _mm_set1_epi32(kProjRow2)));
+            f = _mm_or_si128(f, _mm_andnot_si128(_mm_castps_si128(gt3), _mm_set1_epi32(kProjRow3)));
+            return f;
+        }
+
+        inline __m128i ClassifyFourSSE(const float* data) {
+            __m128 r0 = _mm_loadu_ps(data + 0), r1 = _mm_loadu_ps(data + 4);
+            __m128 r2 = _mm_loadu_ps(data + 8), r3 = _mm_loadu_ps(data + 12);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            return ClassifyTransposedSSE(r0, r1, r2, r3);
+        }
+
+        void ClassifySSE2(const float* data, size_t blockCount, uint8_t* outFeatures) {
+            size_t b = 0;
+            for (; b + 16 <= blockCount; b += 16) {
+                const float* p = data + b * 4;
+                __m128i f0 = ClassifyFourSSE(p), f1 = ClassifyFourSSE(p + 16);
+                __m128i f2 = ClassifyFourSSE(p + 32), f3 = ClassifyFourSSE(p + 48);
+                __m128i packed = _mm_packs_epi16(_mm_packs_epi32(f0, f1), _mm_packs_epi32(f2, f3));
+                _mm_storeu_si128((__m128i*)(outFeatures + b), packed);
+            }
+            ClassifyScalar(data + b * 4, blockCount - b, outFeatures + b);
+        }
+
+        inline __m128i HasBitsSSE(__m128i v, uint8_t bits) {
+            __m128i m = _mm_set1_epi8((char)bits);
+            return _mm_cmpeq_epi8(_mm_and_si128(v, m), m);
+        }
+
+        int CombineSSE2(const uint8_t* features, size_t candidateCount, bool view) {
+            for (size_t i = 0; i < candidateCount; i += 16) {
+                __m128i v0 = _mm_loadu_si128((const __m128i*)(features + i));
+                __m128i v1 = _mm_loadu_si128((const __m128i*)(features + i + 1));
+                __m128i v2 = _mm_loadu_si128((const __m128i*)(features + i + 2));
+                __m128i v3 = _mm_loadu_si128((const __m128i*)(features + i + 3));
+
+                __m128i hit;
+                if (view) {
+                    __m128i rows = HasBitsSSE(_mm_and_si128(_mm_and_si128(v0, v1), v2), kZeroW);
+                    hit = _mm_or_si128(_mm_and_si128(rows, HasBitsSSE(v3, kOneW)), HasBitsSSE(v3, kColMajorRow));
+                } else {
+                    hit = _mm_and_si128(_mm_and_si128(HasBitsSSE(v0, kProjRow0), HasBitsSSE(v1, kProjRow1)),
+                                        _mm_and_si128(HasBitsSSE(v2, kProjRow2), HasBitsSSE(v3, kProjRow3)));
+                }
+
+                unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+                size_t remaining = candidateCount - i;
+                if (remaining < 16) mask &= (1u << remaining) - 1;
+                if (mask) return (int)(i + CountTrailingZeros(mask));
+            }
+            return -1;
+        }
+
+        // ---- AVX2: 32 blocks classified and 32 candidates combined per iteration ----
+
+        WC_TARGET_AVX2 inline __m256i ClassifyEightAVX2(const float* data) {
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+            const __m256 eps = _mm256_set1_ps(kEpsilon);
+            const __m256 one = _mm256_set1_ps(1.0f);
+
+            // Lane halves hold blocks 0-3 and 4-7; transpose within each 128-bit lane
+            __m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(data + 0)), _mm_loadu_ps(data + 16), 1);
+            __m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(data + 4)), _mm_loadu_ps(data + 20), 1);
+            __m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(data + 8)), _mm_loadu_ps(data + 24), 1);
+            __m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(data + 12)), _mm_loadu_ps(data + 28), 1);
+
+            __m256 t0 = _mm256_unpacklo_ps(r0, r1), t1 = _mm256_unpacklo_ps(r2, r3);
+            __m256 t2 = _mm256_unpackhi_ps(r0, r1), t3 = _mm256_unpackhi_ps(r2, r3);
+            __m256 c0 = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t1)));
+            __m256 c1 = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t0), _mm256_castps_pd(t1)));
+            __m256 c2 = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t2), _mm256_castps_pd(t3)));
+            __m256 c3 = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t2), _mm256_castps_pd(t3)));
+
+            __m256 a0 = _mm256_and_ps(c0, absMask), a1 = _mm256_and_ps(c1, absMask);
+            __m256 a2 = _mm256_and_ps(c2, absMask), a3 = _mm256_and_ps(c3, absMask);
+            __m256 oneDist = _mm256_and_ps(_mm256_sub_ps(c3, one), absMask);
+            __m256 negOneDist = _mm256_and_ps(_mm256_add_ps(c3, one), absMask);
+
+            __m256 lt0 = _mm256_cmp_ps(a0, eps, _CMP_LT_OQ), lt1 = _mm256_cmp_ps(a1, eps, _CMP_LT_OQ);
+            __m256 lt2 = _mm256_cmp_ps(a2, eps, _CMP_LT_OQ), lt3 = _mm256_cmp_ps(a3, eps, _CMP_LT_OQ);
+            __m256 gt0 = _mm256_cmp_ps(a0, eps, _CMP_GT_OQ), gt1 = _mm256_cmp_ps(a1, eps, _CMP_GT_OQ);
+            __m256 gt2 = _mm256_cmp_ps(a2, eps, _CMP_GT_OQ), gt3 = _mm256_cmp_ps(a3, eps, _CMP_GT_OQ);
+            __m256 oneLt = _mm256_cmp_ps(oneDist, eps, _CMP_LT_OQ);
+            __m256 oneGt = _mm256_cmp_ps(oneDist, eps, _CMP_GT_OQ);
+            __m256 negOneGt = _mm256_cmp_ps(negOneDist, eps, _CMP_GT_OQ);
+
+            __m256 col = _mm256_and_ps(_mm256_and_ps(lt0, lt1), _mm256_and_ps(lt2, oneLt));
+            __m256 p0 = _mm256_or_ps(_mm256_or_ps(gt1, gt2), gt3);
+            __m256 p1 = _mm256_or_ps(_mm256_or_ps(gt0, gt2), gt3);
+            __m256 p2 = _mm256_and_ps(oneGt, negOneGt);
+
+            __m256i f = _mm256_and_si256(_mm256_castps_si256(col), _mm256_set1_epi32(kColMajorRow));
+            f = _mm256_or_si256(f, _mm256_and_si256(_mm256_castps_si256(lt3), _mm256_set1_epi32(kZeroW)));
+            f = _mm256_or_si256(f, _mm256_and_si256(_mm256_castps_si256(oneLt), _mm256_set1_epi32(kOneW)));
+            f = _mm256_or_si256(f, _mm256_andnot_si256(_mm256_castps_si256(p0), _mm256_set1_epi32(kProjRow0)));
+            f = _mm256_or_si256(f, _mm256_andnot_si256(_mm256_castps_si256(p1), _mm256_set1_epi32(kProjRow1)));
+            f = _mm256_or_si256(f, _mm256_andnot_si256(_mm256_castps_si256(p2), _mm256_set1_epi32(kProjRow2)));
+            f = _mm256_or_si256(f, _mm256_andnot_si256(_mm256_castps_si256(gt3), _mm256_set1_epi32(kProjRow3)));
+            return f;
+        }
+
+        WC_TARGET_AVX2 void ClassifyAVX2(const float* data, size_t blockCount, uint8_t* outFeatures) {
+            size_t b = 0;
+            for (; b + 32 <= blockCount; b += 32) {
+                const float* p = data + b * 4;
+                __m256i f0 = ClassifyEightAVX2(p), f1 = ClassifyEightAVX2(p + 32);
+                __m256i f2 = ClassifyEightAVX2(p + 64), f3 = ClassifyEightAVX2(p + 96);
+                // Packs interleave 128-bit lanes; restore block order with a dword permute
+                __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(f0, f1), _mm256_packs_epi32(f2, f3));
+                packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+                _mm256_storeu_si256((__m256i*)(outFeatures + b), packed);
+            }
+            ClassifySSE2(data + b * 4, blockCount - b, outFeatures + b);
+        }
+
+        WC_TARGET_AVX2 inline __m256i HasBitsAVX2(__m256i v, uint8_t bits) {
+            __m256i m = _mm256_set1_epi8((char)bits);
+            return _mm256_cmpeq_epi8(_mm256_and_si256(v, m), m);
+        }
+
+        WC_TARGET_AVX2 int CombineAVX2(const uint8_t* features, size_t candidateCount, bool view) {
+            for (size_t i = 0; i < candidateCount; i += 32) {
+                __m256i v0 = _mm256_loadu_si256((const __m256i*)(features + i));
+                __m256i v1 = _mm256_loadu_si256((const __m256i*)(features + i + 1));
+                __m256i v2 = _mm256_loadu_si256((const __m256i*)(features + i + 2));
+                __m256i v3 = _mm256_loadu_si256((const __m256i*)(features + i + 3));
+
+                __m256i hit;
+                if (view) {
+                    __m256i rows = HasBitsAVX2(_mm256_and_si256(_mm256_and_si256(v0, v1), v2), kZeroW);
+                    hit = _mm256_or_si256(_mm256_and_si256(rows, HasBitsAVX2(v3, kOneW)), HasBitsAVX2(v3, kColMajorRow));
+                } else {
+                    hit = _mm256_and_si256(_mm256_and_si256(HasBitsAVX2(v0, kProjRow0), HasBitsAVX2(v1, kProjRow1)),
+                                           _mm256_and_si256(HasBitsAVX2(v2, kProjRow2), HasBitsAVX2(v3, kProjRow3)));
+                }
+
+                unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+                size_t remaining = candidateCount - i;
+                if (remaining < 32) mask &= (1u << remaining) - 1;
+                if (mask) return (int)(i + CountTrailingZeros(mask));
+            }
+            return -1;
+        }
+
+        bool CpuSupportsAVX2() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx) return false;
+            if ((_xgetbv(0) & 0x6) != 0x6) return false; // OS saves XMM/YMM state
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif
+
+        int FindFirst(const float* data, size_t beginFloat, size_t endFloat, bool view, bool* outIsTransposed, MatrixScanner::Path path) {
+            ClassifyFn classify = ClassifyScalar;
+            CombineFn combine = CombineScalar;
+#if WC_SCANNER_X86
+            if (path == MatrixScanner::Path::AVX2) { classify = ClassifyAVX2; combine = CombineAVX2; }
+            else if (path == MatrixScanner::Path::SSE2) { classify = ClassifySSE2; combine = CombineSSE2; }
+#else
+            (void)path;
+#endif
+
+            uint8_t features[kChunkBlocks + kFeaturePadding];
+            size_t block = (beginFloat + 3) / 4;
+            size_t endBlock = (endFloat + 3) / 4; // Exclusive, candidate blocks start below endFloat
+
+            while (block < endBlock) {
+                size_t count = std::min(kChunkBlocks, endBlock - block);
+                classify(data + block * 4, count + 3, features);
+                memset(features + count + 3, 0, kFeaturePadding - 3);
+
+                int hit = combine(features, count, view);
+                if (hit >= 0) {
+                    if (outIsTransposed) *outIsTransposed = (features[hit + 3] & kColMajorRow) != 0;
+                    return (int)((block + hit) * 4);
+                }
+                block += count;
+            }
+            return -1;
+        }
+    }
+
+    int MatrixScanner::FindViewMatrix(const float* data, size_t beginFloat, size_t endFloat, bool* outIsTransposed) {
+        return FindFirst(data, beginFloat, endFloat, true, outIsTransposed, GetActivePath());
+    }
+
+    int MatrixScanner::FindProjectionMatrix(const float* data, size_t beginFloat, size_t endFloat) {
+        return FindFirst(data, beginFloat, endFloat, false, nullptr, GetActivePath());
+    }
+
+    int MatrixScanner::FindViewMatrix(const float* data, size_t beginFloat, size_t endFloat, bool* outIsTransposed, Path path) {
+        return FindFirst(data, beginFloat, endFloat, true, outIsTransposed, path);
+    }
+
+    int MatrixScanner::FindProjectionMatrix(const float* data, size_t beginFloat, size_t endFloat, Path path) {
+        return FindFirst(data, beginFloat, endFloat, false, nullptr, path);
+    }
+
+    MatrixScanner::Path MatrixScanner::GetActivePath() {
+#if WC_SCANNER_X86
+        static const Path s_path = CpuSupportsAVX2() ? Path::AVX2 : Path::SSE2;
+        return s_path;
+#else
+        return Path::Scalar;
+#endif
+    }
+
+    const char* MatrixScanner::GetPathName(Path path) {
+        switch (path) {
+            case Path::AVX2: return "AVX2";
+            case Path::SSE2: return "SSE2";
+            default: return "Scalar";
+        }
+    }
+
+    bool MatrixScanner::IsProjectionMatrix(const float* data) {
+        const float epsilon = kEpsilon;
+        // Check for projection patterns (0s in specific spots)
+        // [ x 0 0 0 ]
+        // [ 0 x 0 0 ]
+        // [ 0 0 x x ]
+        // [ 0 0 x 0 ]
+        if (std::abs(data[1]) > epsilon || std::abs(data[2]) > epsilon || std::abs(data[3]) > epsilon) return false;
+        if (std::abs(data[4]) > epsilon || std::abs(data[6]) > epsilon || std::abs(data[7]) > epsilon) return false;
+        if (std::abs(data[15]) > epsilon) return false;
+
+        // Check w components
+        if (std::abs(data[11] - 1.0f) > epsilon && std::abs(data[11] + 1.0f) > epsilon) return false;
+
+        return true;
+    }
+
+    bool MatrixScanner::IsViewMatrix(const float* data, bool* outIsTransposed) {
+        const float epsilon = kEpsilon;
+        // Row Major: [x x x 0], [x x x 0], [x x x 0], [x x x 1]
+        bool rowMajor = (std::abs(data[3]) < epsilon && std::abs(data[7]) < epsilon && std::abs(data[11]) < epsilon && std::abs(data[15] - 1.0f) < epsilon);
+        // Col Major (Transposed): [x x x x], [x x x x], [x x x x], [0 0 0 1]
+        bool colMajor = (std::abs(data[12]) < epsilon && std::abs(data[13]) < epsilon && std::abs(data[14]) < epsilon && std::abs(data[15] - 1.0f) < epsilon);
+
+        if (outIsTransposed) *outIsTransposed = colMajor;
+
+        // To distinguish from World Matrix, we check if it is orthogonal (rotation part).
+        // View Matrix rotation part is orthogonal. World Matrix can be scaled.
+        // For now, heuristic is weak but matches original code intent.
+
+        return rowMajor || colMajor;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Camera {
+
+    // Vectorized search for view/projection matrix candidates in raw constant buffer data.
+    // Candidates sit on a 4-float grid; every path returns exactly the offsets of the scalar predicates.
+    class MatrixScanner {
+    public:
+        enum class Path { Scalar, SSE2, AVX2 };
+
+        // Returns the first float offset in [beginFloat, endFloat) (4-float grid) holding a view matrix, or -1.
+        // data must be readable up to the last candidate offset + 16 floats.
+        static int FindViewMatrix(const float* data, size_t beginFloat, size_t endFloat, bool* outIsTransposed);
+        static int FindProjectionMatrix(const float* data, size_t beginFloat, size_t endFloat);
+
+        // Same as above with an explicit code path (for validation against the scalar reference)
+        static int FindViewMatrix(const float* data, size_t beginFloat, size_t endFloat, bool* outIsTransposed, Path path);
+        static int FindProjectionMatrix(const float* data, size_t beginFloat, size_t endFloat, Path path);
+
+        // Best path supported by this CPU, detected once
+        static Path GetActivePath();
+        static const char* GetPathName(Path path);
+
+        // Scalar reference predicates on a single 16-float window
+        static bool IsViewMatrix(const float* data, bool* outIsTransposed);
+        static bool IsProjectionMatrix(const float* data);
+    };
+}
@@ -0,0 +1,500 @@
+#include "CpuProjector.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define WC_PROJECTOR_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define WC_TARGET_AVX2
+#else
+#define WC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace Compute {
+
+    namespace {
+        // Per-frame sampling constants. Faces that are skipped or missing have scale 0 (padded to 8 for AVX2 permutes).
+        struct SampleState {
+            const uint8_t* faces[8] = {};
+            float scale[8] = {};
+            size_t stride = 0;
+            uint32_t faceSize = 0;
+            float size = 0.0f;
+            float halfTexel = 0.0f;
+        };
+
+        SampleState MakeSampleState(const NV12Converter::CubeFaces& cube) {
+            SampleState state;
+            for (int i = 0; i < 6; ++i) {
+                bool rendered = cube.faces[i] && cube.faceScale[i] > 0.0f;
+                state.faces[i] = rendered ? cube.faces[i] : nullptr;
+                state.scale[i] = rendered ? cube.faceScale[i] : 0.0f;
+            }
+            state.stride = cube.stride;
+            state.faceSize = cube.faceSize;
+            state.size = (float)cube.faceSize;
+            state.halfTexel = 0.5f / (float)cube.faceSize;
+            return state;
+        }
+
+        inline uint32_t LoadTexel(const uint8_t* face, size_t stride, int x, int y) {
+            uint32_t texel;
+            memcpy(&texel, face + y * stride + x * 4, sizeof(texel));
+            return texel;
+        }
+
+        // ---- Scalar: the exact operation sequence of NV12Converter::ProjectCube, which the vector paths repeat ----
+
+        inline void SamplePixel(const SampleState& s, uint32_t entry, int16_t* r, int16_t* g, int16_t* b) {
+            float u, v;
+            int face = ProjectionLut::Unpack(entry, &u, &v);
+            float scale = s.scale[face];
+            if (scale <= 0.0f) {
+                *r = *g = *b = 0;
+                return;
+            }
+
+            u = std::clamp(u * scale, s.halfTexel, scale - s.halfTexel);
+            v = std::clamp(v * scale, s.halfTexel, scale - s.halfTexel);
+
+            float tx = u * s.size - 0.5f;
+            float ty = v * s.size - 0.5f;
+            float fx0 = std::floor(tx), fy0 = std::floor(ty);
+            float wx = tx - fx0, wy = ty - fy0;
+            int last = (int)s.faceSize - 1;
+            int x0 = std::clamp((int)fx0, 0, last), x1 = std::clamp((int)fx0 + 1, 0, last);
+            int y0 = std::clamp((int)fy0, 0, last), y1 = std::clamp((int)fy0 + 1, 0, last);
+
+            const uint8_t* r0 = s.faces[face] + y0 * s.stride;
+            const uint8_t* r1 = s.faces[face] + y1 * s.stride;
+            int16_t* out[3] = { r, g, b };
+            for (int c = 0; c < 3; ++c) {
+                float top = r0[x0 * 4 + c] + (r0[x1 * 4 + c] - r0[x0 * 4 + c]) * wx;
+                float bottom = r1[x0 * 4 + c] + (r1[x1 * 4 + c] - r1[x0 * 4 + c]) * wx;
+                *out[c] = NV12Converter::Quantize((top + (bottom - top) * wy) / 255.0f);
+            }
+        }
+
+        void SampleRowScalar(const SampleState& s, const uint32_t* lut, uint32_t begin, uint32_t end, int16_t* r, int16_t* g, int16_t* b) {
+            for (uint32_t x = begin; x < end; ++x) SamplePixel(s, lut[x], &r[x], &g[x], &b[x]);
+        }
+
+        void ConvertRowsScalar(const int16_t* const rows[2][3], uint32_t begin, uint32_t end, uint8_t* y0, uint8_t* y1, uint8_t* uv) {
+            for (uint32_t x = begin; x < end; x += 2) {
+                int sum[3] = {};
+                for (uint32_t i = 0; i < 4; ++i) {
+                    uint32_t row = i >> 1, px = x + (i & 1);
+                    int rgb[3] = { rows[row][0][px], rows[row][1][px], rows[row][2][px] };
+                    (row ? y1 : y0)[px] = NV12Converter::Luma(rgb[0], rgb[1], rgb[2]);
+                    for (int c = 0; c < 3; ++c) sum[c] += rgb[c];
+                }
+                NV12Converter::Chroma(sum[0], sum[1], sum[2], &uv[x], &uv[x + 1]);
+            }
+        }
+
+#if WC_PROJECTOR_X86
+        // ---- SSE2 (baseline on x64) ----
+
+        // Bilinear blend of one channel (bits shift..shift+7 of the packed texels), then Quantize
+        inline __m128i BlendChannelSSE(__m128i t00, __m128i t01, __m128i t10, __m128i t11, int shift, __m128 wx, __m128 wy) {
+            const __m128i byteMask = _mm_set1_epi32(0xFF);
+            __m128i c00 = _mm_and_si128(_mm_srli_epi32(t00, shift), byteMask);
+            __m128i c01 = _mm_and_si128(_mm_srli_epi32(t01, shift), byteMask);
+            __m128i c10 = _mm_and_si128(_mm_srli_epi32(t10, shift), byteMask);
+            __m128i c11 = _mm_and_si128(_mm_srli_epi32(t11, shift), byteMask);
+
+            __m128 top = _mm_add_ps(_mm_cvtepi32_ps(c00), _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(c01, c00)), wx));
+            __m128 bottom = _mm_add_ps(_mm_cvtepi32_ps(c10), _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(c11, c10)), wx));
+            __m128 value = _mm_div_ps(_mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy)), _mm_set1_ps(255.0f));
+
+            value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+        }
+
+        inline __m128i ClampIndexSSE(__m128i index, __m128i last) {
+            index = _mm_and_si128(index, _mm_cmpgt_epi32(index, _mm_set1_epi32(-1)));
+            __m128i over = _mm_cmpgt_epi32(index, last);
+            return _mm_or_si128(_mm_and_si128(over, last), _mm_andnot_si128(over, index));
+        }
+
+        void SampleRowSSE2(const SampleState& s, const uint32_t* lut, uint32_t begin, uint32_t end, int16_t* r, int16_t* g, int16_t* b) {
+            const __m128i coordMask = _mm_set1_epi32(ProjectionLut::kCoordMax);
+            const __m128 coordScale = _mm_set1_ps(1.0f / (float)ProjectionLut::kCoordMax);
+            const __m128 size = _mm_set1_ps(s.size);
+            const __m128 half = _mm_set1_ps(s.halfTexel);
+            const __m128 pointFive = _mm_set1_ps(0.5f);
+            const __m128i last = _mm_set1_epi32((int)s.faceSize - 1);
+            const __m128i one = _mm_set1_epi32(1);
+
+            uint32_t x = begin;
+            for (; x + 4 <= end; x += 4) {
+                __m128i entry = _mm_loadu_si128((const __m128i*)(lut + x));
+                __m128 u = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(entry, coordMask)), coordScale);
+                __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(entry, ProjectionLut::kCoordBits), coordMask)), coordScale);
+
+                alignas(16) int32_t face[4];
+                _mm_store_si128((__m128i*)face, _mm_and_si128(_mm_srli_epi32(entry, ProjectionLut::kFaceShift), _mm_set1_epi32(7)));
+                __m128 scale = _mm_setr_ps(s.scale[face[0]], s.scale[face[1]], s.scale[face[2]], s.scale[face[3]]);
+                __m128 high = _mm_sub_ps(scale, half);
+                u = _mm_min_ps(_mm_max_ps(_mm_mul_ps(u, scale), half), high);
+                v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(v, scale), half), high);
+
+                __m128 tx = _mm_sub_ps(_mm_mul_ps(u, size), pointFive);
+                __m128 ty = _mm_sub_ps(_mm_mul_ps(v, size), pointFive);
+                // floor: truncate, then step down where truncation rounded up (negative values)
+                __m128i ix = _mm_cvttps_epi32(tx), iy = _mm_cvttps_epi32(ty);
+                ix = _mm_add_epi32(ix, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(ix), tx)));
+                iy = _mm_add_epi32(iy, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(iy), ty)));
+                __m128 wx = _mm_sub_ps(tx, _mm_cvtepi32_ps(ix));
+                __m128 wy = _mm_sub_ps(ty, _mm_cvtepi32_ps(iy));
+
+                alignas(16) int32_t x0[4], x1[4], y0[4], y1[4];
+                _mm_store_si128((__m128i*)x0, ClampIndexSSE(ix, last));
+                _mm_store_si128((__m128i*)x1, ClampIndexSSE(_mm_add_epi32(ix, one), last));
+                _mm_store_si128((__m128i*)y0, ClampIndexSSE(iy, last));
+                _mm_store_si128((__m128i*)y1, ClampIndexSSE(_mm_add_epi32(iy, one), last));
+
+                alignas(16) uint32_t t00[4] = {}, t01[4] = {}, t10[4] = {}, t11[4] = {};
+                for (int i = 0; i < 4; ++i) {
+                    const uint8_t* base = s.faces[face[i]];
+                    if (!base) continue; // Masked to black below
+                    t00[i] = LoadTexel(base, s.stride, x0[i], y0[i]);
+                    t01[i] = LoadTexel(base, s.stride, x1[i], y0[i]);
+                    t10[i] = LoadTexel(base, s.stride, x0[i], y1[i]);
+                    t11[i] = LoadTexel(base, s.stride, x1[i], y1[i]);
+                }
+                __m128i q00 = _mm_load_si128((const __m128i*)t00), q01 = _mm_load_si128((const __m128i*)t01);
+                __m128i q10 = _mm_load_si128((const __m128i*)t10), q11 = _mm_load_si128((const __m128i*)t11);
+
+                __m128i rendered = _mm_castps_si128(_mm_cmpgt_ps(scale, _mm_setzero_ps()));
+                __m128i red = _mm_and_si128(BlendChannelSSE(q00, q01, q10, q11, 0, wx, wy), rendered);
+                __m128i green = _mm_and_si128(BlendChannelSSE(q00, q01, q10, q11, 8, wx, wy), rendered);
+                __m128i blue = _mm_and_si128(BlendChannelSSE(q00, q01, q10, q11, 16, wx, wy), rendered);
+
+                _mm_storel_epi64((__m128i*)(r + x), _mm_packs_epi32(red, red));
+                _mm_storel_epi64((__m128i*)(g + x), _mm_packs_epi32(green, green));
+                _mm_storel_epi64((__m128i*)(b + x), _mm_packs_epi32(blue, blue));
+            }
+            SampleRowScalar(s, lut, x, end, r, g, b);
+        }
+
+        // 16.16 fixed point through 16-bit multiply-adds: 46871 * g is split into (g << 16) - 18665 * g, and the chroma
+        // weights of 32768 become shifts. Matches NV12Converter::Luma/Chroma exactly.
+        inline __m128i LumaSSE(__m128i red, __m128i green, __m128i blue) {
+            const __m128i rgWeights = _mm_setr_epi16(13933, -18665, 13933, -18665, 13933, -18665, 13933, -18665);
+            const __m128i bWeights = _mm_setr_epi16(4732, 0, 4732, 0, 4732, 0, 4732, 0);
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i round = _mm_set1_epi32(32768);
+
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(red, green), rgWeights), _mm_madd_epi16(_mm_unpacklo_epi16(blue, zero), bWeights));
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(red, green), rgWeights), _mm_madd_epi16(_mm_unpackhi_epi16(blue, zero), bWeights));
+            lo = _mm_add_epi32(_mm_add_epi32(lo, _mm_slli_epi32(_mm_unpacklo_epi16(green, zero), 16)), round);
+            hi = _mm_add_epi32(_mm_add_epi32(hi, _mm_slli_epi32(_mm_unpackhi_epi16(green, zero), 16)), round);
+            __m128i luma = _mm_packs_epi32(_mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+            return _mm_packus_epi16(luma, luma);
+        }
+
+        void ConvertRowsSSE2(const int16_t* const rows[2][3], uint32_t begin, uint32_t end, uint8_t* y0, uint8_t* y1, uint8_t* uv) {
+            const __m128i ones = _mm_set1_epi16(1);
+            const __m128i uWeights = _mm_setr_epi16(-7510, -25258, -7510, -25258, -7510, -25258, -7510, -25258);
+            const __m128i vWeights = _mm_setr_epi16(-29767, -3001, -29767, -3001, -29767, -3001, -29767, -3001);
+            const __m128i offset = _mm_set1_epi32((128 << 18) + (1 << 17));
+
+            uint32_t x = begin;
+            for (; x + 8 <= end; x += 8) {
+                __m128i r0 = _mm_loadu_si128((const __m128i*)(rows[0][0] + x));
+                __m128i g0 = _mm_loadu_si128((const __m128i*)(rows[0][1] + x));
+                __m128i b0 = _mm_loadu_si128((const __m128i*)(rows[0][2] + x));
+                __m128i r1 = _mm_loadu_si128((const __m128i*)(rows[1][0] + x));
+                __m128i g1 = _mm_loadu_si128((const __m128i*)(rows[1][1] + x));
+                __m128i b1 = _mm_loadu_si128((const __m128i*)(rows[1][2] + x));
+
+                _mm_storel_epi64((__m128i*)(y0 + x), LumaSSE(r0, g0, b0));
+                _mm_storel_epi64((__m128i*)(y1 + x), LumaSSE(r1, g1, b1));
+
+                // 2x2 sums per block (int32, at most 1020)
+                __m128i rSum = _mm_madd_epi16(_mm_add_epi16(r0, r1), ones);
+                __m128i gSum = _mm_madd_epi16(_mm_add_epi16(g0, g1), ones);
+                __m128i bSum = _mm_madd_epi16(_mm_add_epi16(b0, b1), ones);
+
+                __m128i u = _mm_madd_epi16(_mm_or_si128(rSum, _mm_slli_epi32(gSum, 16)), uWeights);
+                u = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(u, _mm_slli_epi32(bSum, 15)), offset), 18);
+                __m128i v = _mm_madd_epi16(_mm_or_si128(gSum, _mm_slli_epi32(bSum, 16)), vWeights);
+                v = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(v, _mm_slli_epi32(rSum, 15)), offset), 18);
+
+                // Interleave as 16-bit U, V pairs; the unsigned pack clamps 256 to 255 like Chroma
+                __m128i pairs = _mm_or_si128(u, _mm_slli_epi32(v, 16));
+                _mm_storel_epi64((__m128i*)(uv + x), _mm_packus_epi16(pairs, pairs));
+            }
+            ConvertRowsScalar(rows, x, end, y0, y1, uv);
+        }
+
+        // ---- AVX2: sampling 8 pixels per step; conversion stays on SSE2 (it is a small share of the work) ----
+
+        WC_TARGET_AVX2 inline __m256i BlendChannelAVX2(__m256i t00, __m256i t01, __m256i t10, __m256i t11, int shift, __m256 wx, __m256 wy) {
+            const __m256i byteMask = _mm256_set1_epi32(0xFF);
+            __m256i c00 = _mm256_and_si256(_mm256_srli_epi32(t00, shift), byteMask);
+            __m256i c01 = _mm256_and_si256(_mm256_srli_epi32(t01, shift), byteMask);
+            __m256i c10 = _mm256_and_si256(_mm256_srli_epi32(t10, shift), byteMask);
+            __m256i c11 = _mm256_and_si256(_mm256_srli_epi32(t11, shift), byteMask);
+
+            __m256 top = _mm256_add_ps(_mm256_cvtepi32_ps(c00), _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(c01, c00)), wx));
+            __m256 bottom = _mm256_add_ps(_mm256_cvtepi32_ps(c10), _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_sub_epi32(c11, c10)), wx));
+            __m256 value = _mm256_div_ps(_mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), wy)), _mm256_set1_ps(255.0f));
+
+            value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+            return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(255.0f)), _mm256_set1_ps(0.5f)));
+        }
+
+        WC_TARGET_AVX2 inline void StoreInt16AVX2(int16_t* out, __m256i value) {
+            __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+            _mm_storeu_si128((__m128i*)out, packed);
+        }
+
+        WC_TARGET_AVX2 void SampleRowAVX2(const SampleState& s, const uint32_t* lut, uint32_t begin, uint32_t end, int16_t* r, int16_t* g, int16_t* b) {
+            const __m256i coordMask = _mm256_set1_epi32(ProjectionLut::kCoordMax);
+            const __m256 coordScale = _mm256_set1_ps(1.0f / (float)ProjectionLut::kCoordMax);
+            const __m256 size = _mm256_set1_ps(s.size);
+            const __m256 half = _mm256_set1_ps(s.halfTexel);
+            const __m256 pointFive = _mm256_set1_ps(0.5f);
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i last = _mm256_set1_epi32((int)s.faceSize - 1);
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256 scaleTable = _mm256_loadu_ps(s.scale);
+
+            uint32_t x = begin;
+            for (; x + 8 <= end; x += 8) {
+                __m256i entry = _mm256_loadu_si256((const __m256i*)(lut + x));
+                __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(entry, coordMask)), coordScale);
+                __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(entry, ProjectionLut::kCoordBits), coordMask)), coordScale);
+                __m256i faceIndex = _mm256_and_si256(_mm256_srli_epi32(entry, ProjectionLut::kFaceShift), _mm256_set1_epi32(7));
+
+                __m256 scale = _mm256_permutevar8x32_ps(scaleTable, faceIndex);
+                __m256 high = _mm256_sub_ps(scale, half);
+                u = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(u, scale), half), high);
+                v = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(v, scale), half), high);
+
+                __m256 tx = _mm256_sub_ps(_mm256_mul_ps(u, size), pointFive);
+                __m256 ty = _mm256_sub_ps(_mm256_mul_ps(v, size), pointFive);
+                __m256 fx0 = _mm256_floor_ps(tx), fy0 = _mm256_floor_ps(ty);
+                __m256 wx = _mm256_sub_ps(tx, fx0), wy = _mm256_sub_ps(ty, fy0);
+                __m256i ix = _mm256_cvttps_epi32(fx0), iy = _mm256_cvttps_epi32(fy0);
+
+                alignas(32) int32_t face[8], x0[8], x1[8], y0[8], y1[8];
+                _mm256_store_si256((__m256i*)face, faceIndex);
+                _mm256_store_si256((__m256i*)x0, _mm256_min_epi32(_mm256_max_epi32(ix, zero), last));
+                _mm256_store_si256((__m256i*)x1, _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(ix, one), zero), last));
+                _mm256_store_si256((__m256i*)y0, _mm256_min_epi32(_mm256_max_epi32(iy, zero), last));
+                _mm256_store_si256((__m256i*)y1, _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(iy, one), zero), last));
+
+                alignas(32) uint32_t t00[8] = {}, t01[8] = {}, t10[8] = {}, t11[8] = {};
+                for (int i = 0; i < 8; ++i) {
+                    const uint8_t* base = s.faces[face[i]];
+                    if (!base) continue; // Masked to black below
+                    t00[i] = LoadTexel(base, s.stride, x0[i], y0[i]);
+                    t01[i] = LoadTexel(base, s.stride, x1[i], y0[i]);
+                    t10[i] = LoadTexel(base, s.stride, x0[i], y1[i]);
+                    t11[i] = LoadTexel(base, s.stride, x1[i], y1[i]);
+                }
+                __m256i q00 = _mm256_load_si256((const __m256i*)t00), q01 = _mm256_load_si256((const __m256i*)t01);
+                __m256i q10 = _mm256_load_si256((const __m256i*)t10), q11 = _mm256_load_si256((const __m256i*)t11);
+
+                __m256i rendered = _mm256_castps_si256(_mm256_cmp_ps(scale, _mm256_setzero_ps(), _CMP_GT_OQ));
+                StoreInt16AVX2(r + x, _mm256_and_si256(BlendChannelAVX2(q00, q01, q10, q11, 0, wx, wy), rendered));
+                StoreInt16AVX2(g + x, _mm256_and_si256(BlendChannelAVX2(q00, q01, q10, q11, 8, wx, wy), rendered));
+                StoreInt16AVX2(b + x, _mm256_and_si256(BlendChannelAVX2(q00, q01, q10, q11, 16, wx, wy), rendered));
+            }
+            SampleRowSSE2(s, lut, x, end, r, g, b);
+        }
+
+        bool CpuSupportsAVX2() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx) return false;
+            if ((_xgetbv(0) & 0x6) != 0x6) return false; // OS saves XMM/YMM state
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif
+
+        using SampleRowFn = void (*)(const SampleState&, const uint32_t*, uint32_t, uint32_t, int16_t*, int16_t*, int16_t*);
+        using ConvertRowsFn = void (*)(const int16_t* const[2][3], uint32_t, uint32_t, uint8_t*, uint8_t*, uint8_t*);
+
+        uint64_t NowNanoseconds() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    CpuProjector::CpuProjector(uint32_t threadCount) {
+        m_path = GetActivePath();
+
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        m_scratch.resize(threadCount);
+        for (uint32_t i = 1; i < threadCount; ++i) m_workers.emplace_back(&CpuProjector::WorkerLoop, this, i);
+    }
+
+    CpuProjector::~CpuProjector() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& worker : m_workers) worker.join();
+    }
+
+    void CpuProjector::SetPath(Path path) {
+        Path best = GetActivePath();
+        m_path = (best == Path::AVX2 || path != Path::AVX2) && (best != Path::Scalar || path == Path::Scalar) ? path : best;
+    }
+
+    void CpuProjector::ProjectToNV12(const NV12Converter::CubeFaces& cube, const ProjectionLut& lut,
+                                     uint8_t* y, size_t yStride, uint8_t* uv, size_t uvStride) {
+        Job job;
+        job.cube = &cube;
+        job.lut = &lut;
+        job.y = y;
+        job.yStride = yStride;
+        job.uv = uv;
+        job.uvStride = uvStride;
+        Run(job);
+    }
+
+    void CpuProjector::ProjectToRGBA(const NV12Converter::CubeFaces& cube, const ProjectionLut& lut, uint8_t* rgba, size_t stride) {
+        Job job;
+        job.cube = &cube;
+        job.lut = &lut;
+        job.rgba = rgba;
+        job.rgbaStride = stride;
+        Run(job);
+    }
+
+    void CpuProjector::Run(const Job& job) {
+        uint64_t start = NowNanoseconds();
+
+        m_job = job;
+        m_job.bandCount = (job.lut->GetHeight() + kBandRows - 1) / kBandRows;
+        m_nextBand.store(0, std::memory_order_relaxed);
+        m_busyNanoseconds.store(0, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running = (uint32_t)m_workers.size();
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        ProcessBands(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_running == 0; });
+
+        m_stats.frames++;
+        m_stats.pixels += (uint64_t)job.lut->GetWidth() * job.lut->GetHeight();
+        m_stats.busyNanoseconds += m_busyNanoseconds.load(std::memory_order_relaxed);
+        m_stats.wallNanoseconds += NowNanoseconds() - start;
+    }
+
+    void CpuProjector::WorkerLoop(uint32_t worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&] { return m_quit || m_generation != seen; });
+                if (m_quit) return;
+                seen = m_generation;
+            }
+
+            ProcessBands(worker);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_running == 0) m_done.notify_one();
+        }
+    }
+
+    void CpuProjector::ProcessBands(uint32_t worker) {
+        const Job& job = m_job;
+        const uint32_t width = job.lut->GetWidth();
+        const uint32_t height = job.lut->GetHeight();
+        const SampleState state = MakeSampleState(*job.cube);
+
+        SampleRowFn sampleRow = SampleRowScalar;
+        ConvertRowsFn convertRows = ConvertRowsScalar;
+#if WC_PROJECTOR_X86
+        if (m_path == Path::AVX2) { sampleRow = SampleRowAVX2; convertRows = ConvertRowsSSE2; }
+        else if (m_path == Path::SSE2) { sampleRow = SampleRowSSE2; convertRows = ConvertRowsSSE2; }
+#endif
+
+        // Two rows of quantized R, G, B planes
+        std::vector<int16_t>& scratch = m_scratch[worker];
+        if (scratch.size() < (size_t)width * 6) scratch.resize((size_t)width * 6);
+        int16_t* planes = scratch.data();
+        const int16_t* const rows[2][3] = {
+            { planes, planes + width, planes + width * 2 },
+            { planes + width * 3, planes + width * 4, planes + width * 5 }
+        };
+
+        uint64_t start = 0;
+        for (;;) {
+            uint32_t band = m_nextBand.fetch_add(1, std::memory_order_relaxed);
+            if (band >= job.bandCount) break;
+            if (!start) start = NowNanoseconds();
+
+            uint32_t rowEnd = std::min(height, (band + 1) * kBandRows);
+            for (uint32_t row = band * kBandRows; row < rowEnd; row += 2) {
+                uint32_t pair = std::min(2u, rowEnd - row);
+                for (uint32_t i = 0; i < pair; ++i) {
+                    int16_t* out = planes + width * 3 * i;
+                    sampleRow(state, job.lut->GetData() + (size_t)(row + i) * width, 0, width, out, out + width, out + width * 2);
+                }
+
+                if (job.y) {
+                    convertRows(rows, 0, width, job.y + row * job.yStride, job.y + (row + 1) * job.yStride, job.uv + (row / 2) * job.uvStride);
+                    continue;
+                }
+
+                for (uint32_t i = 0; i < pair; ++i) {
+                    uint8_t* out = job.rgba + (row + i) * job.rgbaStride;
+                    for (uint32_t x = 0; x < width; ++x) {
+                        out[x * 4 + 0] = (uint8_t)rows[i][0][x];
+                        out[x * 4 + 1] = (uint8_t)rows[i][1][x];
+                        out[x * 4 + 2] = (uint8_t)rows[i][2][x];
+                        out[x * 4 + 3] = 255;
+                    }
+                }
+            }
+        }
+
+        if (start) m_busyNanoseconds.fetch_add(NowNanoseconds() - start, std::memory_order_relaxed);
+    }
+
+    CpuProjector::Path CpuProjector::GetActivePath() {
+#if WC_PROJECTOR_X86
+        static const Path s_path = CpuSupportsAVX2() ? Path::AVX2 : Path::SSE2;
+        return s_path;
+#else
+        return Path::Scalar;
+#endif
+    }
+
+    const char* CpuProjector::GetPathName(Path path) {
+        switch (path) {
+            case Path::AVX2: return "AVX2";
+            case Path::SSE2: return "SSE2";
+            default: return "Scalar";
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NV12Converter.h"
+#include "ProjectionLut.h"
+
+namespace Compute {
+
+    struct CpuProjectorStats {
+        uint64_t frames = 0;
+        uint64_t pixels = 0;
+        uint64_t busyNanoseconds = 0; // Summed over all threads that worked on a frame
+        uint64_t wallNanoseconds = 0;
+    };
+
+    // CPU projection engine: six RGBA8 faces -> output layout (ProjectionLut) as NV12 or RGBA8.
+    // Output is cut into bands of rows that a persistent worker pool (plus the calling thread) claims in order.
+    // Cube sampling runs 4 (SSE2) or 8 (AVX2) pixels per step, color conversion 8 pixels per step in 16-bit integer
+    // lanes. Every path produces exactly the output of NV12Converter::ProjectCube and so the CubeToNV12 color stage.
+    class CpuProjector {
+    public:
+        enum class Path { Scalar, SSE2, AVX2 };
+
+        static constexpr uint32_t kBandRows = 16;
+
+        // threadCount 0 uses every hardware thread
+        explicit CpuProjector(uint32_t threadCount = 0);
+        ~CpuProjector();
+
+        CpuProjector(const CpuProjector&) = delete;
+        CpuProjector& operator=(const CpuProjector&) = delete;
+
+        // Output has the table's size (even width and height for NV12)
+        void ProjectToNV12(const NV12Converter::CubeFaces& cube, const ProjectionLut& lut,
+                           uint8_t* y, size_t yStride, uint8_t* uv, size_t uvStride);
+        void ProjectToRGBA(const NV12Converter::CubeFaces& cube, const ProjectionLut& lut, uint8_t* rgba, size_t stride);
+
+        // Forces a code path (for validation against the scalar reference); unsupported paths fall back to the best one
+        void SetPath(Path path);
+        Path GetPath() const { return m_path; }
+        uint32_t GetThreadCount() const { return (uint32_t)m_workers.size() + 1; }
+        const CpuProjectorStats& GetStats() const { return m_stats; }
+
+        // Best path supported by this CPU, detected once
+        static Path GetActivePath();
+        static const char* GetPathName(Path path);
+
+    private:
+        struct Job {
+            const NV12Converter::CubeFaces* cube = nullptr;
+            const ProjectionLut* lut = nullptr;
+            uint8_t* y = nullptr;
+            size_t yStride = 0;
+            uint8_t* uv = nullptr;
+            size_t uvStride = 0;
+            uint8_t* rgba = nullptr;
+            size_t rgbaStride = 0;
+            uint32_t bandCount = 0;
+        };
+
+        void Run(const Job& job);
+        void ProcessBands(uint32_t worker);
+        void WorkerLoop(uint32_t worker);
+
+        Path m_path = Path::Scalar;
+        std::vector<std::thread> m_workers;
+        std::vector<std::vector<int16_t>> m_scratch; // Quantized RGB of two rows, per thread (index 0: caller)
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        uint64_t m_generation = 0;
+        uint32_t m_running = 0;
+        bool m_quit = false;
+
+        Job m_job;
+        std::atomic<uint32_t> m_nextBand{ 0 };
+        std::atomic<uint64_t> m_busyNanoseconds{ 0 };
+
+        CpuProjectorStats m_stats;
+    };
+}
@@ -0,0 +1,39 @@
+// CubeProjection.hlsli
+// Output -> cube face gather shared by the projection kernels (any ProjectionLayout). The mapping comes from a precomputed table
+// (Compute::ProjectionLut, rebuilt on resize), so no trigonometry or face selection runs per pixel.
+// Compute::NV12Converter::ProjectCube mirrors this on the CPU with the same table.
+
+Texture2DArray<float4> g_InputFaces : register(t0); // Six cube faces (D3D cube face order)
+Texture2D<uint> g_ProjectionLut : register(t1);     // One packed (face, u, v) entry per output pixel
+SamplerState g_Sampler : register(s0);
+
+cbuffer ProjectionParams : register(b0)
+{
+    float4 g_FaceScale[6];  // x: fraction of the slice the face was rendered into (top-left), 0 = face not rendered
+};
+
+// ProjectionLut entry layout
+static const uint LUT_COORD_BITS = 14;
+static const uint LUT_COORD_MAX = (1u << LUT_COORD_BITS) - 1;
+static const uint LUT_FACE_SHIFT = 2 * LUT_COORD_BITS;
+static const float LUT_COORD_SCALE = 1.0f / (float)LUT_COORD_MAX;
+
+// Cube color seen by output pixel pos; black where the face was not rendered
+float3 SampleProjection(uint2 pos)
+{
+    uint entry = g_ProjectionLut[pos];
+    uint face = (entry >> LUT_FACE_SHIFT) & 7;
+    float2 coords = float2(entry & LUT_COORD_MAX, (entry >> LUT_COORD_BITS) & LUT_COORD_MAX) * LUT_COORD_SCALE;
+
+    float scale = g_FaceScale[face].x;
+    if (scale <= 0.0f) return float3(0.0f, 0.0f, 0.0f);
+
+    // Reduced faces cover only part of the slice; clamp half a texel inside it so filtering never reads past the edge
+    uint faceWidth, faceHeight, faceCount;
+    g_InputFaces.GetDimensions(faceWidth, faceHeight, faceCount);
+    float halfTexel = 0.5f / (float)faceWidth;
+    float2 faceUV = clamp(coords * scale, halfTexel, scale - halfTexel);
+
+    // We sample LoD 0 directly
+    return g_InputFaces.SampleLevel(g_Sampler, float3(faceUV, (float)face), 0).rgb;
+}
@@ -0,0 +1,43 @@
+// CubeToNV12.hlsl
+// Fused projection and color conversion: samples the cube faces straight into the NV12 planes of the encoder input
+// (full-range BT.709), one thread per 2x2 pixel block. No intermediate RGBA equirect is written. The planes are views
+// of one slice of the encoder's surface array.
+// The integer color stage is mirrored bit-exactly by Compute::NV12Converter.
+
+#include "CubeProjection.hlsli"
+
+RWTexture2DArray<uint> g_OutputY : register(u0);   // Luma plane (R8_UINT view of a single slice)
+RWTexture2DArray<uint2> g_OutputUV : register(u1); // Chroma plane, half resolution (R8G8_UINT view)
+
+// BT.709 in 16.16 fixed point; the luma row sums to 65536, the chroma rows to 0
+static const int3 RGB2Y = int3(13933, 46871, 4732);
+static const int3 RGB2U = int3(-7510, -25258, 32768);
+static const int3 RGB2V = int3(32768, -29767, -3001);
+
+[numthreads(8, 8, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint width, height, slices;
+    g_OutputY.GetDimensions(width, height, slices);
+
+    // Output dimensions are even
+    uint2 pos = DTid.xy * 2;
+    if (pos.x >= width || pos.y >= height) return;
+
+    int3 sum = int3(0, 0, 0);
+    [unroll]
+    for (uint i = 0; i < 4; ++i) {
+        uint2 p = pos + uint2(i & 1, i >> 1);
+        float3 color = SampleProjection(p);
+        int3 rgb = (int3)(saturate(color) * 255.0f + 0.5f);
+
+        g_OutputY[uint3(p, 0)] = (uint)((dot(rgb, RGB2Y) + 32768) >> 16);
+        sum += rgb;
+    }
+
+    // Chroma of the exact block average: the sums carry two extra fraction bits. The offset keeps every term
+    // non-negative, so the shifts round down.
+    int u = (dot(sum, RGB2U) + (128 << 18) + (1 << 17)) >> 18;
+    int v = (dot(sum, RGB2V) + (128 << 18) + (1 << 17)) >> 18;
+    g_OutputUV[uint3(DTid.xy, 0)] = uint2(min(u, 255), min(v, 255));
+}
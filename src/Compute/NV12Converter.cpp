@@ -0,0 +1,99 @@
+#include "NV12Converter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Compute {
+
+    namespace {
+        // Same constants as CubeToNV12.hlsl
+        constexpr int kRGB2Y[3] = { 13933, 46871, 4732 };
+        constexpr int kRGB2U[3] = { -7510, -25258, 32768 };
+        constexpr int kRGB2V[3] = { 32768, -29767, -3001 };
+
+        // SampleLevel with a linear filter and clamp addressing on one RGBA8 slice
+        void SampleBilinear(const uint8_t* face, size_t stride, uint32_t size, float u, float v, float* rgb) {
+            float tx = u * size - 0.5f;
+            float ty = v * size - 0.5f;
+            float fx0 = std::floor(tx), fy0 = std::floor(ty);
+            float wx = tx - fx0, wy = ty - fy0;
+            int x0 = std::clamp((int)fx0, 0, (int)size - 1), x1 = std::clamp((int)fx0 + 1, 0, (int)size - 1);
+            int y0 = std::clamp((int)fy0, 0, (int)size - 1), y1 = std::clamp((int)fy0 + 1, 0, (int)size - 1);
+
+            const uint8_t* r0 = face + y0 * stride;
+            const uint8_t* r1 = face + y1 * stride;
+            for (int c = 0; c < 3; ++c) {
+                float top = r0[x0 * 4 + c] + (r0[x1 * 4 + c] - r0[x0 * 4 + c]) * wx;
+                float bottom = r1[x0 * 4 + c] + (r1[x1 * 4 + c] - r1[x0 * 4 + c]) * wx;
+                rgb[c] = (top + (bottom - top) * wy) / 255.0f;
+            }
+        }
+
+        // SampleProjection from CubeProjection.hlsli
+        void SampleProjection(const NV12Converter::CubeFaces& cube, uint32_t entry, float* rgb) {
+            float faceU, faceV;
+            int face = ProjectionLut::Unpack(entry, &faceU, &faceV);
+            float scale = cube.faceScale[face];
+            if (scale <= 0.0f || !cube.faces[face]) {
+                rgb[0] = rgb[1] = rgb[2] = 0.0f;
+                return;
+            }
+
+            float halfTexel = 0.5f / (float)cube.faceSize;
+            faceU = std::clamp(faceU * scale, halfTexel, scale - halfTexel);
+            faceV = std::clamp(faceV * scale, halfTexel, scale - halfTexel);
+            SampleBilinear(cube.faces[face], cube.stride, cube.faceSize, faceU, faceV, rgb);
+        }
+    }
+
+    uint8_t NV12Converter::Luma(int r, int g, int b) {
+        return (uint8_t)((r * kRGB2Y[0] + g * kRGB2Y[1] + b * kRGB2Y[2] + 32768) >> 16);
+    }
+
+    void NV12Converter::Chroma(int rSum, int gSum, int bSum, uint8_t* outU, uint8_t* outV) {
+        // Offset keeps the sums non-negative, so the shifts round down exactly like the kernel
+        int u = (rSum * kRGB2U[0] + gSum * kRGB2U[1] + bSum * kRGB2U[2] + (128 << 18) + (1 << 17)) >> 18;
+        int v = (rSum * kRGB2V[0] + gSum * kRGB2V[1] + bSum * kRGB2V[2] + (128 << 18) + (1 << 17)) >> 18;
+        *outU = (uint8_t)std::min(u, 255);
+        *outV = (uint8_t)std::min(v, 255);
+    }
+
+    uint8_t NV12Converter::Quantize(float value) {
+        return (uint8_t)(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    void NV12Converter::ConvertRGBA(const uint8_t* rgba, size_t rgbaStride, uint32_t width, uint32_t height,
+                                    uint8_t* y, size_t yStride, uint8_t* uv, size_t uvStride) {
+        for (uint32_t by = 0; by < height / 2; ++by) {
+            for (uint32_t bx = 0; bx < width / 2; ++bx) {
+                int sum[3] = {};
+                for (uint32_t i = 0; i < 4; ++i) {
+                    uint32_t px = bx * 2 + (i & 1), py = by * 2 + (i >> 1);
+                    const uint8_t* p = rgba + py * rgbaStride + px * 4;
+                    y[py * yStride + px] = Luma(p[0], p[1], p[2]);
+                    for (int c = 0; c < 3; ++c) sum[c] += p[c];
+                }
+                Chroma(sum[0], sum[1], sum[2], &uv[by * uvStride + bx * 2], &uv[by * uvStride + bx * 2 + 1]);
+            }
+        }
+    }
+
+    void NV12Converter::ProjectCube(const CubeFaces& cube, const ProjectionLut& lut,
+                                    uint8_t* y, size_t yStride, uint8_t* uv, size_t uvStride) {
+        uint32_t width = lut.GetWidth(), height = lut.GetHeight();
+        for (uint32_t by = 0; by < height / 2; ++by) {
+            for (uint32_t bx = 0; bx < width / 2; ++bx) {
+                int sum[3] = {};
+                for (uint32_t i = 0; i < 4; ++i) {
+                    uint32_t px = bx * 2 + (i & 1), py = by * 2 + (i >> 1);
+                    float color[3];
+                    SampleProjection(cube, lut.GetEntry(px, py), color);
+
+                    int rgb[3] = { Quantize(color[0]), Quantize(color[1]), Quantize(color[2]) };
+                    y[py * yStride + px] = Luma(rgb[0], rgb[1], rgb[2]);
+                    for (int c = 0; c < 3; ++c) sum[c] += rgb[c];
+                }
+                Chroma(sum[0], sum[1], sum[2], &uv[by * uvStride + bx * 2], &uv[by * uvStride + bx * 2 + 1]);
+            }
+        }
+    }
+}
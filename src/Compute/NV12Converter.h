@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ProjectionLut.h"
+
+namespace Compute {
+
+    // CPU reference of CubeToNV12.hlsl for validation. The color stage (8-bit RGB to full-range BT.709 NV12, chroma
+    // from the exact 2x2 average) is integer arithmetic and matches the kernel bit for bit. ProjectCube reads the same
+    // ProjectionLut as the kernel and filters bilinearly in float; the GPU's filter precision can move a sample by one
+    // RGB step before the color stage.
+    class NV12Converter {
+    public:
+        // Six RGBA8 face slices in D3D cube face order, as the projection kernels see them
+        struct CubeFaces {
+            const uint8_t* faces[6] = {};
+            uint32_t faceSize = 0;  // Slice edge length in texels
+            size_t stride = 0;      // Bytes per row
+            float faceScale[6] = {}; // Rendered fraction of each slice (top-left), 0 = not rendered
+        };
+
+        // 16.16 fixed-point BT.709 full range
+        static uint8_t Luma(int r, int g, int b);
+        // Chroma of a 2x2 block from the sums of its four 8-bit samples (no rounding of the average)
+        static void Chroma(int rSum, int gSum, int bSum, uint8_t* outU, uint8_t* outV);
+        // [0, 1] to 8 bits, as the kernel rounds filtered colors
+        static uint8_t Quantize(float value);
+
+        // RGBA8 image with even dimensions to NV12 planes (uv holds interleaved U, V at half resolution)
+        static void ConvertRGBA(const uint8_t* rgba, size_t rgbaStride, uint32_t width, uint32_t height,
+                                uint8_t* y, size_t yStride, uint8_t* uv, size_t uvStride);
+
+        // Full kernel: projection of the cube straight into NV12 planes of the table's size (even width and height)
+        static void ProjectCube(const CubeFaces& cube, const ProjectionLut& lut,
+                                uint8_t* y, size_t yStride, uint8_t* uv, size_t uvStride);
+    };
+}
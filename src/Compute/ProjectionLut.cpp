@@ -0,0 +1,133 @@
+#include "ProjectionLut.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Compute {
+
+    namespace {
+        constexpr double kPi = 3.14159265358979323846;
+
+        uint32_t QuantizeCoord(double value) {
+            double scaled = value * ProjectionLut::kCoordMax + 0.5;
+            if (scaled <= 0.0) return 0;
+            if (scaled >= (double)ProjectionLut::kCoordMax) return ProjectionLut::kCoordMax;
+            return (uint32_t)scaled;
+        }
+
+        // Face coordinate (cube, [0, 1]) of a tile coordinate ([0, 1]) and back. EAC spaces samples evenly in angle:
+        // a tile coordinate t covers the angle (t - 0.5) * PI/2 from the face center.
+        double TileToFace(ProjectionLayout layout, double t) {
+            if (layout != ProjectionLayout::EAC3x2) return t;
+            return std::tan((t - 0.5) * kPi / 2.0) * 0.5 + 0.5;
+        }
+
+        double FaceToTile(ProjectionLayout layout, double c) {
+            if (layout != ProjectionLayout::EAC3x2) return c;
+            return std::atan(c * 2.0 - 1.0) * 2.0 / kPi + 0.5;
+        }
+    }
+
+    uint32_t ProjectionLut::Pack(int face, double u, double v) {
+        return QuantizeCoord(u) | (QuantizeCoord(v) << kCoordBits) | ((uint32_t)face << kFaceShift);
+    }
+
+    int ProjectionLut::Unpack(uint32_t entry, float* outU, float* outV) {
+        // Same expression as the kernels (multiply by the rounded reciprocal), so both unpack identical coordinates
+        constexpr float kScale = 1.0f / (float)kCoordMax;
+        *outU = (float)(entry & kCoordMax) * kScale;
+        *outV = (float)((entry >> kCoordBits) & kCoordMax) * kScale;
+        return (int)((entry >> kFaceShift) & 7);
+    }
+
+    int ProjectionLut::MapDirection(double x, double y, double z, double* outU, double* outV) {
+        double ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+        int face;
+        double sc, tc, ma;
+        if (ax >= ay && ax >= az) {
+            ma = ax;
+            face = x > 0.0 ? 0 : 1;
+            sc = x > 0.0 ? -z : z;
+            tc = -y;
+        } else if (ay >= az) {
+            ma = ay;
+            face = y > 0.0 ? 2 : 3;
+            sc = x;
+            tc = y > 0.0 ? z : -z;
+        } else {
+            ma = az;
+            face = z > 0.0 ? 4 : 5;
+            sc = z > 0.0 ? x : -x;
+            tc = -y;
+        }
+        *outU = sc / ma * 0.5 + 0.5;
+        *outV = tc / ma * 0.5 + 0.5;
+        return face;
+    }
+
+    int ProjectionLut::MapPixel(ProjectionLayout layout, uint32_t x, uint32_t y, uint32_t width, uint32_t height, double longitudeSpan,
+                                double* outU, double* outV) {
+        if (layout == ProjectionLayout::Equirect) {
+            // Same sample positions as the analytic shader had: pixel corners, theta in [-span/2, span/2), phi in [-PI/2, PI/2)
+            double theta = ((double)x / width - 0.5) * longitudeSpan;
+            double phi = (double)y / height * kPi - kPi / 2.0;
+            return MapDirection(std::cos(phi) * std::sin(theta), std::sin(phi), std::cos(phi) * std::cos(theta), outU, outV);
+        }
+
+        // Columns and rows past the last whole tile (width not a multiple of 3, odd height) repeat its edge, so every
+        // pixel stays on one of the six faces
+        uint32_t tileWidth = std::max(width / 3, 1u), tileHeight = std::max(height / 2, 1u);
+        uint32_t column = std::min(x / tileWidth, 2u), row = std::min(y / tileHeight, 1u);
+        *outU = TileToFace(layout, std::min(((x - column * tileWidth) + 0.5) / tileWidth, 1.0));
+        *outV = TileToFace(layout, std::min(((y - row * tileHeight) + 0.5) / tileHeight, 1.0));
+        // Tiles are row-major in D3D cube face order, which is Spherical Video V2 cubemap layout 0
+        return (int)(row * 3 + column);
+    }
+
+    void ProjectionLut::MapFace(ProjectionLayout layout, int face, double u, double v, uint32_t width, uint32_t height,
+                                double* outX, double* outY) {
+        uint32_t tileWidth = width / 3, tileHeight = height / 2;
+        *outX = (face % 3) * tileWidth + FaceToTile(layout, u) * tileWidth;
+        *outY = (face / 3) * tileHeight + FaceToTile(layout, v) * tileHeight;
+    }
+
+    bool ProjectionLut::Build(ProjectionLayout layout, uint32_t width, uint32_t height, float longitudeSpan) {
+        if (layout == m_layout && width == m_width && height == m_height && longitudeSpan == m_longitudeSpan && !m_entries.empty()) return false;
+
+        m_layout = layout;
+        m_width = width;
+        m_height = height;
+        m_longitudeSpan = longitudeSpan;
+        m_entries.resize((size_t)width * height);
+
+        if (layout != ProjectionLayout::Equirect) {
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    double u, v;
+                    int face = MapPixel(layout, x, y, width, height, longitudeSpan, &u, &v);
+                    m_entries[(size_t)y * width + x] = Pack(face, u, v);
+                }
+            }
+            return true;
+        }
+
+        // The mapping is separable in trigonometry: one sin/cos pair per column and per row
+        std::vector<double> sinTheta(width), cosTheta(width);
+        for (uint32_t x = 0; x < width; ++x) {
+            double theta = ((double)x / width - 0.5) * longitudeSpan;
+            sinTheta[x] = std::sin(theta);
+            cosTheta[x] = std::cos(theta);
+        }
+
+        for (uint32_t y = 0; y < height; ++y) {
+            double phi = (double)y / height * kPi - kPi / 2.0;
+            double sinPhi = std::sin(phi), cosPhi = std::cos(phi);
+            uint32_t* row = &m_entries[(size_t)y * width];
+            for (uint32_t x = 0; x < width; ++x) {
+                double u, v;
+                int face = MapDirection(cosPhi * sinTheta[x], sinPhi, cosPhi * cosTheta[x], &u, &v);
+                row[x] = Pack(face, u, v);
+            }
+        }
+        return true;
+    }
+}
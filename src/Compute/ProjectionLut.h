@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Compute {
+
+    // Arrangement of the sphere in the output video
+    enum class ProjectionLayout {
+        Equirect, // Longitude x latitude (2:1 for 360)
+        Cube3x2,  // Cube faces as tiles: Right, Left, Up on top, Down, Front, Back below (Spherical Video V2 layout 0)
+        EAC3x2    // Cube3x2 with equi-angular sampling inside each tile (uniform angle per pixel)
+    };
+
+    // Precomputed output -> cube mapping: one packed (face, u, v) entry per output pixel, built once per output size
+    // and shared by the projection kernels (uploaded as an R32_UINT texture) and the CPU reference. The per-frame
+    // projection is then a table read and a filtered gather, with no trigonometry or face selection.
+    // Entry layout: u in bits 0-13, v in bits 14-27 (unorm over the face), face in bits 28-30 (D3D cube face order).
+    class ProjectionLut {
+    public:
+        static constexpr uint32_t kCoordBits = 14;
+        static constexpr uint32_t kCoordMax = (1u << kCoordBits) - 1;
+        static constexpr uint32_t kFaceShift = 2 * kCoordBits;
+
+        // Rebuilds the table for a new layout, output size or longitude span (equirect only); returns false when it is
+        // already current. 3x2 layouts tile width / 3 by height / 2; any remainder repeats the last tile's edge.
+        bool Build(ProjectionLayout layout, uint32_t width, uint32_t height, float longitudeSpan);
+
+        ProjectionLayout GetLayout() const { return m_layout; }
+        uint32_t GetWidth() const { return m_width; }
+        uint32_t GetHeight() const { return m_height; }
+        const uint32_t* GetData() const { return m_entries.data(); }
+        uint32_t GetEntry(uint32_t x, uint32_t y) const { return m_entries[(size_t)y * m_width + x]; }
+
+        static uint32_t Pack(int face, double u, double v);
+        static int Unpack(uint32_t entry, float* outU, float* outV);
+
+        // Analytic mapping the table is built from: face (D3D cube face order) and [0, 1] face coordinates seen by
+        // output pixel (x, y). Equirect longitude spans longitudeSpan centered on the front face, latitude runs top to
+        // bottom; 3x2 layouts sample tile pixel centers.
+        static int MapPixel(ProjectionLayout layout, uint32_t x, uint32_t y, uint32_t width, uint32_t height, double longitudeSpan,
+                            double* outU, double* outV);
+        // Inverse for the 3x2 layouts: continuous output pixel position of face coordinates (u, v)
+        static void MapFace(ProjectionLayout layout, int face, double u, double v, uint32_t width, uint32_t height,
+                            double* outX, double* outY);
+        // Face and [0, 1] face coordinates of a direction, matching TextureCube addressing (+X, -X, +Y, -Y, +Z, -Z)
+        static int MapDirection(double x, double y, double z, double* outU, double* outV);
+
+    private:
+        std::vector<uint32_t> m_entries;
+        ProjectionLayout m_layout = ProjectionLayout::Equirect;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+        float m_longitudeSpan = 0.0f;
+    };
+}
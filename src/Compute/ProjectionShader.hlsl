@@ -1,12 +1,10 @@
 // ProjectionShader.hlsl
-// Converts a Cubemap (or Texture2DArray of 6 faces) to Equirectangular Projection
+// Converts the six cube faces (Texture2DArray slices, D3D cube face order) to the output layout (equirect or 3x2).
+// Fallback for GPUs without NV12 UAVs; CubeToNV12.hlsl writes the encoder input directly otherwise.
 
-TextureCube<float4> g_InputCubemap : register(t0);
-RWTexture2D<float4> g_OutputTexture : register(u0);
-
-SamplerState g_Sampler : register(s0);
+#include "CubeProjection.hlsli"
 
-static const float PI = 3.14159265359f;
+RWTexture2D<float4> g_OutputTexture : register(u0);
 
 [numthreads(16, 16, 1)]
 void main(uint3 DTid : SV_DispatchThreadID)
@@ -16,25 +14,5 @@ void main(uint3 DTid : SV_DispatchThreadID)
 
     if (DTid.x >= width || DTid.y >= height) return;
 
-    // Normalizing coordinates to [0, 1]
-    float2 uv = float2(DTid.x, DTid.y) / float2(width, height);
-
-    // Spherical coordinates
-    // Theta (Longitude): [-PI, PI]
-    // Phi (Latitude): [-PI/2, PI/2]
-    float theta = uv.x * 2.0f * PI - PI;
-    float phi = uv.y * PI - PI / 2.0f;
-
-    // Converting to direction vector
-    // Assuming Y-up coordinate system
-    float3 dir;
-    dir.x = cos(phi) * sin(theta);
-    dir.y = sin(phi);      
-    dir.z = cos(phi) * cos(theta);
-
-    // Sampling the cubemap
-    // We sample LoD 0 directly
-    float4 color = g_InputCubemap.SampleLevel(g_Sampler, normalize(dir), 0);
-
-    g_OutputTexture[DTid.xy] = color;
+    g_OutputTexture[DTid.xy] = float4(SampleProjection(DTid.xy), 1.0f);
 }
@@ -0,0 +1,225 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cwchar>
+#include <cstdint>
+#include <cstdlib>
+#include "../Compute/ProjectionLut.h"
+#include "../Video/Encoder.h"
+
+// How intercepted camera draws are replicated into the six cube faces
+enum class ReplayMode {
+    Immediate, // Re-render each draw six times as it is issued
+    FaceMajor, // Record draws and replay the log once per face (six render target switches per flush)
+    SinglePass // Draw once through a generated instanced GS that writes all six faces (per-face fallback otherwise)
+};
+
+// When a FaceMajor log is replayed. Replaying earlier keeps dynamic buffers the draws read closer to their contents
+// at record time.
+enum class ReplayFlush {
+    Present,      // Once per frame
+    PassBoundary  // Whenever the game switches depth-stencil target, and at present
+};
+
+// Part of the sphere written to the output video
+enum class Coverage {
+    Full, // 360 x 180 equirectangular (2:1)
+    VR180 // Front hemisphere, 180 x 180 equirectangular (1:1)
+};
+
+// Which encoder the capture is written with
+enum class EncoderBackend {
+    Auto,     // Hardware, falling back to software when neither NVENC nor AMF opens
+    Hardware, // NVENC/AMF fed from GPU surfaces
+    Software  // CPU encoder fed from staged readbacks of the GPU output
+};
+
+// Resolution of each cube face relative to the full face size, indexed like Camera::CubeFace
+// (Right, Left, Up, Down, Front, Back). A scale of 0 skips the face entirely.
+struct FaceBudget {
+    static constexpr int kFaceCount = 6;
+
+    float scale[kFaceCount] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+
+    bool IsActive(int face) const { return scale[face] > 0.0f; }
+
+    uint32_t GetActiveMask() const {
+        uint32_t mask = 0;
+        for (int i = 0; i < kFaceCount; ++i) {
+            if (IsActive(i)) mask |= 1u << i;
+        }
+        return mask;
+    }
+
+    // Rendered edge length in pixels (0 when skipped)
+    uint32_t GetResolution(int face, uint32_t faceSize) const {
+        if (!IsActive(face)) return 0;
+        uint32_t size = (uint32_t)(scale[face] * faceSize + 0.5f);
+        return size < 1 ? 1 : (size > faceSize ? faceSize : size);
+    }
+};
+
+// Capture settings, read from the [Capture] section of WideCapture.ini in the working directory
+struct CaptureConfig {
+    ReplayMode replayMode = ReplayMode::Immediate;
+    ReplayFlush replayFlush = ReplayFlush::Present;
+    Coverage coverage = Coverage::Full;
+    Compute::ProjectionLayout layout = Compute::ProjectionLayout::Equirect;
+    FaceBudget faceBudget;
+
+    // Temporal face schedule: each face renders every faceInterval[i] frames (1 = every frame) and keeps its last
+    // contents in between. Camera moves beyond refreshAngle degrees or refreshDistance world units (0 = off) between
+    // frames re-render every face.
+    uint32_t faceInterval[FaceBudget::kFaceCount] = { 1, 1, 1, 1, 1, 1 };
+    float refreshAngle = 10.0f;
+    float refreshDistance = 0.0f;
+
+    // Output frame rate, independent of the game frame rate. Frames between capture slots skip the face rendering,
+    // projection and encode entirely. gameFrameTime > 0 times capture by game frames of that many milliseconds
+    // (fixed-timestep or slowed-down games) instead of the wall clock. variableFrameRate stamps frames with their real
+    // capture time instead of their slot index.
+    uint32_t captureFps = 60;
+    float gameFrameTime = 0.0f;
+    bool variableFrameRate = false;
+
+    // Captured frames waiting for the encoding thread (0 encodes on the present thread) and what happens when the
+    // encoder falls behind that far
+    uint32_t encodeQueueDepth = 3;
+    Video::QueuePolicy encodeQueuePolicy = Video::QueuePolicy::Block;
+
+    // Container layout on disk (fragmented by default, so a crash leaves a playable file). In replay mode
+    // saveReplayKey (a virtual-key code) writes the buffered window.
+    Video::OutputOptions output;
+    uint32_t saveReplayKey = VK_F8;
+
+    // Average bit rate, and how much coarser the polar bands of equirect output are encoded (default: 4 QP beyond 60
+    // degrees, 8 beyond 75). The bands only apply to the software encoders; NVENC and AMF encode every row alike.
+    uint32_t bitrateMbps = 50;
+    Video::RoiProfile roiProfile = { { { 60.0f, 4 }, { 75.0f, 8 } } };
+
+    // Encoder sessions the output is split between, as a grid of columns x rows tiles, each a track of its own
+    uint32_t tileColumns = 1;
+    uint32_t tileRows = 1;
+
+    // Encoder selection; softwarePreset empty uses the codec's realtime default
+    EncoderBackend encoder = EncoderBackend::Auto;
+    Video::SoftwareCodec softwareCodec = Video::SoftwareCodec::X264;
+    std::string softwarePreset;
+
+    static CaptureConfig Load(const wchar_t* path = L".\\WideCapture.ini") {
+        CaptureConfig config;
+
+        wchar_t value[64];
+        GetPrivateProfileStringW(L"Capture", L"ReplayMode", L"immediate", value, 64, path);
+        if (_wcsicmp(value, L"face_major") == 0) config.replayMode = ReplayMode::FaceMajor;
+        else if (_wcsicmp(value, L"single_pass") == 0) config.replayMode = ReplayMode::SinglePass;
+
+        GetPrivateProfileStringW(L"Capture", L"ReplayFlush", L"present", value, 64, path);
+        if (_wcsicmp(value, L"pass") == 0) config.replayFlush = ReplayFlush::PassBoundary;
+
+        // Layout=cube or eac stores the faces as 3x2 tiles (6 face areas instead of the equirect's 8); always full sphere
+        GetPrivateProfileStringW(L"Capture", L"Layout", L"equirect", value, 64, path);
+        if (_wcsicmp(value, L"cube") == 0) config.layout = Compute::ProjectionLayout::Cube3x2;
+        else if (_wcsicmp(value, L"eac") == 0) config.layout = Compute::ProjectionLayout::EAC3x2;
+
+        // VR180 never sees the Back face and only the front half of the side faces, which are viewed at grazing angles
+        GetPrivateProfileStringW(L"Capture", L"Coverage", L"full", value, 64, path);
+        if (_wcsicmp(value, L"vr180") == 0 && config.layout == Compute::ProjectionLayout::Equirect) {
+            config.coverage = Coverage::VR180;
+            config.faceBudget = { { 0.5f, 0.5f, 0.5f, 0.5f, 1.0f, 0.0f } };
+        }
+
+        // FaceScale=right,left,up,down,front,back overrides the coverage defaults
+        GetPrivateProfileStringW(L"Capture", L"FaceScale", L"", value, 64, path);
+        float scale[FaceBudget::kFaceCount];
+        if (swscanf_s(value, L"%f,%f,%f,%f,%f,%f", &scale[0], &scale[1], &scale[2], &scale[3], &scale[4], &scale[5]) == FaceBudget::kFaceCount) {
+            for (int i = 0; i < FaceBudget::kFaceCount; ++i) {
+                config.faceBudget.scale[i] = scale[i] < 0.0f ? 0.0f : (scale[i] > 1.0f ? 1.0f : scale[i]);
+            }
+        }
+
+        // FaceInterval=right,left,up,down,front,back, e.g. 1,1,3,3,1,3 refreshes Up/Down/Back round-robin
+        GetPrivateProfileStringW(L"Capture", L"FaceInterval", L"", value, 64, path);
+        unsigned int interval[FaceBudget::kFaceCount];
+        if (swscanf_s(value, L"%u,%u,%u,%u,%u,%u", &interval[0], &interval[1], &interval[2], &interval[3], &interval[4], &interval[5]) == FaceBudget::kFaceCount) {
+            for (int i = 0; i < FaceBudget::kFaceCount; ++i) config.faceInterval[i] = interval[i] ? interval[i] : 1;
+        }
+
+        GetPrivateProfileStringW(L"Capture", L"RefreshAngle", L"10", value, 64, path);
+        config.refreshAngle = (float)_wtof(value);
+        GetPrivateProfileStringW(L"Capture", L"RefreshDistance", L"0", value, 64, path);
+        config.refreshDistance = (float)_wtof(value);
+
+        config.captureFps = GetPrivateProfileIntW(L"Capture", L"CaptureFps", 60, path);
+        if (config.captureFps == 0) config.captureFps = 60;
+
+        // CaptureClock=game times capture by GameFrameTime milliseconds per game frame (default: one capture slot)
+        GetPrivateProfileStringW(L"Capture", L"CaptureClock", L"wall", value, 64, path);
+        if (_wcsicmp(value, L"game") == 0) {
+            GetPrivateProfileStringW(L"Capture", L"GameFrameTime", L"0", value, 64, path);
+            config.gameFrameTime = (float)_wtof(value);
+            if (config.gameFrameTime <= 0.0f) config.gameFrameTime = 1000.0f / config.captureFps;
+        }
+
+        config.variableFrameRate = GetPrivateProfileIntW(L"Capture", L"VariableFrameRate", 0, path) != 0;
+
+        config.encodeQueueDepth = GetPrivateProfileIntW(L"Capture", L"EncodeQueue", 3, path);
+        if (config.encodeQueueDepth > 16) config.encodeQueueDepth = 16;
+        GetPrivateProfileStringW(L"Capture", L"EncodeQueuePolicy", L"block", value, 64, path);
+        if (_wcsicmp(value, L"drop_oldest") == 0) config.encodeQueuePolicy = Video::QueuePolicy::DropOldest;
+        else if (_wcsicmp(value, L"drop_newest") == 0) config.encodeQueuePolicy = Video::QueuePolicy::DropNewest;
+
+        // OutputMode=faststart restores the single rewritten file; segmented cuts SegmentSeconds long files; replay keeps
+        // the last ReplaySeconds in memory until SaveReplayKey is pressed
+        GetPrivateProfileStringW(L"Capture", L"OutputMode", L"fragmented", value, 64, path);
+        if (_wcsicmp(value, L"faststart") == 0) config.output.mode = Video::OutputMode::Faststart;
+        else if (_wcsicmp(value, L"segmented") == 0) config.output.mode = Video::OutputMode::Segmented;
+        else if (_wcsicmp(value, L"replay") == 0) config.output.mode = Video::OutputMode::Replay;
+        config.output.segmentSeconds = GetPrivateProfileIntW(L"Capture", L"SegmentSeconds", 60, path);
+        if (config.output.segmentSeconds == 0) config.output.segmentSeconds = 60;
+        config.output.replaySeconds = GetPrivateProfileIntW(L"Capture", L"ReplaySeconds", 30, path);
+        if (config.output.replaySeconds == 0) config.output.replaySeconds = 30;
+        if (config.output.replaySeconds > 600) config.output.replaySeconds = 600;
+        // Decimal or 0x hex
+        GetPrivateProfileStringW(L"Capture", L"SaveReplayKey", L"0x77", value, 64, path);
+        config.saveReplayKey = (uint32_t)wcstoul(value, nullptr, 0);
+        if (config.saveReplayKey == 0 || config.saveReplayKey > 0xFE) config.saveReplayKey = VK_F8;
+
+        config.bitrateMbps = GetPrivateProfileIntW(L"Capture", L"Bitrate", 50, path);
+        if (config.bitrateMbps == 0) config.bitrateMbps = 50;
+
+        // PoleQp=latitude:offset,... e.g. 60:4,75:8; PoleQp=off encodes every row alike. Software encoders only.
+        GetPrivateProfileStringW(L"Capture", L"PoleQp", L"60:4,75:8", value, 64, path);
+        if (_wcsicmp(value, L"off") == 0 || value[0] == L'\0') {
+            config.roiProfile.bands.clear();
+        } else {
+            Video::RoiProfile profile;
+            Video::LatitudeBand band;
+            int consumed = 0;
+            for (const wchar_t* c = value; swscanf_s(c, L"%f:%d%n", &band.minLatitude, &band.qpOffset, &consumed) == 2; c += consumed) {
+                profile.bands.push_back(band);
+                if (c[consumed] != L',') break;
+                consumed++;
+            }
+            if (!profile.bands.empty()) config.roiProfile = profile;
+        }
+
+        // TileColumns=4 splits an 8K equirect into four 2K-wide tracks; 3x2 on a cube or EAC layout gives a track per face
+        config.tileColumns = GetPrivateProfileIntW(L"Capture", L"TileColumns", 1, path);
+        config.tileRows = GetPrivateProfileIntW(L"Capture", L"TileRows", 1, path);
+        config.tileColumns = config.tileColumns < 1 ? 1 : (config.tileColumns > 8 ? 8 : config.tileColumns);
+        config.tileRows = config.tileRows < 1 ? 1 : (config.tileRows > 8 ? 8 : config.tileRows);
+
+        // Encoder=software skips the GPU encoder; SoftwareCodec=x264, x265 or svtav1 picks the CPU one
+        GetPrivateProfileStringW(L"Capture", L"Encoder", L"auto", value, 64, path);
+        if (_wcsicmp(value, L"hardware") == 0) config.encoder = EncoderBackend::Hardware;
+        else if (_wcsicmp(value, L"software") == 0) config.encoder = EncoderBackend::Software;
+        GetPrivateProfileStringW(L"Capture", L"SoftwareCodec", L"x264", value, 64, path);
+        if (_wcsicmp(value, L"x265") == 0) config.softwareCodec = Video::SoftwareCodec::X265;
+        else if (_wcsicmp(value, L"svtav1") == 0) config.softwareCodec = Video::SoftwareCodec::SvtAv1;
+        GetPrivateProfileStringW(L"Capture", L"SoftwarePreset", L"", value, 64, path);
+        for (const wchar_t* c = value; *c; ++c) config.softwarePreset += (char)*c; // Preset names are ASCII
+
+        return config;
+    }
+};
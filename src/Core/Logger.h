@@ -17,10 +17,12 @@ public:
     enum class Level { Info, Warning, Error };
 
     static void Init() {
+#ifdef _WIN32
         AllocConsole();
         FILE* f;
         freopen_s(&f, "CONOUT$", "w", stdout);
         freopen_s(&f, "CONOUT$", "w", stderr);
+#endif
         
         m_logFile.open("WideCapture.log", std::ios::out | std::ios::trunc);
     }
@@ -29,7 +31,9 @@ public:
         if (m_logFile.is_open()) {
             m_logFile.close();
         }
+#ifdef _WIN32
         FreeConsole();
+#endif
     }
 
     template<typename... Args>
@@ -48,7 +52,11 @@ public:
 
         std::time_t t = std::time(nullptr);
         std::tm tm;
+#ifdef _WIN32
         localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
 
         std::stringstream timestamp;
         timestamp << std::put_time(&tm, "%H:%M:%S");
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+// Sequence lock for small trivially copyable snapshots.
+// Readers never block or write shared memory; they retry if a write overlapped their copy.
+// Writers must be serialized externally.
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock payload must be trivially copyable");
+
+public:
+    void Write(const T& value) {
+        uint32_t seq = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(seq + 1, std::memory_order_relaxed); // Odd: write in progress
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&m_value, &value, sizeof(T));
+        m_sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    T Read() const {
+        T result;
+        for (;;) {
+            uint32_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            std::memcpy(&result, &m_value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) return result;
+        }
+    }
+
+private:
+    std::atomic<uint32_t> m_sequence{ 0 };
+    T m_value{};
+};
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "BindingTracker.h"
+
+namespace Graphics {
+
+    void CommandListBindings::OnPushDescriptors(reshade::api::shader_stage stages, const reshade::api::descriptor_table_update& update) {
+        stateSerial++;
+        if ((stages & reshade::api::shader_stage::vertex) == 0) return;
+        if (update.type != reshade::api::descriptor_type::constant_buffer) return;
+
+        const auto* ranges = static_cast<const reshade::api::buffer_range*>(update.descriptors);
+        for (uint32_t i = 0; i < update.count; ++i) {
+            uint32_t slot = update.binding + i;
+            if (slot >= kVSConstantSlots) break;
+            vsConstantBuffers[slot] = ranges ? ranges[i].buffer.handle : 0;
+        }
+    }
+
+    void CommandListBindings::OnBindDescriptorTables(reshade::api::shader_stage stages) {
+        // D3D11 binds through push_descriptors; tables would bypass the shadow table, so fall back to a resync
+        if ((stages & reshade::api::shader_stage::vertex) != 0) stale = true;
+        stateSerial++;
+    }
+
+    void CommandListBindings::OnBindPipeline(reshade::api::pipeline_stage stages, reshade::api::pipeline pipeline) {
+        if ((stages & reshade::api::pipeline_stage::vertex_shader) != 0) vertexShader = pipeline.handle;
+        if ((stages & reshade::api::pipeline_stage::hull_shader) != 0) hullShader = pipeline.handle;
+        if ((stages & reshade::api::pipeline_stage::domain_shader) != 0) domainShader = pipeline.handle;
+        if ((stages & reshade::api::pipeline_stage::geometry_shader) != 0) geometryShader = pipeline.handle;
+        stateSerial++;
+    }
+
+    int CommandListBindings::FindVSConstantBuffer(uint64_t buffer) const {
+        for (uint32_t slot = 0; slot < kVSConstantSlots; ++slot) {
+            if (vsConstantBuffers[slot] == buffer) return (int)slot;
+        }
+        return -1;
+    }
+
+    CommandListBindings* CommandListBindings::Get(reshade::api::command_list* cmd_list) {
+        return cmd_list->get_private_data<CommandListBindings>();
+    }
+
+    CommandListBindings* CommandListBindings::GetOrCreate(reshade::api::command_list* cmd_list) {
+        // The immediate context has no init_command_list event, so tables are created on first use
+        CommandListBindings* bindings = cmd_list->get_private_data<CommandListBindings>();
+        if (!bindings) bindings = cmd_list->create_private_data<CommandListBindings>();
+        return bindings;
+    }
+
+    void CommandListBindings::Destroy(reshade::api::command_list* cmd_list) {
+        if (cmd_list->get_private_data<CommandListBindings>()) cmd_list->destroy_private_data<CommandListBindings>();
+    }
+}
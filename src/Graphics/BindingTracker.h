@@ -0,0 +1,39 @@
+#pragma once
+#include <reshade.hpp>
+#include <cstdint>
+
+namespace Graphics {
+
+    // Shadow copy of the vertex stage bindings of one command list, kept up to date from ReShade binding events
+    // so draws can check for the camera buffer without querying the driver. Stored as command list private data.
+    struct __declspec(uuid("6f0c2b7e-41d9-4a3e-9b58-2e7d1c4a9f30")) CommandListBindings {
+        static constexpr uint32_t kVSConstantSlots = 14; // D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+
+        uint64_t vsConstantBuffers[kVSConstantSlots] = {};
+        uint64_t vertexShader = 0;
+        uint64_t hullShader = 0;
+        uint64_t domainShader = 0;
+        uint64_t geometryShader = 0;
+        // Set when the bindings may have changed without an event (state cleared, tables bound, command list
+        // executed); the owner must resynchronize from the driver before trusting the table
+        bool stale = true;
+        // Bumped by every pipeline state change seen, so recorders can reuse a captured state while it is unchanged
+        uint64_t stateSerial = 0;
+
+        void OnPushDescriptors(reshade::api::shader_stage stages, const reshade::api::descriptor_table_update& update);
+        void OnBindDescriptorTables(reshade::api::shader_stage stages);
+        void OnBindPipeline(reshade::api::pipeline_stage stages, reshade::api::pipeline pipeline);
+        // Any other state change (vertex/index buffers, dynamic states, render targets)
+        void OnBindState() { stateSerial++; }
+        void Invalidate() { stale = true; stateSerial++; }
+
+        bool UsesTessellationOrGeometry() const { return hullShader || domainShader || geometryShader; }
+
+        // Returns the VS slot the buffer is bound to, or -1
+        int FindVSConstantBuffer(uint64_t buffer) const;
+
+        static CommandListBindings* Get(reshade::api::command_list* cmd_list);
+        static CommandListBindings* GetOrCreate(reshade::api::command_list* cmd_list);
+        static void Destroy(reshade::api::command_list* cmd_list);
+    };
+}
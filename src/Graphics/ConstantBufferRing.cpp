@@ -0,0 +1,183 @@
+#include "pch.h"
+#include "ConstantBufferRing.h"
+#include "../Core/Logger.h"
+#include <algorithm>
+
+namespace Graphics {
+
+    bool ConstantBufferRing::Initialize(ID3D11Device* device) {
+        Reset();
+        if (!device) return false;
+        m_device = device;
+
+        // Offsets and NO_OVERWRITE on dynamic constant buffers are optional D3D11.1 features
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+            options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer) {
+            D3D11_BUFFER_DESC desc = {};
+            desc.ByteWidth = kRingBytes;
+            desc.Usage = D3D11_USAGE_DYNAMIC;
+            desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            if (SUCCEEDED(device->CreateBuffer(&desc, nullptr, m_ring.GetAddressOf()))) {
+                m_frame.buffersCreated++;
+            }
+        }
+
+        LOG_INFO("Camera constant upload: ", m_ring ? "D3D11.1 ring" : "pooled buffers (D3D11.0)");
+        return true;
+    }
+
+    void ConstantBufferRing::Reset() {
+        m_ring.Reset();
+        m_immediate1.Reset();
+        m_immediate = nullptr;
+        m_ringCursor = 0;
+        m_ringStarted = false;
+        m_ringGeneration = 0;
+        m_pool.clear();
+        m_currentBucket = -1;
+        m_usingRing = false;
+        m_device.Reset();
+    }
+
+    bool ConstantBufferRing::Upload(ID3D11DeviceContext* ctx, UINT byteWidth, const PayloadSet& payloads) {
+        if (!m_device || !ctx || !payloads.faces) return false;
+
+        // The ring (and resident payload reuse) relies on a single timeline, so deferred contexts use the pool
+        bool immediate = ctx->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE;
+        if (m_ring && immediate) {
+            if (GetContext1(ctx) && UploadRing(byteWidth, payloads)) {
+                m_usingRing = true;
+                return true;
+            }
+        }
+
+        m_usingRing = false;
+        return UploadPool(ctx, immediate, byteWidth, payloads);
+    }
+
+    ID3D11DeviceContext1* ConstantBufferRing::GetContext1(ID3D11DeviceContext* ctx) {
+        if (ctx != m_immediate) {
+            if (ctx->GetType() != D3D11_DEVICE_CONTEXT_IMMEDIATE) return nullptr;
+            m_immediate1.Reset();
+            ctx->QueryInterface(IID_PPV_ARGS(m_immediate1.GetAddressOf()));
+            m_immediate = ctx;
+        }
+        return m_immediate1.Get();
+    }
+
+    bool ConstantBufferRing::UploadRing(UINT byteWidth, const PayloadSet& payloads) {
+        // Bound ranges are whole multiples of 16 constants (256 bytes) and must cover the game's buffer
+        UINT faceBytes = (std::max(byteWidth, payloads.faceSize) + 255) & ~255u;
+        UINT totalBytes = faceBytes * Camera::FacePayloads::kFaceCount;
+        if (totalBytes > kRingBytes) return false;
+
+        if (m_ringStarted && payloads.generation != 0 && m_ringGeneration == payloads.generation && m_ringFaceBytes == faceBytes) {
+            m_frame.reusedUploads++;
+            return true;
+        }
+
+        D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+        if (!m_ringStarted || m_ringCursor + totalBytes > kRingBytes) {
+            if (m_ringStarted) m_frame.ringWraps++;
+            mapType = D3D11_MAP_WRITE_DISCARD;
+            m_ringCursor = 0;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(m_immediate->Map(m_ring.Get(), 0, mapType, 0, &mapped))) return false;
+        // Slot bytes past the payload (a larger bound buffer, 256-byte rounding) are zeroed rather than left holding
+        // whatever an earlier set wrote there
+        uint8_t* dst = (uint8_t*)mapped.pData + m_ringCursor;
+        for (uint32_t i = 0; i < Camera::FacePayloads::kFaceCount; ++i) {
+            memcpy(dst + i * faceBytes, payloads.faces + (size_t)i * payloads.faceStride, payloads.faceSize);
+            memset(dst + i * faceBytes + payloads.faceSize, 0, faceBytes - payloads.faceSize);
+        }
+        m_immediate->Unmap(m_ring.Get(), 0);
+
+        m_ringStarted = true;
+        m_ringOffset = m_ringCursor;
+        m_ringFaceBytes = faceBytes;
+        m_ringGeneration = payloads.generation;
+        m_ringCursor += totalBytes;
+
+        m_frame.uploads++;
+        m_frame.bytesUploaded += (uint64_t)payloads.faceSize * Camera::FacePayloads::kFaceCount;
+        return true;
+    }
+
+    bool ConstantBufferRing::UploadPool(ID3D11DeviceContext* ctx, bool immediate, UINT byteWidth, const PayloadSet& payloads) {
+        auto it = std::find_if(m_pool.begin(), m_pool.end(), [&](const PoolBucket& b) { return b.byteWidth == byteWidth; });
+        if (it == m_pool.end()) {
+            PoolBucket bucket;
+            bucket.byteWidth = byteWidth;
+
+            D3D11_BUFFER_DESC desc = {};
+            desc.ByteWidth = byteWidth;
+            desc.Usage = D3D11_USAGE_DYNAMIC;
+            desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            for (auto& face : bucket.faces) {
+                if (FAILED(m_device->CreateBuffer(&desc, nullptr, face.GetAddressOf()))) return false;
+                m_frame.buffersCreated++;
+            }
+            m_pool.push_back(bucket);
+            it = m_pool.end() - 1;
+        }
+
+        m_currentBucket = (int)(it - m_pool.begin());
+        PoolBucket& bucket = *it;
+
+        if (immediate && payloads.generation != 0 && bucket.generation == payloads.generation) {
+            m_frame.reusedUploads++;
+            return true;
+        }
+
+        UINT copyBytes = std::min(byteWidth, payloads.faceSize);
+        for (uint32_t i = 0; i < Camera::FacePayloads::kFaceCount; ++i) {
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            if (FAILED(ctx->Map(bucket.faces[i].Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+                bucket.generation = 0;
+                return false;
+            }
+            memcpy(mapped.pData, payloads.faces + (size_t)i * payloads.faceStride, copyBytes);
+            memset((uint8_t*)mapped.pData + copyBytes, 0, byteWidth - copyBytes); // DISCARD leaves undefined contents
+            ctx->Unmap(bucket.faces[i].Get(), 0);
+        }
+
+        // Contents written on a deferred context only become resident when its command list executes
+        bucket.generation = immediate ? payloads.generation : 0;
+
+        m_frame.uploads++;
+        m_frame.bytesUploaded += (uint64_t)copyBytes * Camera::FacePayloads::kFaceCount;
+        return true;
+    }
+
+    void ConstantBufferRing::BindFace(ID3D11DeviceContext* ctx, UINT slot, uint32_t face) {
+        if (m_usingRing) {
+            UINT firstConstant = (m_ringOffset + face * m_ringFaceBytes) / 16;
+            UINT numConstants = m_ringFaceBytes / 16;
+            // Some D3D11.1 runtimes ignore an offset change while the same buffer stays bound; unbind first
+            ID3D11Buffer* nullBuffer = nullptr;
+            m_immediate1->VSSetConstantBuffers(slot, 1, &nullBuffer);
+            m_immediate1->VSSetConstantBuffers1(slot, 1, m_ring.GetAddressOf(), &firstConstant, &numConstants);
+        } else if (m_currentBucket >= 0) {
+            ctx->VSSetConstantBuffers(slot, 1, m_pool[m_currentBucket].faces[face].GetAddressOf());
+        }
+    }
+
+    void ConstantBufferRing::EndFrame() {
+        AddStats(m_frame);
+        m_lastFrame = m_frame;
+        m_frame = UploadStats();
+    }
+
+    void ConstantBufferRing::AddStats(const UploadStats& delta) {
+        m_total.bytesUploaded += delta.bytesUploaded;
+        m_total.buffersCreated += delta.buffersCreated;
+        m_total.uploads += delta.uploads;
+        m_total.reusedUploads += delta.reusedUploads;
+        m_total.ringWraps += delta.ringWraps;
+    }
+}
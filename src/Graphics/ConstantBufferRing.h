@@ -0,0 +1,86 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "../Camera/FacePayloads.h"
+
+namespace Graphics {
+    using Microsoft::WRL::ComPtr;
+
+    struct UploadStats {
+        uint64_t bytesUploaded = 0;
+        uint64_t buffersCreated = 0;
+        uint64_t uploads = 0;       // Payload sets written
+        uint64_t reusedUploads = 0; // Payload sets already resident (unchanged generation)
+        uint64_t ringWraps = 0;
+    };
+
+    // Upload path for the injected per-face camera constants.
+    // D3D11.1: one large dynamic buffer appended to with MAP_WRITE_NO_OVERWRITE (DISCARD on wrap), each face bound
+    // through VSSetConstantBuffers1 offsets. D3D11.0 and deferred contexts: pooled per-face dynamic buffers bucketed by
+    // ByteWidth. On the immediate context a payload generation that is already resident is not uploaded again.
+    class ConstantBufferRing {
+    public:
+        static constexpr UINT kRingBytes = 4 * 1024 * 1024;
+
+        bool Initialize(ID3D11Device* device);
+        void Reset();
+        bool IsInitialized() const { return m_device != nullptr; }
+
+        // Six face payloads laid out faceStride bytes apart; generation identifies the contents (0 = never reuse)
+        struct PayloadSet {
+            const uint8_t* faces = nullptr;
+            uint32_t faceSize = 0;
+            uint32_t faceStride = 0;
+            uint64_t generation = 0;
+        };
+
+        // Makes all six face payloads available on the GPU, sized for a bound buffer of byteWidth bytes
+        bool Upload(ID3D11DeviceContext* ctx, UINT byteWidth, const PayloadSet& payloads);
+        bool Upload(ID3D11DeviceContext* ctx, UINT byteWidth, const Camera::FacePayloads& payloads) {
+            return Upload(ctx, byteWidth, { payloads.GetData(), payloads.GetSize(), payloads.GetStride(), payloads.GetGeneration() });
+        }
+        // Binds one face of the last Upload to a VS constant buffer slot
+        void BindFace(ID3D11DeviceContext* ctx, UINT slot, uint32_t face);
+
+        // D3D11.1 interface of the immediate context (queried once and cached), nullptr for deferred contexts or 11.0
+        ID3D11DeviceContext1* GetContext1(ID3D11DeviceContext* ctx);
+
+        // Closes the current frame's counters; GetFrameStats returns the last closed frame
+        void EndFrame();
+        UploadStats GetFrameStats() const { return m_lastFrame; }
+        UploadStats GetTotalStats() const { return m_total; }
+
+    private:
+        struct PoolBucket {
+            UINT byteWidth = 0;
+            ComPtr<ID3D11Buffer> faces[Camera::FacePayloads::kFaceCount];
+            uint64_t generation = 0; // Resident payload generation (immediate context only)
+        };
+
+        bool UploadRing(UINT byteWidth, const PayloadSet& payloads);
+        bool UploadPool(ID3D11DeviceContext* ctx, bool immediate, UINT byteWidth, const PayloadSet& payloads);
+        void AddStats(const UploadStats& delta);
+
+        ComPtr<ID3D11Device> m_device;
+
+        // D3D11.1 ring
+        ComPtr<ID3D11Buffer> m_ring;
+        ID3D11DeviceContext* m_immediate = nullptr; // Context m_immediate1 was queried from
+        ComPtr<ID3D11DeviceContext1> m_immediate1;
+        UINT m_ringCursor = 0;
+        bool m_ringStarted = false;  // First map of a dynamic buffer must DISCARD
+        UINT m_ringOffset = 0;       // Start of the current payload set
+        UINT m_ringFaceBytes = 0;    // Per-face stride of the current set (multiple of 256)
+        uint64_t m_ringGeneration = 0;
+
+        // D3D11.0 fallback
+        std::vector<PoolBucket> m_pool;
+        int m_currentBucket = -1;
+        bool m_usingRing = false;
+
+        UploadStats m_frame;
+        UploadStats m_lastFrame;
+        UploadStats m_total;
+    };
+}
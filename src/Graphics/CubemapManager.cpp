@@ -3,14 +3,45 @@
 #include "../Compute/ShaderCompiler.h"
 #include "../Core/Logger.h"
 #include <d3dcompiler.h>
+#include <d3d11_3.h>
 #include <algorithm>
-#include "StateBlock.h"
+#include "StateGuard.h"
+#include "BindingTracker.h"
 
 namespace Graphics {
 
     CubemapManager::CubemapManager(reshade::api::device* device) : m_device(device) {
+        m_config = CaptureConfig::Load();
+        LOG_INFO("Draw replay mode: ", m_config.replayMode == ReplayMode::FaceMajor ? "face major" : m_config.replayMode == ReplayMode::SinglePass ? "single pass" : "immediate",
+                 m_config.replayMode == ReplayMode::FaceMajor ? (m_config.replayFlush == ReplayFlush::PassBoundary ? " (flush per pass)" : " (flush at present)") : "");
+        if (m_config.layout != Compute::ProjectionLayout::Equirect) {
+            LOG_INFO("Output layout: ", m_config.layout == Compute::ProjectionLayout::EAC3x2 ? "EAC 3x2" : "cube 3x2");
+        }
+        if (m_config.coverage == Coverage::VR180 || m_config.faceBudget.GetActiveMask() != 0x3F) {
+            const FaceBudget& budget = m_config.faceBudget;
+            LOG_INFO("Capture coverage: ", m_config.coverage == Coverage::VR180 ? "VR180" : "full", ", face scale R/L/U/D/F/B ",
+                     budget.scale[0], "/", budget.scale[1], "/", budget.scale[2], "/", budget.scale[3], "/", budget.scale[4], "/", budget.scale[5]);
+        }
+        m_facePayloads.SetActiveFaces(m_config.faceBudget.GetActiveMask());
+        m_scheduler.Configure(m_config.faceBudget.GetActiveMask(), m_config.faceInterval, m_config.refreshAngle, m_config.refreshDistance);
+
+        std::unique_ptr<Video::TimeSource> timeSource;
+        if (m_config.gameFrameTime > 0.0f) timeSource = std::make_unique<Video::GameTimeSource>((int64_t)(m_config.gameFrameTime * 1000000.0));
+        m_clock.Configure(std::move(timeSource), m_config.captureFps, m_config.variableFrameRate);
+        LOG_INFO("Capture rate: ", m_config.captureFps, " fps, ", m_config.gameFrameTime > 0.0f ? "game clock" : "wall clock",
+                 m_config.variableFrameRate ? ", variable frame rate" : ", constant frame rate");
+
         m_cameraController = std::make_unique<Camera::CameraController>();
-        m_encoder = std::make_unique<Video::FFmpegBackend>();
+        LOG_INFO("Encoder: ", m_config.encoder == EncoderBackend::Hardware ? "hardware" : m_config.encoder == EncoderBackend::Software ? "software" : "auto");
+        if (!m_config.roiProfile.bands.empty() && m_config.encoder != EncoderBackend::Software) {
+            LOG_INFO("PoleQp: software encoder only", m_config.encoder == EncoderBackend::Auto ? " (applies if auto falls back to it)" : ", ignored");
+        }
+        LOG_INFO("Encode queue: ", m_config.encodeQueueDepth ? std::to_string(m_config.encodeQueueDepth) + " frames" : std::string("off"),
+                 m_config.encodeQueuePolicy == Video::QueuePolicy::DropOldest ? ", drop oldest" :
+                 m_config.encodeQueuePolicy == Video::QueuePolicy::DropNewest ? ", drop newest" : ", block");
+        if (m_config.output.mode == Video::OutputMode::Segmented) LOG_INFO("Output: ", m_config.output.segmentSeconds, " s segments");
+        else if (m_config.output.mode == Video::OutputMode::Replay) LOG_INFO("Output: last ", m_config.output.replaySeconds, " s in memory, saved on key 0x", std::hex, m_config.saveReplayKey, std::dec);
+        else LOG_INFO("Output: ", m_config.output.mode == Video::OutputMode::Faststart ? "faststart MP4" : "fragmented MP4");
     }
 
     CubemapManager::~CubemapManager() {
@@ -21,129 +52,240 @@ namespace Graphics {
         if (m_device) {
             for (int i = 0; i < 6; ++i) {
                 if (m_faceRtvs[i].handle) m_device->destroy_resource_view(m_faceRtvs[i]);
-                if (m_faceSrvs[i].handle) m_device->destroy_resource_view(m_faceSrvs[i]);
-                if (m_faceTextures[i].handle) m_device->destroy_resource(m_faceTextures[i]);
+                m_faceRtvs[i] = {};
+            }
+            if (m_faceArrayRtv.handle) m_device->destroy_resource_view(m_faceArrayRtv);
+            m_faceArrayRtv = {};
+            for (int i = 0; i < 6; ++i) {
+                if (m_faceDsvs[i].handle) m_device->destroy_resource_view(m_faceDsvs[i]);
+                m_faceDsvs[i] = {};
             }
+            if (m_faceArrayDsv.handle) m_device->destroy_resource_view(m_faceArrayDsv);
+            if (m_faceDepth.handle) m_device->destroy_resource(m_faceDepth);
+            m_faceArrayDsv = {};
+            m_faceDepth = {};
             if (m_cubeSrv.handle) m_device->destroy_resource_view(m_cubeSrv);
             if (m_cubeTexture.handle) m_device->destroy_resource(m_cubeTexture);
+            m_cubeSrv = {};
+            m_cubeTexture = {};
             if (m_equirectUAV.handle) m_device->destroy_resource_view(m_equirectUAV);
             if (m_equirectSRV.handle) m_device->destroy_resource_view(m_equirectSRV);
             if (m_equirectTexture.handle) m_device->destroy_resource(m_equirectTexture);
+            m_equirectUAV = {};
+            m_equirectSRV = {};
+            m_equirectTexture = {};
         }
 
-        m_nv12Y_RTV.Reset();
-        m_nv12UV_RTV.Reset();
-        m_equirectNV12.Reset();
+        // Frames still being read back belong to this recording
+        if (m_readbackCount && m_encoder) {
+            ComPtr<ID3D11DeviceContext> ctx;
+            if (ID3D11Device* d3d11Dev = m_device ? (ID3D11Device*)m_device->get_native() : nullptr) d3d11Dev->GetImmediateContext(ctx.GetAddressOf());
+            if (ctx) EncodeReadbacks(ctx.Get(), true);
+        }
+        for (Readback& readback : m_readbacks) readback.staging.Reset();
+        m_readbackSource.Reset();
+        m_readbackHead = 0;
+        m_readbackCount = 0;
+
+        m_surfaceViews.clear();
+        m_surfaceArray.Reset();
+        m_cubeToNV12.Reset();
         m_projectionShader.Reset();
+        m_projectionParams.Reset();
+        m_projectionLutSrv.Reset();
         m_convertVS.Reset();
         m_convertPS_Y.Reset();
         m_convertPS_UV.Reset();
         m_linearSampler.Reset();
+        m_cbRing.Reset();
+        m_recorder.Clear();
+        m_multiView.Reset();
 
         if (m_encoder) m_encoder->Finish();
     }
 
     bool CubemapManager::InitResources(uint32_t width, uint32_t height) {
-        if (m_width == width && m_height == height && m_faceTextures[0].handle != 0) return true;
+        if (m_width == width && m_height == height && m_cubeTexture.handle != 0) return true;
         
         DestroyResources();
 
         m_width = width;
         m_height = height;
         m_faceSize = std::min(width, height); // Keep it square
+        for (int i = 0; i < 6; ++i) m_faceSizes[i] = m_config.faceBudget.GetResolution(i, m_faceSize);
+        m_scheduler.ForceRefresh(); // New face textures hold nothing to reuse
+        m_clock.Restart(); // New output file
+        m_captureFrame = false;
 
-        // 1. Create Face Textures (R8G8B8A8 UNORM)
-        for (int i = 0; i < 6; ++i) {
-            if (!m_device->create_resource(
-                reshade::api::resource_desc(m_faceSize, m_faceSize, 1, 1, reshade::api::format::r8g8b8a8_unorm, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::render_target | reshade::api::resource_usage::copy_source | reshade::api::resource_usage::shader_resource),
-                nullptr, reshade::api::resource_usage::shader_resource, &m_faceTextures[i]))
-            {
-                LOG_ERROR("Failed to create face texture ", i);
-                return false;
-            }
-
-            if (!m_device->create_resource_view(m_faceTextures[i], reshade::api::resource_usage::render_target,
-                reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 1), &m_faceRtvs[i]))
-                return false;
+        // 1. Create Cube Texture (R8G8B8A8 UNORM). Faces render straight into its slices (reduced-resolution faces into
+        // the top-left corner) and the projection pass samples it in place through the array view
+        if (!m_device->create_resource(
+            reshade::api::resource_desc(reshade::api::resource_type::texture_2d, m_faceSize, m_faceSize, 6, 1, reshade::api::format::r8g8b8a8_unorm, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::render_target | reshade::api::resource_usage::shader_resource, reshade::api::resource_flags::cube_compatible),
+            nullptr, reshade::api::resource_usage::shader_resource, &m_cubeTexture))
+        {
+            LOG_ERROR("Failed to create cube texture");
+            return false;
+        }
 
-            if (!m_device->create_resource_view(m_faceTextures[i], reshade::api::resource_usage::shader_resource,
-                reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 1), &m_faceSrvs[i]))
+        for (int i = 0; i < 6; ++i) {
+            if (!m_device->create_resource_view(m_cubeTexture, reshade::api::resource_usage::render_target,
+                reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d_array, reshade::api::format::r8g8b8a8_unorm, 0, 1, i, 1), &m_faceRtvs[i]))
                 return false;
         }
 
-        // 2. Create Cube Texture Array (for Compute Shader)
-        if (!m_device->create_resource(
-            reshade::api::resource_desc(reshade::api::resource_type::texture_2d, m_faceSize, m_faceSize, 6, 1, reshade::api::format::r8g8b8a8_unorm, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::copy_dest | reshade::api::resource_usage::shader_resource),
-            nullptr, reshade::api::resource_usage::shader_resource, &m_cubeTexture))
+        if (!m_device->create_resource_view(m_cubeTexture, reshade::api::resource_usage::render_target,
+            reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d_array, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 6), &m_faceArrayRtv))
             return false;
 
         if (!m_device->create_resource_view(m_cubeTexture, reshade::api::resource_usage::shader_resource,
-            reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_cube, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 6), &m_cubeSrv))
+            reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d_array, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 6), &m_cubeSrv))
             return false;
 
-        // 3. Equirectangular Output
-        UINT eqW = m_faceSize * 4;
-        UINT eqH = eqW / 2;
-        // Align to 16
-        eqW = (eqW + 15) & ~15;
-        eqH = (eqH + 15) & ~15;
-
+        // Face depth array, only used by replayed draws (one slice per face)
         if (!m_device->create_resource(
-            reshade::api::resource_desc(eqW, eqH, 1, 1, reshade::api::format::r8g8b8a8_unorm, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::unordered_access | reshade::api::resource_usage::shader_resource),
-            nullptr, reshade::api::resource_usage::unordered_access, &m_equirectTexture))
+            reshade::api::resource_desc(reshade::api::resource_type::texture_2d, m_faceSize, m_faceSize, 6, 1, reshade::api::format::d24_unorm_s8_uint, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::depth_stencil),
+            nullptr, reshade::api::resource_usage::depth_stencil_write, &m_faceDepth))
             return false;
 
-        if (!m_device->create_resource_view(m_equirectTexture, reshade::api::resource_usage::unordered_access,
-            reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 1), &m_equirectUAV))
-            return false;
+        for (int i = 0; i < 6; ++i) {
+            if (!m_device->create_resource_view(m_faceDepth, reshade::api::resource_usage::depth_stencil,
+                reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d_array, reshade::api::format::d24_unorm_s8_uint, 0, 1, i, 1), &m_faceDsvs[i]))
+                return false;
+        }
 
-        if (!m_device->create_resource_view(m_equirectTexture, reshade::api::resource_usage::shader_resource,
-            reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 1), &m_equirectSRV))
+        if (!m_device->create_resource_view(m_faceDepth, reshade::api::resource_usage::depth_stencil,
+            reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d_array, reshade::api::format::d24_unorm_s8_uint, 0, 1, 0, 6), &m_faceArrayDsv))
             return false;
 
-        // 4. Native D3D11 Initialization for Shaders/FFmpeg
+        // 2. Output image
+        UINT eqW, eqH;
+        if (m_config.layout == Compute::ProjectionLayout::Equirect) {
+            // 360 is 2:1 (4 faces around), VR180 covers half the longitudes at the same angular resolution (1:1)
+            eqW = m_config.coverage == Coverage::VR180 ? m_faceSize * 2 : m_faceSize * 4;
+            eqH = m_faceSize * 2;
+            // Align to 16
+            eqW = (eqW + 15) & ~15;
+            eqH = (eqH + 15) & ~15;
+        } else {
+            // 3x2 tiles at face resolution; a tile edge that is a multiple of 16 keeps tiles on whole pixels and both
+            // dimensions aligned
+            UINT tile = std::max(16u, m_faceSize & ~15u);
+            eqW = tile * 3;
+            eqH = tile * 2;
+        }
+
+        // 3. Native D3D11 Initialization for Shaders/FFmpeg
         ID3D11Device* d3d11Dev = (ID3D11Device*)m_device->get_native();
         if (!d3d11Dev) return false;
 
-        // Compile Projection Shader
-        if (FAILED(Compute::ShaderCompiler::CompileComputeShader(d3d11Dev, L"shaders/ProjectionShader.hlsl", "main", m_projectionShader.GetAddressOf()))) {
-             // Fallback try local
-             if (FAILED(Compute::ShaderCompiler::CompileComputeShader(d3d11Dev, L"ProjectionShader.hlsl", "main", m_projectionShader.GetAddressOf()))) {
-                 LOG_ERROR("Failed to compile ProjectionShader");
-                 // Continue anyway to allow build
-             }
-        }
-
-        // Compile RGB->NV12
-        ID3DBlob* vsBlob = nullptr;
-        ID3DBlob* psYBlob = nullptr;
-        ID3DBlob* psUVBlob = nullptr;
-        
-        if (FAILED(D3DCompileFromFile(L"RGBToNV12.hlsl", nullptr, nullptr, "VS", "vs_5_0", 0, 0, &vsBlob, nullptr))) {
-             if (FAILED(D3DCompileFromFile(L"src/Graphics/RGBToNV12.hlsl", nullptr, nullptr, "VS", "vs_5_0", 0, 0, &vsBlob, nullptr)))
-                LOG_ERROR("Failed RGBToNV12 VS");
+        // Init Encoder first: it owns the NV12 surfaces the output is written into
+        Video::SphericalMetadata spherical;
+        if (m_config.layout == Compute::ProjectionLayout::Equirect) {
+            spherical.projection = Video::SphericalMetadata::Projection::Equirectangular;
+            if (m_config.coverage == Coverage::VR180) spherical.boundLeft = spherical.boundRight = 0.25f;
+        } else {
+            // sv3d has no equi-angular variant; EAC files carry the cubemap tag of the same tile layout
+            spherical.projection = Video::SphericalMetadata::Projection::Cubemap;
         }
-        if (vsBlob) {
-            d3d11Dev->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, m_convertVS.GetAddressOf());
-            vsBlob->Release();
+        if (!InitEncoder(d3d11Dev, eqW, eqH, spherical)) return false;
+
+        // The fused kernel writes the planes through UAVs when the surfaces allow them
+        bool surfaceUav = false;
+        if (m_hardwareEncoder) {
+            D3D11_TEXTURE2D_DESC surfaceDesc = {};
+            surfaceUav = m_hardwareEncoder->GetSurfaceDesc(&surfaceDesc) && (surfaceDesc.BindFlags & D3D11_BIND_UNORDERED_ACCESS);
+        } else if (!InitReadback(d3d11Dev, eqW, eqH, &surfaceUav)) {
+            return false;
         }
 
-        if (FAILED(D3DCompileFromFile(L"RGBToNV12.hlsl", nullptr, nullptr, "PS_Y", "ps_5_0", 0, 0, &psYBlob, nullptr))) {
-             if (FAILED(D3DCompileFromFile(L"src/Graphics/RGBToNV12.hlsl", nullptr, nullptr, "PS_Y", "ps_5_0", 0, 0, &psYBlob, nullptr))) {}
-        }
-        if (psYBlob) {
-            d3d11Dev->CreatePixelShader(psYBlob->GetBufferPointer(), psYBlob->GetBufferSize(), nullptr, m_convertPS_Y.GetAddressOf());
-            psYBlob->Release();
-        }
+        if (surfaceUav && InitFusedConversion(d3d11Dev)) {
+            LOG_INFO("Projecting the cube straight into NV12");
+        } else {
+            LOG_INFO("NV12 compute writes unavailable, projecting through an RGBA equirect");
 
-        if (FAILED(D3DCompileFromFile(L"RGBToNV12.hlsl", nullptr, nullptr, "PS_UV", "ps_5_0", 0, 0, &psUVBlob, nullptr))) {
-             if (FAILED(D3DCompileFromFile(L"src/Graphics/RGBToNV12.hlsl", nullptr, nullptr, "PS_UV", "ps_5_0", 0, 0, &psUVBlob, nullptr))) {}
-        }
-        if (psUVBlob) {
-            d3d11Dev->CreatePixelShader(psUVBlob->GetBufferPointer(), psUVBlob->GetBufferSize(), nullptr, m_convertPS_UV.GetAddressOf());
-            psUVBlob->Release();
+            if (!m_device->create_resource(
+                reshade::api::resource_desc(eqW, eqH, 1, 1, reshade::api::format::r8g8b8a8_unorm, 1, reshade::api::memory_heap::gpu_only, reshade::api::resource_usage::unordered_access | reshade::api::resource_usage::shader_resource),
+                nullptr, reshade::api::resource_usage::unordered_access, &m_equirectTexture))
+                return false;
+
+            if (!m_device->create_resource_view(m_equirectTexture, reshade::api::resource_usage::unordered_access,
+                reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 1), &m_equirectUAV))
+                return false;
+
+            if (!m_device->create_resource_view(m_equirectTexture, reshade::api::resource_usage::shader_resource,
+                reshade::api::resource_view_desc(reshade::api::resource_view_type::texture_2d, reshade::api::format::r8g8b8a8_unorm, 0, 1, 0, 1), &m_equirectSRV))
+                return false;
+
+            // Compile Projection Shader
+            if (FAILED(Compute::ShaderCompiler::CompileComputeShader(d3d11Dev, L"shaders/ProjectionShader.hlsl", "main", m_projectionShader.GetAddressOf()))) {
+                 // Fallback try local
+                 if (FAILED(Compute::ShaderCompiler::CompileComputeShader(d3d11Dev, L"ProjectionShader.hlsl", "main", m_projectionShader.GetAddressOf()))) {
+                     LOG_ERROR("Failed to compile ProjectionShader");
+                     // Continue anyway to allow build
+                 }
+            }
+
+            // Compile RGB->NV12
+            ID3DBlob* vsBlob = nullptr;
+            ID3DBlob* psYBlob = nullptr;
+            ID3DBlob* psUVBlob = nullptr;
+
+            if (FAILED(D3DCompileFromFile(L"RGBToNV12.hlsl", nullptr, nullptr, "VS", "vs_5_0", 0, 0, &vsBlob, nullptr))) {
+                 if (FAILED(D3DCompileFromFile(L"src/Graphics/RGBToNV12.hlsl", nullptr, nullptr, "VS", "vs_5_0", 0, 0, &vsBlob, nullptr)))
+                    LOG_ERROR("Failed RGBToNV12 VS");
+            }
+            if (vsBlob) {
+                d3d11Dev->CreateVertexShader(vsBlob->GetBufferPointer(), vsBlob->GetBufferSize(), nullptr, m_convertVS.GetAddressOf());
+                vsBlob->Release();
+            }
+
+            if (FAILED(D3DCompileFromFile(L"RGBToNV12.hlsl", nullptr, nullptr, "PS_Y", "ps_5_0", 0, 0, &psYBlob, nullptr))) {
+                 if (FAILED(D3DCompileFromFile(L"src/Graphics/RGBToNV12.hlsl", nullptr, nullptr, "PS_Y", "ps_5_0", 0, 0, &psYBlob, nullptr))) {}
+            }
+            if (psYBlob) {
+                d3d11Dev->CreatePixelShader(psYBlob->GetBufferPointer(), psYBlob->GetBufferSize(), nullptr, m_convertPS_Y.GetAddressOf());
+                psYBlob->Release();
+            }
+
+            if (FAILED(D3DCompileFromFile(L"RGBToNV12.hlsl", nullptr, nullptr, "PS_UV", "ps_5_0", 0, 0, &psUVBlob, nullptr))) {
+                 if (FAILED(D3DCompileFromFile(L"src/Graphics/RGBToNV12.hlsl", nullptr, nullptr, "PS_UV", "ps_5_0", 0, 0, &psUVBlob, nullptr))) {}
+            }
+            if (psUVBlob) {
+                d3d11Dev->CreatePixelShader(psUVBlob->GetBufferPointer(), psUVBlob->GetBufferSize(), nullptr, m_convertPS_UV.GetAddressOf());
+                psUVBlob->Release();
+            }
         }
 
+        // Projection parameters only change with the face size
+        struct ProjectionParams {
+            float faceScale[6][4];  // x: rendered fraction of the slice, 0 = face skipped
+        } params = {};
+        for (int i = 0; i < 6; ++i) params.faceScale[i][0] = (float)m_faceSizes[i] / (float)m_faceSize;
+
+        D3D11_BUFFER_DESC paramsDesc = {};
+        paramsDesc.ByteWidth = sizeof(params);
+        paramsDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        paramsDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        D3D11_SUBRESOURCE_DATA paramsData = { &params };
+        if (FAILED(d3d11Dev->CreateBuffer(&paramsDesc, &paramsData, m_projectionParams.GetAddressOf()))) return false;
+
+        // Per-pixel mapping for the projection kernels, only rebuilt when the output changes
+        m_projectionLut.Build(m_config.layout, eqW, eqH, m_config.coverage == Coverage::VR180 ? DirectX::XM_PI : DirectX::XM_2PI);
+
+        D3D11_TEXTURE2D_DESC lutDesc = {};
+        lutDesc.Width = eqW;
+        lutDesc.Height = eqH;
+        lutDesc.MipLevels = 1;
+        lutDesc.ArraySize = 1;
+        lutDesc.Format = DXGI_FORMAT_R32_UINT;
+        lutDesc.SampleDesc.Count = 1;
+        lutDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        lutDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        D3D11_SUBRESOURCE_DATA lutData = { m_projectionLut.GetData(), eqW * sizeof(uint32_t) };
+        ComPtr<ID3D11Texture2D> lutTexture;
+        if (FAILED(d3d11Dev->CreateTexture2D(&lutDesc, &lutData, lutTexture.GetAddressOf()))) return false;
+        if (FAILED(d3d11Dev->CreateShaderResourceView(lutTexture.Get(), nullptr, m_projectionLutSrv.GetAddressOf()))) return false;
+
         D3D11_SAMPLER_DESC sampDesc = {};
         sampDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
         sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
@@ -151,105 +293,421 @@ namespace Graphics {
         sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
         d3d11Dev->CreateSamplerState(&sampDesc, m_linearSampler.GetAddressOf());
 
-        // Create NV12 Resources
-        D3D11_TEXTURE2D_DESC nv12Desc = {};
-        nv12Desc.Width = eqW;
-        nv12Desc.Height = eqH;
-        nv12Desc.MipLevels = 1;
-        nv12Desc.ArraySize = 1;
-        nv12Desc.Format = DXGI_FORMAT_NV12;
-        nv12Desc.SampleDesc.Count = 1;
-        nv12Desc.Usage = D3D11_USAGE_DEFAULT;
-        nv12Desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        m_cbRing.Initialize(d3d11Dev);
+        if (m_config.replayMode == ReplayMode::SinglePass && !m_multiView.Initialize(d3d11Dev)) {
+            LOG_WARNING("Single-pass rendering unavailable, using per-face draws");
+        }
 
-        if (FAILED(d3d11Dev->CreateTexture2D(&nv12Desc, nullptr, m_equirectNV12.GetAddressOf()))) return false;
+        return true;
+    }
 
-        D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-        rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-        rtvDesc.Format = DXGI_FORMAT_R8_UNORM;
-        d3d11Dev->CreateRenderTargetView(m_equirectNV12.Get(), &rtvDesc, m_nv12Y_RTV.GetAddressOf());
+    bool CubemapManager::InitFusedConversion(ID3D11Device* device) {
+        // Plane views need the D3D11.3 view descriptions
+        ComPtr<ID3D11Device3> device3;
+        if (FAILED(device->QueryInterface(IID_PPV_ARGS(device3.GetAddressOf())))) return false;
 
-        rtvDesc.Format = DXGI_FORMAT_R8G8_UNORM;
-        d3d11Dev->CreateRenderTargetView(m_equirectNV12.Get(), &rtvDesc, m_nv12UV_RTV.GetAddressOf());
+        if (FAILED(Compute::ShaderCompiler::CompileComputeShader(device, L"shaders/CubeToNV12.hlsl", "main", m_cubeToNV12.GetAddressOf())) &&
+            FAILED(Compute::ShaderCompiler::CompileComputeShader(device, L"CubeToNV12.hlsl", "main", m_cubeToNV12.GetAddressOf()))) {
+            LOG_ERROR("Failed to compile CubeToNV12");
+            return false;
+        }
+        return true;
+    }
 
-        // Init Encoder
-        if (m_encoder && !m_encoder->Initialize(d3d11Dev, eqW, eqH, 60, "widecapture_reshade.mp4")) return false;
+    bool CubemapManager::InitEncoder(ID3D11Device* device, UINT width, UINT height, const Video::SphericalMetadata& spherical) {
+        m_encoder.reset();
+        m_hardwareEncoder = nullptr;
+
+        Video::EncoderConfig encoderConfig;
+        encoderConfig.width = (int)width;
+        encoderConfig.height = (int)height;
+        encoderConfig.fps = (int)m_clock.GetFps();
+        encoderConfig.timeBase = m_clock.GetTimeBase();
+        encoderConfig.bitRate = (int64_t)m_config.bitrateMbps * 1000000;
+        encoderConfig.filename = "widecapture_reshade.mp4";
+        encoderConfig.device = device;
+
+        auto configure = [&](Video::Encoder& encoder) {
+            encoder.SetQueue(m_config.encodeQueueDepth, m_config.encodeQueuePolicy);
+            encoder.SetOutput(m_config.output);
+            encoder.SetSphericalMetadata(spherical);
+            encoder.SetTiles(m_config.tileColumns, m_config.tileRows);
+        };
+
+        if (m_config.encoder != EncoderBackend::Software) {
+            auto hardware = std::make_unique<Video::FFmpegBackend>();
+            configure(*hardware);
+            if (hardware->Initialize(encoderConfig)) {
+                m_hardwareEncoder = hardware.get();
+                m_encoder = std::move(hardware);
+                return true;
+            }
+            if (m_config.encoder == EncoderBackend::Hardware) return false;
+            LOG_WARNING("No hardware encoder, encoding on the CPU");
+        }
 
+        auto software = std::make_unique<Video::SoftwareBackend>(m_config.softwareCodec, m_config.softwarePreset);
+        configure(*software);
+        software->SetRoiProfile(m_config.roiProfile); // NVENC/AMF have no region-of-interest input in FFmpeg
+        if (!software->Initialize(encoderConfig)) return false;
+        m_encoder = std::move(software);
         return true;
     }
 
+    bool CubemapManager::InitReadback(ID3D11Device* device, UINT width, UINT height, bool* uav) {
+        // Same layout as the hardware pool surfaces, so the projection passes don't care which one they write
+        D3D11_TEXTURE2D_DESC desc = {};
+        desc.Width = width;
+        desc.Height = height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = DXGI_FORMAT_NV12;
+        desc.SampleDesc.Count = 1;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+        *uav = false;
+        D3D11_FEATURE_DATA_FORMAT_SUPPORT nv12Support = { DXGI_FORMAT_NV12 };
+        if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_FORMAT_SUPPORT, &nv12Support, sizeof(nv12Support))) &&
+            (nv12Support.OutFormatSupport & D3D11_FORMAT_SUPPORT_TYPED_UNORDERED_ACCESS_VIEW)) {
+            desc.BindFlags |= D3D11_BIND_UNORDERED_ACCESS;
+            *uav = SUCCEEDED(device->CreateTexture2D(&desc, nullptr, m_readbackSource.GetAddressOf()));
+            if (!*uav) desc.BindFlags &= ~D3D11_BIND_UNORDERED_ACCESS;
+        }
+        if (!m_readbackSource && FAILED(device->CreateTexture2D(&desc, nullptr, m_readbackSource.GetAddressOf()))) {
+            LOG_ERROR("Failed to create the NV12 output texture");
+            return false;
+        }
+
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.BindFlags = 0;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        for (Readback& readback : m_readbacks) {
+            if (FAILED(device->CreateTexture2D(&desc, nullptr, readback.staging.GetAddressOf()))) {
+                LOG_ERROR("Failed to create the NV12 staging textures");
+                return false;
+            }
+        }
+        m_readbackHead = 0;
+        m_readbackCount = 0;
+        return true;
+    }
+
+    bool CubemapManager::AcquireOutput(Video::FrameDesc* surface) {
+        if (!m_encoder) return false;
+        if (m_hardwareEncoder) return m_encoder->AcquireSurface(surface);
+        if (!m_readbackSource) return false;
+
+        surface->format = Video::PixelFormat::NV12;
+        surface->width = (int)m_projectionLut.GetWidth();
+        surface->height = (int)m_projectionLut.GetHeight();
+        surface->surface = m_readbackSource.Get();
+        surface->subresource = 0;
+        return true;
+    }
+
+    void CubemapManager::ReleaseOutput() {
+        if (m_hardwareEncoder) m_encoder->ReleaseSurface();
+    }
+
+    void CubemapManager::SubmitOutput(ID3D11DeviceContext* ctx) {
+        if (m_hardwareEncoder) {
+            m_encoder->SubmitSurface(m_clock.GetTimestamp());
+            return;
+        }
+
+        // Frees the oldest staging texture first when all of them are in flight
+        EncodeReadbacks(ctx, false);
+
+        Readback& readback = m_readbacks[(m_readbackHead + m_readbackCount) % kReadbackFrames];
+        ctx->CopyResource(readback.staging.Get(), m_readbackSource.Get());
+        readback.timestamp = m_clock.GetTimestamp();
+        m_readbackCount++;
+    }
+
+    void CubemapManager::EncodeReadbacks(ID3D11DeviceContext* ctx, bool flush) {
+        UINT height = m_projectionLut.GetHeight();
+        while (m_readbackCount > 0) {
+            Readback& readback = m_readbacks[m_readbackHead];
+            UINT flags = (flush || m_readbackCount == kReadbackFrames) ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT;
+
+            D3D11_MAPPED_SUBRESOURCE mapped = {};
+            HRESULT hr = ctx->Map(readback.staging.Get(), 0, D3D11_MAP_READ, flags, &mapped);
+            if (hr == DXGI_ERROR_WAS_STILL_DRAWING) break;
+
+            if (SUCCEEDED(hr)) {
+                // A mapped NV12 texture is one allocation: the UV plane follows the Y plane at the same pitch
+                Video::FrameDesc frame;
+                frame.format = Video::PixelFormat::NV12;
+                frame.width = (int)m_projectionLut.GetWidth();
+                frame.height = (int)height;
+                frame.planes[0] = (uint8_t*)mapped.pData;
+                frame.planes[1] = (uint8_t*)mapped.pData + (size_t)mapped.RowPitch * height;
+                frame.strides[0] = frame.strides[1] = mapped.RowPitch;
+                m_encoder->EncodeFrame(frame, readback.timestamp);
+                ctx->Unmap(readback.staging.Get(), 0);
+            } else {
+                LOG_ERROR("Failed to map an NV12 readback: ", hr);
+            }
+
+            m_readbackHead = (m_readbackHead + 1) % kReadbackFrames;
+            m_readbackCount--;
+        }
+    }
+
+    const CubemapManager::SurfaceViews* CubemapManager::GetSurfaceViews(const Video::FrameDesc& surface) {
+        // D3D11 surfaces are single-mip texture arrays, so the subresource is the array slice
+        ID3D11Texture2D* texture = (ID3D11Texture2D*)surface.surface;
+        uint32_t slice = surface.subresource;
+
+        // A new pool (encoder restarted) invalidates every view
+        if (texture != m_surfaceArray.Get()) {
+            m_surfaceArray = texture;
+            m_surfaceViews.clear();
+        }
+        if (slice >= m_surfaceViews.size()) m_surfaceViews.resize(slice + 1);
+
+        SurfaceViews& views = m_surfaceViews[slice];
+        if (views.yUav || views.yRtv) return &views;
+
+        ID3D11Device* device = (ID3D11Device*)m_device->get_native();
+        if (m_cubeToNV12) {
+            ComPtr<ID3D11Device3> device3;
+            if (FAILED(device->QueryInterface(IID_PPV_ARGS(device3.GetAddressOf())))) return nullptr;
+
+            D3D11_UNORDERED_ACCESS_VIEW_DESC1 uavDesc = {};
+            uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2DARRAY;
+            uavDesc.Format = DXGI_FORMAT_R8_UINT;
+            uavDesc.Texture2DArray.FirstArraySlice = slice;
+            uavDesc.Texture2DArray.ArraySize = 1;
+            uavDesc.Texture2DArray.PlaneSlice = 0;
+            ComPtr<ID3D11UnorderedAccessView1> yUav;
+            if (FAILED(device3->CreateUnorderedAccessView1(texture, &uavDesc, yUav.GetAddressOf()))) return nullptr;
+
+            uavDesc.Format = DXGI_FORMAT_R8G8_UINT;
+            uavDesc.Texture2DArray.PlaneSlice = 1;
+            ComPtr<ID3D11UnorderedAccessView1> uvUav;
+            if (FAILED(device3->CreateUnorderedAccessView1(texture, &uavDesc, uvUav.GetAddressOf()))) return nullptr;
+
+            views.yUav = yUav;
+            views.uvUav = uvUav;
+        } else {
+            // The view format selects the plane
+            D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+            rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+            rtvDesc.Format = DXGI_FORMAT_R8_UNORM;
+            rtvDesc.Texture2DArray.FirstArraySlice = slice;
+            rtvDesc.Texture2DArray.ArraySize = 1;
+            ComPtr<ID3D11RenderTargetView> yRtv, uvRtv;
+            if (FAILED(device->CreateRenderTargetView(texture, &rtvDesc, yRtv.GetAddressOf()))) return nullptr;
+
+            rtvDesc.Format = DXGI_FORMAT_R8G8_UNORM;
+            if (FAILED(device->CreateRenderTargetView(texture, &rtvDesc, uvRtv.GetAddressOf()))) return nullptr;
+
+            views.yRtv = yRtv;
+            views.uvRtv = uvRtv;
+        }
+        return &views;
+    }
+
     void CubemapManager::OnUpdateBuffer(reshade::api::device* device, reshade::api::resource resource, const void* data, uint64_t size) {
+        // Face-major draws still in the log read this vertex or index buffer; replay them before the update lands.
+        // (Mapped buffers are dynamic, which the log only holds as constant buffer snapshots.)
+        if (m_recorder.OnBufferWrite(resource.handle)) {
+            ComPtr<ID3D11DeviceContext> ctx;
+            ((ID3D11Device*)device->get_native())->GetImmediateContext(ctx.GetAddressOf());
+            FlushReplay(ctx.Get());
+        }
+
         if (m_cameraController) {
-            m_cameraController->OnUpdateBuffer(resource, data, size);
+            m_cameraController->OnUpdateBuffer(resource.handle, data, size);
         }
     }
 
+    void CubemapManager::OnDestroyResource(reshade::api::resource resource) {
+        if (m_cameraController) {
+            m_cameraController->OnDestroyResource(resource.handle);
+        }
+    }
+
+    void CubemapManager::OnInitPipeline(reshade::api::pipeline pipeline, uint32_t subobjectCount, const reshade::api::pipeline_subobject* subobjects) {
+        if (m_config.replayMode == ReplayMode::SinglePass) m_multiView.OnInitPipeline(pipeline, subobjectCount, subobjects);
+    }
+
+    void CubemapManager::OnDestroyPipeline(reshade::api::pipeline pipeline) {
+        if (m_config.replayMode == ReplayMode::SinglePass) m_multiView.OnDestroyPipeline(pipeline);
+    }
+
     void CubemapManager::OnBindPipeline(reshade::api::command_list* cmd_list, reshade::api::pipeline_stage stages, reshade::api::pipeline pipeline) {
-        // Track pipeline if necessary
+        CommandListBindings::GetOrCreate(cmd_list)->OnBindPipeline(stages, pipeline);
+    }
+
+    void CubemapManager::OnPushDescriptors(reshade::api::command_list* cmd_list, reshade::api::shader_stage stages, const reshade::api::descriptor_table_update& update) {
+        CommandListBindings::GetOrCreate(cmd_list)->OnPushDescriptors(stages, update);
+    }
+
+    void CubemapManager::OnBindDescriptorTables(reshade::api::command_list* cmd_list, reshade::api::shader_stage stages) {
+        CommandListBindings::GetOrCreate(cmd_list)->OnBindDescriptorTables(stages);
+    }
+
+    void CubemapManager::OnResetCommandList(reshade::api::command_list* cmd_list) {
+        if (CommandListBindings* bindings = CommandListBindings::Get(cmd_list)) bindings->Invalidate();
+    }
+
+    void CubemapManager::OnBindState(reshade::api::command_list* cmd_list) {
+        if (CommandListBindings* bindings = CommandListBindings::Get(cmd_list)) bindings->OnBindState();
+    }
+
+    void CubemapManager::OnBindRenderTargets(reshade::api::command_list* cmd_list, reshade::api::resource_view dsv) {
+        OnBindState(cmd_list);
+
+        if (m_config.replayMode != ReplayMode::FaceMajor || m_config.replayFlush != ReplayFlush::PassBoundary) return;
+        if (dsv.handle == m_lastDepthTarget) return;
+        m_lastDepthTarget = dsv.handle;
+
+        // A new depth target starts a new pass; replay what the previous one recorded while its inputs are still current
+        ID3D11DeviceContext* ctx = (ID3D11DeviceContext*)cmd_list->get_native();
+        if (ctx && ctx->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE) FlushReplay(ctx);
+    }
+
+    void CubemapManager::FlushReplay(ID3D11DeviceContext* ctx) {
+        if (m_recorder.IsEmpty() || !m_faceDepth.handle) return;
+
+        ClearFaceDepth(ctx);
+
+        DrawRecorder::FaceTarget faces[6];
+        for (int i = 0; i < 6; ++i) {
+            faces[i].rtv = (ID3D11RenderTargetView*)m_faceRtvs[i].handle;
+            faces[i].dsv = (ID3D11DepthStencilView*)m_faceDsvs[i].handle;
+            faces[i].size = m_frameFaceSizes[i];
+        }
+        m_recorder.Replay(ctx, m_cbRing.GetContext1(ctx), m_cbRing, faces);
+    }
+
+    void CubemapManager::ClearFaceDepth(ID3D11DeviceContext* ctx) {
+        // Once per frame, before the first replayed or single-pass draw
+        if (m_faceDepthCleared) return;
+        ctx->ClearDepthStencilView((ID3D11DepthStencilView*)m_faceArrayDsv.handle, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+        m_faceDepthCleared = true;
+    }
+
+    bool CubemapManager::ScheduleFaces() {
+        // Decided at the first camera draw of a frame, when the camera buffer already holds this frame's view
+        if (!m_facesScheduled) {
+            Camera::Float4x4 view = m_cameraController->GetSnapshot().view;
+            uint32_t mask = m_scheduler.Schedule(DirectX::XMFLOAT4X4(&view.m[0][0]));
+            m_frameFaceMask = 0;
+            for (int i = 0; i < 6; ++i) {
+                m_frameFaceSizes[i] = (mask & (1u << i)) ? m_faceSizes[i] : 0;
+                if (m_frameFaceSizes[i]) m_frameFaceMask |= 1u << i;
+            }
+            m_facesScheduled = true;
+        }
+        return m_frameFaceMask != 0;
     }
 
     void CubemapManager::ProcessDraw(reshade::api::command_list* cmd_list, bool indexed, uint32_t count, uint32_t instance_count, uint32_t first, int32_t offset_or_vertex, uint32_t first_instance) {
         if (!m_isRecording) return;
-        
-        reshade::api::resource cameraBuffer = m_cameraController->GetCameraBuffer();
+        if (!m_cbRing.IsInitialized()) return; // Face targets are created on the first present
+        if (!m_captureFrame) return; // Between capture slots the game draws once and nothing is replicated
+
+        reshade::api::resource cameraBuffer = { m_cameraController->GetCameraBuffer() };
         if (cameraBuffer.handle == 0) return;
 
         ID3D11DeviceContext* ctx = (ID3D11DeviceContext*)cmd_list->get_native();
         if (!ctx) return;
 
-        // Check if camera buffer is bound to VS slot 0, 1, or 2
-        ID3D11Buffer* nativeCamBuf = (ID3D11Buffer*)cameraBuffer.handle;
-        ID3D11Buffer* vsBuffers[3] = { nullptr };
-        ctx->VSGetConstantBuffers(0, 3, vsBuffers);
-
-        int slot = -1;
-        for(int i=0; i<3; ++i) {
-            if (vsBuffers[i] == nativeCamBuf) {
-                slot = i;
+        // Check the shadow bindings for the camera buffer in any VS slot
+        CommandListBindings* bindings = CommandListBindings::GetOrCreate(cmd_list);
+        if (bindings->stale) {
+            // Bindings changed without events (first use, state cleared); resync once from the driver
+            ID3D11Buffer* vsBuffers[CommandListBindings::kVSConstantSlots] = { nullptr };
+            ctx->VSGetConstantBuffers(0, CommandListBindings::kVSConstantSlots, vsBuffers);
+            for (uint32_t i = 0; i < CommandListBindings::kVSConstantSlots; ++i) {
+                bindings->vsConstantBuffers[i] = (uint64_t)vsBuffers[i];
+                if (vsBuffers[i]) vsBuffers[i]->Release();
             }
-            if (vsBuffers[i]) vsBuffers[i]->Release();
-            if (slot != -1) break;
+
+            ComPtr<ID3D11VertexShader> vs;
+            ComPtr<ID3D11HullShader> hs;
+            ComPtr<ID3D11DomainShader> ds;
+            ComPtr<ID3D11GeometryShader> gs;
+            ctx->VSGetShader(vs.GetAddressOf(), nullptr, nullptr);
+            ctx->HSGetShader(hs.GetAddressOf(), nullptr, nullptr);
+            ctx->DSGetShader(ds.GetAddressOf(), nullptr, nullptr);
+            ctx->GSGetShader(gs.GetAddressOf(), nullptr, nullptr);
+            bindings->vertexShader = (uint64_t)vs.Get();
+            bindings->hullShader = (uint64_t)hs.Get();
+            bindings->domainShader = (uint64_t)ds.Get();
+            bindings->geometryShader = (uint64_t)gs.Get();
+            bindings->stale = false;
         }
 
+        int slot = bindings->FindVSConstantBuffer(cameraBuffer.handle);
         if (slot == -1) return;
 
-        // Save State
-        StateBlock state(ctx);
+        ID3D11Buffer* nativeCamBuf = (ID3D11Buffer*)cameraBuffer.handle;
+
+        // Face payloads are only rebuilt when the camera buffer changed since the last draw
+        if (!m_facePayloads.Refresh(*m_cameraController)) return;
 
-        // Loop 6 Faces
-        std::vector<uint8_t> modData;
+        // Nothing to do when every face keeps last frame's contents
+        if (!ScheduleFaces()) return;
 
-        // Create a temporary buffer for injection if not cached.
-        // For performance in a real scenario, we should have a pool.
-        // Here we create one per draw call which is slow but correct for logic.
         D3D11_BUFFER_DESC desc = {};
         nativeCamBuf->GetDesc(&desc);
-        desc.Usage = D3D11_USAGE_DYNAMIC;
-        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 
-        ComPtr<ID3D11Buffer> tempCB;
-        ComPtr<ID3D11Device> device;
-        ctx->GetDevice(&device);
-        if (FAILED(device->CreateBuffer(&desc, nullptr, tempCB.GetAddressOf()))) return;
+        DrawRecorder::DrawArgs args;
+        args.indexed = indexed;
+        args.count = count;
+        args.instanceCount = instance_count;
+        args.first = first;
+        args.vertexOffset = offset_or_vertex;
+        args.firstInstance = first_instance;
+
+        // Single-pass mode draws all six faces at once through the generated GS (immediate context, game draws without
+        // tessellation or GS); unsupported shaders and topologies fall through to the per-face loop
+        if (m_config.replayMode == ReplayMode::SinglePass && ctx->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE &&
+            !bindings->UsesTessellationOrGeometry() && m_facePayloads.HasFaceClipTransforms()) {
+            ClearFaceDepth(ctx);
+            if (m_multiView.Draw(ctx, bindings->vertexShader, args, m_facePayloads, (ID3D11RenderTargetView*)m_faceArrayRtv.handle,
+                                 (ID3D11DepthStencilView*)m_faceArrayDsv.handle, m_frameFaceSizes))
+                return;
+        }
 
-        // Get Current Depth View to reuse (assuming face render target matches size)
-        ComPtr<ID3D11DepthStencilView> currentDSV;
-        ctx->OMGetRenderTargets(0, nullptr, currentDSV.GetAddressOf());
+        // Face-major mode defers the draw to FlushReplay (immediate context, no tessellation or GS; others fall through)
+        if (m_config.replayMode == ReplayMode::FaceMajor && ctx->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE &&
+            !bindings->UsesTessellationOrGeometry()) {
+            if (m_recorder.Record(ctx, m_cbRing.GetContext1(ctx), bindings->stateSerial, args, (UINT)slot, desc.ByteWidth, m_facePayloads))
+                return;
+            // Not deferrable; keep the face order of what was logged before it
+            FlushReplay(ctx);
+        }
 
-        for (int i = 0; i < 6; ++i) {
-            if (!m_cameraController->GetModifiedBufferData((Camera::CubeFace)i, modData)) continue;
+        // Upload all six faces at once (skipped while the same payload generation is still resident)
+        if (!m_cbRing.Upload(ctx, desc.ByteWidth, m_facePayloads)) return;
 
-            // Update Temp Buffer
-            D3D11_MAPPED_SUBRESOURCE mapped;
-            if (SUCCEEDED(ctx->Map(tempCB.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
-                memcpy(mapped.pData, modData.data(), std::min((size_t)desc.ByteWidth, modData.size()));
-                ctx->Unmap(tempCB.Get(), 0);
-            }
+        // Save only what the replication touches: the camera slot, the render targets and the face viewport
+        StateGuard<kStateVSConstantBuffer | kStateRenderTargets | kStateViewports | kStateScissorRects> state(ctx, slot, m_cbRing.GetContext1(ctx));
+
+        // Reuse the current depth view (assuming face render target matches size)
+        ID3D11DepthStencilView* currentDSV = state.GetDepthStencilView();
+
+        // Single-pass fallbacks share the face depth slices with the single-pass draws so occlusion stays consistent
+        bool faceDepth = m_config.replayMode == ReplayMode::SinglePass && ctx->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE;
+        if (faceDepth) ClearFaceDepth(ctx);
+
+        for (int i = 0; i < 6; ++i) {
+            if (m_frameFaceSizes[i] == 0) continue; // Skipped by the face budget or not scheduled this frame
 
             // Bind Modified Camera
-            ID3D11Buffer* cbArray[] = { tempCB.Get() };
-            ctx->VSSetConstantBuffers(slot, 1, cbArray);
+            m_cbRing.BindFace(ctx, slot, i);
+
+            // Reduced-resolution faces render into the top-left corner of their slice
+            D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (FLOAT)m_frameFaceSizes[i], (FLOAT)m_frameFaceSizes[i], 0.0f, 1.0f };
+            D3D11_RECT scissor = { 0, 0, (LONG)m_frameFaceSizes[i], (LONG)m_frameFaceSizes[i] };
+            ctx->RSSetViewports(1, &viewport);
+            ctx->RSSetScissorRects(1, &scissor);
 
             // Bind Face Render Target
             // Note: We reuse current DSV. If Face Size != Screen Size, this is invalid!
@@ -259,7 +717,7 @@ namespace Graphics {
             // For now, we assume the user configured the game resolution to match or we accept artifacts.
 
             ID3D11RenderTargetView* faceRTV = (ID3D11RenderTargetView*)m_faceRtvs[i].handle;
-            ctx->OMSetRenderTargets(1, &faceRTV, currentDSV.Get()); // Re-bind DSV
+            ctx->OMSetRenderTargets(1, &faceRTV, faceDepth ? (ID3D11DepthStencilView*)m_faceDsvs[i].handle : currentDSV); // Re-bind DSV
 
             // Draw
             if (indexed) {
@@ -269,7 +727,7 @@ namespace Graphics {
             }
         }
 
-        // StateBlock destructor restores state automatically
+        // StateGuard destructor restores state automatically
     }
 
     void CubemapManager::OnDraw(reshade::api::command_list* cmd_list, uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance) {
@@ -280,25 +738,47 @@ namespace Graphics {
         ProcessDraw(cmd_list, true, index_count, instance_count, first_index, vertex_offset, first_instance);
     }
 
-    void CubemapManager::OnPresent(reshade::api::command_queue* queue, reshade::api::swapchain* swapchain) {
-        if (!InitResources(m_width, m_height)) {
-             reshade::api::resource backBuffer = swapchain->get_current_back_buffer();
-             reshade::api::resource_desc desc = m_device->get_resource_desc(backBuffer);
-             InitResources((uint32_t)desc.texture.width, (uint32_t)desc.texture.height);
+    void CubemapManager::ProjectAndEncode(ID3D11DeviceContext* ctx) {
+        // Borrow the encoder surface first and write it in place; nothing is projected for a dropped frame
+        Video::FrameDesc surface;
+        if (!AcquireOutput(&surface)) return;
+        const SurfaceViews* views = GetSurfaceViews(surface);
+        if (!views) {
+            LOG_ERROR("Failed to create views on the encoder surface");
+            ReleaseOutput();
+            return;
         }
 
-        // Copy Faces to Cube Texture (Array)
-        for(int i=0; i<6; ++i) {
-             m_device->copy_texture_region(m_faceTextures[i], 0, nullptr, m_cubeTexture, i, nullptr);
+        UINT outWidth = m_projectionLut.GetWidth();
+        UINT outHeight = m_projectionLut.GetHeight();
+        ID3D11ShaderResourceView* srvs[] = { (ID3D11ShaderResourceView*)m_cubeSrv.handle, m_projectionLutSrv.Get() };
+        ID3D11ShaderResourceView* nullSRVs[] = { nullptr, nullptr };
+
+        if (m_cubeToNV12) {
+            // One pass from the cube faces to the encoder input, one thread per 2x2 block
+            ctx->CSSetShader(m_cubeToNV12.Get(), nullptr, 0);
+            ctx->CSSetConstantBuffers(0, 1, m_projectionParams.GetAddressOf());
+            ctx->CSSetSamplers(0, 1, m_linearSampler.GetAddressOf());
+            ctx->CSSetShaderResources(0, 2, srvs);
+            ID3D11UnorderedAccessView* uavs[] = { views->yUav.Get(), views->uvUav.Get() };
+            ctx->CSSetUnorderedAccessViews(0, 2, uavs, nullptr);
+
+            ctx->Dispatch((outWidth / 2 + 7) / 8, (outHeight / 2 + 7) / 8, 1);
+
+            ID3D11UnorderedAccessView* nullUAVs[] = { nullptr, nullptr };
+            ctx->CSSetUnorderedAccessViews(0, 2, nullUAVs, nullptr);
+            ctx->CSSetShaderResources(0, 2, nullSRVs);
+
+            SubmitOutput(ctx);
+            return;
         }
 
         // Execute Compute Shader to Stitch/Project
-        ID3D11DeviceContext* ctx = (ID3D11DeviceContext*)queue->get_native();
-
         if (m_projectionShader) {
             ctx->CSSetShader(m_projectionShader.Get(), nullptr, 0);
-            ID3D11ShaderResourceView* srv = (ID3D11ShaderResourceView*)m_cubeSrv.handle;
-            ctx->CSSetShaderResources(0, 1, &srv);
+            ctx->CSSetConstantBuffers(0, 1, m_projectionParams.GetAddressOf());
+            ctx->CSSetSamplers(0, 1, m_linearSampler.GetAddressOf());
+            ctx->CSSetShaderResources(0, 2, srvs);
             ID3D11UnorderedAccessView* uav = (ID3D11UnorderedAccessView*)m_equirectUAV.handle;
             ctx->CSSetUnorderedAccessViews(0, 1, &uav, nullptr);
             
@@ -309,48 +789,127 @@ namespace Graphics {
             
             ID3D11UnorderedAccessView* nullUAV[] = { nullptr };
             ctx->CSSetUnorderedAccessViews(0, 1, nullUAV, nullptr);
-            ID3D11ShaderResourceView* nullSRV[] = { nullptr };
-            ctx->CSSetShaderResources(0, 1, nullSRV);
+            ctx->CSSetShaderResources(0, 2, nullSRVs);
         }
 
         // Convert to NV12 and Encode
-        // We render a full-screen quad to the NV12 targets using the Equirect texture as input
-        if (m_equirectNV12) {
-             // Setup Viewport
-             D3D11_TEXTURE2D_DESC eqDesc;
-             m_equirectNV12->GetDesc(&eqDesc);
-
-             ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-             ctx->VSSetShader(m_convertVS.Get(), nullptr, 0);
-
-             ID3D11ShaderResourceView* srv = (ID3D11ShaderResourceView*)m_equirectSRV.handle;
-             ctx->PSSetShaderResources(0, 1, &srv);
-             ctx->PSSetSamplers(0, 1, m_linearSampler.GetAddressOf());
-
-             // Y Pass
-             D3D11_VIEWPORT vp = {};
-             vp.Width = (float)eqDesc.Width;
-             vp.Height = (float)eqDesc.Height;
-             vp.MaxDepth = 1.0f;
-             ctx->RSSetViewports(1, &vp);
-             ctx->OMSetRenderTargets(1, m_nv12Y_RTV.GetAddressOf(), nullptr);
-             ctx->PSSetShader(m_convertPS_Y.Get(), nullptr, 0);
-             ctx->Draw(3, 0); // Full screen triangle
-
-             // UV Pass
-             vp.Width = (float)eqDesc.Width / 2.0f;
-             vp.Height = (float)eqDesc.Height / 2.0f;
-             ctx->RSSetViewports(1, &vp);
-             ctx->OMSetRenderTargets(1, m_nv12UV_RTV.GetAddressOf(), nullptr);
-             ctx->PSSetShader(m_convertPS_UV.Get(), nullptr, 0);
-             ctx->Draw(3, 0);
-
-             // Encode
-             m_encoder->EncodeFrame(m_equirectNV12.Get());
-
-             // Cleanup
-             ID3D11RenderTargetView* nullRTV = nullptr;
-             ctx->OMSetRenderTargets(1, &nullRTV, nullptr);
+        // We render a full-screen quad to the surface planes using the Equirect texture as input
+        ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        ctx->VSSetShader(m_convertVS.Get(), nullptr, 0);
+
+        ID3D11ShaderResourceView* srv = (ID3D11ShaderResourceView*)m_equirectSRV.handle;
+        ctx->PSSetShaderResources(0, 1, &srv);
+        ctx->PSSetSamplers(0, 1, m_linearSampler.GetAddressOf());
+
+        // Y Pass
+        D3D11_VIEWPORT vp = {};
+        vp.Width = (float)outWidth;
+        vp.Height = (float)outHeight;
+        vp.MaxDepth = 1.0f;
+        ctx->RSSetViewports(1, &vp);
+        ctx->OMSetRenderTargets(1, views->yRtv.GetAddressOf(), nullptr);
+        ctx->PSSetShader(m_convertPS_Y.Get(), nullptr, 0);
+        ctx->Draw(3, 0); // Full screen triangle
+
+        // UV Pass
+        vp.Width = (float)outWidth / 2.0f;
+        vp.Height = (float)outHeight / 2.0f;
+        ctx->RSSetViewports(1, &vp);
+        ctx->OMSetRenderTargets(1, views->uvRtv.GetAddressOf(), nullptr);
+        ctx->PSSetShader(m_convertPS_UV.Get(), nullptr, 0);
+        ctx->Draw(3, 0);
+
+        // Cleanup
+        ID3D11RenderTargetView* nullRTV = nullptr;
+        ctx->OMSetRenderTargets(1, &nullRTV, nullptr);
+
+        // Encode
+        SubmitOutput(ctx);
+    }
+
+    void CubemapManager::OnReShadePresent(reshade::api::effect_runtime* runtime) {
+        // Instant replay: the key press starts a save in the background. ReShade's input sees every press made while
+        // the game window has focus, however short, and reports it once.
+        if (m_encoder && m_config.output.mode == Video::OutputMode::Replay && runtime->is_key_pressed(m_config.saveReplayKey)) {
+            m_encoder->SaveReplay();
+        }
+    }
+
+    void CubemapManager::OnPresent(reshade::api::command_queue* queue, reshade::api::swapchain* swapchain) {
+        if (!InitResources(m_width, m_height)) {
+             reshade::api::resource backBuffer = swapchain->get_current_back_buffer();
+             reshade::api::resource_desc desc = m_device->get_resource_desc(backBuffer);
+             InitResources((uint32_t)desc.texture.width, (uint32_t)desc.texture.height);
+        }
+
+        ID3D11DeviceContext* ctx = (ID3D11DeviceContext*)queue->get_native();
+
+        if (m_captureFrame) {
+            // Render the face-major log before the faces are consumed
+            FlushReplay(ctx);
+            ProjectAndEncode(ctx);
+        }
+        m_faceDepthCleared = false;
+        m_lastDepthTarget = 0;
+        m_facesScheduled = false;
+
+        m_cbRing.EndFrame();
+
+        // The passes above change state behind the binding tracker's back
+        if (CommandListBindings* bindings = CommandListBindings::Get(queue->get_immediate_command_list())) bindings->Invalidate();
+
+        // The next frame starts now
+        m_captureFrame = m_clock.BeginFrame();
+
+        // Periodic scanner statistics (per-frame averages since start)
+        if (++m_frameCount % 600 == 0) {
+            Camera::ScanStats stats = m_cameraController->GetScanStats();
+            LOG_INFO("Camera scan: ", stats.windowsScanned / m_frameCount, " of ", stats.windowsTotal / m_frameCount,
+                     " windows/frame tested, ", stats.negativeCacheHits / m_frameCount, " negative cache hits/frame, ",
+                     stats.fullScans, " full scans total");
+
+            LOG_INFO("Face payloads: ", m_facePayloads.GetRebuildCount(), " rebuilds total (",
+                     m_facePayloads.GetRebuildCount() * Camera::FacePayloads::kFaceCount / m_frameCount, " face matrix sets/frame)");
+
+            UploadStats upload = m_cbRing.GetFrameStats();
+            UploadStats uploadTotal = m_cbRing.GetTotalStats();
+            LOG_INFO("Camera constants last frame: ", upload.bytesUploaded, " bytes uploaded, ", upload.uploads, " uploads, ",
+                     upload.reusedUploads, " reused, ", upload.buffersCreated, " buffers created (", uploadTotal.buffersCreated,
+                     " total, ", uploadTotal.ringWraps, " ring wraps)");
+
+            if (m_config.replayMode == ReplayMode::FaceMajor) {
+                ReplayStats replay = m_recorder.GetStats();
+                LOG_INFO("Face-major replay: ", replay.draws / m_frameCount, " draws/frame, ", replay.states / m_frameCount,
+                         " states/frame, ", replay.payloadSets / m_frameCount, " payload sets/frame, ", replay.flushes / m_frameCount, " flushes/frame (",
+                         replay.writeFlushes / m_frameCount, " forced by buffer writes), ", replay.snapshots / m_frameCount, " constant buffer snapshots/frame");
+            }
+
+            if (m_config.replayMode == ReplayMode::SinglePass) {
+                MultiViewStats multiView = m_multiView.GetStats();
+                LOG_INFO("Single pass: ", multiView.draws / m_frameCount, " draws/frame, ", multiView.fallbacks / m_frameCount,
+                         " per-face fallbacks/frame (", multiView.compileFallbacks, " while compiling), ", multiView.shadersCompiled, " geometry shaders compiled, ",
+                         multiView.shadersRejected, " rejected");
+            }
+
+            const FaceScheduleStats& schedule = m_scheduler.GetStats();
+            if (schedule.frames) {
+                LOG_INFO("Face renders per 100 frames R/L/U/D/F/B: ", schedule.faceRenders[0] * 100 / schedule.frames, "/",
+                         schedule.faceRenders[1] * 100 / schedule.frames, "/", schedule.faceRenders[2] * 100 / schedule.frames, "/",
+                         schedule.faceRenders[3] * 100 / schedule.frames, "/", schedule.faceRenders[4] * 100 / schedule.frames, "/",
+                         schedule.faceRenders[5] * 100 / schedule.frames, ", ", schedule.fullRefreshes, " full refreshes");
+            }
+
+            const Video::CaptureClockStats& clock = m_clock.GetStats();
+            LOG_INFO("Capture clock: ", clock.captures, " of ", clock.frames, " frames captured, ", clock.skippedSlots,
+                     " output frames without a game frame");
+
+            Video::FrameQueueStats encode = m_encoder ? m_encoder->GetQueueStats() : Video::FrameQueueStats();
+            LOG_INFO("Encode queue: ", encode.depth, " frames queued (max ", encode.maxDepth, "), ", encode.completed, " of ",
+                     encode.submitted, " encoded, ", encode.droppedOldest + encode.droppedNewest, " dropped, ", encode.blocks, " waits");
+
+            Camera::BufferCacheStats cache = m_cameraController->GetCacheStats();
+            LOG_INFO("Buffer cache: ", cache.entries, " entries, ", cache.residentBytes / 1024, " KB resident, ",
+                     cache.committedBytes / 1024, " KB committed, ", cache.evictions, " evictions, ", cache.purges, " purges");
         }
     }
 }
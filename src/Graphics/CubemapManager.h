@@ -3,8 +3,18 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include <memory>
+#include <vector>
 #include "../Camera/CameraController.h"
+#include "../Camera/FacePayloads.h"
 #include "../Video/FFmpegBackend.h"
+#include "../Video/SoftwareBackend.h"
+#include "../Video/CaptureClock.h"
+#include "../Compute/ProjectionLut.h"
+#include "ConstantBufferRing.h"
+#include "DrawRecorder.h"
+#include "MultiViewRenderer.h"
+#include "FaceScheduler.h"
+#include "../Core/Config.h"
 
 namespace Graphics {
 
@@ -14,40 +24,110 @@ namespace Graphics {
         ~CubemapManager();
 
         void OnPresent(reshade::api::command_queue* queue, reshade::api::swapchain* swapchain);
+        void OnReShadePresent(reshade::api::effect_runtime* runtime);
         void OnDraw(reshade::api::command_list* cmd_list, uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
         void OnDrawIndexed(reshade::api::command_list* cmd_list, uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
         void OnUpdateBuffer(reshade::api::device* device, reshade::api::resource resource, const void* data, uint64_t size);
+        void OnDestroyResource(reshade::api::resource resource);
+        void OnInitPipeline(reshade::api::pipeline pipeline, uint32_t subobjectCount, const reshade::api::pipeline_subobject* subobjects);
+        void OnDestroyPipeline(reshade::api::pipeline pipeline);
         void OnBindPipeline(reshade::api::command_list* cmd_list, reshade::api::pipeline_stage stages, reshade::api::pipeline pipeline);
+        void OnPushDescriptors(reshade::api::command_list* cmd_list, reshade::api::shader_stage stages, const reshade::api::descriptor_table_update& update);
+        void OnBindDescriptorTables(reshade::api::command_list* cmd_list, reshade::api::shader_stage stages);
+        void OnResetCommandList(reshade::api::command_list* cmd_list);
+        void OnBindState(reshade::api::command_list* cmd_list);
+        void OnBindRenderTargets(reshade::api::command_list* cmd_list, reshade::api::resource_view dsv);
 
     private:
         bool InitResources(uint32_t width, uint32_t height);
         void DestroyResources();
         
         void ProcessDraw(reshade::api::command_list* cmd_list, auto drawCallback);
+        void FlushReplay(ID3D11DeviceContext* ctx);
+        void ClearFaceDepth(ID3D11DeviceContext* ctx);
+        void ProjectAndEncode(ID3D11DeviceContext* ctx);
+        // The fused kernel; false when the GPU cannot write NV12 from compute
+        bool InitFusedConversion(ID3D11Device* device);
+        // Hardware encoder, or the software one per the config
+        bool InitEncoder(ID3D11Device* device, UINT width, UINT height, const Video::SphericalMetadata& spherical);
+        // Software encoding: the NV12 output texture and its staging copies; uav reports compute write support
+        bool InitReadback(ID3D11Device* device, UINT width, UINT height, bool* uav);
+
+        // The NV12 surface this frame is written into: an encoder pool surface, or the readback source
+        bool AcquireOutput(Video::FrameDesc* surface);
+        void SubmitOutput(ID3D11DeviceContext* ctx);
+        void ReleaseOutput();
+        // Hands finished readbacks to the software encoder, oldest first. Waits for the GPU only when every staging
+        // texture is in flight, or for all of them when flushing.
+        void EncodeReadbacks(ID3D11DeviceContext* ctx, bool flush);
+
+        // Plane views on one slice of the encoder's surface array, created on first use of the slice
+        struct SurfaceViews {
+            Microsoft::WRL::ComPtr<ID3D11RenderTargetView> yRtv;
+            Microsoft::WRL::ComPtr<ID3D11RenderTargetView> uvRtv;
+            Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> yUav;
+            Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uvUav;
+        };
+        const SurfaceViews* GetSurfaceViews(const Video::FrameDesc& surface);
+        // Picks this frame's faces on first use; false when none is rendered this frame
+        bool ScheduleFaces();
 
         reshade::api::device* m_device = nullptr;
+        CaptureConfig m_config;
         std::unique_ptr<Camera::CameraController> m_cameraController;
-        std::unique_ptr<Video::FFmpegBackend> m_encoder;
+        Camera::FacePayloads m_facePayloads; // Render thread only
+        ConstantBufferRing m_cbRing;
+        DrawRecorder m_recorder; // FaceMajor replay log (immediate context)
+        MultiViewRenderer m_multiView; // SinglePass draws (immediate context)
+        FaceScheduler m_scheduler;
+        Video::CaptureClock m_clock;
+        std::unique_ptr<Video::Encoder> m_encoder;
+        Video::FFmpegBackend* m_hardwareEncoder = nullptr; // m_encoder when it encodes from GPU surfaces
 
         // Resources
-        reshade::api::resource m_faceTextures[6] = {};
-        reshade::api::resource_view m_faceRtvs[6] = {};
-        reshade::api::resource_view m_faceSrvs[6] = {};
-        
+        // Faces are the six slices of the cube texture: per-slice RTVs for per-face draws, a whole-array RTV for single
+        // pass, and an array SRV the projection pass samples in place
         reshade::api::resource m_cubeTexture = {};
+        reshade::api::resource_view m_faceRtvs[6] = {};
+        reshade::api::resource_view m_faceArrayRtv = {};
         reshade::api::resource_view m_cubeSrv = {};
+        
+        // Face depth (one slice per face) for replayed and single-pass draws
+        reshade::api::resource m_faceDepth = {};
+        reshade::api::resource_view m_faceDsvs[6] = {};
+        reshade::api::resource_view m_faceArrayDsv = {};
+        bool m_faceDepthCleared = false;
+        uint64_t m_lastDepthTarget = 0; // Game DSV, for pass boundary flushes
 
         reshade::api::resource m_equirectTexture = {};
         reshade::api::resource_view m_equirectUAV = {};
         reshade::api::resource_view m_equirectSRV = {};
 
-        // Native Interop for FFmpeg (NV12)
-        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_equirectNV12;
-        Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_nv12Y_RTV;
-        Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_nv12UV_RTV;
+        // Native Interop for FFmpeg (NV12): the output is written straight into the encoder's pool surfaces
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_surfaceArray;
+        std::vector<SurfaceViews> m_surfaceViews; // Indexed by array slice
+
+        // Software encoding: the output is written into a texture of our own and copied to a ring of staging textures,
+        // mapped a few frames later so the present thread doesn't wait for the GPU
+        static constexpr uint32_t kReadbackFrames = 3;
+        struct Readback {
+            Microsoft::WRL::ComPtr<ID3D11Texture2D> staging;
+            int64_t timestamp = 0;
+        };
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> m_readbackSource;
+        Readback m_readbacks[kReadbackFrames];
+        uint32_t m_readbackHead = 0;  // Oldest copy not yet encoded
+        uint32_t m_readbackCount = 0;
+
+        // Fused cube -> NV12 kernel. Without it the cube is projected into the RGBA equirect and converted by two raster
+        // passes (equirect texture and the shaders below are only created for that fallback).
+        Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_cubeToNV12;
 
         // Shaders (Native D3D11 for now as ReShade doesn't provide easy runtime compilation)
         Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_projectionShader;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> m_projectionParams;
+        Compute::ProjectionLut m_projectionLut; // Rebuilt when the output size changes, kept for CPU projection
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_projectionLutSrv;
         Microsoft::WRL::ComPtr<ID3D11VertexShader> m_convertVS;
         Microsoft::WRL::ComPtr<ID3D11PixelShader> m_convertPS_Y;
         Microsoft::WRL::ComPtr<ID3D11PixelShader> m_convertPS_UV;
@@ -57,17 +137,11 @@ namespace Graphics {
         uint32_t m_width = 0;
         uint32_t m_height = 0;
         uint32_t m_faceSize = 0;
-
-        // Pipeline tracking
-        reshade::api::pipeline_layout m_currentPipelineLayout = { 0 };
-        // We need to track if the camera buffer is bound. ReShade doesn't give easy access to "currently bound buffers"
-        // without tracking 'push_descriptors' or 'bind_descriptor_tables'.
-        // Simplified: we will try to find the slot index if possible, or just scan binds.
-        // Actually, detecting if the *current* draw call uses the camera buffer is hard without tracking bindings.
-        // For now, we will assume if the CameraController has identified a buffer, we check if it is active.
-        // BUT: ReShade's event `draw` doesn't tell us what resources are bound.
-        // We must implement `push_descriptors` / `bind_descriptor_tables` tracking in the manager.
-
-        bool m_isCameraBufferBound = false;
+        UINT m_faceSizes[6] = {}; // Rendered size per face from the face budget (0 = skipped)
+        UINT m_frameFaceSizes[6] = {}; // m_faceSizes limited to the faces scheduled this frame
+        uint32_t m_frameFaceMask = 0;
+        bool m_facesScheduled = false;
+        bool m_captureFrame = false; // Decided at the previous present for the frame in flight
+        uint64_t m_frameCount = 0;
     };
 }
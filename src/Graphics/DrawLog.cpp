@@ -0,0 +1,162 @@
+#include "DrawLog.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Graphics {
+
+    bool DrawLog::Record(DrawLogDevice& device, uint64_t stateSerial, const DrawArgs& args, uint32_t cameraSlot,
+                         uint32_t cameraByteWidth, const Camera::FacePayloads& payloads) {
+        m_recordThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+        // Consecutive draws usually share state; capture only when the tracker saw a change
+        if (!m_hasState || stateSerial != m_stateSerial) {
+            m_state = DrawLogState();
+            device.CaptureState(m_stateCount, &m_state);
+            m_hasState = true;
+            m_stateSerial = stateSerial;
+            m_stateDeferrable = m_state.deferrable;
+            if (!m_stateDeferrable) {
+                device.ReleaseState(m_stateCount);
+                return false;
+            }
+
+            m_stateCount++;
+            m_stats.states++;
+            if (m_state.indexBuffer) m_referencedBuffers.insert(m_state.indexBuffer);
+            for (uint64_t vb : m_state.vertexBuffers) {
+                if (vb) m_referencedBuffers.insert(vb);
+            }
+            m_srvSlots[0] = std::max(m_srvSlots[0], m_state.srvCount[0]);
+            m_srvSlots[1] = std::max(m_srvSlots[1], m_state.srvCount[1]);
+        } else if (!m_stateDeferrable) {
+            return false;
+        }
+
+        // Constant buffers as they are now; the camera slot is replaced by the face payload anyway
+        uint32_t snapshotBegin = (uint32_t)m_bindings.size();
+        for (uint8_t stage = 0; stage < 2; ++stage) {
+            for (uint8_t slot = 0; slot < DrawLogState::kConstantSlots; ++slot) {
+                uint64_t buffer = m_state.snapshotBuffers[stage][slot];
+                if (!buffer || (stage == 0 && slot == cameraSlot)) continue;
+                uint64_t snapshot = Snapshot(device, buffer);
+                if (!snapshot) {
+                    m_bindings.resize(snapshotBegin);
+                    return false;
+                }
+                m_bindings.push_back({ stage, slot, snapshot });
+            }
+        }
+
+        // Draws between two writes share one binding list
+        uint32_t snapshotCount = (uint32_t)m_bindings.size() - snapshotBegin;
+        if (!m_draws.empty() && m_draws.back().state == m_stateCount - 1 && m_draws.back().snapshotCount == snapshotCount) {
+            const SnapshotBinding* last = m_bindings.data() + m_draws.back().snapshotBegin;
+            const SnapshotBinding* current = m_bindings.data() + snapshotBegin;
+            bool same = true;
+            for (uint32_t i = 0; i < snapshotCount && same; ++i) same = last[i].snapshot == current[i].snapshot;
+            if (same) {
+                m_bindings.resize(snapshotBegin);
+                snapshotBegin = m_draws.back().snapshotBegin;
+            }
+        }
+
+        if (m_payloads.empty() || m_payloads.back().generation != payloads.GetGeneration()) {
+            PayloadRecord record;
+            record.offset = m_payloadData.size();
+            record.faceSize = payloads.GetSize();
+            record.faceStride = payloads.GetStride();
+            record.generation = payloads.GetGeneration();
+
+            size_t bytes = (size_t)record.faceStride * Camera::FacePayloads::kFaceCount;
+            m_payloadData.resize(record.offset + bytes);
+            memcpy(m_payloadData.data() + record.offset, payloads.GetData(), bytes);
+            m_payloads.push_back(record);
+            m_stats.payloadSets++;
+        }
+
+        RecordedDraw draw;
+        draw.args = args;
+        draw.state = m_stateCount - 1;
+        draw.payload = (uint32_t)(m_payloads.size() - 1);
+        draw.cameraSlot = cameraSlot;
+        draw.cameraByteWidth = cameraByteWidth;
+        draw.snapshotBegin = snapshotBegin;
+        draw.snapshotCount = snapshotCount;
+        m_draws.push_back(draw);
+        m_stats.draws++;
+        return true;
+    }
+
+    bool DrawLog::OnBufferWrite(uint64_t buffer) {
+        if (m_recordThread.load(std::memory_order_relaxed) != std::this_thread::get_id()) return false;
+        if (m_snapshots.empty() && m_referencedBuffers.empty()) return false;
+
+        m_snapshots.erase(buffer); // Draws recorded from now on take a new copy
+        if (m_referencedBuffers.count(buffer) == 0) return false;
+        m_stats.writeFlushes++;
+        return true;
+    }
+
+    uint64_t DrawLog::Snapshot(DrawLogDevice& device, uint64_t buffer) {
+        auto it = m_snapshots.find(buffer);
+        if (it != m_snapshots.end()) return it->second;
+
+        uint64_t snapshot = device.CopySnapshot(buffer);
+        if (!snapshot) return 0;
+        m_snapshots[buffer] = snapshot;
+        m_stats.snapshots++;
+        return snapshot;
+    }
+
+    void DrawLog::Replay(DrawLogDevice& device) {
+        if (m_draws.empty()) return;
+
+        for (uint32_t face = 0; face < Camera::FacePayloads::kFaceCount; ++face) {
+            if (!device.BeginFace(face)) continue;
+
+            uint32_t currentState = UINT32_MAX;
+            uint32_t currentPayload = UINT32_MAX;
+            uint32_t currentSnapshots = UINT32_MAX;
+
+            for (const RecordedDraw& draw : m_draws) {
+                bool stateChanged = draw.state != currentState;
+                if (stateChanged) {
+                    device.ApplyState(draw.state);
+                    currentState = draw.state;
+                }
+                if (stateChanged || draw.snapshotBegin != currentSnapshots) {
+                    for (uint32_t i = 0; i < draw.snapshotCount; ++i) {
+                        const SnapshotBinding& binding = m_bindings[draw.snapshotBegin + i];
+                        device.BindSnapshot(draw.state, binding.stage, binding.slot, binding.snapshot);
+                    }
+                    currentSnapshots = draw.snapshotBegin;
+                }
+
+                // Applying a state re-binds the game's camera buffer, so the face payload goes back on top
+                if (stateChanged || draw.payload != currentPayload) {
+                    const PayloadRecord& payload = m_payloads[draw.payload];
+                    DrawLogDevice::Payload set = { m_payloadData.data() + payload.offset, payload.faceSize, payload.faceStride, payload.generation };
+                    if (!device.BindPayload(face, draw.cameraSlot, draw.cameraByteWidth, set)) continue;
+                    currentPayload = draw.payload;
+                }
+
+                device.Draw(draw.args);
+            }
+        }
+
+        m_stats.flushes++;
+        Clear();
+    }
+
+    void DrawLog::Clear() {
+        m_stateCount = 0;
+        m_hasState = false;
+        m_srvSlots[0] = m_srvSlots[1] = 0;
+        m_snapshots.clear();
+        m_referencedBuffers.clear();
+        m_bindings.clear();
+        m_payloadData.clear();
+        m_payloads.clear();
+        m_draws.clear();
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../Camera/FacePayloads.h"
+
+namespace Graphics {
+
+    struct ReplayStats {
+        uint64_t draws = 0;        // Draws recorded
+        uint64_t states = 0;       // Pipeline states captured
+        uint64_t payloadSets = 0;  // Distinct face payload sets recorded
+        uint64_t flushes = 0;      // Log replays
+        uint64_t snapshots = 0;    // Constant buffers copied at record time
+        uint64_t writeFlushes = 0; // Flushes forced by a write to a vertex or index buffer the log reads
+    };
+
+    struct DrawArgs {
+        bool indexed = false;
+        uint32_t count = 0;
+        uint32_t instanceCount = 1;
+        uint32_t first = 0;
+        int32_t vertexOffset = 0;
+        uint32_t firstInstance = 0;
+    };
+
+    // What the log needs to know about a captured pipeline state. Buffers are the API objects' handles.
+    struct DrawLogState {
+        static constexpr uint32_t kConstantSlots = 14; // D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+        static constexpr uint32_t kVertexSlots = 32;   // D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT
+
+        bool deferrable = true; // No dynamic vertex or index buffer
+        uint64_t indexBuffer = 0;
+        uint64_t vertexBuffers[kVertexSlots] = {};
+        uint64_t snapshotBuffers[2][kConstantSlots] = {}; // VS/PS constant buffers the game can rewrite (0 = none)
+        uint32_t srvCount[2] = {};                        // VS/PS highest bound SRV slot + 1
+    };
+
+    // The graphics API side of the log: captures and re-applies pipeline states, copies constant buffers and issues
+    // the replayed draws. States are addressed by the index the log assigns; slots are reused after a flush.
+    class DrawLogDevice {
+    public:
+        struct Payload {
+            const uint8_t* faces = nullptr;
+            uint32_t faceSize = 0;
+            uint32_t faceStride = 0;
+            uint64_t generation = 0;
+        };
+
+        virtual ~DrawLogDevice() = default;
+
+        // Record time
+        virtual void CaptureState(uint32_t state, DrawLogState* outState) = 0;
+        virtual void ReleaseState(uint32_t state) = 0;
+        // Copies a constant buffer's current contents; 0 when no snapshot can be created
+        virtual uint64_t CopySnapshot(uint64_t buffer) = 0;
+
+        // Replay time. BeginFace returns false for faces that are not rendered.
+        virtual bool BeginFace(uint32_t face) = 0;
+        virtual void ApplyState(uint32_t state) = 0;
+        virtual void BindSnapshot(uint32_t state, uint8_t stage, uint8_t slot, uint64_t snapshot) = 0;
+        virtual bool BindPayload(uint32_t face, uint32_t cameraSlot, uint32_t cameraByteWidth, const Payload& payload) = 0;
+        virtual void Draw(const DrawArgs& args) = 0;
+    };
+
+    // Face-major replay log, independent of the graphics API.
+    // Camera draws are recorded with the pipeline state they were issued with (captured again only when the binding
+    // tracker's state serial moved) and the face payloads they need. Replay renders the whole log once per face with
+    // the faces as the outer loop, so render targets switch six times per flush instead of six times per draw.
+    // Buffers the game rewrites between draws: the VS/PS constant buffers of each draw are copied into snapshots
+    // (once per write), and a write to a recorded vertex or index buffer flushes the log before it lands.
+    class DrawLog {
+    public:
+        // Returns false without recording when the draw cannot be deferred (its state is not deferrable, or a snapshot
+        // could not be made); the caller then flushes the log and renders the draw immediately.
+        bool Record(DrawLogDevice& device, uint64_t stateSerial, const DrawArgs& args, uint32_t cameraSlot,
+                    uint32_t cameraByteWidth, const Camera::FacePayloads& payloads);
+
+        // Call before a buffer's contents change and after it was mapped. Returns true when recorded draws read the
+        // buffer directly, so the log must be replayed before the write. Writes from threads other than the recording
+        // one are deferred context commands and never hit the log.
+        bool OnBufferWrite(uint64_t buffer);
+
+        // Issues the log face by face and clears it
+        void Replay(DrawLogDevice& device);
+
+        // Drops the log (capacity is kept)
+        void Clear();
+        bool IsEmpty() const { return m_draws.empty(); }
+
+        // Highest SRV slot counts of the logged VS/PS states, which a replayed state must clear up to
+        uint32_t GetSRVSlots(uint32_t stage) const { return m_srvSlots[stage]; }
+        ReplayStats GetStats() const { return m_stats; }
+
+    private:
+        struct PayloadRecord {
+            size_t offset = 0; // Into m_payloadData
+            uint32_t faceSize = 0;
+            uint32_t faceStride = 0;
+            uint64_t generation = 0;
+        };
+
+        struct RecordedDraw {
+            DrawArgs args;
+            uint32_t state = 0;
+            uint32_t payload = 0;
+            uint32_t cameraSlot = 0;
+            uint32_t cameraByteWidth = 0;
+            uint32_t snapshotBegin = 0; // Range in m_bindings
+            uint32_t snapshotCount = 0;
+        };
+
+        // A constant buffer slot rebound to its record-time snapshot
+        struct SnapshotBinding {
+            uint8_t stage = 0; // 0 = VS, 1 = PS
+            uint8_t slot = 0;
+            uint64_t snapshot = 0;
+        };
+
+        // Current snapshot of a constant buffer, copied on first use after a write; 0 when none can be created
+        uint64_t Snapshot(DrawLogDevice& device, uint64_t buffer);
+
+        DrawLogState m_state;    // Last captured state; draws are recorded against it until the serial moves
+        uint32_t m_stateCount = 0; // States logged since the last flush
+        uint64_t m_stateSerial = 0;
+        bool m_hasState = false;       // m_stateSerial was captured since the last flush
+        bool m_stateDeferrable = true;
+        uint32_t m_srvSlots[2] = {};
+
+        std::unordered_map<uint64_t, uint64_t> m_snapshots; // Buffer -> snapshot of its current contents
+        std::unordered_set<uint64_t> m_referencedBuffers;   // Vertex and index buffers the log reads directly
+        std::vector<SnapshotBinding> m_bindings;
+        std::atomic<std::thread::id> m_recordThread;
+
+        std::vector<uint8_t> m_payloadData;
+        std::vector<PayloadRecord> m_payloads;
+        std::vector<RecordedDraw> m_draws;
+
+        ReplayStats m_stats;
+    };
+}
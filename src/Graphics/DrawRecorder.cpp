@@ -0,0 +1,275 @@
+#include "pch.h"
+#include "DrawRecorder.h"
+#include "StateGuard.h"
+#include <algorithm>
+
+namespace Graphics {
+
+    namespace {
+        constexpr UINT kCBSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+        constexpr UINT kSamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+        constexpr UINT kVBSlots = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+
+        template<typename T, size_t N>
+        void AttachAll(ComPtr<T> (&dst)[N], T* (&src)[N]) {
+            for (size_t i = 0; i < N; ++i) dst[i].Attach(src[i]);
+        }
+
+        template<typename T, size_t N>
+        void GetAll(const ComPtr<T> (&src)[N], T* (&dst)[N]) {
+            for (size_t i = 0; i < N; ++i) dst[i] = src[i].Get();
+        }
+
+        template<typename T, size_t N>
+        UINT BoundCount(T* (&slots)[N]) {
+            UINT count = N;
+            while (count > 0 && !slots[count - 1]) count--;
+            return count;
+        }
+
+        bool IsDynamic(ID3D11Buffer* buffer) {
+            if (!buffer) return false;
+            D3D11_BUFFER_DESC desc;
+            buffer->GetDesc(&desc);
+            return desc.Usage == D3D11_USAGE_DYNAMIC;
+        }
+
+        // Constant buffers the game can rewrite (everything but immutable ones)
+        void SnapshotBuffers(ID3D11Buffer* (&cbs)[kCBSlots], uint64_t (&outBuffers)[DrawLogState::kConstantSlots]) {
+            for (UINT i = 0; i < kCBSlots; ++i) {
+                outBuffers[i] = 0;
+                if (!cbs[i]) continue;
+                D3D11_BUFFER_DESC desc;
+                cbs[i]->GetDesc(&desc);
+                if (desc.Usage != D3D11_USAGE_IMMUTABLE) outBuffers[i] = (uint64_t)cbs[i];
+            }
+        }
+    }
+
+    static_assert(DrawLogState::kConstantSlots == D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, "DrawLogState slot counts");
+    static_assert(DrawLogState::kVertexSlots == D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT, "DrawLogState slot counts");
+
+    bool DrawRecorder::Record(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, uint64_t stateSerial, const DrawArgs& args,
+                              UINT cameraSlot, UINT cameraByteWidth, const Camera::FacePayloads& payloads) {
+        m_ctx = ctx;
+        m_context1 = context1;
+        return m_log.Record(*this, stateSerial, args, cameraSlot, cameraByteWidth, payloads);
+    }
+
+    void DrawRecorder::CaptureState(uint32_t state, DrawLogState* outState) {
+        if (state == m_states.size()) m_states.emplace_back();
+        Capture(m_ctx, m_context1, m_states[state], outState);
+        m_liveStates = std::max(m_liveStates, state + 1);
+    }
+
+    void DrawRecorder::ReleaseState(uint32_t state) {
+        m_states[state] = PipelineState();
+    }
+
+    uint64_t DrawRecorder::CopySnapshot(uint64_t buffer) {
+        ID3D11Buffer* source = (ID3D11Buffer*)buffer;
+        D3D11_BUFFER_DESC desc;
+        source->GetDesc(&desc);
+        SnapshotPool& pool = m_snapshotPools[desc.ByteWidth];
+        if (pool.used == pool.buffers.size()) {
+            ComPtr<ID3D11Device> device;
+            m_ctx->GetDevice(device.GetAddressOf());
+            D3D11_BUFFER_DESC snapshotDesc = { desc.ByteWidth, D3D11_USAGE_DEFAULT, D3D11_BIND_CONSTANT_BUFFER };
+            ComPtr<ID3D11Buffer> snapshot;
+            if (!device || FAILED(device->CreateBuffer(&snapshotDesc, nullptr, snapshot.GetAddressOf()))) return 0;
+            pool.buffers.push_back(snapshot);
+        }
+
+        ID3D11Buffer* snapshot = pool.buffers[pool.used++].Get();
+        m_ctx->CopyResource(snapshot, source);
+        return (uint64_t)snapshot;
+    }
+
+    void DrawRecorder::BindSnapshot(uint32_t state, uint8_t stage, uint8_t slot, uint64_t snapshot) {
+        const PipelineState& pipeline = m_states[state];
+        const ShaderStageState& stageState = stage == 0 ? pipeline.vs : pipeline.ps;
+        ID3D11Buffer* buffer = (ID3D11Buffer*)snapshot;
+        // Same ByteWidth as the game's buffer, so its constant range still applies
+        if (m_context1 && pipeline.hasConstantOffsets) {
+            const UINT* first = &stageState.firstConstant[slot];
+            const UINT* num = &stageState.numConstants[slot];
+            if (stage == 0) m_context1->VSSetConstantBuffers1(slot, 1, &buffer, first, num);
+            else m_context1->PSSetConstantBuffers1(slot, 1, &buffer, first, num);
+        } else if (stage == 0) {
+            m_ctx->VSSetConstantBuffers(slot, 1, &buffer);
+        } else {
+            m_ctx->PSSetConstantBuffers(slot, 1, &buffer);
+        }
+    }
+
+    void DrawRecorder::Replay(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, ConstantBufferRing& ring,
+                              const FaceTarget (&faces)[Camera::FacePayloads::kFaceCount]) {
+        if (m_log.IsEmpty()) return;
+
+        // The replay runs between game commands; put back everything it changes
+        StateGuard<kStateRenderTargets | kStateViewports | kStateScissorRects> targets(ctx);
+        PipelineState saved;
+        Capture(ctx, context1, saved, nullptr);
+        m_srvSlots[0] = std::max(m_log.GetSRVSlots(0), saved.vs.srvCount);
+        m_srvSlots[1] = std::max(m_log.GetSRVSlots(1), saved.ps.srvCount);
+
+        m_ctx = ctx;
+        m_context1 = context1;
+        m_ring = &ring;
+        m_faces = faces;
+        m_log.Replay(*this);
+        m_ring = nullptr;
+        m_faces = nullptr;
+
+        Apply(ctx, context1, saved, m_srvSlots);
+        Clear();
+    }
+
+    bool DrawRecorder::BeginFace(uint32_t face) {
+        const FaceTarget& target = m_faces[face];
+        if (target.size == 0) return false;
+
+        D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (FLOAT)target.size, (FLOAT)target.size, 0.0f, 1.0f };
+        D3D11_RECT scissor = { 0, 0, (LONG)target.size, (LONG)target.size };
+        m_ctx->OMSetRenderTargets(1, &target.rtv, target.dsv);
+        m_ctx->RSSetViewports(1, &viewport);
+        m_ctx->RSSetScissorRects(1, &scissor);
+        return true;
+    }
+
+    void DrawRecorder::ApplyState(uint32_t state) {
+        Apply(m_ctx, m_context1, m_states[state], m_srvSlots);
+    }
+
+    bool DrawRecorder::BindPayload(uint32_t face, uint32_t cameraSlot, uint32_t cameraByteWidth, const Payload& payload) {
+        ConstantBufferRing::PayloadSet set = { payload.faces, payload.faceSize, payload.faceStride, payload.generation };
+        if (!m_ring->Upload(m_ctx, cameraByteWidth, set)) return false;
+        m_ring->BindFace(m_ctx, cameraSlot, face);
+        return true;
+    }
+
+    void DrawRecorder::Draw(const DrawArgs& args) {
+        if (args.indexed) {
+            m_ctx->DrawIndexedInstanced(args.count, args.instanceCount, args.first, args.vertexOffset, args.firstInstance);
+        } else {
+            m_ctx->DrawInstanced(args.count, args.instanceCount, args.first, args.firstInstance);
+        }
+    }
+
+    void DrawRecorder::Clear() {
+        m_log.Clear();
+        for (uint32_t i = 0; i < m_liveStates; ++i) m_states[i] = PipelineState();
+        m_liveStates = 0;
+        for (auto& [byteWidth, pool] : m_snapshotPools) pool.used = 0;
+    }
+
+    void DrawRecorder::Capture(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, PipelineState& state, DrawLogState* outState) {
+        // IA
+        ctx->IAGetInputLayout(state.inputLayout.ReleaseAndGetAddressOf());
+        ctx->IAGetPrimitiveTopology(&state.topology);
+        ctx->IAGetIndexBuffer(state.indexBuffer.ReleaseAndGetAddressOf(), &state.indexFormat, &state.indexOffset);
+        ID3D11Buffer* vbs[kVBSlots] = { nullptr };
+        ctx->IAGetVertexBuffers(0, kVBSlots, vbs, state.vertexStrides, state.vertexOffsets);
+        AttachAll(state.vertexBuffers, vbs);
+
+        // A dynamic vertex or index buffer is rewritten in place by the next map; such draws are not deferred
+        if (outState) {
+            outState->indexBuffer = (uint64_t)state.indexBuffer.Get();
+            outState->deferrable = !IsDynamic(state.indexBuffer.Get());
+            for (UINT i = 0; i < kVBSlots; ++i) {
+                outState->vertexBuffers[i] = (uint64_t)vbs[i];
+                if (outState->deferrable) outState->deferrable = !IsDynamic(vbs[i]);
+            }
+        }
+
+        // Shaders
+        ctx->VSGetShader(state.vertexShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+        ctx->HSGetShader(state.hullShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+        ctx->DSGetShader(state.domainShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+        ctx->GSGetShader(state.geometryShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+        ctx->PSGetShader(state.pixelShader.ReleaseAndGetAddressOf(), nullptr, nullptr);
+
+        // VS resources
+        state.hasConstantOffsets = context1 != nullptr;
+        ID3D11Buffer* cbs[kCBSlots] = { nullptr };
+        if (context1) {
+            context1->VSGetConstantBuffers1(0, kCBSlots, cbs, state.vs.firstConstant, state.vs.numConstants);
+        } else {
+            ctx->VSGetConstantBuffers(0, kCBSlots, cbs);
+        }
+        if (outState) SnapshotBuffers(cbs, outState->snapshotBuffers[0]);
+        AttachAll(state.vs.constantBuffers, cbs);
+        ID3D11ShaderResourceView* srvs[kSRVSlots] = { nullptr };
+        ctx->VSGetShaderResources(0, kSRVSlots, srvs);
+        AttachAll(state.vs.srvs, srvs);
+        state.vs.srvCount = BoundCount(srvs);
+        if (outState) outState->srvCount[0] = state.vs.srvCount;
+        ID3D11SamplerState* samplers[kSamplerSlots] = { nullptr };
+        ctx->VSGetSamplers(0, kSamplerSlots, samplers);
+        AttachAll(state.vs.samplers, samplers);
+
+        // PS resources
+        if (context1) {
+            context1->PSGetConstantBuffers1(0, kCBSlots, cbs, state.ps.firstConstant, state.ps.numConstants);
+        } else {
+            ctx->PSGetConstantBuffers(0, kCBSlots, cbs);
+        }
+        if (outState) SnapshotBuffers(cbs, outState->snapshotBuffers[1]);
+        AttachAll(state.ps.constantBuffers, cbs);
+        ctx->PSGetShaderResources(0, kSRVSlots, srvs);
+        AttachAll(state.ps.srvs, srvs);
+        state.ps.srvCount = BoundCount(srvs);
+        if (outState) outState->srvCount[1] = state.ps.srvCount;
+        ctx->PSGetSamplers(0, kSamplerSlots, samplers);
+        AttachAll(state.ps.samplers, samplers);
+
+        // RS / OM
+        ctx->RSGetState(state.rasterizerState.ReleaseAndGetAddressOf());
+        ctx->OMGetBlendState(state.blendState.ReleaseAndGetAddressOf(), state.blendFactor, &state.sampleMask);
+        ctx->OMGetDepthStencilState(state.depthStencilState.ReleaseAndGetAddressOf(), &state.stencilRef);
+    }
+
+    void DrawRecorder::Apply(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, const PipelineState& state, const UINT (&srvSlots)[2]) {
+        ctx->IASetInputLayout(state.inputLayout.Get());
+        ctx->IASetPrimitiveTopology(state.topology);
+        ctx->IASetIndexBuffer(state.indexBuffer.Get(), state.indexFormat, state.indexOffset);
+        ID3D11Buffer* vbs[kVBSlots];
+        GetAll(state.vertexBuffers, vbs);
+        ctx->IASetVertexBuffers(0, kVBSlots, vbs, state.vertexStrides, state.vertexOffsets);
+
+        ctx->VSSetShader(state.vertexShader.Get(), nullptr, 0);
+        ctx->HSSetShader(state.hullShader.Get(), nullptr, 0);
+        ctx->DSSetShader(state.domainShader.Get(), nullptr, 0);
+        ctx->GSSetShader(state.geometryShader.Get(), nullptr, 0);
+        ctx->PSSetShader(state.pixelShader.Get(), nullptr, 0);
+
+        ID3D11Buffer* cbs[kCBSlots];
+        GetAll(state.vs.constantBuffers, cbs);
+        if (context1 && state.hasConstantOffsets) {
+            context1->VSSetConstantBuffers1(0, kCBSlots, cbs, state.vs.firstConstant, state.vs.numConstants);
+        } else {
+            ctx->VSSetConstantBuffers(0, kCBSlots, cbs);
+        }
+        ID3D11ShaderResourceView* srvs[kSRVSlots];
+        GetAll(state.vs.srvs, srvs);
+        if (srvSlots[0]) ctx->VSSetShaderResources(0, srvSlots[0], srvs);
+        ID3D11SamplerState* samplers[kSamplerSlots];
+        GetAll(state.vs.samplers, samplers);
+        ctx->VSSetSamplers(0, kSamplerSlots, samplers);
+
+        GetAll(state.ps.constantBuffers, cbs);
+        if (context1 && state.hasConstantOffsets) {
+            context1->PSSetConstantBuffers1(0, kCBSlots, cbs, state.ps.firstConstant, state.ps.numConstants);
+        } else {
+            ctx->PSSetConstantBuffers(0, kCBSlots, cbs);
+        }
+        GetAll(state.ps.srvs, srvs);
+        if (srvSlots[1]) ctx->PSSetShaderResources(0, srvSlots[1], srvs);
+        GetAll(state.ps.samplers, samplers);
+        ctx->PSSetSamplers(0, kSamplerSlots, samplers);
+
+        ctx->RSSetState(state.rasterizerState.Get());
+        ctx->OMSetBlendState(state.blendState.Get(), state.blendFactor, state.sampleMask);
+        ctx->OMSetDepthStencilState(state.depthStencilState.Get(), state.stencilRef);
+    }
+}
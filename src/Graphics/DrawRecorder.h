@@ -0,0 +1,117 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <unordered_map>
+#include <vector>
+#include "ConstantBufferRing.h"
+#include "DrawLog.h"
+
+namespace Graphics {
+    using Microsoft::WRL::ComPtr;
+
+    // Face-major replay log for the immediate context: DrawLog with the D3D11 side of it.
+    // The log decides what is recorded, copied and flushed and in what order the draws are replayed; this class
+    // captures and re-applies the pipeline states (everything but render targets, viewports and scissors, which are
+    // replaced per face), keeps the pooled constant buffer snapshots and issues the draws.
+    class DrawRecorder : private DrawLogDevice {
+    public:
+        static constexpr UINT kSRVSlots = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT; // Per stage
+
+        using DrawArgs = Graphics::DrawArgs;
+
+        struct FaceTarget {
+            ID3D11RenderTargetView* rtv = nullptr;
+            ID3D11DepthStencilView* dsv = nullptr;
+            UINT size = 0; // Rendered edge length from the top-left corner; 0 skips the face
+        };
+
+        // context1 (optional) preserves D3D11.1 constant buffer offsets. Returns false without recording when the draw
+        // cannot be deferred (dynamic vertex or index buffers, which a later map rewrites in place); the caller then
+        // flushes the log and renders the draw immediately.
+        bool Record(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, uint64_t stateSerial, const DrawArgs& args,
+                    UINT cameraSlot, UINT cameraByteWidth, const Camera::FacePayloads& payloads);
+
+        // Call before a buffer's contents change (update_buffer_region) and after it was mapped. Returns true when
+        // recorded draws read the buffer directly, so the log must be replayed before the write.
+        bool OnBufferWrite(uint64_t buffer) { return m_log.OnBufferWrite(buffer); }
+
+        // Renders the log into the active face targets, restores the context state it touched and clears the log
+        void Replay(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, ConstantBufferRing& ring,
+                    const FaceTarget (&faces)[Camera::FacePayloads::kFaceCount]);
+
+        // Drops the log and releases every recorded reference (capacity is kept)
+        void Clear();
+        bool IsEmpty() const { return m_log.IsEmpty(); }
+
+        ReplayStats GetStats() const { return m_log.GetStats(); }
+
+    private:
+        struct ShaderStageState {
+            ComPtr<ID3D11Buffer> constantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+            UINT firstConstant[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = {}; // Valid with hasConstantOffsets
+            UINT numConstants[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT] = {};
+            ComPtr<ID3D11ShaderResourceView> srvs[kSRVSlots];
+            UINT srvCount = 0; // Highest bound SRV slot + 1
+            ComPtr<ID3D11SamplerState> samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+        };
+
+        // Everything a recorded draw depends on except render targets, viewports and scissors (replaced per face)
+        struct PipelineState {
+            ComPtr<ID3D11InputLayout> inputLayout;
+            D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+            ComPtr<ID3D11Buffer> indexBuffer;
+            DXGI_FORMAT indexFormat = DXGI_FORMAT_UNKNOWN;
+            UINT indexOffset = 0;
+            ComPtr<ID3D11Buffer> vertexBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+            UINT vertexStrides[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+            UINT vertexOffsets[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+
+            ComPtr<ID3D11VertexShader> vertexShader;
+            ComPtr<ID3D11HullShader> hullShader;
+            ComPtr<ID3D11DomainShader> domainShader;
+            ComPtr<ID3D11GeometryShader> geometryShader;
+            ComPtr<ID3D11PixelShader> pixelShader;
+            ShaderStageState vs;
+            ShaderStageState ps;
+            bool hasConstantOffsets = false; // Constant buffers captured through ID3D11DeviceContext1
+
+            ComPtr<ID3D11RasterizerState> rasterizerState;
+            ComPtr<ID3D11BlendState> blendState;
+            FLOAT blendFactor[4] = {};
+            UINT sampleMask = 0xFFFFFFFF;
+            ComPtr<ID3D11DepthStencilState> depthStencilState;
+            UINT stencilRef = 0;
+        };
+
+        struct SnapshotPool {
+            std::vector<ComPtr<ID3D11Buffer>> buffers;
+            size_t used = 0;
+        };
+
+        // DrawLogDevice, valid during Record and Replay
+        void CaptureState(uint32_t state, DrawLogState* outState) override;
+        void ReleaseState(uint32_t state) override;
+        uint64_t CopySnapshot(uint64_t buffer) override;
+        bool BeginFace(uint32_t face) override;
+        void ApplyState(uint32_t state) override;
+        void BindSnapshot(uint32_t state, uint8_t stage, uint8_t slot, uint64_t snapshot) override;
+        bool BindPayload(uint32_t face, uint32_t cameraSlot, uint32_t cameraByteWidth, const Payload& payload) override;
+        void Draw(const DrawArgs& args) override;
+
+        static void Capture(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, PipelineState& state, DrawLogState* outState);
+        // Sets srvSlots[stage] SRV slots so a replayed state's higher slots are also cleared
+        static void Apply(ID3D11DeviceContext* ctx, ID3D11DeviceContext1* context1, const PipelineState& state, const UINT (&srvSlots)[2]);
+
+        DrawLog m_log;
+        std::vector<PipelineState> m_states; // Indexed like the log's states, reused across flushes
+        uint32_t m_liveStates = 0;           // Entries holding references
+
+        std::unordered_map<UINT, SnapshotPool> m_snapshotPools; // By ByteWidth, reused across flushes
+
+        ID3D11DeviceContext* m_ctx = nullptr;
+        ID3D11DeviceContext1* m_context1 = nullptr;
+        ConstantBufferRing* m_ring = nullptr;
+        const FaceTarget* m_faces = nullptr;
+        UINT m_srvSlots[2] = {};
+    };
+}
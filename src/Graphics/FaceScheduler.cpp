@@ -0,0 +1,64 @@
+#include "FaceScheduler.h"
+#include <cmath>
+
+namespace Graphics {
+
+    void FaceScheduler::Configure(uint32_t activeMask, const uint32_t (&intervals)[kFaceCount], float refreshAngleDegrees, float refreshDistance) {
+        m_activeMask = activeMask;
+
+        // The k-th face with a given interval gets phase k, so at most one face of each group renders per frame
+        // once the group is as large as its interval
+        for (uint32_t i = 0; i < kFaceCount; ++i) {
+            m_interval[i] = intervals[i] ? intervals[i] : 1;
+            uint32_t rank = 0;
+            for (uint32_t j = 0; j < i; ++j) {
+                if ((m_activeMask & (1u << j)) && m_interval[j] == m_interval[i]) rank++;
+            }
+            m_phase[i] = rank % m_interval[i];
+        }
+
+        m_refreshCos = std::cos(refreshAngleDegrees * DirectX::XM_PI / 180.0f);
+        m_refreshDistance = refreshDistance;
+        m_forceRefresh = true;
+    }
+
+    bool FaceScheduler::CameraJumped(const DirectX::XMFLOAT4X4& view) const {
+        // Rotation angle between the two views: trace(R0^T R1) = 1 + 2 cos(angle) for the 3x3 rotation parts
+        float trace = 0.0f;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) trace += m_lastView.m[r][c] * view.m[r][c];
+        }
+        if ((trace - 1.0f) * 0.5f < m_refreshCos) return true;
+
+        if (m_refreshDistance > 0.0f) {
+            DirectX::XMVECTOR det;
+            DirectX::XMVECTOR lastEye = DirectX::XMMatrixInverse(&det, DirectX::XMLoadFloat4x4(&m_lastView)).r[3];
+            DirectX::XMVECTOR eye = DirectX::XMMatrixInverse(&det, DirectX::XMLoadFloat4x4(&view)).r[3];
+            float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(eye, lastEye)));
+            if (distance > m_refreshDistance) return true;
+        }
+        return false;
+    }
+
+    uint32_t FaceScheduler::Schedule(const DirectX::XMFLOAT4X4& view) {
+        uint32_t mask = 0;
+        if (m_forceRefresh || CameraJumped(view)) {
+            mask = m_activeMask;
+            m_stats.fullRefreshes++;
+        } else {
+            for (uint32_t i = 0; i < kFaceCount; ++i) {
+                if ((m_activeMask & (1u << i)) && (m_frame + m_phase[i]) % m_interval[i] == 0) mask |= 1u << i;
+            }
+        }
+
+        for (uint32_t i = 0; i < kFaceCount; ++i) {
+            if (mask & (1u << i)) m_stats.faceRenders[i]++;
+        }
+        m_stats.frames++;
+
+        m_lastView = view;
+        m_forceRefresh = false;
+        m_frame++;
+        return mask;
+    }
+}
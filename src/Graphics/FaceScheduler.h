@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <DirectXMath.h>
+
+namespace Graphics {
+
+    struct FaceScheduleStats {
+        uint64_t frames = 0;
+        uint64_t faceRenders[6] = {}; // Frames each face was rendered in, indexed like Camera::CubeFace
+        uint64_t fullRefreshes = 0;   // Frames where a camera jump (or a reset) forced every face
+    };
+
+    // Chooses which cube faces are re-rendered each frame. Every face has its own interval (render every Nth frame);
+    // faces sharing an interval are staggered round-robin so the work spreads evenly across frames. Faces that are
+    // skipped keep their last contents. A camera jump beyond the thresholds since the previous frame renders all faces.
+    class FaceScheduler {
+    public:
+        static constexpr uint32_t kFaceCount = 6;
+
+        // activeMask: faces that exist at all (face budget). Intervals of 0 are treated as 1.
+        // refreshDistance <= 0 disables the translation check.
+        void Configure(uint32_t activeMask, const uint32_t (&intervals)[kFaceCount], float refreshAngleDegrees, float refreshDistance);
+
+        // Faces (bit per face) to render in the frame that starts now; view is the game camera of that frame
+        uint32_t Schedule(const DirectX::XMFLOAT4X4& view);
+
+        // Renders every active face next frame (face contents were lost or are not valid yet)
+        void ForceRefresh() { m_forceRefresh = true; }
+
+        const FaceScheduleStats& GetStats() const { return m_stats; }
+
+    private:
+        bool CameraJumped(const DirectX::XMFLOAT4X4& view) const;
+
+        uint32_t m_activeMask = (1u << kFaceCount) - 1;
+        uint32_t m_interval[kFaceCount] = { 1, 1, 1, 1, 1, 1 };
+        uint32_t m_phase[kFaceCount] = {};
+        float m_refreshCos = 0.0f;
+        float m_refreshDistance = 0.0f;
+
+        DirectX::XMFLOAT4X4 m_lastView = {};
+        bool m_forceRefresh = true;
+        uint64_t m_frame = 0;
+
+        FaceScheduleStats m_stats;
+    };
+}
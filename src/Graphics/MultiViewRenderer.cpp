@@ -0,0 +1,219 @@
+#include "pch.h"
+#include "MultiViewRenderer.h"
+#include "StateGuard.h"
+#include "../Core/Logger.h"
+#include <d3dcompiler.h>
+
+namespace Graphics {
+
+    namespace {
+        bool GetPrimitiveClass(D3D11_PRIMITIVE_TOPOLOGY topology, PrimitiveClass* outPrimitive) {
+            switch (topology) {
+                case D3D11_PRIMITIVE_TOPOLOGY_POINTLIST:
+                    *outPrimitive = PrimitiveClass::Point;
+                    return true;
+                case D3D11_PRIMITIVE_TOPOLOGY_LINELIST:
+                case D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP:
+                    *outPrimitive = PrimitiveClass::Line;
+                    return true;
+                case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST:
+                case D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:
+                    *outPrimitive = PrimitiveClass::Triangle;
+                    return true;
+                default:
+                    return false; // Adjacency and patch lists
+            }
+        }
+    }
+
+    bool MultiViewRenderer::Initialize(ID3D11Device* device) {
+        Reset();
+
+        D3D11_BUFFER_DESC desc = {};
+        desc.ByteWidth = (UINT)MultiViewShader::kFaceTransformBytes;
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        if (FAILED(device->CreateBuffer(&desc, nullptr, m_faceTransforms.GetAddressOf()))) return false;
+
+        m_device = device;
+        m_compiler = std::thread(&MultiViewRenderer::CompileLoop, this);
+        return true;
+    }
+
+    void MultiViewRenderer::Reset() {
+        // The compiler uses the device; it finishes the shader in progress and drops the rest
+        StopCompiler();
+
+        m_faceTransforms.Reset();
+        m_device.Reset();
+        m_transformGeneration = 0;
+        m_transformMask = 0;
+
+        // Signatures stay valid across resource recreation; only the compiled shaders belong to the device
+        std::lock_guard<std::mutex> lock(m_shaderMutex);
+        for (auto& [handle, entry] : m_shaders) {
+            for (uint32_t i = 0; i < kPrimitiveClassCount; ++i) {
+                entry.geometryShaders[i].Reset();
+                entry.rejected[i] = false;
+                entry.pending[i] = false;
+            }
+        }
+    }
+
+    void MultiViewRenderer::StopCompiler() {
+        if (!m_compiler.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_shaderMutex);
+            m_compilerQuit = true;
+        }
+        m_compileWake.notify_all();
+        m_compiler.join();
+
+        std::lock_guard<std::mutex> lock(m_shaderMutex);
+        m_compileQueue.clear();
+        m_compilerQuit = false;
+    }
+
+    void MultiViewRenderer::OnInitPipeline(reshade::api::pipeline pipeline, uint32_t subobjectCount, const reshade::api::pipeline_subobject* subobjects) {
+        for (uint32_t i = 0; i < subobjectCount; ++i) {
+            if (subobjects[i].type != reshade::api::pipeline_subobject_type::vertex_shader || subobjects[i].count == 0) continue;
+
+            const auto* shader = static_cast<const reshade::api::shader_desc*>(subobjects[i].data);
+            if (!shader || !shader->code) return;
+
+            ShaderEntry entry;
+            if (!ShaderSignature::Parse(shader->code, shader->code_size, ShaderSignature::Kind::Output, &entry.outputs)) return;
+            entry.replicable = MultiViewShader::CanReplicate(entry.outputs);
+
+            std::lock_guard<std::mutex> lock(m_shaderMutex);
+            entry.id = m_nextShaderId++;
+            m_shaders[pipeline.handle] = std::move(entry);
+            return;
+        }
+    }
+
+    void MultiViewRenderer::OnDestroyPipeline(reshade::api::pipeline pipeline) {
+        std::lock_guard<std::mutex> lock(m_shaderMutex);
+        m_shaders.erase(pipeline.handle);
+    }
+
+    ID3D11GeometryShader* MultiViewRenderer::GetGeometryShader(uint64_t vertexShader, PrimitiveClass primitive, bool* outPending) {
+        uint32_t index = (uint32_t)primitive;
+        *outPending = false;
+
+        std::lock_guard<std::mutex> lock(m_shaderMutex);
+        auto it = m_shaders.find(vertexShader);
+        if (it == m_shaders.end() || !it->second.replicable || it->second.rejected[index]) return nullptr;
+        ShaderEntry& entry = it->second;
+        if (entry.geometryShaders[index]) return entry.geometryShaders[index].Get();
+
+        // First draw with this VS and primitive class: compiling takes milliseconds, so it happens off the render thread
+        if (!entry.pending[index]) {
+            entry.pending[index] = true;
+            m_compileQueue.push_back({ vertexShader, entry.id, primitive });
+            m_compileWake.notify_one();
+        }
+        *outPending = true;
+        return nullptr;
+    }
+
+    void MultiViewRenderer::CompileLoop() {
+        std::unique_lock<std::mutex> lock(m_shaderMutex);
+        while (true) {
+            m_compileWake.wait(lock, [this] { return m_compilerQuit || !m_compileQueue.empty(); });
+            if (m_compilerQuit) return;
+
+            CompileJob job = m_compileQueue.front();
+            m_compileQueue.pop_front();
+            auto it = m_shaders.find(job.vertexShader);
+            if (it == m_shaders.end() || it->second.id != job.id) continue; // Destroyed before its turn
+            std::vector<SignatureElement> outputs = it->second.outputs;
+            lock.unlock();
+
+            std::string source = MultiViewShader::GenerateGeometryShader(outputs, job.primitive);
+            ComPtr<ID3DBlob> bytecode;
+            ComPtr<ID3DBlob> errors;
+            ComPtr<ID3D11GeometryShader> geometryShader;
+            bool valid = SUCCEEDED(D3DCompile(source.data(), source.size(), "WideCaptureMultiView", nullptr, nullptr, "main", "gs_5_0",
+                                              D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, bytecode.GetAddressOf(), errors.GetAddressOf())) &&
+                         MultiViewShader::VerifyGeometryShader(outputs, bytecode->GetBufferPointer(), bytecode->GetBufferSize()) &&
+                         SUCCEEDED(m_device->CreateGeometryShader(bytecode->GetBufferPointer(), bytecode->GetBufferSize(), nullptr, geometryShader.GetAddressOf()));
+
+            if (!valid) {
+                LOG_WARNING("Single-pass geometry shader rejected for vertex shader ", (void*)job.vertexShader,
+                            errors ? (const char*)errors->GetBufferPointer() : "");
+                m_shadersRejected++;
+            } else {
+                m_shadersCompiled++;
+            }
+
+            lock.lock();
+            it = m_shaders.find(job.vertexShader);
+            if (it == m_shaders.end() || it->second.id != job.id) continue; // Destroyed while compiling
+            uint32_t index = (uint32_t)job.primitive;
+            it->second.geometryShaders[index] = geometryShader;
+            it->second.rejected[index] = !valid;
+            it->second.pending[index] = false;
+        }
+    }
+
+    bool MultiViewRenderer::UploadFaceTransforms(ID3D11DeviceContext* ctx, const Camera::FacePayloads& payloads, uint32_t faceMask) {
+        if (payloads.GetGeneration() == m_transformGeneration && faceMask == m_transformMask) return true;
+
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(ctx->Map(m_faceTransforms.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) return false;
+        memcpy(mapped.pData, payloads.GetFaceClipTransforms(), MultiViewShader::kFaceMaskOffset);
+        memcpy((uint8_t*)mapped.pData + MultiViewShader::kFaceMaskOffset, &faceMask, sizeof(faceMask));
+        ctx->Unmap(m_faceTransforms.Get(), 0);
+
+        m_transformGeneration = payloads.GetGeneration();
+        m_transformMask = faceMask;
+        return true;
+    }
+
+    bool MultiViewRenderer::Draw(ID3D11DeviceContext* ctx, uint64_t vertexShader, const DrawRecorder::DrawArgs& args,
+                                 const Camera::FacePayloads& payloads, ID3D11RenderTargetView* rtv, ID3D11DepthStencilView* dsv,
+                                 const UINT (&faceSizes)[MultiViewShader::kFaceCount]) {
+        if (!m_device || !payloads.HasFaceClipTransforms()) return false;
+
+        uint32_t faceMask = 0;
+        D3D11_VIEWPORT viewports[MultiViewShader::kFaceCount];
+        D3D11_RECT scissors[MultiViewShader::kFaceCount];
+        for (uint32_t i = 0; i < MultiViewShader::kFaceCount; ++i) {
+            if (faceSizes[i]) faceMask |= 1u << i;
+            viewports[i] = { 0.0f, 0.0f, (float)faceSizes[i], (float)faceSizes[i], 0.0f, 1.0f };
+            scissors[i] = { 0, 0, (LONG)faceSizes[i], (LONG)faceSizes[i] };
+        }
+
+        D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        ctx->IAGetPrimitiveTopology(&topology);
+
+        PrimitiveClass primitive;
+        ID3D11GeometryShader* geometryShader = nullptr;
+        bool pending = false;
+        if (GetPrimitiveClass(topology, &primitive)) geometryShader = GetGeometryShader(vertexShader, primitive, &pending);
+        if (!geometryShader || !UploadFaceTransforms(ctx, payloads, faceMask)) {
+            m_stats.fallbacks++;
+            if (pending) m_stats.compileFallbacks++;
+            return false;
+        }
+
+        StateGuard<kStateRenderTargets | kStateViewports | kStateScissorRects | kStateGeometryShader> state(ctx);
+
+        ctx->OMSetRenderTargets(1, &rtv, dsv);
+        ctx->RSSetViewports(MultiViewShader::kFaceCount, viewports);
+        ctx->RSSetScissorRects(MultiViewShader::kFaceCount, scissors);
+        ctx->GSSetShader(geometryShader, nullptr, 0);
+        ctx->GSSetConstantBuffers(MultiViewShader::kFaceTransformSlot, 1, m_faceTransforms.GetAddressOf());
+
+        if (args.indexed) {
+            ctx->DrawIndexedInstanced(args.count, args.instanceCount, args.first, args.vertexOffset, args.firstInstance);
+        } else {
+            ctx->DrawInstanced(args.count, args.instanceCount, args.first, args.firstInstance);
+        }
+
+        m_stats.draws++;
+        return true;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <reshade.hpp>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../Camera/FacePayloads.h"
+#include "DrawRecorder.h"
+#include "MultiViewShader.h"
+
+namespace Graphics {
+    using Microsoft::WRL::ComPtr;
+
+    struct MultiViewStats {
+        uint64_t draws = 0;           // Draws rendered into all six faces in one pass
+        uint64_t fallbacks = 0;       // Draws handed back to the per-face path (unknown VS, unsupported topology, GS not ready)
+        uint64_t compileFallbacks = 0; // Of those, draws whose geometry shader was still compiling
+        uint64_t shadersCompiled = 0; // Generated geometry shaders created
+        uint64_t shadersRejected = 0; // Generated geometry shaders that failed to compile or link
+    };
+
+    // Single-pass cube rendering: a camera draw is issued once with a generated instanced geometry shader that sends
+    // every primitive to the six slices of the face array (SV_RenderTargetArrayIndex), transformed by per-face clip
+    // matrices. The game's vertex shader, constants and instance count are left untouched.
+    // Vertex shader output signatures are recorded from init_pipeline (any thread); drawing is immediate-context only.
+    // Geometry shaders are compiled on a worker thread when a vertex shader is first drawn with; its draws take the
+    // per-face path until the shader is ready.
+    class MultiViewRenderer {
+    public:
+        ~MultiViewRenderer() { Reset(); }
+
+        bool Initialize(ID3D11Device* device);
+        void Reset();
+
+        void OnInitPipeline(reshade::api::pipeline pipeline, uint32_t subobjectCount, const reshade::api::pipeline_subobject* subobjects);
+        void OnDestroyPipeline(reshade::api::pipeline pipeline);
+
+        // Draws into every face of rtv/dsv (six-slice array views) with a non-zero size, each through a viewport of that
+        // size at the slice's top-left corner. Returns false, with nothing drawn, when the vertex shader or topology
+        // cannot be replicated; the caller then falls back to per-face rendering.
+        bool Draw(ID3D11DeviceContext* ctx, uint64_t vertexShader, const DrawRecorder::DrawArgs& args, const Camera::FacePayloads& payloads,
+                  ID3D11RenderTargetView* rtv, ID3D11DepthStencilView* dsv, const UINT (&faceSizes)[MultiViewShader::kFaceCount]);
+
+        MultiViewStats GetStats() const {
+            MultiViewStats stats = m_stats;
+            stats.shadersCompiled = m_shadersCompiled.load(std::memory_order_relaxed);
+            stats.shadersRejected = m_shadersRejected.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+        static constexpr uint32_t kPrimitiveClassCount = 3;
+
+        struct ShaderEntry {
+            uint64_t id = 0; // Tells a recreated pipeline with the same handle apart from the one a job was queued for
+            std::vector<SignatureElement> outputs;
+            bool replicable = false;
+            ComPtr<ID3D11GeometryShader> geometryShaders[kPrimitiveClassCount];
+            bool rejected[kPrimitiveClassCount] = {};
+            bool pending[kPrimitiveClassCount] = {}; // Queued or compiling
+        };
+
+        struct CompileJob {
+            uint64_t vertexShader = 0;
+            uint64_t id = 0;
+            PrimitiveClass primitive = PrimitiveClass::Triangle;
+        };
+
+        // The shader for this VS and primitive class, or nullptr while it compiles or when it cannot be built
+        ID3D11GeometryShader* GetGeometryShader(uint64_t vertexShader, PrimitiveClass primitive, bool* outPending);
+        void CompileLoop();
+        void StopCompiler();
+        bool UploadFaceTransforms(ID3D11DeviceContext* ctx, const Camera::FacePayloads& payloads, uint32_t faceMask);
+
+        ComPtr<ID3D11Device> m_device;
+        ComPtr<ID3D11Buffer> m_faceTransforms; // FaceClip[6] and FaceMask, rewritten when either changes
+        uint64_t m_transformGeneration = 0;
+        uint32_t m_transformMask = 0;
+
+        std::mutex m_shaderMutex; // init_pipeline/destroy_pipeline may come from any thread
+        std::unordered_map<uint64_t, ShaderEntry> m_shaders;
+        uint64_t m_nextShaderId = 1;
+
+        // Compiler thread, fed under m_shaderMutex
+        std::thread m_compiler;
+        std::deque<CompileJob> m_compileQueue;
+        std::condition_variable m_compileWake;
+        bool m_compilerQuit = false;
+
+        MultiViewStats m_stats; // Render thread
+        std::atomic<uint64_t> m_shadersCompiled{ 0 };
+        std::atomic<uint64_t> m_shadersRejected{ 0 };
+    };
+}
@@ -0,0 +1,143 @@
+#include "MultiViewShader.h"
+#include <algorithm>
+
+namespace Graphics {
+
+    namespace {
+        bool IsContiguousMask(uint8_t mask) {
+            if (mask == 0 || mask > 0xF) return false;
+            while ((mask & 1) == 0) mask >>= 1;
+            return (mask & (mask + 1)) == 0;
+        }
+
+        uint32_t ComponentCount(uint8_t mask) {
+            uint32_t count = 0;
+            for (; mask; mask >>= 1) count += mask & 1;
+            return count;
+        }
+
+        const char* ScalarType(uint32_t componentType) {
+            switch (componentType) {
+                case kComponentUInt32: return "uint";
+                case kComponentSInt32: return "int";
+                default:               return "float";
+            }
+        }
+
+        std::vector<SignatureElement> SortedByRegister(const std::vector<SignatureElement>& elements) {
+            // Declaration order drives the compiler's register packing; replaying the original layout order
+            // reproduces the original registers and masks
+            std::vector<SignatureElement> sorted = elements;
+            std::stable_sort(sorted.begin(), sorted.end(), [](const SignatureElement& a, const SignatureElement& b) {
+                if (a.registerIndex != b.registerIndex) return a.registerIndex < b.registerIndex;
+                return (a.mask & (uint8_t)(~a.mask + 1)) < (b.mask & (uint8_t)(~b.mask + 1)); // Lowest component first
+            });
+            return sorted;
+        }
+
+        void AppendMembers(std::string& out, const std::vector<SignatureElement>& elements) {
+            for (size_t i = 0; i < elements.size(); ++i) {
+                const SignatureElement& e = elements[i];
+                uint32_t components = ComponentCount(e.mask);
+                out += "    ";
+                out += ScalarType(e.componentType);
+                if (components > 1) out += std::to_string(components);
+                out += " e" + std::to_string(i) + " : " + e.semanticName;
+                if (e.semanticIndex != 0) out += std::to_string(e.semanticIndex);
+                out += ";\n";
+            }
+        }
+    }
+
+    bool MultiViewShader::CanReplicate(const std::vector<SignatureElement>& vsOutputs) {
+        const SignatureElement* position = ShaderSignature::FindSystemValue(vsOutputs, kSystemValuePosition);
+        if (!position || position->mask != 0xF || position->componentType != kComponentFloat32) return false;
+
+        for (const SignatureElement& e : vsOutputs) {
+            if (e.stream != 0 || e.minPrecision != 0 || !IsContiguousMask(e.mask)) return false;
+            if (e.componentType < kComponentUInt32 || e.componentType > kComponentFloat32) return false;
+            if (e.systemValue == kSystemValueRenderTargetArrayIndex || e.systemValue == kSystemValueViewportArrayIndex) return false;
+        }
+        return true;
+    }
+
+    std::string MultiViewShader::GenerateGeometryShader(const std::vector<SignatureElement>& vsOutputs, PrimitiveClass primitive) {
+        std::vector<SignatureElement> elements = SortedByRegister(vsOutputs);
+
+        size_t positionIndex = 0;
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (elements[i].systemValue == kSystemValuePosition) positionIndex = i;
+        }
+        std::string position = "e" + std::to_string(positionIndex);
+
+        const char* inputType = "triangle";
+        const char* streamType = "TriangleStream";
+        uint32_t vertices = 3;
+        if (primitive == PrimitiveClass::Line) {
+            inputType = "line";
+            streamType = "LineStream";
+            vertices = 2;
+        } else if (primitive == PrimitiveClass::Point) {
+            inputType = "point";
+            streamType = "PointStream";
+            vertices = 1;
+        }
+        std::string count = std::to_string(vertices);
+
+        std::string hlsl;
+        hlsl.reserve(2048);
+        hlsl += "cbuffer FaceTransforms : register(b" + std::to_string(kFaceTransformSlot) + ")\n{\n";
+        hlsl += "    row_major float4x4 FaceClip[" + std::to_string(kFaceCount) + "];\n";
+        hlsl += "    uint FaceMask;\n};\n\n";
+
+        hlsl += "struct VertexData\n{\n";
+        AppendMembers(hlsl, elements);
+        hlsl += "};\n\n";
+
+        hlsl += "struct FaceVertex\n{\n";
+        AppendMembers(hlsl, elements);
+        hlsl += "    uint face : SV_RenderTargetArrayIndex;\n";
+        hlsl += "    uint viewport : SV_ViewportArrayIndex;\n};\n\n";
+
+        hlsl += "[instance(" + std::to_string(kFaceCount) + ")]\n";
+        hlsl += "[maxvertexcount(" + count + ")]\n";
+        hlsl += "void main(" + std::string(inputType) + " VertexData input[" + count + "], uint face : SV_GSInstanceID, inout " +
+                streamType + "<FaceVertex> stream)\n{\n";
+
+        hlsl += "    if ((FaceMask & (1u << face)) == 0) return;\n\n";
+        hlsl += "    float4 position[" + count + "];\n";
+        hlsl += "    uint outside = 0x3F;\n";
+        hlsl += "    [unroll] for (uint i = 0; i < " + count + "; ++i)\n    {\n";
+        hlsl += "        float4 p = mul(input[i]." + position + ", FaceClip[face]);\n";
+        hlsl += "        position[i] = p;\n";
+        hlsl += "        outside &= (p.x < -p.w ? 1u : 0u) | (p.x > p.w ? 2u : 0u) | (p.y < -p.w ? 4u : 0u) |\n";
+        hlsl += "                   (p.y > p.w ? 8u : 0u) | (p.z < 0.0f ? 16u : 0u) | (p.z > p.w ? 32u : 0u);\n";
+        hlsl += "    }\n";
+        hlsl += "    if (outside != 0) return; // Entirely behind one plane of this face's frustum\n\n";
+
+        hlsl += "    [unroll] for (uint v = 0; v < " + count + "; ++v)\n    {\n";
+        hlsl += "        FaceVertex o;\n";
+        for (size_t i = 0; i < elements.size(); ++i) {
+            std::string name = "e" + std::to_string(i);
+            if (i == positionIndex) hlsl += "        o." + name + " = position[v];\n";
+            else                    hlsl += "        o." + name + " = input[v]." + name + ";\n";
+        }
+        hlsl += "        o.face = face;\n";
+        hlsl += "        o.viewport = face;\n";
+        hlsl += "        stream.Append(o);\n";
+        hlsl += "    }\n";
+        hlsl += "}\n";
+        return hlsl;
+    }
+
+    bool MultiViewShader::VerifyGeometryShader(const std::vector<SignatureElement>& vsOutputs, const void* bytecode, size_t size) {
+        std::vector<SignatureElement> gsInputs;
+        std::vector<SignatureElement> gsOutputs;
+        if (!ShaderSignature::Parse(bytecode, size, ShaderSignature::Kind::Input, &gsInputs)) return false;
+        if (!ShaderSignature::Parse(bytecode, size, ShaderSignature::Kind::Output, &gsOutputs)) return false;
+
+        return gsInputs.size() == vsOutputs.size() &&
+               ShaderSignature::Links(vsOutputs, gsInputs) &&
+               ShaderSignature::Links(gsOutputs, vsOutputs);
+    }
+}
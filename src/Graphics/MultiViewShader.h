@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ShaderSignature.h"
+
+namespace Graphics {
+
+    // Input primitive of the generated geometry shader, derived from the draw's topology
+    enum class PrimitiveClass { Point, Line, Triangle };
+
+    // Generates the geometry shaders used for single-pass cube rendering. Each one is a pass-through for a specific
+    // vertex shader's output signature: it runs one instance per face, moves SV_Position from the game's clip space
+    // into the face's (FaceClip[face], row-vector), drops primitives outside the face frustum and routes the rest
+    // to the face's render target array slice and viewport. Faces missing from FaceMask emit nothing.
+    // Pure string/bytecode work, independent of D3D.
+    class MultiViewShader {
+    public:
+        static constexpr uint32_t kFaceCount = 6;
+        static constexpr uint32_t kFaceTransformSlot = 0; // GS constant buffer register of FaceClip[6] and FaceMask
+        static constexpr size_t kFaceMaskOffset = kFaceCount * 16 * sizeof(float);
+        static constexpr size_t kFaceTransformBytes = kFaceMaskOffset + 16;
+
+        // True if the vertex shader outputs can be passed through: full-precision stream 0 elements with contiguous
+        // masks, an SV_Position, and no render target/viewport array index already written by the game
+        static bool CanReplicate(const std::vector<SignatureElement>& vsOutputs);
+
+        // HLSL source (entry point "main", gs_5_0) whose input and output signatures mirror vsOutputs register for register
+        static std::string GenerateGeometryShader(const std::vector<SignatureElement>& vsOutputs, PrimitiveClass primitive);
+
+        // Checks compiled bytecode against the signature it was generated for: every VS output is consumed and
+        // re-emitted at the same register and mask, so the game's pixel shader links exactly as it did with the VS
+        static bool VerifyGeometryShader(const std::vector<SignatureElement>& vsOutputs, const void* bytecode, size_t size);
+    };
+}
@@ -0,0 +1,118 @@
+#include "ShaderSignature.h"
+#include <cstring>
+
+namespace Graphics {
+
+    namespace {
+        constexpr uint32_t FourCC(char a, char b, char c, char d) {
+            return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+        }
+
+        constexpr uint32_t kContainerMagic = FourCC('D', 'X', 'B', 'C');
+        constexpr size_t kContainerHeaderBytes = 32; // Magic, 16-byte checksum, version, total size, chunk count
+
+        uint32_t ReadU32(const uint8_t* p) {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        bool SemanticEquals(const std::string& a, const std::string& b) {
+            // HLSL semantics are case-insensitive
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                char x = a[i], y = b[i];
+                if (x >= 'a' && x <= 'z') x = (char)(x - 'a' + 'A');
+                if (y >= 'a' && y <= 'z') y = (char)(y - 'a' + 'A');
+                if (x != y) return false;
+            }
+            return true;
+        }
+
+        bool ParseChunk(const uint8_t* chunk, size_t chunkSize, size_t elementBytes, bool hasStream, bool hasMinPrecision,
+                        std::vector<SignatureElement>* outElements) {
+            if (chunkSize < 8) return false;
+            uint32_t count = ReadU32(chunk);
+            uint32_t first = ReadU32(chunk + 4);
+            if (first > chunkSize || (chunkSize - first) / elementBytes < count) return false;
+
+            outElements->clear();
+            outElements->reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                const uint8_t* e = chunk + first + (size_t)i * elementBytes;
+                SignatureElement element;
+                if (hasStream) {
+                    element.stream = ReadU32(e);
+                    e += 4;
+                }
+
+                uint32_t nameOffset = ReadU32(e);
+                element.semanticIndex = ReadU32(e + 4);
+                element.systemValue = ReadU32(e + 8);
+                element.componentType = ReadU32(e + 12);
+                element.registerIndex = ReadU32(e + 16);
+                element.mask = e[20];
+                if (hasMinPrecision) element.minPrecision = ReadU32(e + 24);
+
+                // Names are NUL-terminated strings inside the chunk, offsets relative to the chunk data
+                if (nameOffset >= chunkSize) return false;
+                const char* name = (const char*)chunk + nameOffset;
+                size_t length = strnlen(name, chunkSize - nameOffset);
+                if (length == chunkSize - nameOffset) return false;
+                element.semanticName.assign(name, length);
+
+                outElements->push_back(std::move(element));
+            }
+            return true;
+        }
+    }
+
+    bool ShaderSignature::Parse(const void* bytecode, size_t size, Kind kind, std::vector<SignatureElement>* outElements) {
+        const uint8_t* data = (const uint8_t*)bytecode;
+        if (!data || size < kContainerHeaderBytes || ReadU32(data) != kContainerMagic) return false;
+
+        uint32_t chunkCount = ReadU32(data + 28);
+        if ((size - kContainerHeaderBytes) / 4 < chunkCount) return false;
+
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            uint32_t offset = ReadU32(data + kContainerHeaderBytes + i * 4);
+            if (offset > size || size - offset < 8) return false;
+
+            uint32_t fourCC = ReadU32(data + offset);
+            uint32_t chunkSize = ReadU32(data + offset + 4);
+            if (size - offset - 8 < chunkSize) return false;
+            const uint8_t* chunk = data + offset + 8;
+
+            if (kind == Kind::Input) {
+                if (fourCC == FourCC('I', 'S', 'G', 'N')) return ParseChunk(chunk, chunkSize, 24, false, false, outElements);
+                if (fourCC == FourCC('I', 'S', 'G', '1')) return ParseChunk(chunk, chunkSize, 32, true, true, outElements);
+            } else {
+                if (fourCC == FourCC('O', 'S', 'G', 'N')) return ParseChunk(chunk, chunkSize, 24, false, false, outElements);
+                if (fourCC == FourCC('O', 'S', 'G', '5')) return ParseChunk(chunk, chunkSize, 28, true, false, outElements);
+                if (fourCC == FourCC('O', 'S', 'G', '1')) return ParseChunk(chunk, chunkSize, 32, true, true, outElements);
+            }
+        }
+        return false;
+    }
+
+    bool ShaderSignature::Links(const std::vector<SignatureElement>& producer, const std::vector<SignatureElement>& consumer) {
+        for (const SignatureElement& in : consumer) {
+            bool found = false;
+            for (const SignatureElement& out : producer) {
+                if (out.stream != 0 || out.registerIndex != in.registerIndex) continue;
+                if (out.semanticIndex != in.semanticIndex || !SemanticEquals(out.semanticName, in.semanticName)) continue;
+                found = (out.mask & in.mask) == in.mask && out.componentType == in.componentType;
+                break;
+            }
+            if (!found) return false;
+        }
+        return true;
+    }
+
+    const SignatureElement* ShaderSignature::FindSystemValue(const std::vector<SignatureElement>& elements, uint32_t systemValue) {
+        for (const SignatureElement& element : elements) {
+            if (element.systemValue == systemValue) return &element;
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Graphics {
+
+    // One element of a DXBC input or output signature (the D3D11_SIGNATURE_PARAMETER_DESC fields the linker checks)
+    struct SignatureElement {
+        std::string semanticName;
+        uint32_t semanticIndex = 0;
+        uint32_t systemValue = 0;   // D3D_NAME
+        uint32_t componentType = 0; // D3D_REGISTER_COMPONENT_TYPE
+        uint32_t registerIndex = 0;
+        uint8_t mask = 0;           // Components present (bit 0 = x)
+        uint32_t stream = 0;
+        uint32_t minPrecision = 0;  // D3D_MIN_PRECISION, 0 = full precision
+    };
+
+    // Values of D3D_NAME / D3D_REGISTER_COMPONENT_TYPE used here, so the parser does not depend on the SDK headers
+    enum SignatureSystemValue : uint32_t {
+        kSystemValueUndefined = 0,
+        kSystemValuePosition = 1,
+        kSystemValueClipDistance = 2,
+        kSystemValueCullDistance = 3,
+        kSystemValueRenderTargetArrayIndex = 4,
+        kSystemValueViewportArrayIndex = 5,
+    };
+
+    enum SignatureComponentType : uint32_t {
+        kComponentUnknown = 0,
+        kComponentUInt32 = 1,
+        kComponentSInt32 = 2,
+        kComponentFloat32 = 3,
+    };
+
+    // Reads shader signatures straight from DXBC container bytecode (no D3DReflect, so it also runs off Windows)
+    class ShaderSignature {
+    public:
+        enum class Kind { Input, Output };
+
+        // Parses the ISGN/ISG1 (Input) or OSGN/OSG5/OSG1 (Output) chunk. Elements are returned in chunk order, which
+        // the compiler emits sorted by register and start component. Returns false on malformed bytecode or a missing chunk.
+        static bool Parse(const void* bytecode, size_t size, Kind kind, std::vector<SignatureElement>* outElements);
+
+        // True if every element of consumer (same semantic, register and mask, stream 0) is provided by producer,
+        // the rule the D3D11 runtime applies when linking two pipeline stages
+        static bool Links(const std::vector<SignatureElement>& producer, const std::vector<SignatureElement>& consumer);
+
+        static const SignatureElement* FindSystemValue(const std::vector<SignatureElement>& elements, uint32_t systemValue);
+    };
+}
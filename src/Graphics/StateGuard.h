@@ -0,0 +1,122 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <cstdint>
+
+namespace Graphics {
+    using Microsoft::WRL::ComPtr;
+
+    // Pipeline state groups a StateGuard saves and restores
+    enum StateGroup : uint32_t {
+        kStateVSConstantBuffer = 1u << 0, // One VS constant buffer slot, including D3D11.1 constant offsets
+        kStateRenderTargets    = 1u << 1, // All OM render targets and the depth-stencil view
+        kStateViewports        = 1u << 2,
+        kStateScissorRects     = 1u << 3,
+        kStateGeometryShader   = 1u << 4, // GS shader and GS constant buffer slot 0
+    };
+
+    // Saves only the state groups selected at compile time and restores them on destruction.
+    // Unlike StateBlock (full IA/RS/VS/PS/OM/CS snapshot), the cost scales with what the caller actually changes.
+    template<uint32_t Groups>
+    class StateGuard {
+    public:
+        // context1 is optional; without it the D3D11.1 interface is queried when constant offsets must be preserved
+        StateGuard(ID3D11DeviceContext* context, UINT vsConstantSlot = 0, ID3D11DeviceContext1* context1 = nullptr)
+            : m_context(context), m_context1(context1), m_vsConstantSlot(vsConstantSlot) {
+            if constexpr ((Groups & kStateVSConstantBuffer) != 0) {
+                if (!m_context1 && SUCCEEDED(m_context->QueryInterface(IID_PPV_ARGS(m_queried1.GetAddressOf())))) {
+                    m_context1 = m_queried1.Get();
+                }
+                if (m_context1) {
+                    m_context1->VSGetConstantBuffers1(m_vsConstantSlot, 1, m_vsConstantBuffer.GetAddressOf(), &m_firstConstant, &m_numConstants);
+                } else {
+                    m_context->VSGetConstantBuffers(m_vsConstantSlot, 1, m_vsConstantBuffer.GetAddressOf());
+                }
+            }
+            if constexpr ((Groups & kStateRenderTargets) != 0) {
+                ID3D11RenderTargetView* rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = { nullptr };
+                m_context->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtvs, m_depthStencilView.GetAddressOf());
+                for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) m_renderTargetViews[i].Attach(rtvs[i]);
+            }
+            if constexpr ((Groups & kStateViewports) != 0) {
+                m_numViewports = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+                m_context->RSGetViewports(&m_numViewports, m_viewports);
+            }
+            if constexpr ((Groups & kStateScissorRects) != 0) {
+                m_numScissorRects = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+                m_context->RSGetScissorRects(&m_numScissorRects, m_scissorRects);
+            }
+            if constexpr ((Groups & kStateGeometryShader) != 0) {
+                m_numGSClassInstances = D3D11_SHADER_MAX_INTERFACES;
+                m_context->GSGetShader(m_geometryShader.GetAddressOf(), m_gsClassInstances, &m_numGSClassInstances);
+                m_context->GSGetConstantBuffers(0, 1, m_gsConstantBuffer.GetAddressOf());
+            }
+        }
+
+        ~StateGuard() {
+            if constexpr ((Groups & kStateVSConstantBuffer) != 0) {
+                if (m_context1) {
+                    // Re-binding the same buffer with new offsets can be ignored by some runtimes; unbind first
+                    ID3D11Buffer* nullBuffer = nullptr;
+                    m_context1->VSSetConstantBuffers(m_vsConstantSlot, 1, &nullBuffer);
+                    m_context1->VSSetConstantBuffers1(m_vsConstantSlot, 1, m_vsConstantBuffer.GetAddressOf(), &m_firstConstant, &m_numConstants);
+                } else {
+                    m_context->VSSetConstantBuffers(m_vsConstantSlot, 1, m_vsConstantBuffer.GetAddressOf());
+                }
+            }
+            if constexpr ((Groups & kStateRenderTargets) != 0) {
+                ID3D11RenderTargetView* rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+                for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) rtvs[i] = m_renderTargetViews[i].Get();
+                m_context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtvs, m_depthStencilView.Get());
+            }
+            if constexpr ((Groups & kStateViewports) != 0) {
+                m_context->RSSetViewports(m_numViewports, m_viewports);
+            }
+            if constexpr ((Groups & kStateScissorRects) != 0) {
+                m_context->RSSetScissorRects(m_numScissorRects, m_scissorRects);
+            }
+            if constexpr ((Groups & kStateGeometryShader) != 0) {
+                m_context->GSSetShader(m_geometryShader.Get(), m_gsClassInstances, m_numGSClassInstances);
+                m_context->GSSetConstantBuffers(0, 1, m_gsConstantBuffer.GetAddressOf());
+                for (UINT i = 0; i < m_numGSClassInstances; ++i) {
+                    if (m_gsClassInstances[i]) m_gsClassInstances[i]->Release();
+                }
+            }
+        }
+
+        StateGuard(const StateGuard&) = delete;
+        StateGuard& operator=(const StateGuard&) = delete;
+
+        // Saved depth-stencil view (kStateRenderTargets), saves the caller a second OMGetRenderTargets
+        ID3D11DepthStencilView* GetDepthStencilView() const { return m_depthStencilView.Get(); }
+
+    private:
+        ID3D11DeviceContext* m_context;
+        ID3D11DeviceContext1* m_context1;
+        ComPtr<ID3D11DeviceContext1> m_queried1;
+
+        // kStateVSConstantBuffer
+        UINT m_vsConstantSlot;
+        ComPtr<ID3D11Buffer> m_vsConstantBuffer;
+        UINT m_firstConstant = 0;
+        UINT m_numConstants = 0;
+
+        // kStateRenderTargets
+        ComPtr<ID3D11RenderTargetView> m_renderTargetViews[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+        ComPtr<ID3D11DepthStencilView> m_depthStencilView;
+
+        // kStateViewports
+        D3D11_VIEWPORT m_viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+        UINT m_numViewports = 0;
+
+        // kStateScissorRects
+        D3D11_RECT m_scissorRects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+        UINT m_numScissorRects = 0;
+
+        // kStateGeometryShader
+        ComPtr<ID3D11GeometryShader> m_geometryShader;
+        ID3D11ClassInstance* m_gsClassInstances[D3D11_SHADER_MAX_INTERFACES] = { nullptr };
+        UINT m_numGSClassInstances = 0;
+        ComPtr<ID3D11Buffer> m_gsConstantBuffer;
+    };
+}
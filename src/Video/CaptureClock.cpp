@@ -0,0 +1,70 @@
+#include "CaptureClock.h"
+#include <chrono>
+
+namespace Video {
+
+    namespace {
+        constexpr int64_t kNanoseconds = 1000000000;
+
+        // (value * multiplier + rounding) / divisor for value >= 0, split on divisor so the product stays in range
+        // (nanoseconds times 90000 overflows int64 after about 28 hours)
+        int64_t MulDiv(int64_t value, int64_t multiplier, int64_t divisor, int64_t rounding = 0) {
+            return value / divisor * multiplier + (value % divisor * multiplier + rounding) / divisor;
+        }
+    }
+
+    int64_t WallTimeSource::Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void CaptureClock::Configure(std::unique_ptr<TimeSource> source, uint32_t fps, bool variableFrameRate) {
+        m_source = source ? std::move(source) : std::make_unique<WallTimeSource>();
+        m_fps = fps ? fps : 1;
+        m_variableFrameRate = variableFrameRate;
+        m_stats = CaptureClockStats();
+        Restart();
+    }
+
+    void CaptureClock::Restart() {
+        m_started = false;
+        m_nextSlot = 0;
+        m_captureFrame = false;
+        m_timestamp = -1;
+    }
+
+    int64_t CaptureClock::SlotTime(int64_t slot) const {
+        // Exact slot times, so integer nanosecond periods do not accumulate drift
+        return MulDiv(slot, kNanoseconds, m_fps);
+    }
+
+    bool CaptureClock::BeginFrame() {
+        if (!m_source) m_source = std::make_unique<WallTimeSource>();
+
+        int64_t now = m_source->Now();
+        if (!m_started) {
+            m_started = true;
+            m_start = now;
+            m_lastFrame = now;
+        }
+
+        int64_t elapsed = now - m_start;
+        int64_t frameTime = now - m_lastFrame;
+        m_lastFrame = now;
+        m_stats.frames++;
+
+        // Take this frame once the next slot is less than half a game frame away; the following frame would be farther
+        m_captureFrame = elapsed + frameTime / 2 >= SlotTime(m_nextSlot);
+        if (!m_captureFrame) return false;
+
+        // Nearest slot; a long frame can pass several, which stay empty
+        int64_t slot = MulDiv(elapsed, m_fps, kNanoseconds, kNanoseconds / 2);
+        if (slot < m_nextSlot) slot = m_nextSlot;
+        m_stats.skippedSlots += (uint64_t)(slot - m_nextSlot);
+        m_nextSlot = slot + 1;
+
+        int64_t timestamp = m_variableFrameRate ? MulDiv(elapsed, kVariableTimeBase, kNanoseconds) : slot;
+        m_timestamp = timestamp > m_timestamp ? timestamp : m_timestamp + 1;
+        m_stats.captures++;
+        return true;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+namespace Video {
+
+    // Monotonic time in nanoseconds. CaptureClock queries it exactly once per game frame.
+    class TimeSource {
+    public:
+        virtual ~TimeSource() = default;
+        virtual int64_t Now() = 0;
+    };
+
+    // Real time (steady clock)
+    class WallTimeSource : public TimeSource {
+    public:
+        int64_t Now() override;
+    };
+
+    // Game time advancing a fixed step per frame, for games running a fixed timestep or slowed down for offline capture
+    class GameTimeSource : public TimeSource {
+    public:
+        explicit GameTimeSource(int64_t frameNanoseconds) : m_frameNanoseconds(frameNanoseconds) {}
+        int64_t Now() override { return m_frames++ * m_frameNanoseconds; }
+
+    private:
+        int64_t m_frameNanoseconds;
+        int64_t m_frames = 0;
+    };
+
+    struct CaptureClockStats {
+        uint64_t frames = 0;       // Game frames seen
+        uint64_t captures = 0;     // Frames selected for capture
+        uint64_t skippedSlots = 0; // Output frame slots no game frame landed on (game slower than the capture rate)
+    };
+
+    // Decimates game frames to a capture rate independent of the game frame rate. Output frame slots sit on a fixed
+    // grid from the first frame (no drift); each slot takes the game frame nearest to it. Timestamps are the slot index
+    // (constant frame rate) or the frame's elapsed time in 1/kVariableTimeBase seconds (variable frame rate).
+    class CaptureClock {
+    public:
+        static constexpr int kVariableTimeBase = 90000;
+
+        // A null source selects the wall clock. fps of 0 is treated as 1.
+        void Configure(std::unique_ptr<TimeSource> source, uint32_t fps, bool variableFrameRate);
+
+        // Starts a new output: the next frame is captured with timestamp 0
+        void Restart();
+
+        // Call once at the start of every game frame; true when the frame is captured
+        bool BeginFrame();
+
+        bool IsCaptureFrame() const { return m_captureFrame; }
+        // Timestamp of the current capture frame in 1/GetTimeBase() seconds, strictly increasing across captures
+        int64_t GetTimestamp() const { return m_timestamp; }
+        int GetTimeBase() const { return m_variableFrameRate ? kVariableTimeBase : (int)m_fps; }
+        uint32_t GetFps() const { return m_fps; }
+
+        const CaptureClockStats& GetStats() const { return m_stats; }
+
+    private:
+        int64_t SlotTime(int64_t slot) const;
+
+        std::unique_ptr<TimeSource> m_source;
+        uint32_t m_fps = 60;
+        bool m_variableFrameRate = false;
+
+        bool m_started = false;
+        int64_t m_start = 0;
+        int64_t m_lastFrame = 0;
+        int64_t m_nextSlot = 0;
+
+        bool m_captureFrame = false;
+        int64_t m_timestamp = -1;
+
+        CaptureClockStats m_stats;
+    };
+}
@@ -1,13 +1,116 @@
 #pragma once
-#include <d3d11.h>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include "FrameQueue.h"
 
 namespace Video {
+    // Spherical Video V2 metadata (sv3d) written into the container
+    struct SphericalMetadata {
+        enum class Projection { None, Equirectangular, Cubemap };
+        Projection projection = Projection::None;
+        // Equirectangular crop as fractions of the full sphere (VR180: 0.25 on the left and right)
+        float boundLeft = 0.0f;
+        float boundTop = 0.0f;
+        float boundRight = 0.0f;
+        float boundBottom = 0.0f;
+    };
+
+    // How the MP4 reaches the disk
+    enum class OutputMode {
+        Faststart,  // One file, moov moved to the front at Finish (rewrites the file; unplayable after a crash)
+        Fragmented, // One fragmented file written a GOP at a time; playable up to the last fragment after a crash
+        Segmented,  // Fragmented files of segmentSeconds each plus a .ffconcat index of the finished ones
+        Replay      // Nothing written while encoding: the last replaySeconds stay in memory until SaveReplay
+    };
+
+    struct OutputOptions {
+        OutputMode mode = OutputMode::Fragmented;
+        uint32_t segmentSeconds = 60;
+        uint32_t replaySeconds = 30;
+    };
+
+    // Quality by latitude for equirectangular output: rows at least minLatitude degrees from the equator are encoded
+    // qpOffset steps coarser (the highest band reached applies). The polar rows are stretched over many pixels that
+    // viewers rarely look at. Only SoftwareBackend applies it; FFmpeg's NVENC and AMF encoders take no region-of-interest
+    // data, so FFmpegBackend ignores it.
+    struct LatitudeBand {
+        float minLatitude = 0.0f;
+        int qpOffset = 0;
+    };
+
+    struct RoiProfile {
+        std::vector<LatitudeBand> bands; // Empty: uniform quality
+    };
+
+    // Layout of the encoder input (4:2:0, luma plane + interleaved chroma plane)
+    enum class PixelFormat {
+        NV12, // 8 bit
+        P010  // 10 bit in the high bits of 16-bit samples
+    };
+
+    // One input frame: CPU planes with strides, or an opaque hardware surface whose meaning the backend defines
+    // (D3D11: ID3D11Texture2D* and array slice)
+    struct FrameDesc {
+        PixelFormat format = PixelFormat::NV12;
+        int width = 0;
+        int height = 0;
+
+        uint8_t* planes[2] = {}; // Y, UV
+        size_t strides[2] = {};
+
+        void* surface = nullptr;
+        uint32_t subresource = 0;
+
+        bool IsHardware() const { return surface != nullptr; }
+    };
+
+    // Encoders driven on the CPU by the software backend (each used only if the FFmpeg build includes it)
+    enum class SoftwareCodec {
+        X264,  // libx264
+        X265,  // libx265
+        SvtAv1 // libsvtav1
+    };
+
+    struct EncoderConfig {
+        int width = 0;
+        int height = 0;
+        int fps = 60;        // Nominal rate (GOP length, rate control)
+        int timeBase = 60;   // Frame timestamps are in 1/timeBase seconds
+        int64_t bitRate = 50000000;
+        PixelFormat format = PixelFormat::NV12;
+        std::string filename;
+        void* device = nullptr; // Hardware backends: native device (D3D11: ID3D11Device*)
+    };
+
     class Encoder {
     public:
         virtual ~Encoder() = default;
-        virtual bool Initialize(ID3D11Device* pDevice, int width, int height, int fps, const std::string& filename) = 0;
-        virtual void EncodeFrame(ID3D11Texture2D* pSourceTexture) = 0;
+        virtual bool Initialize(const EncoderConfig& config) = 0;
+        // Copies the frame into an encoder surface and submits it
+        virtual void EncodeFrame(const FrameDesc& frame, int64_t timestamp) = 0;
+        // Zero-copy input: write into the acquired surface, then submit it (or release it unused). Acquiring fails when
+        // the queue policy drops the frame. At most one surface is acquired at a time.
+        virtual bool AcquireSurface(FrameDesc* surface) = 0;
+        virtual void SubmitSurface(int64_t timestamp) = 0;
+        virtual void ReleaseSurface() = 0;
         virtual void Finish() = 0;
+        // Applies to the next Initialize
+        virtual void SetSphericalMetadata(const SphericalMetadata& metadata) = 0;
+        // Frames waiting for the encode thread and what happens when it falls behind (depth 0: encode on the caller's
+        // thread). Applies to the next Initialize.
+        virtual void SetQueue(uint32_t depth, QueuePolicy policy) = 0;
+        virtual FrameQueueStats GetQueueStats() const = 0;
+        // Applies to the next Initialize
+        virtual void SetOutput(const OutputOptions& output) = 0;
+        // Applies to the next Initialize, for equirectangular spherical metadata only
+        virtual void SetRoiProfile(const RoiProfile& profile) = 0;
+        // Splits the frame into columns x rows tiles, each encoded by its own session and thread into its own track of
+        // the output file (for frames beyond one encoder's size or speed). Applies to the next Initialize.
+        virtual void SetTiles(uint32_t columns, uint32_t rows) = 0;
+        // Replay output: writes the buffered window to a new file on a thread of its own and returns right away. False
+        // in other modes, or while the previous save is still being written.
+        virtual bool SaveReplay() = 0;
     };
 }
@@ -1,41 +1,49 @@
 #pragma once
-#include "Encoder.h"
-#include <mutex>
+#include "FFmpegEncoder.h"
+#include <wrl/client.h>
 
 #pragma warning(push)
 #pragma warning(disable: 4244)
 extern "C" {
-#include <libavcodec/avcodec.h>
-#include <libavformat/avformat.h>
 #include <libavutil/hwcontext.h>
 #include <libavutil/hwcontext_d3d11va.h>
-#include <libavutil/imgutils.h>
-#include <libavutil/opt.h>
 }
 #pragma warning(pop)
 
 namespace Video {
-    class FFmpegBackend : public Encoder {
+    // Hardware encoding (NVENC, AMF) from a D3D11VA surface pool. Surfaces are ID3D11Texture2D* array slices.
+    class FFmpegBackend : public FFmpegEncoder {
     public:
-        FFmpegBackend();
-        ~FFmpegBackend();
+        ~FFmpegBackend() override;
 
-        bool Initialize(ID3D11Device* pDevice, int width, int height, int fps, const std::string& filename) override;
-        void EncodeFrame(ID3D11Texture2D* pSourceTexture) override;
-        void Finish() override;
+        // Layout of the surface pool (valid after Initialize)
+        bool GetSurfaceDesc(D3D11_TEXTURE2D_DESC* desc) const;
+
+    protected:
+        const AVCodec* OpenInput(const EncoderConfig& config) override;
+        void ConfigureCodec(AVCodecContext* codecCtx, uint32_t tile, AVDictionary** options) override;
+        // FFmpeg's h264_nvenc and h264_amf don't read AV_FRAME_DATA_REGIONS_OF_INTEREST
+        bool SupportsRegions() const override { return false; }
+        void OnStarted() override;
+        void CloseInput() override;
+        bool PrepareFrame(AVFrame* frame) override;
+        void DescribeFrame(AVFrame* frame, FrameDesc* desc) override;
+        bool CopyFrame(const FrameDesc& source, const FrameDesc& target) override;
+        bool CropFrame(AVFrame* frame, uint32_t tile, AVFrame* target) override;
 
     private:
+        // Input frames NVENC may hold while encoding (its "surfaces" option)
+        static constexpr int kEncoderSurfaces = 8;
+
         void InitHWContext(ID3D11Device* pDevice);
+        // Initialized NV12 D3D11VA frames context, or null
+        AVBufferRef* CreateSurfacePool(int width, int height, int size, UINT bindFlags);
 
-        AVFormatContext* m_fmtCtx = nullptr;
-        AVCodecContext* m_codecCtx = nullptr;
-        AVStream* m_videoStream = nullptr;
-        
         AVBufferRef* m_hwDeviceRef = nullptr;
-        AVBufferRef* m_hwFramesRef = nullptr;
-        
-        std::mutex m_mutex;
-        int64_t m_pts = 0;
+        AVBufferRef* m_hwFramesRef = nullptr;     // Surfaces the caller renders into
+        std::vector<AVBufferRef*> m_tilePools;    // Tiled: per-tile surfaces the encoders read
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_context;
+        const AVCodec* m_codec = nullptr;
         int m_width = 0;
         int m_height = 0;
     };
@@ -0,0 +1,651 @@
+#include "FFmpegEncoder.h"
+#include "../Core/Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+namespace Video {
+    namespace {
+        // Filename without its extension (widecapture.mp4 -> widecapture)
+        std::string BaseName(const std::string& filename) {
+            size_t dot = filename.find_last_of('.');
+            size_t separator = filename.find_last_of("/\\");
+            if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) return filename;
+            return filename.substr(0, dot);
+        }
+
+        // Edge i of count equal parts, on a 16-pixel boundary so tiles stay whole macroblocks and chroma samples
+        int TileEdge(int size, uint32_t i, uint32_t count) {
+            if (i >= count) return size;
+            return (int)((int64_t)size * i / count) & ~15;
+        }
+
+        // Local time for file names (20240131_235959)
+        std::string FileTimestamp() {
+            std::time_t t = std::time(nullptr);
+            std::tm tm;
+#ifdef _WIN32
+            localtime_s(&tm, &t);
+#else
+            localtime_r(&t, &tm);
+#endif
+            char text[32];
+            strftime(text, sizeof(text), "%Y%m%d_%H%M%S", &tm);
+            return text;
+        }
+    }
+
+    FFmpegEncoder::FFmpegEncoder() {
+        av_log_set_level(AV_LOG_WARNING);
+    }
+
+    // Backends call Finish from their own destructors, while CloseInput still resolves to them
+    FFmpegEncoder::~FFmpegEncoder() = default;
+
+    void FFmpegEncoder::Finish() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_started = false;
+
+        // Encode whatever is still queued; a surface acquired but never submitted is dropped
+        m_acquired = nullptr;
+        m_queue.Close();
+        if (m_worker.joinable()) m_worker.join();
+
+        {
+            std::lock_guard<std::mutex> tileLock(m_tileMutex);
+            m_tileQuit = true;
+        }
+        m_tileWake.notify_all();
+        for (std::thread& worker : m_tileWorkers) worker.join();
+        m_tileWorkers.clear();
+
+        // Drain the encoders
+        for (uint32_t i = 0; i < (uint32_t)m_tiles.size(); ++i) {
+            if (!m_tiles[i].codecCtx || !m_tiles[i].packet) continue;
+            avcodec_send_frame(m_tiles[i].codecCtx, nullptr);
+            WritePackets(i);
+        }
+
+        // A save in progress still reads the buffer and the tracks' parameters
+        if (m_replayWriter.joinable()) m_replayWriter.join();
+        m_replay.Release();
+
+        if (m_fmtCtx) {
+            if (m_headerWritten) av_write_trailer(m_fmtCtx);
+            if (!(m_fmtCtx->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&m_fmtCtx->pb);
+            }
+            avformat_free_context(m_fmtCtx);
+            m_fmtCtx = nullptr;
+        }
+        m_headerWritten = false;
+
+        for (Tile& tile : m_tiles) {
+            avcodec_free_context(&tile.codecCtx);
+            avcodec_parameters_free(&tile.params);
+            av_frame_free(&tile.crop);
+            av_packet_free(&tile.packet);
+            av_buffer_unref(&tile.regions);
+        }
+        m_tiles.clear();
+
+        for (AVFrame*& frame : m_queue.GetSlots()) av_frame_free(&frame);
+
+        CloseInput();
+    }
+
+    void FFmpegEncoder::LayoutTiles(int width, int height) {
+        // Tiles narrower or shorter than a macroblock row are not worth a session
+        uint32_t columns = std::clamp<uint32_t>(m_tileColumns, 1, (uint32_t)std::max(1, width / 16));
+        uint32_t rows = std::clamp<uint32_t>(m_tileRows, 1, (uint32_t)std::max(1, height / 16));
+
+        m_tileRects.clear();
+        for (uint32_t row = 0; row < rows; ++row) {
+            for (uint32_t column = 0; column < columns; ++column) {
+                TileRect rect;
+                rect.x = TileEdge(width, column, columns);
+                rect.y = TileEdge(height, row, rows);
+                rect.width = TileEdge(width, column + 1, columns) - rect.x;
+                rect.height = TileEdge(height, row + 1, rows) - rect.y;
+                m_tileRects.push_back(rect);
+            }
+        }
+    }
+
+    AVStream* FFmpegEncoder::AddStream(AVFormatContext* fmtCtx, uint32_t tile) {
+        AVStream* stream = avformat_new_stream(fmtCtx, nullptr);
+        if (!stream || avcodec_parameters_copy(stream->codecpar, m_tiles[tile].params) < 0) return nullptr;
+        // Packets are rescaled from the codec time base when written
+        stream->time_base = m_timeBase;
+
+        if (m_tileRects.size() > 1) {
+            // Where the track goes when the tiles are put back together
+            const TileRect& rect = m_tileRects[tile];
+            std::string title = "tile " + std::to_string(rect.x) + "," + std::to_string(rect.y) + " " +
+                                std::to_string(rect.width) + "x" + std::to_string(rect.height);
+            av_dict_set(&stream->metadata, "title", title.c_str(), 0);
+        }
+        AttachSphericalMetadata(tile, stream);
+        return stream;
+    }
+
+    void FFmpegEncoder::AttachSphericalMetadata(uint32_t tile, AVStream* stream) {
+        if (m_spherical.projection == SphericalMetadata::Projection::None) return;
+
+        // sv3d can describe part of an equirect sphere, but not part of a cube
+        bool tiled = m_tileRects.size() > 1;
+        if (tiled && m_spherical.projection == SphericalMetadata::Projection::Cubemap) return;
+
+        // The tile's share of the frame's window on the sphere
+        const TileRect& rect = m_tileRects[tile];
+        const TileRect& last = m_tileRects.back();
+        float frameWidth = (float)(last.x + last.width);
+        float frameHeight = (float)(last.y + last.height);
+        float spanX = 1.0f - m_spherical.boundLeft - m_spherical.boundRight;
+        float spanY = 1.0f - m_spherical.boundTop - m_spherical.boundBottom;
+        float boundLeft = m_spherical.boundLeft + spanX * (float)rect.x / frameWidth;
+        float boundRight = m_spherical.boundRight + spanX * (frameWidth - (float)(rect.x + rect.width)) / frameWidth;
+        float boundTop = m_spherical.boundTop + spanY * (float)rect.y / frameHeight;
+        float boundBottom = m_spherical.boundBottom + spanY * (frameHeight - (float)(rect.y + rect.height)) / frameHeight;
+
+        size_t size = 0;
+        AVSphericalMapping* mapping = av_spherical_alloc(&size);
+        if (!mapping) return;
+
+        bool cropped = boundLeft > 0.0f || boundTop > 0.0f || boundRight > 0.0f || boundBottom > 0.0f;
+        if (m_spherical.projection == SphericalMetadata::Projection::Cubemap) mapping->projection = AV_SPHERICAL_CUBEMAP;
+        else mapping->projection = cropped ? AV_SPHERICAL_EQUIRECTANGULAR_TILE : AV_SPHERICAL_EQUIRECTANGULAR;
+
+        // Bounds are 0.32 fixed point
+        mapping->bound_left = (uint32_t)(boundLeft * 4294967295.0);
+        mapping->bound_top = (uint32_t)(boundTop * 4294967295.0);
+        mapping->bound_right = (uint32_t)(boundRight * 4294967295.0);
+        mapping->bound_bottom = (uint32_t)(boundBottom * 4294967295.0);
+
+#if LIBAVCODEC_VERSION_MAJOR >= 61
+        AVPacketSideData* sideData = av_packet_side_data_new(&stream->codecpar->coded_side_data,
+            &stream->codecpar->nb_coded_side_data, AV_PKT_DATA_SPHERICAL, size, 0);
+        if (sideData) memcpy(sideData->data, mapping, size);
+        av_free(mapping);
+#else
+        // Takes ownership on success
+        if (av_stream_add_side_data(stream, AV_PKT_DATA_SPHERICAL, (uint8_t*)mapping, size) < 0) av_free(mapping);
+#endif
+    }
+
+    void FFmpegEncoder::BuildRegions(const AVCodec* codec, int width, int height) {
+        for (Tile& tile : m_tiles) av_buffer_unref(&tile.regions);
+        if (m_spherical.projection != SphericalMetadata::Projection::Equirectangular || m_roiProfile.bands.empty()) return;
+        if (!SupportsRegions()) {
+            LOG_WARNING(codec->name, " ignores region-of-interest data: polar rows are encoded at full quality (PoleQp=off silences this)");
+            return;
+        }
+
+        // Latitudes covered by the frame, from the crop bounds
+        float latTop = 90.0f - m_spherical.boundTop * 180.0f;
+        float latBottom = -90.0f + m_spherical.boundBottom * 180.0f;
+        float span = latTop - latBottom;
+        if (span <= 0.0f) return;
+
+        // Row where a latitude is crossed, on a 16-row boundary so each macroblock row gets a single offset
+        auto edge = [&](float latitude) {
+            int row = (int)std::lround((latTop - latitude) / span * (float)height / 16.0f) * 16;
+            return std::clamp(row, 0, height);
+        };
+
+        std::vector<AVRegionOfInterest> regions;
+        auto addRegion = [&](int top, int bottom, int qpOffset) {
+            if (bottom <= top || qpOffset == 0) return;
+            AVRegionOfInterest region = {};
+            region.self_size = sizeof(AVRegionOfInterest);
+            region.top = top;
+            region.bottom = bottom;
+            region.left = 0;
+            region.right = width;
+            // libx264/libx265 scale the [-1, 1] offset to +-25 QP
+            region.qoffset = av_make_q(std::clamp(qpOffset, -25, 25), 25);
+            regions.push_back(region);
+        };
+
+        // Highest band first: each covers the rows between its latitude and the band above it, mirrored in both
+        // hemispheres, so no two regions overlap
+        std::vector<LatitudeBand> bands = m_roiProfile.bands;
+        std::sort(bands.begin(), bands.end(), [](const LatitudeBand& a, const LatitudeBand& b) { return a.minLatitude > b.minLatitude; });
+
+        int northEdge = 0;
+        int southEdge = height;
+        for (const LatitudeBand& band : bands) {
+            int north = std::max(edge(band.minLatitude), northEdge);
+            int south = std::max(std::min(edge(-band.minLatitude), southEdge), north);
+            addRegion(northEdge, north, band.qpOffset);
+            addRegion(south, southEdge, band.qpOffset);
+            northEdge = north;
+            southEdge = south;
+        }
+        if (regions.empty()) return;
+
+        // Each tile gets the regions it intersects, in its own coordinates
+        for (size_t i = 0; i < m_tiles.size(); ++i) {
+            const TileRect& rect = m_tileRects[i];
+            std::vector<AVRegionOfInterest> clipped;
+            for (AVRegionOfInterest region : regions) {
+                region.top = std::max(region.top, rect.y) - rect.y;
+                region.bottom = std::min(region.bottom, rect.y + rect.height) - rect.y;
+                region.left = std::max(region.left, rect.x) - rect.x;
+                region.right = std::min(region.right, rect.x + rect.width) - rect.x;
+                if (region.bottom > region.top && region.right > region.left) clipped.push_back(region);
+            }
+            if (clipped.empty()) continue;
+
+            m_tiles[i].regions = av_buffer_alloc(clipped.size() * sizeof(AVRegionOfInterest));
+            if (m_tiles[i].regions) memcpy(m_tiles[i].regions->data, clipped.data(), clipped.size() * sizeof(AVRegionOfInterest));
+        }
+        LOG_INFO("Latitude rate control: ", regions.size(), " regions");
+    }
+
+    void FFmpegEncoder::SetOutputOptions(AVDictionary** options, const std::string& filename) const {
+        // Every fragment is one GOP, written as soon as the next keyframe arrives
+        const char* fragmentFlags = "+frag_keyframe+empty_moov+default_base_moof";
+
+        switch (m_output.mode) {
+            case OutputMode::Faststart:
+                // The trailer moves the moov to the front, which rewrites the whole file
+                av_dict_set(options, "movflags", "faststart", 0);
+                break;
+
+            case OutputMode::Fragmented:
+                av_dict_set(options, "movflags", fragmentFlags, 0);
+                av_dict_set(options, "flush_packets", "1", 0); // Hand finished fragments to the OS right away
+                break;
+
+            case OutputMode::Segmented: {
+                // Each segment is a fragmented MP4 of its own; the index lists the finished ones for the concat demuxer
+                std::string segmentOptions = std::string("movflags=") + fragmentFlags;
+                if (m_spherical.projection != SphericalMetadata::Projection::None) segmentOptions += ":strict=unofficial";
+                av_dict_set(options, "segment_format", "mp4", 0);
+                av_dict_set(options, "segment_format_options", segmentOptions.c_str(), 0);
+                av_dict_set_int(options, "segment_time", m_output.segmentSeconds ? m_output.segmentSeconds : 1, 0);
+                av_dict_set(options, "segment_list", (BaseName(filename) + ".ffconcat").c_str(), 0);
+                av_dict_set(options, "segment_list_type", "ffconcat", 0);
+                break;
+            }
+
+            case OutputMode::Replay:
+                break; // Saved replays are plain MP4s
+        }
+    }
+
+    bool FFmpegEncoder::Initialize(const EncoderConfig& config) {
+        m_pts = 0;
+        m_timeBase = { 1, config.timeBase }; // Units of the capture clock timestamps
+        m_filename = config.filename;
+
+        try {
+            LayoutTiles(config.width, config.height);
+            const AVCodec* codec = OpenInput(config);
+
+            // Segments go through the segment muxer, which names the files itself; replays get a muxer per save
+            bool segmented = m_output.mode == OutputMode::Segmented;
+            bool replay = m_output.mode == OutputMode::Replay;
+            if (!replay) {
+                std::string target = segmented ? BaseName(config.filename) + "_%05d.mp4" : config.filename;
+                avformat_alloc_output_context2(&m_fmtCtx, nullptr, segmented ? "segment" : nullptr, target.c_str());
+                if (!m_fmtCtx) throw std::runtime_error("Could not create output context");
+            }
+
+            // One session and track per tile, sharing the bit rate by area
+            bool tiled = m_tileRects.size() > 1;
+            int64_t frameArea = (int64_t)config.width * config.height;
+            m_tiles.resize(m_tileRects.size());
+            for (uint32_t i = 0; i < (uint32_t)m_tiles.size(); ++i) {
+                Tile& tile = m_tiles[i];
+                const TileRect& rect = m_tileRects[i];
+
+                tile.codecCtx = avcodec_alloc_context3(codec);
+                if (!tile.codecCtx) throw std::runtime_error("Could not allocate codec context");
+                tile.codecCtx->width = rect.width;
+                tile.codecCtx->height = rect.height;
+                tile.codecCtx->time_base = m_timeBase;
+                tile.codecCtx->framerate = { config.fps, 1 };
+
+                tile.codecCtx->bit_rate = config.bitRate * rect.width * rect.height / frameArea;
+                tile.codecCtx->gop_size = config.fps * 2;
+                tile.codecCtx->max_b_frames = 0;
+
+                AVDictionary* codecOpt = nullptr;
+                ConfigureCodec(tile.codecCtx, i, &codecOpt);
+
+                // Fragmented MP4 writes its moov up front, so SPS/PPS must be known before the first packet
+                if (replay || segmented || (m_fmtCtx->oformat->flags & AVFMT_GLOBALHEADER)) tile.codecCtx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+                int opened = avcodec_open2(tile.codecCtx, codec, &codecOpt);
+                av_dict_free(&codecOpt);
+                if (opened < 0) throw std::runtime_error(tiled ? "Could not open codec for tile " + std::to_string(i) : std::string("Could not open codec"));
+
+                tile.params = avcodec_parameters_alloc();
+                if (!tile.params || avcodec_parameters_from_context(tile.params, tile.codecCtx) < 0) throw std::runtime_error("Could not copy codec parameters");
+                if (!replay) {
+                    tile.stream = AddStream(m_fmtCtx, i);
+                    if (!tile.stream) throw std::runtime_error("Could not create stream");
+                }
+
+                tile.packet = av_packet_alloc();
+                if (tiled) tile.crop = av_frame_alloc();
+                if (!tile.packet || (tiled && !tile.crop)) throw std::runtime_error("Failed to allocate packets");
+            }
+            LOG_INFO("Encoder: ", codec->name, " ", config.width, "x", config.height,
+                     tiled ? " in " + std::to_string(m_tiles.size()) + " tiles" : std::string(), " at ", config.bitRate / 1000000, " Mbps");
+            if (tiled && m_spherical.projection == SphericalMetadata::Projection::Cubemap) LOG_WARNING("Cube tiles carry no spherical metadata");
+            BuildRegions(codec, config.width, config.height);
+
+            if (replay) {
+                // Room for the window plus the GOP it starts in and the one being written, with headroom for rate
+                // control overshoot and for packets arriving while a save holds the window
+                uint32_t seconds = (m_output.replaySeconds ? m_output.replaySeconds : 30) + 4;
+                size_t capacity = (size_t)(config.bitRate / 8 * seconds * 3 / 2);
+                uint32_t packets = (uint32_t)m_tiles.size() * (uint32_t)config.fps * seconds * 2;
+                m_replay.Reset(capacity, packets, (int64_t)(seconds - 4) * config.timeBase);
+                LOG_INFO("Replay buffer: ", seconds - 4, " s in ", capacity >> 20, " MB");
+            } else {
+                if (!(m_fmtCtx->oformat->flags & AVFMT_NOFILE)) {
+                    if (avio_open(&m_fmtCtx->pb, config.filename.c_str(), AVIO_FLAG_WRITE) < 0) throw std::runtime_error("Could not open output file");
+                }
+
+                // The MP4 muxer only writes sv3d boxes in unofficial mode
+                if (m_spherical.projection != SphericalMetadata::Projection::None) m_fmtCtx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+
+                AVDictionary* opt = nullptr;
+                SetOutputOptions(&opt, config.filename);
+                int ret = avformat_write_header(m_fmtCtx, &opt);
+                av_dict_free(&opt);
+                if (ret < 0) {
+                    throw std::runtime_error("Failed to write header");
+                }
+                m_headerWritten = true;
+            }
+
+            std::vector<AVFrame*> frames(GetQueueSlots());
+            for (AVFrame*& frame : frames) {
+                frame = av_frame_alloc();
+                if (!frame) throw std::runtime_error("Failed to allocate frames");
+            }
+            m_queue.Reset(std::move(frames), m_queuePolicy);
+
+            OnStarted();
+            m_tileQuit = false;
+            m_tileGeneration = 0;
+            for (uint32_t i = 1; i < (uint32_t)m_tiles.size(); ++i) m_tileWorkers.emplace_back(&FFmpegEncoder::TileLoop, this, i);
+            if (m_queueDepth > 0) m_worker = std::thread(&FFmpegEncoder::EncodeLoop, this);
+
+            m_started = true;
+            return true;
+        } catch (const std::exception& e) {
+            LOG_ERROR("FFmpeg Init Failed: ", e.what());
+            return false;
+        }
+    }
+
+    bool FFmpegEncoder::AcquireSurface(FrameDesc* surface) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_started) return false;
+
+        if (!m_acquired) {
+            // Take a queue slot (may wait or drop, depending on the policy)
+            AVFrame** slot = m_queue.BeginPush();
+            if (!slot) return false;
+
+            if (!PrepareFrame(*slot)) {
+                LOG_ERROR("Failed to allocate encoder frame");
+                m_queue.EndPush(false);
+                return false;
+            }
+            m_acquired = *slot;
+        }
+
+        DescribeFrame(m_acquired, surface);
+        return true;
+    }
+
+    void FFmpegEncoder::ReleaseSurface() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_acquired) return;
+        RecycleFrame(m_acquired);
+        m_acquired = nullptr;
+        m_queue.EndPush(false);
+    }
+
+    void FFmpegEncoder::SubmitSurface(int64_t timestamp) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_acquired) return;
+
+        // Muxers reject non-increasing timestamps
+        m_acquired->pts = timestamp < m_pts ? m_pts : timestamp;
+        m_pts = m_acquired->pts + 1;
+        m_acquired = nullptr;
+
+        // Hand over to the encoding thread, or encode right here without one
+        m_queue.EndPush();
+        if (!m_worker.joinable()) {
+            if (AVFrame** queued = m_queue.BeginPop()) {
+                EncodeQueued(*queued);
+                m_queue.EndPop();
+            }
+        }
+    }
+
+    void FFmpegEncoder::EncodeFrame(const FrameDesc& frame, int64_t timestamp) {
+        FrameDesc surface;
+        if (!AcquireSurface(&surface)) return;
+
+        if (!CopyFrame(frame, surface)) {
+            LOG_ERROR("Frame does not match the encoder input");
+            ReleaseSurface();
+            return;
+        }
+        SubmitSurface(timestamp);
+    }
+
+    bool FFmpegEncoder::CropFrame(AVFrame* frame, uint32_t tile, AVFrame* target) {
+        const TileRect& rect = m_tileRects[tile];
+        if (av_frame_ref(target, frame) < 0) return false;
+
+        target->crop_left = (size_t)rect.x;
+        target->crop_top = (size_t)rect.y;
+        target->crop_right = (size_t)(frame->width - rect.x - rect.width);
+        target->crop_bottom = (size_t)(frame->height - rect.y - rect.height);
+        // Unaligned: the plane pointers land exactly on the tile corner (16-pixel aligned anyway)
+        return av_frame_apply_cropping(target, AV_FRAME_CROP_UNALIGNED) >= 0;
+    }
+
+    void FFmpegEncoder::EncodeLoop() {
+        while (AVFrame** queued = m_queue.BeginPop()) {
+            EncodeQueued(*queued);
+            m_queue.EndPop();
+        }
+    }
+
+    void FFmpegEncoder::EncodeQueued(AVFrame* frame) {
+        AVFrame* input = ConvertFrame(frame);
+        if (!input) {
+            LOG_ERROR("Failed to convert frame for the encoder");
+            RecycleFrame(frame);
+            return;
+        }
+
+        if (m_tiles.size() == 1) {
+            EncodeTile(0, input);
+        } else {
+            // Every tile encodes this frame before the next one starts, so the tracks stay in step
+            {
+                std::lock_guard<std::mutex> lock(m_tileMutex);
+                m_tileFrame = input;
+                m_tilesRunning = (uint32_t)m_tiles.size() - 1;
+                m_tileGeneration++;
+            }
+            m_tileWake.notify_all();
+
+            EncodeTile(0, input);
+
+            std::unique_lock<std::mutex> lock(m_tileMutex);
+            m_tileDone.wait(lock, [this] { return m_tilesRunning == 0; });
+            m_tileFrame = nullptr;
+        }
+        RecycleFrame(frame);
+    }
+
+    void FFmpegEncoder::EncodeTile(uint32_t index, AVFrame* frame) {
+        Tile& tile = m_tiles[index];
+        AVFrame* send = frame;
+        if (tile.crop) {
+            if (!CropFrame(frame, index, tile.crop)) {
+                LOG_ERROR("Failed to crop tile ", index);
+                av_frame_unref(tile.crop);
+                return;
+            }
+            tile.crop->pts = frame->pts;
+            send = tile.crop;
+        }
+
+        // Slots are reused with whatever side data the last frame carried
+        av_frame_remove_side_data(send, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+        if (tile.regions) {
+            AVBufferRef* regions = av_buffer_ref(tile.regions);
+            if (regions && !av_frame_new_side_data_from_buf(send, AV_FRAME_DATA_REGIONS_OF_INTEREST, regions)) av_buffer_unref(&regions);
+        }
+
+        int ret = avcodec_send_frame(tile.codecCtx, send);
+        if (tile.crop) av_frame_unref(tile.crop);
+        if (ret < 0) {
+            LOG_ERROR("Error sending frame to encoder: ", ret);
+            return;
+        }
+        WritePackets(index);
+    }
+
+    void FFmpegEncoder::TileLoop(uint32_t index) {
+        uint64_t seen = 0;
+        for (;;) {
+            AVFrame* frame = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_tileMutex);
+                m_tileWake.wait(lock, [&] { return m_tileQuit || m_tileGeneration != seen; });
+                if (m_tileQuit) return;
+                seen = m_tileGeneration;
+                frame = m_tileFrame;
+            }
+
+            EncodeTile(index, frame);
+
+            std::lock_guard<std::mutex> lock(m_tileMutex);
+            if (--m_tilesRunning == 0) m_tileDone.notify_one();
+        }
+    }
+
+    void FFmpegEncoder::WritePackets(uint32_t index) {
+        Tile& tile = m_tiles[index];
+        for (;;) {
+            int ret = avcodec_receive_packet(tile.codecCtx, tile.packet);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
+            else if (ret < 0) {
+                LOG_ERROR("Error receiving packet");
+                break;
+            }
+
+            if (!tile.stream) {
+                // Replay: copied into the ring in codec time base
+                ReplayPacket packet;
+                packet.stream = index;
+                packet.pts = tile.packet->pts;
+                packet.dts = tile.packet->dts;
+                packet.duration = tile.packet->duration;
+                packet.keyframe = (tile.packet->flags & AV_PKT_FLAG_KEY) != 0;
+                packet.data = tile.packet->data;
+                packet.size = (size_t)tile.packet->size;
+                m_replay.Append(packet);
+                av_packet_unref(tile.packet);
+                continue;
+            }
+
+            av_packet_rescale_ts(tile.packet, tile.codecCtx->time_base, tile.stream->time_base);
+            tile.packet->stream_index = tile.stream->index;
+            std::lock_guard<std::mutex> lock(m_muxMutex);
+            av_interleaved_write_frame(m_fmtCtx, tile.packet); // Takes the packet's reference
+        }
+    }
+
+    bool FFmpegEncoder::SaveReplay() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_started || m_output.mode != OutputMode::Replay) return false;
+        if (m_replaySaving) {
+            LOG_WARNING("Previous replay still being saved");
+            return false;
+        }
+        if (m_replayWriter.joinable()) m_replayWriter.join(); // Already done
+
+        m_replaySaving = true;
+        m_replayWriter = std::thread(&FFmpegEncoder::WriteReplay, this, BaseName(m_filename) + "_replay_" + FileTimestamp() + ".mp4");
+        return true;
+    }
+
+    void FFmpegEncoder::WriteReplay(std::string filename) {
+        uint32_t count = 0;
+        if (!m_replay.Pin(&count)) {
+            LOG_WARNING("Replay buffer is empty");
+            m_replaySaving = false;
+            return;
+        }
+
+        AVFormatContext* fmtCtx = nullptr;
+        AVPacket* packet = av_packet_alloc();
+        try {
+            avformat_alloc_output_context2(&fmtCtx, nullptr, "mp4", filename.c_str());
+            if (!fmtCtx || !packet) throw std::runtime_error("Could not create output context");
+            for (uint32_t i = 0; i < (uint32_t)m_tiles.size(); ++i) {
+                if (!AddStream(fmtCtx, i)) throw std::runtime_error("Could not create stream");
+            }
+            if (avio_open(&fmtCtx->pb, filename.c_str(), AVIO_FLAG_WRITE) < 0) throw std::runtime_error("Could not open output file");
+            if (m_spherical.projection != SphericalMetadata::Projection::None) fmtCtx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+            if (avformat_write_header(fmtCtx, nullptr) < 0) throw std::runtime_error("Failed to write header");
+
+            // The window starts at a GOP, which begins at zero; a track's packets from before its own keyframe of
+            // that frame belong to the previous GOP and are skipped
+            int64_t origin = m_replay.GetPinned(0).dts;
+            int64_t end = origin;
+            std::vector<bool> started(m_tiles.size(), false);
+            for (uint32_t i = 0; i < count; ++i) {
+                ReplayPacket source = m_replay.GetPinned(i);
+                if (source.stream >= started.size() || (!started[source.stream] && !source.keyframe)) continue;
+                started[source.stream] = true;
+
+                // Not reference counted: av_write_frame muxes it straight from the ring
+                AVStream* stream = fmtCtx->streams[source.stream];
+                packet->data = (uint8_t*)source.data;
+                packet->size = (int)source.size;
+                packet->stream_index = stream->index;
+                packet->flags = source.keyframe ? AV_PKT_FLAG_KEY : 0;
+                packet->pts = source.pts - origin;
+                packet->dts = source.dts - origin;
+                packet->duration = source.duration;
+                av_packet_rescale_ts(packet, m_timeBase, stream->time_base);
+                if (av_write_frame(fmtCtx, packet) < 0) throw std::runtime_error("Failed to write packet");
+                end = std::max(end, source.pts + source.duration);
+            }
+            if (av_write_trailer(fmtCtx) < 0) throw std::runtime_error("Failed to write trailer");
+
+            ReplayStats stats = m_replay.GetStats();
+            LOG_INFO("Replay saved: ", filename, " (", (end - origin) / m_timeBase.den, " s, ", stats.dropped, " packets dropped so far)");
+        } catch (const std::exception& e) {
+            LOG_ERROR("Replay save failed: ", e.what());
+        }
+
+        if (fmtCtx) {
+            if (fmtCtx->pb) avio_closep(&fmtCtx->pb);
+            avformat_free_context(fmtCtx);
+        }
+        av_packet_free(&packet);
+        m_replay.Unpin();
+        m_replaySaving = false;
+    }
+}
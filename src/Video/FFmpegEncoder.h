@@ -0,0 +1,159 @@
+#pragma once
+#include "Encoder.h"
+#include "ReplayBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 4244)
+#endif
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libavutil/spherical.h>
+}
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace Video {
+
+    // Part of the frame encoded as a stream of its own (tiled encoding), in pixels
+    struct TileRect {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Shared FFmpeg pipeline: codec and muxer setup, output modes, spherical metadata, and the frame queue feeding
+    // the encoding thread. Backends supply the codec and the input frames (hardware surfaces or CPU planes).
+    //
+    // Tiled: every tile has its own codec session and video track in the one output file, all with the same
+    // timestamps. The encoding thread encodes tile 0 and a thread per further tile the others, frame by frame.
+    //
+    // Replay output: packets go into a ReplayBuffer sized from the bit rate instead of a muxer, and SaveReplay muxes the
+    // pinned window into an MP4 of its own on a separate thread.
+    class FFmpegEncoder : public Encoder {
+    public:
+        FFmpegEncoder();
+        ~FFmpegEncoder() override;
+
+        bool Initialize(const EncoderConfig& config) override;
+        void EncodeFrame(const FrameDesc& frame, int64_t timestamp) override;
+        bool AcquireSurface(FrameDesc* surface) override;
+        void SubmitSurface(int64_t timestamp) override;
+        void ReleaseSurface() override;
+        void Finish() override;
+        void SetSphericalMetadata(const SphericalMetadata& metadata) override { m_spherical = metadata; }
+        void SetQueue(uint32_t depth, QueuePolicy policy) override { m_queueDepth = depth; m_queuePolicy = policy; }
+        FrameQueueStats GetQueueStats() const override { return m_queue.GetStats(); }
+        void SetOutput(const OutputOptions& output) override { m_output = output; }
+        void SetRoiProfile(const RoiProfile& profile) override { m_roiProfile = profile; }
+        void SetTiles(uint32_t columns, uint32_t rows) override { m_tileColumns = columns; m_tileRows = rows; }
+        bool SaveReplay() override;
+
+    protected:
+        // Everything below runs inside Initialize/Finish or on the encoding threads, never concurrently with each
+        // other except CropFrame for different tiles
+
+        // Creates the input side (device, pools) and picks the codec; throws std::runtime_error on failure. The tile
+        // layout is already known.
+        virtual const AVCodec* OpenInput(const EncoderConfig& config) = 0;
+        // Backend settings on one tile's allocated codec context (pix_fmt, hardware frames, threading) and open options
+        virtual void ConfigureCodec(AVCodecContext* codecCtx, uint32_t tile, AVDictionary** options) = 0;
+        // Whether the codec applies AVRegionOfInterest side data (latitude rate control is skipped when it doesn't)
+        virtual bool SupportsRegions() const { return true; }
+        // After the output is open, before the encoding threads start
+        virtual void OnStarted() {}
+        // Releases the input side, after the codecs are closed
+        virtual void CloseInput() = 0;
+
+        // Attaches a writable buffer to a queue slot for the next frame
+        virtual bool PrepareFrame(AVFrame* frame) = 0;
+        virtual void DescribeFrame(AVFrame* frame, FrameDesc* desc) = 0;
+        virtual bool CopyFrame(const FrameDesc& source, const FrameDesc& target) = 0;
+        // Encoding thread: the frame to send for a queued slot (a converted copy or the slot itself)
+        virtual AVFrame* ConvertFrame(AVFrame* frame) { return frame; }
+        // Tile threads (tiled only): one tile of the converted frame into target, unreferenced once sent. The default
+        // references the tile's part of CPU planes.
+        virtual bool CropFrame(AVFrame* frame, uint32_t tile, AVFrame* target);
+        // Encoding thread: a slot's frame was sent; release what it holds or keep it for reuse
+        virtual void RecycleFrame(AVFrame* frame) { av_frame_unref(frame); }
+
+        // 0: frames are encoded on the caller's thread
+        uint32_t GetQueueDepth() const { return m_queueDepth; }
+        uint32_t GetQueueSlots() const { return m_queueDepth ? m_queueDepth : 1; }
+        // A single rectangle covering the frame unless tiled
+        const std::vector<TileRect>& GetTiles() const { return m_tileRects; }
+
+    private:
+        struct Tile {
+            AVCodecContext* codecCtx = nullptr;
+            AVStream* stream = nullptr;         // Null in replay mode
+            AVCodecParameters* params = nullptr; // The opened codec's, for the streams of saved replays
+            AVFrame* crop = nullptr;        // Tiled only
+            AVPacket* packet = nullptr;     // Used by the tile's thread only
+            AVBufferRef* regions = nullptr; // ROI side data for each frame (null: none)
+        };
+
+        void LayoutTiles(int width, int height);
+        // The tile's track in fmtCtx: codec parameters, time base, title and spherical metadata
+        AVStream* AddStream(AVFormatContext* fmtCtx, uint32_t tile);
+        void AttachSphericalMetadata(uint32_t tile, AVStream* stream);
+        // Latitude bands as AVRegionOfInterest rectangles, clipped to each tile and shared by every frame
+        void BuildRegions(const AVCodec* codec, int width, int height);
+        void SetOutputOptions(AVDictionary** options, const std::string& filename) const;
+        void EncodeLoop();
+        void EncodeQueued(AVFrame* frame);
+        void EncodeTile(uint32_t tile, AVFrame* frame);
+        void TileLoop(uint32_t tile);
+        void WritePackets(uint32_t tile);
+        void WriteReplay(std::string filename);
+
+        AVFormatContext* m_fmtCtx = nullptr;
+        std::vector<Tile> m_tiles;
+        std::vector<TileRect> m_tileRects;
+        bool m_headerWritten = false; // A failed Initialize leaves a muxer that must not get a trailer
+        bool m_started = false;
+        std::mutex m_muxMutex;        // Tiles write their packets from their own threads
+        AVRational m_timeBase = { 1, 60 };
+        std::string m_filename;
+
+        // Replay output: packets in codec time base, saved by m_replayWriter while m_replaySaving
+        ReplayBuffer m_replay;
+        std::thread m_replayWriter;
+        std::atomic<bool> m_replaySaving{ false };
+
+        // Frames filled on the caller's thread, encoded and muxed on m_worker (inline when the depth is 0)
+        FrameQueue<AVFrame*> m_queue;
+        std::thread m_worker;
+        AVFrame* m_acquired = nullptr; // Surface handed out by AcquireSurface, not yet submitted
+        uint32_t m_queueDepth = 3;
+        QueuePolicy m_queuePolicy = QueuePolicy::Block;
+
+        // Tile threads, woken once per frame; the encoding thread waits for all of them before the next one
+        std::vector<std::thread> m_tileWorkers;
+        std::mutex m_tileMutex;
+        std::condition_variable m_tileWake;
+        std::condition_variable m_tileDone;
+        AVFrame* m_tileFrame = nullptr;
+        uint64_t m_tileGeneration = 0;
+        uint32_t m_tilesRunning = 0;
+        bool m_tileQuit = false;
+
+        std::mutex m_mutex;
+        int64_t m_pts = 0; // Lowest timestamp the next frame may use
+        SphericalMetadata m_spherical;
+        OutputOptions m_output;
+        RoiProfile m_roiProfile;
+        uint32_t m_tileColumns = 1;
+        uint32_t m_tileRows = 1;
+    };
+}
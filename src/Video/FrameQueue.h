@@ -0,0 +1,161 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Video {
+
+    // What a full queue does with a new frame
+    enum class QueuePolicy {
+        Block,      // Wait for the consumer: complete output, but encoder stalls reach the producer
+        DropOldest, // Discard the oldest queued frame: bounded latency, newest content kept
+        DropNewest  // Discard the new frame: queued frames are encoded as submitted
+    };
+
+    struct FrameQueueStats {
+        uint64_t submitted = 0;     // Frames offered by the producer
+        uint64_t completed = 0;     // Frames the consumer finished
+        uint64_t droppedOldest = 0;
+        uint64_t droppedNewest = 0;
+        uint64_t blocks = 0;        // Times the producer had to wait for a free slot
+        uint32_t depth = 0;         // Frames queued or in progress
+        uint32_t maxDepth = 0;
+    };
+
+    // Bounded single-producer, single-consumer FIFO over a fixed set of preallocated slots.
+    // The producer fills a slot between BeginPush and EndPush, the consumer processes one between BeginPop and EndPop;
+    // neither holds the lock meanwhile. Slots are recycled with their previous contents, which the producer releases or
+    // overwrites on reuse (a dropped frame's slot comes back still filled).
+    template<typename T>
+    class FrameQueue {
+    public:
+        // Not thread safe: call while no producer or consumer is active. At least one slot is kept.
+        void Reset(std::vector<T> slots, QueuePolicy policy) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (slots.empty()) slots.emplace_back();
+            m_slots = std::move(slots);
+            m_policy = policy;
+
+            uint32_t count = (uint32_t)m_slots.size();
+            m_free.clear();
+            for (uint32_t i = count; i-- > 0;) m_free.push_back(i);
+            m_ring.assign(count, 0);
+            m_head = 0;
+            m_queued = 0;
+            m_pending = kNone;
+            m_active = kNone;
+            m_closed = false;
+            m_stats = FrameQueueStats();
+        }
+
+        // Slot for the next frame, or null when the frame is dropped (DropNewest) or the queue is closed
+        T* BeginPush() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stats.submitted++;
+
+            if (m_free.empty() && !m_closed) {
+                if (m_policy == QueuePolicy::DropNewest) {
+                    m_stats.droppedNewest++;
+                    return nullptr;
+                }
+                if (m_policy == QueuePolicy::DropOldest && m_queued > 0) {
+                    // Take over the oldest queued slot; the consumer never sees it
+                    m_free.push_back(m_ring[m_head]);
+                    m_head = (m_head + 1) % (uint32_t)m_ring.size();
+                    m_queued--;
+                    m_stats.droppedOldest++;
+                } else {
+                    // Block, or DropOldest with every slot in the consumer's hands
+                    m_stats.blocks++;
+                    m_slotFreed.wait(lock, [this] { return !m_free.empty() || m_closed; });
+                }
+            }
+            if (m_closed) return nullptr;
+
+            m_pending = m_free.back();
+            m_free.pop_back();
+            return &m_slots[m_pending];
+        }
+
+        // Queues the slot from BeginPush, or returns it unused when commit is false
+        void EndPush(bool commit = true) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_pending == kNone) return;
+                if (commit) {
+                    m_ring[(m_head + m_queued) % (uint32_t)m_ring.size()] = m_pending;
+                    m_queued++;
+                    uint32_t depth = m_queued + (m_active != kNone ? 1 : 0);
+                    if (depth > m_stats.maxDepth) m_stats.maxDepth = depth;
+                } else {
+                    m_free.push_back(m_pending);
+                }
+                m_pending = kNone;
+            }
+            if (commit) m_frameQueued.notify_one();
+        }
+
+        // Oldest queued frame; waits for one. Null once the queue is closed and drained.
+        T* BeginPop() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frameQueued.wait(lock, [this] { return m_queued > 0 || m_closed; });
+            if (m_queued == 0) return nullptr;
+
+            m_active = m_ring[m_head];
+            m_head = (m_head + 1) % (uint32_t)m_ring.size();
+            m_queued--;
+            return &m_slots[m_active];
+        }
+
+        void EndPop() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_active == kNone) return;
+                m_free.push_back(m_active);
+                m_active = kNone;
+                m_stats.completed++;
+            }
+            m_slotFreed.notify_one();
+        }
+
+        // Wakes both sides: pushes fail from now on, pops drain what is queued and then return null
+        void Close() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_closed = true;
+            }
+            m_frameQueued.notify_all();
+            m_slotFreed.notify_all();
+        }
+
+        // Every slot, queued or not (for releasing their contents once both sides have stopped)
+        std::vector<T>& GetSlots() { return m_slots; }
+
+        FrameQueueStats GetStats() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            FrameQueueStats stats = m_stats;
+            stats.depth = m_queued + (m_active != kNone ? 1 : 0);
+            return stats;
+        }
+
+    private:
+        static constexpr uint32_t kNone = ~0u;
+
+        std::vector<T> m_slots;
+        std::vector<uint32_t> m_free; // Slot indices owned by neither side
+        std::vector<uint32_t> m_ring; // Queued slot indices, oldest at m_head
+        uint32_t m_head = 0;
+        uint32_t m_queued = 0;
+        uint32_t m_pending = kNone;   // Being filled by the producer
+        uint32_t m_active = kNone;    // Being processed by the consumer
+        QueuePolicy m_policy = QueuePolicy::Block;
+        bool m_closed = false;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_frameQueued;
+        std::condition_variable m_slotFreed;
+        FrameQueueStats m_stats;
+    };
+}
@@ -0,0 +1,171 @@
+#include "ReplayBuffer.h"
+#include <cstring>
+
+namespace Video {
+
+    void ReplayBuffer::Reset(size_t capacity, uint32_t maxPackets, int64_t window) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Assigned, not reserved: the pages are committed now rather than while encoding
+        m_bytes.assign(capacity, 0);
+        m_records.assign(maxPackets, Record());
+        m_gops.assign(maxPackets, 0); // Every GOP has at least one packet
+        m_head = 0;
+        m_first = 0;
+        m_count = 0;
+        m_gopFirst = 0;
+        m_gopCount = 0;
+        m_window = window;
+        m_skipping = true;
+        m_dropped = 0;
+        m_pinned = false;
+    }
+
+    void ReplayBuffer::Release() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pinned) return;
+        std::vector<uint8_t>().swap(m_bytes);
+        std::vector<Record>().swap(m_records);
+        std::vector<uint32_t>().swap(m_gops);
+        m_count = 0;
+        m_gopCount = 0;
+    }
+
+    bool ReplayBuffer::FindSpace(size_t size, size_t* offset) const {
+        if (m_count == (uint32_t)m_records.size()) return false;
+        if (m_count == 0) {
+            *offset = 0;
+            return size <= m_bytes.size();
+        }
+
+        // Live bytes run from the oldest packet to m_head, wrapped when m_head is below it. Wrapping needs strictly
+        // less than the gap so m_head never catches up with the oldest packet.
+        size_t tail = m_records[m_first].offset;
+        if (m_head > tail) {
+            if (m_head + size <= m_bytes.size()) {
+                *offset = m_head;
+                return true;
+            }
+            *offset = 0;
+            return size < tail;
+        }
+        *offset = m_head;
+        return m_head + size < tail;
+    }
+
+    bool ReplayBuffer::IsPinned(size_t offset, size_t size, uint32_t slot) const {
+        if (!m_pinned) return false;
+        if ((slot + m_records.size() - m_pinFirst) % m_records.size() < m_pinCount) return true;
+
+        auto overlaps = [&](size_t begin, size_t end) { return offset < end && begin < offset + size; };
+        if (m_pinBegin < m_pinEnd) return overlaps(m_pinBegin, m_pinEnd);
+        return overlaps(m_pinBegin, m_bytes.size()) || overlaps(0, m_pinEnd);
+    }
+
+    void ReplayBuffer::DropOldestGop() {
+        if (m_gopCount > 1) {
+            uint32_t next = GetGop(1);
+            m_count -= (uint32_t)((next + m_records.size() - m_first) % m_records.size());
+            m_first = next;
+        } else {
+            m_count = 0;
+        }
+        m_gopFirst = (m_gopFirst + 1) % (uint32_t)m_gops.size();
+        m_gopCount--;
+        if (m_count == 0) m_head = 0;
+    }
+
+    void ReplayBuffer::Append(const ReplayPacket& packet) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_records.empty() || !packet.data || !packet.size) return;
+
+        bool startsGop = packet.keyframe && (m_gopCount == 0 || packet.pts != m_records[GetGop(m_gopCount - 1)].pts);
+        if (m_skipping && !startsGop) {
+            m_dropped++;
+            return;
+        }
+
+        // Room comes from the oldest GOPs; a GOP that fills the buffer on its own ends early instead
+        size_t offset = 0;
+        bool fits = FindSpace(packet.size, &offset);
+        while (!fits && m_gopCount > (startsGop ? 0u : 1u)) {
+            DropOldestGop();
+            fits = FindSpace(packet.size, &offset);
+        }
+
+        uint32_t slot = (m_first + m_count) % (uint32_t)m_records.size();
+        if (!fits || IsPinned(offset, packet.size, slot)) {
+            // The rest of this GOP would not decode without the packet
+            m_skipping = true;
+            m_dropped++;
+            return;
+        }
+
+        memcpy(m_bytes.data() + offset, packet.data, packet.size);
+        Record& record = m_records[slot];
+        record.stream = packet.stream;
+        record.pts = packet.pts;
+        record.dts = packet.dts;
+        record.duration = packet.duration;
+        record.keyframe = packet.keyframe;
+        record.offset = offset;
+        record.size = packet.size;
+        if (m_count == 0) m_first = slot;
+        m_count++;
+        m_head = offset + packet.size;
+
+        if (startsGop) {
+            m_gops[(m_gopFirst + m_gopCount) % m_gops.size()] = slot;
+            m_gopCount++;
+            m_skipping = false;
+        }
+
+        // Keep the newest GOP that starts at or before the window's edge, nothing older
+        while (m_gopCount > 1 && m_records[GetGop(1)].pts <= packet.pts - m_window) DropOldestGop();
+    }
+
+    bool ReplayBuffer::Pin(uint32_t* count) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pinned || m_count == 0) return false;
+
+        m_pinned = true;
+        m_pinFirst = m_first;
+        m_pinCount = m_count;
+        m_pinBegin = m_records[m_first].offset;
+        m_pinEnd = m_head;
+        *count = m_count;
+        return true;
+    }
+
+    ReplayPacket ReplayBuffer::GetPinned(uint32_t index) const {
+        // Pinned records and bytes are not written until Unpin
+        const Record& record = m_records[(m_pinFirst + index) % m_records.size()];
+        ReplayPacket packet;
+        packet.stream = record.stream;
+        packet.pts = record.pts;
+        packet.dts = record.dts;
+        packet.duration = record.duration;
+        packet.keyframe = record.keyframe;
+        packet.data = m_bytes.data() + record.offset;
+        packet.size = record.size;
+        return packet;
+    }
+
+    void ReplayBuffer::Unpin() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pinned = false;
+    }
+
+    ReplayStats ReplayBuffer::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ReplayStats stats;
+        stats.packets = m_count;
+        stats.dropped = m_dropped;
+        if (m_count == 0) return stats;
+
+        const Record& oldest = m_records[m_first];
+        const Record& newest = m_records[(m_first + m_count - 1) % m_records.size()];
+        stats.duration = newest.pts - oldest.pts;
+        stats.bytes = m_head > oldest.offset ? m_head - oldest.offset : m_bytes.size() - oldest.offset + m_head;
+        return stats;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Video {
+    // One encoded packet of a track, timestamps in the codec time base
+    struct ReplayPacket {
+        uint32_t stream = 0;
+        int64_t pts = 0;
+        int64_t dts = 0;
+        int64_t duration = 0;
+        bool keyframe = false;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct ReplayStats {
+        int64_t duration = 0;   // Time base units from the oldest packet to the newest
+        size_t bytes = 0;
+        uint32_t packets = 0;
+        uint64_t dropped = 0;   // New packets not kept: no room beside a pinned window, or waiting for a keyframe
+    };
+
+    // The last stretch of the encoded tracks, kept whole GOPs at a time: packet bytes in one preallocated ring, their
+    // records in another, and the GOP starts in a third, so the oldest GOP goes in O(1) and nothing is allocated after
+    // Reset. A GOP starts at the first keyframe of a new timestamp; the other tracks' keyframes of that frame join it.
+    //
+    // A reader pins the buffered packets and reads them without the lock while new ones keep arriving. New packets never
+    // overwrite pinned ones: when the only room left is pinned, they are dropped up to the next keyframe, so the writer
+    // never waits for the reader.
+    class ReplayBuffer {
+    public:
+        // capacity bytes of packet data and at most maxPackets packets, keeping at least window time base units
+        void Reset(size_t capacity, uint32_t maxPackets, int64_t window);
+        // Frees the memory (not while pinned)
+        void Release();
+
+        void Append(const ReplayPacket& packet);
+
+        // Pins the buffered packets for reading; false when empty or already pinned
+        bool Pin(uint32_t* count);
+        // Pinned packet index, oldest first; data stays valid until Unpin
+        ReplayPacket GetPinned(uint32_t index) const;
+        void Unpin();
+
+        ReplayStats GetStats() const;
+
+    private:
+        struct Record {
+            uint32_t stream = 0;
+            int64_t pts = 0;
+            int64_t dts = 0;
+            int64_t duration = 0;
+            bool keyframe = false;
+            size_t offset = 0;
+            size_t size = 0;
+        };
+
+        // Where size bytes fit after the newest packet without touching the live ones
+        bool FindSpace(size_t size, size_t* offset) const;
+        bool IsPinned(size_t offset, size_t size, uint32_t slot) const;
+        void DropOldestGop();
+        uint32_t GetGop(uint32_t index) const { return m_gops[(m_gopFirst + index) % m_gops.size()]; }
+
+        mutable std::mutex m_mutex;
+        std::vector<uint8_t> m_bytes;
+        size_t m_head = 0;            // Where the next packet's bytes go
+
+        std::vector<Record> m_records;
+        uint32_t m_first = 0;         // Oldest record
+        uint32_t m_count = 0;
+
+        std::vector<uint32_t> m_gops; // Records starting a GOP, oldest at m_gopFirst
+        uint32_t m_gopFirst = 0;
+        uint32_t m_gopCount = 0;
+
+        int64_t m_window = 0;
+        bool m_skipping = true;       // Waiting for a keyframe after Reset or a dropped packet
+        uint64_t m_dropped = 0;
+
+        // Read by the reader without the lock while pinned
+        bool m_pinned = false;
+        uint32_t m_pinFirst = 0;
+        uint32_t m_pinCount = 0;
+        size_t m_pinBegin = 0;        // Pinned bytes, wrapping past the end when m_pinEnd <= m_pinBegin
+        size_t m_pinEnd = 0;
+    };
+}
@@ -0,0 +1,149 @@
+#include "SoftwareBackend.h"
+#include "../Core/Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Video {
+    namespace {
+        struct CodecInfo {
+            const char* name;
+            const char* preset; // Fast enough for realtime 4K and up on a desktop CPU
+        };
+
+        const CodecInfo kCodecs[] = {
+            { "libx264", "veryfast" },
+            { "libx265", "ultrafast" },
+            { "libsvtav1", "10" },
+        };
+
+        bool SupportsFormat(const AVCodec* codec, AVPixelFormat format) {
+            const AVPixelFormat* formats = nullptr;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+            int count = 0;
+            if (avcodec_get_supported_config(nullptr, codec, AV_CODEC_CONFIG_PIX_FORMAT, 0, (const void**)&formats, &count) < 0) return false;
+#else
+            formats = codec->pix_fmts;
+#endif
+            if (!formats) return true; // Unknown: anything goes
+            for (; *formats != AV_PIX_FMT_NONE; ++formats) {
+                if (*formats == format) return true;
+            }
+            return false;
+        }
+    }
+
+    SoftwareBackend::SoftwareBackend(SoftwareCodec codec, const std::string& preset) : m_preferred(codec), m_preset(preset) {}
+
+    SoftwareBackend::~SoftwareBackend() {
+        Finish();
+    }
+
+    const AVCodec* SoftwareBackend::OpenInput(const EncoderConfig& config) {
+        m_format = config.format;
+        m_width = config.width;
+        m_height = config.height;
+        m_inputFormat = config.format == PixelFormat::P010 ? AV_PIX_FMT_P010LE : AV_PIX_FMT_NV12;
+        AVPixelFormat planar = config.format == PixelFormat::P010 ? AV_PIX_FMT_YUV420P10LE : AV_PIX_FMT_YUV420P;
+
+        // Preferred codec first, then the rest; skip what the build lacks or what can't take this bit depth
+        int order[] = { (int)m_preferred, 0, 1, 2 };
+        for (int index : order) {
+            const AVCodec* codec = avcodec_find_encoder_by_name(kCodecs[index].name);
+            if (!codec) continue;
+
+            if (SupportsFormat(codec, m_inputFormat)) m_encodeFormat = m_inputFormat;
+            else if (SupportsFormat(codec, planar)) m_encodeFormat = planar;
+            else continue;
+
+            if (index != (int)m_preferred) LOG_WARNING(kCodecs[(int)m_preferred].name, " unavailable, using ", codec->name);
+            m_codec = codec;
+            break;
+        }
+        if (!m_codec) throw std::runtime_error("No software encoder found!");
+
+        if (m_encodeFormat != m_inputFormat) {
+            // Deinterleaving the chroma plane is a plain unscaled conversion
+            m_scaler = sws_getContext(m_width, m_height, m_inputFormat, m_width, m_height, m_encodeFormat, SWS_POINT, nullptr, nullptr, nullptr);
+            m_converted = av_frame_alloc();
+            if (!m_scaler || !m_converted) throw std::runtime_error("Failed to create the format converter");
+            m_converted->format = m_encodeFormat;
+            m_converted->width = m_width;
+            m_converted->height = m_height;
+            if (av_frame_get_buffer(m_converted, 0) < 0) throw std::runtime_error("Failed to allocate the converted frame");
+        }
+        return m_codec;
+    }
+
+    void SoftwareBackend::ConfigureCodec(AVCodecContext* codecCtx, uint32_t /*tile*/, AVDictionary** options) {
+        codecCtx->pix_fmt = m_encodeFormat;
+
+        // One thread per core, frames in flight as well as slices within a frame; tiles split the cores between them
+        uint32_t tiles = (uint32_t)GetTiles().size();
+        codecCtx->thread_count = tiles > 1 ? (int)std::max(1u, std::thread::hardware_concurrency() / tiles) : 0;
+        codecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+        // Tracks only line up at keyframes every tile has; scene cuts would place extra ones per tile
+        if (tiles > 1) {
+            if (strcmp(m_codec->name, "libx264") == 0) av_dict_set(options, "x264-params", "scenecut=0", 0);
+            else if (strcmp(m_codec->name, "libx265") == 0) av_dict_set(options, "x265-params", "scenecut=0", 0);
+            else if (strcmp(m_codec->name, "libsvtav1") == 0) av_dict_set(options, "svtav1-params", "scd=0", 0);
+        }
+
+        const char* preset = kCodecs[(int)m_preferred].preset;
+        for (const CodecInfo& info : kCodecs) {
+            if (strcmp(info.name, m_codec->name) == 0) preset = info.preset;
+        }
+        av_dict_set(options, "preset", m_preset.empty() ? preset : m_preset.c_str(), 0);
+    }
+
+    void SoftwareBackend::CloseInput() {
+        sws_freeContext(m_scaler);
+        m_scaler = nullptr;
+        av_frame_free(&m_converted);
+        m_codec = nullptr;
+    }
+
+    bool SoftwareBackend::PrepareFrame(AVFrame* frame) {
+        // Allocated on first use; afterwards only copied when the encoder still references the previous contents
+        if (!frame->buf[0]) {
+            frame->format = m_inputFormat;
+            frame->width = m_width;
+            frame->height = m_height;
+            return av_frame_get_buffer(frame, 0) >= 0;
+        }
+        return av_frame_make_writable(frame) >= 0;
+    }
+
+    void SoftwareBackend::DescribeFrame(AVFrame* frame, FrameDesc* desc) {
+        desc->format = m_format;
+        desc->width = m_width;
+        desc->height = m_height;
+        for (int plane = 0; plane < 2; ++plane) {
+            desc->planes[plane] = frame->data[plane];
+            desc->strides[plane] = (size_t)frame->linesize[plane];
+        }
+        desc->surface = nullptr;
+        desc->subresource = 0;
+    }
+
+    bool SoftwareBackend::CopyFrame(const FrameDesc& source, const FrameDesc& target) {
+        if (source.IsHardware() || source.format != target.format || source.width != target.width || source.height != target.height) return false;
+        if (!source.planes[0] || !source.planes[1]) return false;
+
+        // Both planes are width samples wide: full-resolution luma, half-resolution interleaved chroma pairs
+        int rowBytes = source.width * (source.format == PixelFormat::P010 ? 2 : 1);
+        av_image_copy_plane(target.planes[0], (int)target.strides[0], source.planes[0], (int)source.strides[0], rowBytes, source.height);
+        av_image_copy_plane(target.planes[1], (int)target.strides[1], source.planes[1], (int)source.strides[1], rowBytes, (source.height + 1) / 2);
+        return true;
+    }
+
+    AVFrame* SoftwareBackend::ConvertFrame(AVFrame* frame) {
+        if (!m_scaler) return frame;
+        if (av_frame_make_writable(m_converted) < 0) return nullptr;
+
+        sws_scale(m_scaler, frame->data, frame->linesize, 0, m_height, m_converted->data, m_converted->linesize);
+        m_converted->pts = frame->pts;
+        return m_converted;
+    }
+}
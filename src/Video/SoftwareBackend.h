@@ -0,0 +1,49 @@
+#pragma once
+#include "FFmpegEncoder.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 4244)
+#endif
+extern "C" {
+#include <libswscale/swscale.h>
+}
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace Video {
+    // CPU encoding (libx264, libx265, SVT-AV1) from NV12/P010 planes, with the encoder's frame and slice threading.
+    // Needs no device: the fallback without NVENC/AMF, and the same pipeline on any platform FFmpeg builds on.
+    class SoftwareBackend : public FFmpegEncoder {
+    public:
+        // The preferred codec is tried first, then the others in enum order. An empty preset uses a realtime default.
+        explicit SoftwareBackend(SoftwareCodec codec = SoftwareCodec::X264, const std::string& preset = std::string());
+        ~SoftwareBackend() override;
+
+    protected:
+        const AVCodec* OpenInput(const EncoderConfig& config) override;
+        void ConfigureCodec(AVCodecContext* codecCtx, uint32_t tile, AVDictionary** options) override;
+        void CloseInput() override;
+        bool PrepareFrame(AVFrame* frame) override;
+        void DescribeFrame(AVFrame* frame, FrameDesc* desc) override;
+        bool CopyFrame(const FrameDesc& source, const FrameDesc& target) override;
+        AVFrame* ConvertFrame(AVFrame* frame) override;
+        void RecycleFrame(AVFrame* /*frame*/) override {} // Slots keep their planes for the next frame
+
+    private:
+        SoftwareCodec m_preferred;
+        std::string m_preset;
+
+        const AVCodec* m_codec = nullptr;
+        PixelFormat m_format = PixelFormat::NV12;
+        AVPixelFormat m_inputFormat = AV_PIX_FMT_NONE;  // Layout of the queue slots (NV12 or P010)
+        AVPixelFormat m_encodeFormat = AV_PIX_FMT_NONE; // What the codec takes; planar when it has no semi-planar input
+        int m_width = 0;
+        int m_height = 0;
+
+        // Encoding thread: semi-planar to planar for codecs without NV12/P010 input
+        SwsContext* m_scaler = nullptr;
+        AVFrame* m_converted = nullptr;
+    };
+}
@@ -2,6 +2,7 @@
 #include <reshade.hpp>
 #include "Core/Logger.h"
 #include "Graphics/CubemapManager.h"
+#include "Graphics/BindingTracker.h"
 
 // Global Manager
 static std::unique_ptr<Graphics::CubemapManager> g_CubemapManager;
@@ -42,6 +43,13 @@ static void on_present(reshade::api::command_queue* queue, reshade::api::swapcha
     }
 }
 
+static void on_reshade_present(reshade::api::effect_runtime* runtime)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnReShadePresent(runtime);
+    }
+}
+
 static void on_draw(reshade::api::command_list* cmd_list, uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
 {
     if (g_CubemapManager) {
@@ -70,6 +78,27 @@ static void on_map_buffer_region(reshade::api::device* device, reshade::api::res
     }
 }
 
+static void on_destroy_resource(reshade::api::device* /*device*/, reshade::api::resource resource)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnDestroyResource(resource);
+    }
+}
+
+static void on_init_pipeline(reshade::api::device* /*device*/, reshade::api::pipeline_layout /*layout*/, uint32_t subobject_count, const reshade::api::pipeline_subobject* subobjects, reshade::api::pipeline pipeline)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnInitPipeline(pipeline, subobject_count, subobjects);
+    }
+}
+
+static void on_destroy_pipeline(reshade::api::device* /*device*/, reshade::api::pipeline pipeline)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnDestroyPipeline(pipeline);
+    }
+}
+
 static void on_bind_pipeline(reshade::api::command_list* cmd_list, reshade::api::pipeline_stage stages, reshade::api::pipeline pipeline)
 {
     if (g_CubemapManager) {
@@ -77,6 +106,76 @@ static void on_bind_pipeline(reshade::api::command_list* cmd_list, reshade::api:
     }
 }
 
+static void on_push_descriptors(reshade::api::command_list* cmd_list, reshade::api::shader_stage stages, reshade::api::pipeline_layout /*layout*/, uint32_t /*layout_param*/, const reshade::api::descriptor_table_update& update)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnPushDescriptors(cmd_list, stages, update);
+    }
+}
+
+static void on_bind_descriptor_tables(reshade::api::command_list* cmd_list, reshade::api::shader_stage stages, reshade::api::pipeline_layout /*layout*/, uint32_t /*first*/, uint32_t /*count*/, const reshade::api::descriptor_table* /*tables*/)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnBindDescriptorTables(cmd_list, stages);
+    }
+}
+
+static void on_bind_render_targets_and_depth_stencil(reshade::api::command_list* cmd_list, uint32_t /*count*/, const reshade::api::resource_view* /*rtvs*/, reshade::api::resource_view dsv)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnBindRenderTargets(cmd_list, dsv);
+    }
+}
+
+static void on_bind_vertex_buffers(reshade::api::command_list* cmd_list, uint32_t /*first*/, uint32_t /*count*/, const reshade::api::resource* /*buffers*/, const uint64_t* /*offsets*/, const uint32_t* /*strides*/)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnBindState(cmd_list);
+    }
+}
+
+static void on_bind_index_buffer(reshade::api::command_list* cmd_list, reshade::api::resource /*buffer*/, uint64_t /*offset*/, uint32_t /*index_size*/)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnBindState(cmd_list);
+    }
+}
+
+static void on_bind_pipeline_states(reshade::api::command_list* cmd_list, uint32_t /*count*/, const reshade::api::dynamic_state* /*states*/, const uint32_t* /*values*/)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnBindState(cmd_list);
+    }
+}
+
+static void on_reset_command_list(reshade::api::command_list* cmd_list)
+{
+    if (g_CubemapManager) {
+        g_CubemapManager->OnResetCommandList(cmd_list);
+    }
+}
+
+static void on_execute_secondary_command_list(reshade::api::command_list* cmd_list, reshade::api::command_list* /*secondary_cmd_list*/)
+{
+    // ExecuteCommandList may clear or replace the executing context's bindings
+    if (g_CubemapManager) {
+        g_CubemapManager->OnResetCommandList(cmd_list);
+    }
+}
+
+static void on_destroy_command_list(reshade::api::command_list* cmd_list)
+{
+    // Freed even without a manager, the shadow tables outlive it
+    Graphics::CommandListBindings::Destroy(cmd_list);
+}
+
+static void on_destroy_command_queue(reshade::api::command_queue* queue)
+{
+    if (reshade::api::command_list* immediate = queue->get_immediate_command_list()) {
+        Graphics::CommandListBindings::Destroy(immediate);
+    }
+}
+
 // Addon Entry Point
 extern "C" __declspec(dllexport) const char* reshade_addon_name = "WideCapture";
 extern "C" __declspec(dllexport) const char* reshade_addon_description = "Captures 360 video from DX11 games.";
@@ -94,13 +193,27 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
         reshade::register_event<reshade::addon_event::init_swapchain>(on_init_swapchain);
         reshade::register_event<reshade::addon_event::destroy_swapchain>(on_destroy_swapchain);
         reshade::register_event<reshade::addon_event::present>(on_present);
+        reshade::register_event<reshade::addon_event::reshade_present>(on_reshade_present);
 
         // Capture Logic Events
         reshade::register_event<reshade::addon_event::draw>(on_draw);
         reshade::register_event<reshade::addon_event::draw_indexed>(on_draw_indexed);
         reshade::register_event<reshade::addon_event::update_buffer_region>(on_update_buffer_region);
         reshade::register_event<reshade::addon_event::map_buffer_region>(on_map_buffer_region);
+        reshade::register_event<reshade::addon_event::destroy_resource>(on_destroy_resource);
+        reshade::register_event<reshade::addon_event::init_pipeline>(on_init_pipeline);
+        reshade::register_event<reshade::addon_event::destroy_pipeline>(on_destroy_pipeline);
         reshade::register_event<reshade::addon_event::bind_pipeline>(on_bind_pipeline);
+        reshade::register_event<reshade::addon_event::push_descriptors>(on_push_descriptors);
+        reshade::register_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables);
+        reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(on_bind_render_targets_and_depth_stencil);
+        reshade::register_event<reshade::addon_event::bind_vertex_buffers>(on_bind_vertex_buffers);
+        reshade::register_event<reshade::addon_event::bind_index_buffer>(on_bind_index_buffer);
+        reshade::register_event<reshade::addon_event::bind_pipeline_states>(on_bind_pipeline_states);
+        reshade::register_event<reshade::addon_event::reset_command_list>(on_reset_command_list);
+        reshade::register_event<reshade::addon_event::execute_secondary_command_list>(on_execute_secondary_command_list);
+        reshade::register_event<reshade::addon_event::destroy_command_list>(on_destroy_command_list);
+        reshade::register_event<reshade::addon_event::destroy_command_queue>(on_destroy_command_queue);
 
         break;
     case DLL_PROCESS_DETACH:
@@ -6,10 +6,6 @@
 #include <dxgi.h>
 #include <d3dcompiler.h>
 
-// Force SSE2 for DirectXMath
-// #include <xmmintrin.h>
-// #include <smmintrin.h>
-#define _XM_NO_INTRINSICS_
 #include <DirectXMath.h>
 #include <wrl/client.h>
 
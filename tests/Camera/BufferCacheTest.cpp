@@ -0,0 +1,34 @@
+#include "Camera/BufferCache.h"
+#include <gtest/gtest.h>
+
+using Camera::BufferCache;
+using Camera::ConstantBufferState;
+
+TEST(BufferCache, CameraEntriesAgeOutWhenUnreferenced) {
+    BufferCache cache(BufferCache::kDefaultBudgetBytes, 4);
+    for (uint64_t handle = 1; handle <= 4; ++handle) {
+        ConstantBufferState* state = cache.FindOrInsert(handle);
+        ASSERT_NE(state, nullptr);
+        state->isCamera = true;
+    }
+
+    // A pool full of camera entries still admits new buffers
+    for (uint64_t handle = 5; handle <= 12; ++handle) ASSERT_NE(cache.FindOrInsert(handle), nullptr) << handle;
+    EXPECT_EQ(cache.GetStats().entries, 4u);
+    EXPECT_EQ(cache.GetStats().evictions, 8u);
+    for (uint64_t handle = 1; handle <= 4; ++handle) EXPECT_EQ(cache.Find(handle), nullptr) << handle;
+}
+
+TEST(BufferCache, PayloadBudgetEvictsOlderCameraEntries) {
+    // Minimum budget: 64 KB payloads soon need room taken from earlier camera entries, never from the one allocating
+    BufferCache cache(0, 64);
+    for (uint64_t handle = 1; handle <= 64; ++handle) {
+        ConstantBufferState* state = cache.FindOrInsert(handle);
+        ASSERT_TRUE(cache.AllocatePayload(*state, BufferCache::kMaxPayloadBytes)) << handle;
+        ASSERT_NE(state->data, nullptr);
+        state->isCamera = true;
+        EXPECT_EQ(cache.Find(handle), state);
+    }
+    EXPECT_GT(cache.GetStats().evictions, 0u);
+    EXPECT_LT(cache.GetStats().entries, 64u);
+}
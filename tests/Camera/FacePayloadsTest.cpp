@@ -0,0 +1,154 @@
+#include "Camera/FacePayloads.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+using namespace Camera;
+
+namespace {
+    // 320-byte camera buffer: row-major view at float 0, projection at float 16 and a marker constant at float 40
+    std::vector<float> CameraBuffer(float eyeZ) {
+        std::vector<float> data(80, 0.0f);
+        data[0] = data[5] = data[10] = 1.0f;
+        data[12] = 3.0f;
+        data[14] = eyeZ;
+        data[15] = 1.0f;
+        data[16] = 1.2f;
+        data[21] = 2.1f;
+        data[26] = 1.0001f;
+        data[27] = 1.0f;
+        data[30] = -0.1f;
+        data[40] = 123.0f;
+        return data;
+    }
+
+    constexpr uint64_t kCameraHandle = 0x1000;
+
+    void Update(CameraController& controller, const std::vector<float>& data, uint64_t handle = kCameraHandle) {
+        controller.OnUpdateBuffer(handle, data.data(), data.size() * sizeof(float));
+    }
+}
+
+TEST(FacePayloads, NothingToBuildWithoutCamera) {
+    CameraController controller;
+    FacePayloads payloads;
+    EXPECT_FALSE(payloads.Refresh(controller));
+    EXPECT_EQ(payloads.GetGeneration(), 0u);
+}
+
+TEST(FacePayloads, FacesPatchMatricesAndKeepOtherConstants) {
+    CameraController controller;
+    FacePayloads payloads;
+    Update(controller, CameraBuffer(5.0f));
+    ASSERT_TRUE(payloads.Refresh(controller));
+
+    EXPECT_EQ(payloads.GetGeneration(), controller.GetSnapshot().version);
+    EXPECT_EQ(payloads.GetSize(), 320u);
+    EXPECT_EQ(payloads.GetStride(), 512u);
+    EXPECT_EQ((uintptr_t)payloads.GetData() % FacePayloads::kAlignment, 0u);
+
+    for (uint32_t i = 0; i < FacePayloads::kFaceCount; ++i) {
+        const float* face = (const float*)payloads.GetFace((CubeFace)i);
+        EXPECT_EQ(face[40], 123.0f) << i;
+        EXPECT_NEAR(face[16], 1.0f, 1e-5f) << i; // 90 degree projection, square aspect
+        EXPECT_NEAR(face[21], 1.0f, 1e-5f) << i;
+        EXPECT_EQ(face[15], 1.0f) << i;
+        if (i > 0) {
+            const float* first = (const float*)payloads.GetFace((CubeFace)0);
+            EXPECT_NE(memcmp(face, first, 16 * sizeof(float)), 0) << "face " << i << " has face 0's view";
+        }
+    }
+}
+
+TEST(FacePayloads, RebuiltOnlyWhenGenerationChanges) {
+    CameraController controller;
+    FacePayloads payloads;
+    Update(controller, CameraBuffer(5.0f));
+    ASSERT_TRUE(payloads.Refresh(controller));
+    uint64_t generation = payloads.GetGeneration();
+    EXPECT_EQ(payloads.GetRebuildCount(), 1u);
+
+    // Identical contents publish nothing new
+    Update(controller, CameraBuffer(5.0f));
+    ASSERT_TRUE(payloads.Refresh(controller));
+    EXPECT_EQ(payloads.GetGeneration(), generation);
+    EXPECT_EQ(payloads.GetRebuildCount(), 1u);
+
+    Update(controller, CameraBuffer(6.0f));
+    ASSERT_TRUE(payloads.Refresh(controller));
+    EXPECT_GT(payloads.GetGeneration(), generation);
+    EXPECT_EQ(payloads.GetRebuildCount(), 2u);
+
+    // A different face mask needs faces that were skipped before
+    payloads.SetActiveFaces(1u << (uint32_t)CubeFace::Front);
+    EXPECT_EQ(payloads.GetGeneration(), 0u);
+    ASSERT_TRUE(payloads.Refresh(controller));
+    EXPECT_EQ(payloads.GetRebuildCount(), 3u);
+}
+
+TEST(FacePayloads, OneRebuildPerCameraVersionAcrossAFrameOfDraws) {
+    // Each frame the game uploads its camera once, then issues many draws; some re-upload the same camera and
+    // others update unrelated buffers. Every draw refreshes, and only the first draw after a new camera rebuilds.
+    const int kFrames = 8;
+    const int kDrawsPerFrame = 500;
+    CameraController controller;
+    FacePayloads payloads;
+    std::vector<float> material(32, 0.5f);
+
+    for (int frame = 0; frame < kFrames; ++frame) {
+        float eyeZ = 5.0f + frame;
+        Update(controller, CameraBuffer(eyeZ));
+        uint64_t version = controller.GetSnapshot().version;
+
+        for (int draw = 0; draw < kDrawsPerFrame; ++draw) {
+            if (draw % 7 == 0) Update(controller, CameraBuffer(eyeZ));
+            if (draw % 3 == 0) {
+                material[0] = (float)draw;
+                Update(controller, material, 0x2000 + (uint64_t)(draw % 5) * 0x40);
+            }
+            ASSERT_TRUE(payloads.Refresh(controller));
+            ASSERT_EQ(payloads.GetGeneration(), version) << "frame " << frame << " draw " << draw;
+            ASSERT_EQ(payloads.GetRebuildCount(), (uint64_t)frame + 1) << "frame " << frame << " draw " << draw;
+        }
+        EXPECT_EQ(controller.GetSnapshot().version, version) << "frame " << frame;
+    }
+}
+
+TEST(FacePayloads, FrontFaceOfAMatchingCameraIsTheIdentityClipTransform) {
+    // A left-handed camera at the origin looking down +Z with a square 90 degree projection already is the front face
+    std::vector<float> data(64, 0.0f);
+    data[0] = data[5] = data[10] = data[15] = 1.0f;
+    float range = 1000.0f / (1000.0f - 0.1f);
+    data[16] = data[21] = 1.0f;
+    data[26] = range;
+    data[27] = 1.0f;
+    data[30] = -range * 0.1f;
+
+    CameraController controller;
+    FacePayloads payloads;
+    Update(controller, data);
+    ASSERT_TRUE(payloads.Refresh(controller));
+    ASSERT_TRUE(payloads.HasFaceClipTransforms());
+
+    const Float4x4& front = payloads.GetFaceClipTransforms()[(uint32_t)CubeFace::Front];
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) EXPECT_NEAR(front.m[r][c], r == c ? 1.0f : 0.0f, 1e-4f) << r << "," << c;
+    }
+
+    // The right face looks down +X: a point ahead on +X lands in the middle of its clip space
+    const Float4x4& right = payloads.GetFaceClipTransforms()[(uint32_t)CubeFace::Right];
+    Float4x4 view = controller.GetViewMatrixForFace(CubeFace::Right);
+    const float world[4] = { 10.0f, 0.0f, 0.0f, 1.0f };
+    float viewSpace[4] = {};
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) viewSpace[c] += world[r] * view.m[r][c];
+    }
+    EXPECT_NEAR(viewSpace[0], 0.0f, 1e-4f);
+    EXPECT_NEAR(viewSpace[1], 0.0f, 1e-4f);
+    EXPECT_NEAR(viewSpace[2], 10.0f, 1e-4f);
+
+    // Game clip x (straight right) is the right face's depth: it feeds w, never x or y
+    EXPECT_NEAR(right.m[0][0], 0.0f, 1e-4f);
+    EXPECT_NEAR(right.m[0][1], 0.0f, 1e-4f);
+    EXPECT_NEAR(right.m[0][3], 1.0f, 1e-4f);
+}
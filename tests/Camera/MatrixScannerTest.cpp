@@ -0,0 +1,127 @@
+#include "Camera/MatrixScanner.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <vector>
+
+using Camera::MatrixScanner;
+
+namespace {
+    // Values clustered around the predicates' thresholds (0, +-1, +-epsilon) plus NaN and infinities
+    float RandomValue(std::mt19937& rng) {
+        const float eps = 0.1f;
+        const float special[] = {
+            0.0f, -0.0f, 1.0f, -1.0f, eps, -eps,
+            std::nextafter(eps, 0.0f), std::nextafter(eps, 1.0f),
+            1.0f + eps, 1.0f - eps, std::nextafter(1.0f + eps, 0.0f), std::nextafter(1.0f - eps, 2.0f),
+            -1.0f - eps, std::nextafter(-1.0f - eps, 0.0f),
+            std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        };
+        std::uniform_int_distribution<int> pick(0, 3);
+        if (pick(rng) == 0) return std::uniform_real_distribution<float>(-10.0f, 10.0f)(rng);
+        return special[std::uniform_int_distribution<size_t>(0, std::size(special) - 1)(rng)];
+    }
+
+    // Writes a matrix that one of the predicates accepts (row-major view, transposed view or projection)
+    void PlantMatrix(std::mt19937& rng, float* m) {
+        std::uniform_real_distribution<float> any(-2.0f, 2.0f);
+        std::uniform_real_distribution<float> small(-0.05f, 0.05f);
+        for (int i = 0; i < 16; ++i) m[i] = any(rng);
+        switch (std::uniform_int_distribution<int>(0, 2)(rng)) {
+            case 0: m[3] = small(rng); m[7] = small(rng); m[11] = small(rng); m[15] = 1.0f + small(rng); break;
+            case 1: m[12] = small(rng); m[13] = small(rng); m[14] = small(rng); m[15] = 1.0f + small(rng); break;
+            default:
+                m[1] = m[2] = m[3] = 0.0f;
+                m[4] = m[6] = m[7] = 0.0f;
+                m[11] = (rng() & 1) ? 1.0f : -1.0f;
+                m[15] = 0.0f;
+                break;
+        }
+    }
+
+    // First 4-float grid offset in [begin, end) accepted by the scalar predicate, -1 if none
+    int ReferenceView(const float* data, size_t begin, size_t end, bool* transposed) {
+        for (size_t offset = (begin + 3) / 4 * 4; offset < end; offset += 4) {
+            if (MatrixScanner::IsViewMatrix(data + offset, transposed)) return (int)offset;
+        }
+        return -1;
+    }
+
+    int ReferenceProjection(const float* data, size_t begin, size_t end) {
+        for (size_t offset = (begin + 3) / 4 * 4; offset < end; offset += 4) {
+            if (MatrixScanner::IsProjectionMatrix(data + offset)) return (int)offset;
+        }
+        return -1;
+    }
+
+    std::vector<MatrixScanner::Path> SupportedPaths() {
+        std::vector<MatrixScanner::Path> paths = { MatrixScanner::Path::Scalar };
+        MatrixScanner::Path active = MatrixScanner::GetActivePath();
+        if (active == MatrixScanner::Path::SSE2 || active == MatrixScanner::Path::AVX2) paths.push_back(MatrixScanner::Path::SSE2);
+        if (active == MatrixScanner::Path::AVX2) paths.push_back(MatrixScanner::Path::AVX2);
+        return paths;
+    }
+}
+
+TEST(MatrixScanner, PathsMatchScalarPredicatesOnRandomBuffers) {
+    std::mt19937 rng(1234);
+    std::vector<MatrixScanner::Path> paths = SupportedPaths();
+
+    for (int iteration = 0; iteration < 4000; ++iteration) {
+        // Long enough to cross the scanner's 256-block chunks, with the 16 readable floats it needs past the end
+        size_t end = std::uniform_int_distribution<size_t>(0, 2400)(rng);
+        size_t begin = std::uniform_int_distribution<size_t>(0, end)(rng);
+        std::vector<float> data(end + 16);
+        for (float& value : data) value = RandomValue(rng);
+
+        int planted = std::uniform_int_distribution<int>(0, 3)(rng);
+        for (int i = 0; i < planted && end >= 4; ++i) {
+            size_t offset = std::uniform_int_distribution<size_t>(0, (end - 1) / 4)(rng) * 4;
+            PlantMatrix(rng, data.data() + offset);
+        }
+
+        bool expectedTransposed = false;
+        int expectedView = ReferenceView(data.data(), begin, end, &expectedTransposed);
+        int expectedProjection = ReferenceProjection(data.data(), begin, end);
+
+        for (MatrixScanner::Path path : paths) {
+            SCOPED_TRACE(testing::Message() << MatrixScanner::GetPathName(path) << " iteration " << iteration << " [" << begin << ", " << end << ")");
+            bool transposed = false;
+            int view = MatrixScanner::FindViewMatrix(data.data(), begin, end, &transposed, path);
+            ASSERT_EQ(view, expectedView);
+            if (view >= 0) {
+                ASSERT_EQ(transposed, expectedTransposed);
+            }
+            ASSERT_EQ(MatrixScanner::FindProjectionMatrix(data.data(), begin, end, path), expectedProjection);
+        }
+    }
+}
+
+TEST(MatrixScanner, FindsMatrixInLastCandidateOfEveryChunkPosition) {
+    // A single view matrix at each grid offset in turn, exercising the tails of the 16/32-candidate vector loops
+    std::vector<MatrixScanner::Path> paths = SupportedPaths();
+    const size_t end = 1100;
+    for (size_t offset = 0; offset < end; offset += 4) {
+        std::vector<float> data(end + 16, 5.0f);
+        data[offset + 15] = 1.0f;
+        data[offset + 12] = data[offset + 13] = data[offset + 14] = 0.0f;
+
+        for (MatrixScanner::Path path : paths) {
+            bool transposed = false;
+            ASSERT_EQ(MatrixScanner::FindViewMatrix(data.data(), 0, end, &transposed, path), (int)offset) << MatrixScanner::GetPathName(path);
+            EXPECT_TRUE(transposed);
+        }
+    }
+}
+
+TEST(MatrixScanner, ActivePathIsUsedByDefault) {
+    std::vector<float> data(64, 3.0f);
+    data[32 + 3] = data[32 + 7] = data[32 + 11] = 0.0f;
+    data[32 + 15] = 1.0f;
+    bool transposed = true;
+    EXPECT_EQ(MatrixScanner::FindViewMatrix(data.data(), 0, 48, &transposed), 32);
+    EXPECT_FALSE(transposed);
+    EXPECT_EQ(MatrixScanner::FindProjectionMatrix(data.data(), 0, 48), -1);
+}
@@ -0,0 +1,129 @@
+#include "Compute/CpuProjector.h"
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using Compute::CpuProjector;
+using Compute::NV12Converter;
+using Compute::ProjectionLayout;
+using Compute::ProjectionLut;
+
+namespace {
+    // Six random RGBA8 faces; one is half rendered and one not rendered at all
+    struct Cube {
+        static constexpr uint32_t kFaceSize = 96;
+        std::vector<uint8_t> texels[6];
+        NV12Converter::CubeFaces faces;
+
+        explicit Cube(unsigned seed) {
+            std::mt19937 rng(seed);
+            const float scales[6] = { 1.0f, 1.0f, 0.5f, 1.0f, 0.75f, 0.0f };
+            faces.faceSize = kFaceSize;
+            faces.stride = kFaceSize * 4;
+            for (int i = 0; i < 6; ++i) {
+                texels[i].resize((size_t)kFaceSize * kFaceSize * 4);
+                for (uint8_t& texel : texels[i]) texel = (uint8_t)rng();
+                faces.faces[i] = texels[i].data();
+                faces.faceScale[i] = scales[i];
+            }
+        }
+    };
+
+    struct Planes {
+        std::vector<uint8_t> y, uv;
+        Planes(uint32_t width, uint32_t height) : y((size_t)width * height), uv((size_t)width * height / 2) {}
+    };
+
+    struct Layout {
+        ProjectionLayout layout;
+        uint32_t width, height; // Neither a multiple of the SIMD width nor of the band height
+    };
+
+    const Layout kLayouts[] = {
+        { ProjectionLayout::Equirect, 514, 258 },
+        { ProjectionLayout::Cube3x2, 390, 262 },
+        { ProjectionLayout::EAC3x2, 390, 262 },
+    };
+
+    std::vector<CpuProjector::Path> SupportedPaths() {
+        std::vector<CpuProjector::Path> paths = { CpuProjector::Path::Scalar };
+        if (CpuProjector::GetActivePath() != CpuProjector::Path::Scalar) paths.push_back(CpuProjector::Path::SSE2);
+        if (CpuProjector::GetActivePath() == CpuProjector::Path::AVX2) paths.push_back(CpuProjector::Path::AVX2);
+        return paths;
+    }
+}
+
+TEST(CpuProjector, EveryPathMatchesReferenceBitForBit) {
+    Cube cube(7);
+    for (const Layout& layout : kLayouts) {
+        ProjectionLut lut;
+        lut.Build(layout.layout, layout.width, layout.height, 6.2831853f);
+
+        Planes reference(layout.width, layout.height);
+        NV12Converter::ProjectCube(cube.faces, lut, reference.y.data(), layout.width, reference.uv.data(), layout.width);
+
+        for (uint32_t threads : { 1u, 4u }) {
+            CpuProjector projector(threads);
+            for (CpuProjector::Path path : SupportedPaths()) {
+                projector.SetPath(path);
+                ASSERT_EQ(projector.GetPath(), path);
+
+                Planes planes(layout.width, layout.height);
+                projector.ProjectToNV12(cube.faces, lut, planes.y.data(), layout.width, planes.uv.data(), layout.width);
+                EXPECT_EQ(planes.y, reference.y) << CpuProjector::GetPathName(path) << " layout " << (int)layout.layout << " threads " << threads;
+                EXPECT_EQ(planes.uv, reference.uv) << CpuProjector::GetPathName(path) << " layout " << (int)layout.layout << " threads " << threads;
+            }
+        }
+    }
+}
+
+TEST(CpuProjector, RGBAOutputConvertsToTheSameNV12) {
+    Cube cube(11);
+    CpuProjector projector(2);
+    for (const Layout& layout : kLayouts) {
+        ProjectionLut lut;
+        lut.Build(layout.layout, layout.width, layout.height, 6.2831853f);
+
+        Planes reference(layout.width, layout.height);
+        NV12Converter::ProjectCube(cube.faces, lut, reference.y.data(), layout.width, reference.uv.data(), layout.width);
+
+        for (CpuProjector::Path path : SupportedPaths()) {
+            projector.SetPath(path);
+            std::vector<uint8_t> rgba((size_t)layout.width * layout.height * 4);
+            projector.ProjectToRGBA(cube.faces, lut, rgba.data(), layout.width * 4);
+
+            // Quantized samples through the color stage alone give the full kernel's output
+            Planes planes(layout.width, layout.height);
+            NV12Converter::ConvertRGBA(rgba.data(), layout.width * 4, layout.width, layout.height, planes.y.data(), layout.width,
+                                       planes.uv.data(), layout.width);
+            EXPECT_EQ(planes.y, reference.y) << CpuProjector::GetPathName(path) << " layout " << (int)layout.layout;
+            EXPECT_EQ(planes.uv, reference.uv) << CpuProjector::GetPathName(path) << " layout " << (int)layout.layout;
+        }
+    }
+}
+
+TEST(CpuProjector, ColorStageEndpoints) {
+    EXPECT_EQ(NV12Converter::Luma(0, 0, 0), 0);
+    EXPECT_EQ(NV12Converter::Luma(255, 255, 255), 255);
+    uint8_t u, v;
+    NV12Converter::Chroma(4 * 255, 4 * 255, 4 * 255, &u, &v);
+    EXPECT_EQ(u, 128);
+    EXPECT_EQ(v, 128);
+    NV12Converter::Chroma(0, 0, 0, &u, &v);
+    EXPECT_EQ(u, 128);
+    EXPECT_EQ(v, 128);
+    EXPECT_EQ(NV12Converter::Quantize(0.0f), 0);
+    EXPECT_EQ(NV12Converter::Quantize(1.0f), 255);
+}
+
+TEST(CpuProjector, StatsCountFramesAndPixels) {
+    Cube cube(3);
+    ProjectionLut lut;
+    lut.Build(ProjectionLayout::EAC3x2, 390, 262, 0.0f);
+    Planes planes(390, 262);
+    CpuProjector projector(3);
+    for (int i = 0; i < 3; ++i) projector.ProjectToNV12(cube.faces, lut, planes.y.data(), 390, planes.uv.data(), 390);
+    EXPECT_EQ(projector.GetThreadCount(), 3u);
+    EXPECT_EQ(projector.GetStats().frames, 3u);
+    EXPECT_EQ(projector.GetStats().pixels, 3u * 390 * 262);
+}
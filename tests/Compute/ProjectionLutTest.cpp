@@ -0,0 +1,191 @@
+#include "Compute/ProjectionLut.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using Compute::ProjectionLayout;
+using Compute::ProjectionLut;
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+
+    struct Direction {
+        double x, y, z;
+    };
+
+    // Inverse of MapDirection: the unit direction through face coordinates (u, v)
+    Direction FaceDirection(int face, double u, double v) {
+        double s = u * 2.0 - 1.0, t = v * 2.0 - 1.0;
+        Direction d;
+        switch (face) {
+            case 0: d = { 1.0, -t, -s }; break;
+            case 1: d = { -1.0, -t, s }; break;
+            case 2: d = { s, 1.0, t }; break;
+            case 3: d = { s, -1.0, -t }; break;
+            case 4: d = { s, -t, 1.0 }; break;
+            default: d = { -s, -t, -1.0 }; break;
+        }
+        double length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+        return { d.x / length, d.y / length, d.z / length };
+    }
+
+    // atan2 of the cross and dot products stays accurate for tiny angles, unlike acos of the dot product
+    double Angle(const Direction& a, const Direction& b) {
+        double cx = a.y * b.z - a.z * b.y, cy = a.z * b.x - a.x * b.z, cz = a.x * b.y - a.y * b.x;
+        return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), a.x * b.x + a.y * b.y + a.z * b.z);
+    }
+
+    // Largest angle one quantization step of a face coordinate can span (at the face center, where it is widest)
+    const double kQuantizationAngle = std::atan(2.0 / ProjectionLut::kCoordMax);
+}
+
+TEST(ProjectionLut, EquirectRoundTrip) {
+    const uint32_t width = 512, height = 256;
+    for (double span : { 2.0 * kPi, kPi }) {
+        for (uint32_t y = 1; y < height; ++y) { // Row 0 is the pole, where longitude is undefined
+            for (uint32_t x = 0; x < width; ++x) {
+                double u, v;
+                int face = ProjectionLut::MapPixel(ProjectionLayout::Equirect, x, y, width, height, span, &u, &v);
+                ASSERT_GE(face, 0);
+                ASSERT_LT(face, 6);
+                Direction d = FaceDirection(face, u, v);
+
+                // Direction back to the pixel corner it was sampled at
+                double theta = std::atan2(d.x, d.z);
+                double phi = std::asin(d.y);
+                double outX = (theta / span + 0.5) * width;
+                double outY = (phi + kPi / 2.0) / kPi * height;
+                double dx = std::fabs(outX - x);
+                if (span == 2.0 * kPi) dx = std::fmin(dx, std::fabs(dx - width)); // theta = -PI and PI are one column
+                ASSERT_LT(dx, 1e-6) << span << " " << x << "," << y;
+                ASSERT_LT(std::fabs(outY - y), 1e-6) << span << " " << x << "," << y;
+
+                // And through MapDirection to the same point on the cube (on a face edge either face may be picked)
+                double u2, v2;
+                int face2 = ProjectionLut::MapDirection(d.x, d.y, d.z, &u2, &v2);
+                ASSERT_LT(Angle(FaceDirection(face2, u2, v2), d), 1e-9) << span << " " << x << "," << y;
+            }
+        }
+    }
+}
+
+TEST(ProjectionLut, CubeLayoutsRoundTrip) {
+    const uint32_t width = 384, height = 256;
+    for (ProjectionLayout layout : { ProjectionLayout::Cube3x2, ProjectionLayout::EAC3x2 }) {
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                double u, v;
+                int face = ProjectionLut::MapPixel(layout, x, y, width, height, 0.0, &u, &v);
+                ASSERT_EQ(face, (int)((y / (height / 2)) * 3 + x / (width / 3)));
+
+                // pixel -> face -> direction -> face -> pixel center
+                Direction d = FaceDirection(face, u, v);
+                double u2, v2;
+                ASSERT_EQ(ProjectionLut::MapDirection(d.x, d.y, d.z, &u2, &v2), face) << x << "," << y;
+                double outX, outY;
+                ProjectionLut::MapFace(layout, face, u2, v2, width, height, &outX, &outY);
+                ASSERT_NEAR(outX, x + 0.5, 1e-6) << (int)layout << " " << x << "," << y;
+                ASSERT_NEAR(outY, y + 0.5, 1e-6) << (int)layout << " " << x << "," << y;
+            }
+        }
+    }
+}
+
+TEST(ProjectionLut, TileCentersFaceTheirAxes) {
+    const Direction axes[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (ProjectionLayout layout : { ProjectionLayout::Cube3x2, ProjectionLayout::EAC3x2 }) {
+        for (int face = 0; face < 6; ++face) {
+            double x, y;
+            ProjectionLut::MapFace(layout, face, 0.5, 0.5, 384, 256, &x, &y);
+            EXPECT_DOUBLE_EQ(x, (face % 3) * 128 + 64.0);
+            EXPECT_DOUBLE_EQ(y, (face / 3) * 128 + 64.0);
+            EXPECT_LT(Angle(FaceDirection(face, 0.5, 0.5), axes[face]), 1e-12);
+        }
+    }
+}
+
+TEST(ProjectionLut, EACSpacesPixelsEvenlyInAngle) {
+    const uint32_t width = 384, height = 256, tile = 128;
+
+    // Angles between neighbouring pixel centers along the middle row of the front tile
+    auto steps = [&](ProjectionLayout layout, double* outMin, double* outMax) {
+        *outMin = 1e9;
+        *outMax = 0.0;
+        uint32_t y = tile + tile / 2;
+        Direction previous = {};
+        for (uint32_t x = tile; x < 2 * tile; ++x) {
+            double u, v;
+            int face = ProjectionLut::MapPixel(layout, x, y, width, height, 0.0, &u, &v);
+            Direction d = FaceDirection(face, u, v);
+            if (x > tile) {
+                double step = Angle(previous, d);
+                *outMin = std::fmin(*outMin, step);
+                *outMax = std::fmax(*outMax, step);
+            }
+            previous = d;
+        }
+    };
+
+    double eacMin, eacMax, cubeMin, cubeMax;
+    steps(ProjectionLayout::EAC3x2, &eacMin, &eacMax);
+    steps(ProjectionLayout::Cube3x2, &cubeMin, &cubeMax);
+    EXPECT_NEAR(eacMax / eacMin, 1.0, 1e-3);
+    EXPECT_NEAR(eacMin, kPi / 2.0 / tile, 1e-3 * kPi / 2.0 / tile);
+    EXPECT_GT(cubeMax / cubeMin, 1.9); // Plain cube faces sample the tile edges twice as densely
+}
+
+TEST(ProjectionLut, TableMatchesAnalyticMapping) {
+    struct Case {
+        ProjectionLayout layout;
+        uint32_t width, height;
+    };
+    for (const Case& c : { Case{ ProjectionLayout::Equirect, 512, 256 }, Case{ ProjectionLayout::Cube3x2, 384, 256 },
+                           Case{ ProjectionLayout::EAC3x2, 384, 256 } }) {
+        ProjectionLut lut;
+        ASSERT_TRUE(lut.Build(c.layout, c.width, c.height, (float)(2.0 * kPi)));
+        EXPECT_FALSE(lut.Build(c.layout, c.width, c.height, (float)(2.0 * kPi))); // Already current
+
+        for (uint32_t y = 0; y < c.height; ++y) {
+            for (uint32_t x = 0; x < c.width; ++x) {
+                double u, v;
+                int face = ProjectionLut::MapPixel(c.layout, x, y, c.width, c.height, (float)(2.0 * kPi), &u, &v);
+                uint32_t entry = lut.GetEntry(x, y);
+                ASSERT_EQ(entry, ProjectionLut::Pack(face, u, v)) << (int)c.layout << " " << x << "," << y;
+
+                // The unpacked entry points within a quantization step of the analytic direction
+                float lutU, lutV;
+                ASSERT_EQ(ProjectionLut::Unpack(entry, &lutU, &lutV), face);
+                ASSERT_LT(Angle(FaceDirection(face, lutU, lutV), FaceDirection(face, u, v)), kQuantizationAngle)
+                    << (int)c.layout << " " << x << "," << y;
+            }
+        }
+    }
+}
+
+TEST(ProjectionLut, UnevenTileSizesStayOnTheCube) {
+    struct Case {
+        uint32_t width, height;
+    };
+    for (ProjectionLayout layout : { ProjectionLayout::Cube3x2, ProjectionLayout::EAC3x2 }) {
+        for (const Case& c : { Case{ 188, 128 }, Case{ 94, 63 }, Case{ 5, 3 }, Case{ 2, 1 } }) {
+            ProjectionLut lut;
+            ASSERT_TRUE(lut.Build(layout, c.width, c.height, 0.0f));
+            for (uint32_t y = 0; y < c.height; ++y) {
+                for (uint32_t x = 0; x < c.width; ++x) {
+                    float u, v;
+                    int face = ProjectionLut::Unpack(lut.GetEntry(x, y), &u, &v);
+                    ASSERT_GE(face, 0);
+                    ASSERT_LT(face, 6) << (int)layout << " " << c.width << "x" << c.height << " at " << x << "," << y;
+                }
+            }
+        }
+
+        // The remainder column and row repeat the edge of the last tile: 188 = 3 * 62 + 2, 63 = 2 * 31 + 1
+        double u, v;
+        EXPECT_EQ(ProjectionLut::MapPixel(layout, 187, 62, 188, 63, 0.0, &u, &v), 5);
+        EXPECT_DOUBLE_EQ(u, 1.0);
+        EXPECT_DOUBLE_EQ(v, 1.0);
+        EXPECT_EQ(ProjectionLut::MapPixel(layout, 185, 30, 188, 63, 0.0, &u, &v), 2);
+        EXPECT_LT(u, 1.0);
+        EXPECT_LT(v, 1.0);
+    }
+}
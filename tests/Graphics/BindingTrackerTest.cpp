@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "Graphics/BindingTracker.h"
+#include <gtest/gtest.h>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace reshade::api;
+using Graphics::CommandListBindings;
+
+namespace {
+    // What the D3D11 runtime would have bound, maintained independently of the tracker
+    struct ReferenceBindings {
+        uint64_t vsConstantBuffers[CommandListBindings::kVSConstantSlots] = {};
+        uint64_t shaders[4] = {}; // VS, HS, DS, GS
+    };
+
+    const shader_stage kShaderStages[] = {
+        shader_stage::vertex, shader_stage::pixel, shader_stage::vertex | shader_stage::pixel, shader_stage::all_graphics,
+        shader_stage::geometry, shader_stage::compute,
+    };
+
+    const pipeline_stage kPipelineStages[] = {
+        pipeline_stage::vertex_shader, pipeline_stage::hull_shader, pipeline_stage::domain_shader, pipeline_stage::geometry_shader,
+        pipeline_stage::pixel_shader, pipeline_stage::hull_shader | pipeline_stage::domain_shader, pipeline_stage::all_shader_stages,
+        pipeline_stage::input_assembler, pipeline_stage::output_merger,
+    };
+
+    const descriptor_type kDescriptorTypes[] = {
+        descriptor_type::constant_buffer, descriptor_type::constant_buffer, descriptor_type::shader_resource_view, descriptor_type::sampler,
+    };
+}
+
+TEST(BindingTracker, SyntheticEventStreamMatchesReference) {
+    std::mt19937 rng(42);
+    auto pick = [&](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+
+    CommandListBindings bindings;
+    bindings.stale = false;
+    ReferenceBindings reference;
+    uint64_t serial = bindings.stateSerial;
+
+    for (int event = 0; event < 20000; ++event) {
+        SCOPED_TRACE(testing::Message() << "event " << event);
+        switch (pick(8)) {
+            case 0: case 1: case 2: case 3: { // push_descriptors
+                shader_stage stages = kShaderStages[pick(std::size(kShaderStages))];
+                descriptor_type type = kDescriptorTypes[pick(std::size(kDescriptorTypes))];
+                descriptor_table_update update = {};
+                update.binding = (uint32_t)pick(16); // Past the last slot on purpose
+                update.count = 1 + (uint32_t)pick(4);
+                update.type = type;
+
+                std::vector<buffer_range> ranges(update.count);
+                for (buffer_range& range : ranges) range.buffer = { pick(4) == 0 ? 0 : 0x1000 + pick(64) * 0x10 };
+                bool unbind = pick(10) == 0; // A null descriptor array unbinds every slot in the range
+                update.descriptors = unbind ? nullptr : ranges.data();
+
+                bindings.OnPushDescriptors(stages, update);
+                if ((stages & shader_stage::vertex) != 0 && type == descriptor_type::constant_buffer) {
+                    for (uint32_t i = 0; i < update.count && update.binding + i < CommandListBindings::kVSConstantSlots; ++i) {
+                        reference.vsConstantBuffers[update.binding + i] = unbind ? 0 : ranges[i].buffer.handle;
+                    }
+                }
+                break;
+            }
+            case 4: case 5: { // bind_pipeline
+                pipeline_stage stages = kPipelineStages[pick(std::size(kPipelineStages))];
+                pipeline pipeline = { pick(3) == 0 ? 0 : 0x9000 + pick(32) };
+                bindings.OnBindPipeline(stages, pipeline);
+                const pipeline_stage shaderStages[] = {
+                    pipeline_stage::vertex_shader, pipeline_stage::hull_shader, pipeline_stage::domain_shader, pipeline_stage::geometry_shader,
+                };
+                for (int s = 0; s < 4; ++s) {
+                    if ((stages & shaderStages[s]) != 0) reference.shaders[s] = pipeline.handle;
+                }
+                break;
+            }
+            case 6: { // bind_descriptor_tables: only a vertex-stage table makes the shadow copy untrustworthy
+                shader_stage stages = kShaderStages[pick(std::size(kShaderStages))];
+                bindings.OnBindDescriptorTables(stages);
+                if ((stages & shader_stage::vertex) != 0) {
+                    ASSERT_TRUE(bindings.stale);
+                    bindings.stale = false; // The owner resynchronizes from the driver
+                } else {
+                    ASSERT_FALSE(bindings.stale);
+                }
+                break;
+            }
+            default:
+                bindings.OnBindState();
+                break;
+        }
+
+        // Every event is a potential state change for the draw recorder
+        ASSERT_GT(bindings.stateSerial, serial);
+        serial = bindings.stateSerial;
+
+        for (uint32_t slot = 0; slot < CommandListBindings::kVSConstantSlots; ++slot) {
+            ASSERT_EQ(bindings.vsConstantBuffers[slot], reference.vsConstantBuffers[slot]) << "slot " << slot;
+        }
+        ASSERT_EQ(bindings.vertexShader, reference.shaders[0]);
+        ASSERT_EQ(bindings.hullShader, reference.shaders[1]);
+        ASSERT_EQ(bindings.domainShader, reference.shaders[2]);
+        ASSERT_EQ(bindings.geometryShader, reference.shaders[3]);
+        ASSERT_EQ(bindings.UsesTessellationOrGeometry(), reference.shaders[1] || reference.shaders[2] || reference.shaders[3]);
+
+        // Lowest slot holding the buffer, as the draw path expects
+        uint64_t probe = 0x1000 + pick(64) * 0x10;
+        int expected = -1;
+        for (uint32_t slot = 0; slot < CommandListBindings::kVSConstantSlots && expected < 0; ++slot) {
+            if (reference.vsConstantBuffers[slot] == probe) expected = (int)slot;
+        }
+        ASSERT_EQ(bindings.FindVSConstantBuffer(probe), expected);
+    }
+}
+
+TEST(BindingTracker, InvalidateMarksStaleAndBumpsSerial) {
+    CommandListBindings bindings;
+    EXPECT_TRUE(bindings.stale); // Unknown until the first resync
+    bindings.stale = false;
+    uint64_t serial = bindings.stateSerial;
+    bindings.Invalidate();
+    EXPECT_TRUE(bindings.stale);
+    EXPECT_GT(bindings.stateSerial, serial);
+}
+
+TEST(BindingTracker, CameraBufferFoundInHighestSlot) {
+    CommandListBindings bindings;
+    buffer_range range = {};
+    range.buffer = { 0x4242 };
+    descriptor_table_update update = {};
+    update.binding = CommandListBindings::kVSConstantSlots - 1;
+    update.count = 1;
+    update.type = descriptor_type::constant_buffer;
+    update.descriptors = &range;
+    bindings.OnPushDescriptors(shader_stage::vertex, update);
+    EXPECT_EQ(bindings.FindVSConstantBuffer(0x4242), (int)CommandListBindings::kVSConstantSlots - 1);
+    EXPECT_EQ(bindings.FindVSConstantBuffer(0x4243), -1);
+}
@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "Graphics/ConstantBufferRing.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using Graphics::ConstantBufferRing;
+using Microsoft::WRL::ComPtr;
+
+namespace {
+    constexpr uint32_t kFaces = Camera::FacePayloads::kFaceCount;
+
+    // Six faces of faceSize bytes, faceStride apart, each face filled with (seed + face)
+    struct Faces {
+        std::vector<uint8_t> bytes;
+        ConstantBufferRing::PayloadSet set;
+
+        Faces(uint32_t faceSize, uint64_t generation, uint8_t seed) : bytes((size_t)kFaces * 512) {
+            for (uint32_t i = 0; i < kFaces; ++i) memset(bytes.data() + i * 512, seed + i, faceSize);
+            set = { bytes.data(), faceSize, 512, generation };
+        }
+    };
+
+    class ConstantBufferRingTest : public testing::Test {
+    protected:
+        void SetUp() override {
+            // WARP is always present and implements the D3D11.1 constant buffer offsets the ring needs
+            HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION,
+                                           m_device.GetAddressOf(), nullptr, m_context.GetAddressOf());
+            ASSERT_TRUE(SUCCEEDED(hr));
+            ASSERT_TRUE(m_ring.Initialize(m_device.Get()));
+        }
+
+        // Reads back the VS constant buffer range bound at slot 0
+        std::vector<uint8_t> ReadBound(UINT* boundBytes) {
+            ComPtr<ID3D11Buffer> buffer;
+            UINT firstConstant = 0, numConstants = 0;
+            ComPtr<ID3D11DeviceContext1> context1;
+            if (SUCCEEDED(m_context.As(&context1))) {
+                context1->VSGetConstantBuffers1(0, 1, buffer.GetAddressOf(), &firstConstant, &numConstants);
+            } else {
+                m_context->VSGetConstantBuffers(0, 1, buffer.GetAddressOf());
+            }
+            if (!buffer) return {};
+
+            D3D11_BUFFER_DESC desc;
+            buffer->GetDesc(&desc);
+            if (numConstants == 0 || firstConstant * 16 + numConstants * 16 > desc.ByteWidth) {
+                firstConstant = 0;
+                numConstants = desc.ByteWidth / 16;
+            }
+
+            desc.Usage = D3D11_USAGE_STAGING;
+            desc.BindFlags = 0;
+            desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            ComPtr<ID3D11Buffer> staging;
+            if (FAILED(m_device->CreateBuffer(&desc, nullptr, staging.GetAddressOf()))) return {};
+            m_context->CopyResource(staging.Get(), buffer.Get());
+
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            if (FAILED(m_context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped))) return {};
+            const uint8_t* begin = (const uint8_t*)mapped.pData + firstConstant * 16;
+            std::vector<uint8_t> contents(begin, begin + numConstants * 16);
+            m_context->Unmap(staging.Get(), 0);
+            *boundBytes = numConstants * 16;
+            return contents;
+        }
+
+        void ExpectFaces(const Faces& faces, UINT byteWidth) {
+            for (uint32_t i = 0; i < kFaces; ++i) {
+                m_ring.BindFace(m_context.Get(), 0, i);
+                UINT bound = 0;
+                std::vector<uint8_t> contents = ReadBound(&bound);
+                ASSERT_GE(bound, byteWidth) << "face " << i;
+                for (UINT b = 0; b < bound; ++b) {
+                    uint8_t expected = b < faces.set.faceSize ? faces.bytes[i * 512 + b] : 0;
+                    ASSERT_EQ(contents[b], expected) << "face " << i << " byte " << b;
+                }
+            }
+        }
+
+        bool SupportsRing() {
+            D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+            return SUCCEEDED(m_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+                   options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+        }
+
+        Graphics::UploadStats EndFrame() {
+            m_ring.EndFrame();
+            return m_ring.GetFrameStats();
+        }
+
+        ComPtr<ID3D11Device> m_device;
+        ComPtr<ID3D11DeviceContext> m_context;
+        ConstantBufferRing m_ring;
+    };
+}
+
+TEST_F(ConstantBufferRingTest, ResidentGenerationIsNotUploadedAgain) {
+    Faces first(320, 5, 10);
+    Faces second(320, 6, 40);
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 320, first.set));
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 320, first.set));
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 320, second.set));
+    Graphics::UploadStats stats = EndFrame();
+    EXPECT_EQ(stats.uploads, 2u);
+    EXPECT_EQ(stats.reusedUploads, 1u);
+    ExpectFaces(second, 320);
+
+    // Only the latest generation is resident; going back uploads again
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 320, first.set));
+    stats = EndFrame();
+    EXPECT_EQ(stats.uploads, 1u);
+    EXPECT_EQ(stats.reusedUploads, 0u);
+    ExpectFaces(first, 320);
+}
+
+TEST_F(ConstantBufferRingTest, GenerationZeroIsAlwaysUploaded) {
+    Faces faces(256, 0, 1);
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 256, faces.set));
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 256, faces.set));
+    Graphics::UploadStats stats = EndFrame();
+    EXPECT_EQ(stats.uploads, 2u);
+    EXPECT_EQ(stats.reusedUploads, 0u);
+}
+
+TEST_F(ConstantBufferRingTest, SlotBytesPastThePayloadAreZero) {
+    // A full-size set first, so recycled memory would show through a short one
+    Faces full(320, 1, 0xC0);
+    Faces shorter(192, 2, 20);
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 320, full.set));
+    ExpectFaces(full, 320);
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 320, shorter.set));
+    ExpectFaces(shorter, 320);
+}
+
+TEST_F(ConstantBufferRingTest, WrapsAcrossManyGenerations) {
+    // 6 x 512 bytes per set: a few thousand sets wrap the 4 MB ring
+    const uint64_t kSets = 2 * ConstantBufferRing::kRingBytes / (kFaces * 512) + 1;
+    for (uint64_t generation = 1; generation <= kSets; ++generation) {
+        Faces faces(512, generation, (uint8_t)generation);
+        ASSERT_TRUE(m_ring.Upload(m_context.Get(), 512, faces.set)) << generation;
+    }
+    Graphics::UploadStats stats = EndFrame();
+    EXPECT_EQ(stats.uploads, kSets);
+    if (SupportsRing()) {
+        EXPECT_EQ(stats.ringWraps, 2u);
+    } else {
+        EXPECT_EQ(stats.ringWraps, 0u);
+    }
+    ExpectFaces(Faces(512, kSets, (uint8_t)kSets), 512);
+}
+
+TEST_F(ConstantBufferRingTest, DeferredContextNeverReusesAGeneration) {
+    ComPtr<ID3D11DeviceContext> deferred;
+    ASSERT_TRUE(SUCCEEDED(m_device->CreateDeferredContext(0, deferred.GetAddressOf())));
+
+    // Deferred writes are only resident once the command list runs, so neither context may skip the next upload
+    Faces faces(256, 7, 3);
+    ASSERT_TRUE(m_ring.Upload(deferred.Get(), 256, faces.set));
+    ASSERT_TRUE(m_ring.Upload(deferred.Get(), 256, faces.set));
+    ASSERT_TRUE(m_ring.Upload(m_context.Get(), 256, faces.set));
+    Graphics::UploadStats stats = EndFrame();
+    EXPECT_EQ(stats.uploads, 3u);
+    EXPECT_EQ(stats.reusedUploads, 0u);
+}
@@ -0,0 +1,337 @@
+#include "Graphics/DrawLog.h"
+#include "Camera/CameraController.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace Graphics;
+
+namespace {
+    constexpr uint32_t kCameraSlot = 0;
+    constexpr uint32_t kCameraBytes = 320;
+    constexpr uint64_t kCameraBuffer = 0x300;
+    constexpr uint64_t kMaterial = 0x100; // VS 1 and PS 2
+    constexpr uint64_t kObject = 0x200;   // PS 3
+
+    // DrawLogDevice double. `bound` is the pipeline the game has bound now and `contents` the value held by each
+    // buffer and snapshot; replayed draws are recorded with the face, the state and the constants they saw.
+    class MockDevice : public DrawLogDevice {
+    public:
+        struct ReplayedDraw {
+            uint32_t face = 0;
+            uint32_t count = 0;
+            uint32_t state = 0;
+            uint64_t payloadGeneration = 0;
+            std::map<std::pair<uint8_t, uint8_t>, uint32_t> constants; // (stage, slot) -> value
+        };
+
+        DrawLogState bound;
+        std::unordered_map<uint64_t, uint32_t> contents;
+        uint32_t faceMask = 0x3F;
+        bool failCopies = false;
+        bool failPayloads = false;
+
+        std::vector<DrawLogState> states; // By state index, as captured
+        int captures = 0;
+        std::vector<uint32_t> released;
+        int copies = 0;
+        int faceBegins = 0;
+        int stateApplies = 0;
+        int snapshotBinds = 0;
+        int payloadBinds = 0;
+        std::vector<ReplayedDraw> draws;
+
+        void CaptureState(uint32_t state, DrawLogState* outState) override {
+            if (state >= states.size()) states.resize(state + 1);
+            states[state] = bound;
+            *outState = bound;
+            captures++;
+        }
+
+        void ReleaseState(uint32_t state) override { released.push_back(state); }
+
+        uint64_t CopySnapshot(uint64_t buffer) override {
+            if (failCopies) return 0;
+            uint64_t snapshot = 0x900000 + (uint64_t)++copies;
+            contents[snapshot] = contents[buffer];
+            return snapshot;
+        }
+
+        bool BeginFace(uint32_t face) override {
+            if ((faceMask & (1u << face)) == 0) return false;
+            m_face = face;
+            faceBegins++;
+            return true;
+        }
+
+        void ApplyState(uint32_t state) override {
+            // The game's buffers go back in every slot, like applying a captured D3D state
+            m_state = state;
+            m_bound.clear();
+            for (uint8_t stage = 0; stage < 2; ++stage) {
+                for (uint8_t slot = 0; slot < DrawLogState::kConstantSlots; ++slot) {
+                    if (states[state].snapshotBuffers[stage][slot]) m_bound[{ stage, slot }] = states[state].snapshotBuffers[stage][slot];
+                }
+            }
+            m_payload = 0;
+            stateApplies++;
+        }
+
+        void BindSnapshot(uint32_t state, uint8_t stage, uint8_t slot, uint64_t snapshot) override {
+            EXPECT_EQ(state, m_state);
+            m_bound[{ stage, slot }] = snapshot;
+            snapshotBinds++;
+        }
+
+        bool BindPayload(uint32_t face, uint32_t cameraSlot, uint32_t cameraByteWidth, const Payload& payload) override {
+            EXPECT_EQ(face, m_face);
+            EXPECT_EQ(cameraSlot, kCameraSlot);
+            EXPECT_EQ(cameraByteWidth, kCameraBytes);
+            if (failPayloads) return false;
+            m_payload = payload.generation;
+            payloadBinds++;
+            return true;
+        }
+
+        void Draw(const DrawArgs& args) override {
+            ReplayedDraw draw;
+            draw.face = m_face;
+            draw.count = args.count;
+            draw.state = m_state;
+            draw.payloadGeneration = m_payload;
+            for (const auto& [key, buffer] : m_bound) draw.constants[key] = contents[buffer];
+            draws.push_back(draw);
+        }
+
+    private:
+        uint32_t m_face = 0;
+        uint32_t m_state = 0;
+        uint64_t m_payload = 0;
+        std::map<std::pair<uint8_t, uint8_t>, uint64_t> m_bound;
+    };
+
+    class DrawLogTest : public testing::Test {
+    protected:
+        void SetUp() override {
+            UpdateCamera(5.0f);
+            m_device.bound.snapshotBuffers[0][kCameraSlot] = kCameraBuffer;
+            m_device.bound.snapshotBuffers[0][1] = kMaterial;
+            m_device.bound.snapshotBuffers[1][2] = kMaterial;
+            m_device.bound.snapshotBuffers[1][3] = kObject;
+        }
+
+        // 320-byte camera buffer with a row-major view at float 0 and a projection at float 16
+        void UpdateCamera(float eyeZ) {
+            std::vector<float> camera(kCameraBytes / sizeof(float), 0.0f);
+            camera[0] = camera[5] = camera[10] = camera[15] = 1.0f;
+            camera[14] = eyeZ;
+            camera[16] = 1.2f;
+            camera[21] = 2.1f;
+            camera[26] = 1.0001f;
+            camera[27] = 1.0f;
+            camera[30] = -0.1f;
+            m_controller.OnUpdateBuffer(kCameraBuffer, camera.data(), kCameraBytes);
+            ASSERT_TRUE(m_payloads.Refresh(m_controller));
+        }
+
+        // The game rewriting a buffer between draws
+        void Write(uint64_t buffer, uint32_t value) {
+            EXPECT_FALSE(m_log.OnBufferWrite(buffer));
+            m_device.contents[buffer] = value;
+        }
+
+        bool Record(uint32_t count, uint64_t stateSerial = 1) {
+            DrawArgs args;
+            args.count = count;
+            return m_log.Record(m_device, stateSerial, args, kCameraSlot, kCameraBytes, m_payloads);
+        }
+
+        Camera::CameraController m_controller;
+        Camera::FacePayloads m_payloads;
+        MockDevice m_device;
+        DrawLog m_log;
+    };
+}
+
+TEST_F(DrawLogTest, ReplaysEveryDrawPerFaceWithFacesOutermost) {
+    ASSERT_TRUE(Record(1, 1));
+    ASSERT_TRUE(Record(2, 1));
+    ASSERT_TRUE(Record(3, 2));
+    EXPECT_EQ(m_device.captures, 2);
+    EXPECT_EQ(m_log.GetStats().states, 2u);
+
+    m_log.Replay(m_device);
+    ASSERT_EQ(m_device.draws.size(), 3u * 6);
+    for (size_t i = 0; i < m_device.draws.size(); ++i) {
+        EXPECT_EQ(m_device.draws[i].face, i / 3) << i;
+        EXPECT_EQ(m_device.draws[i].count, i % 3 + 1) << i;
+        EXPECT_EQ(m_device.draws[i].state, i % 3 == 2 ? 1u : 0u) << i;
+        EXPECT_EQ(m_device.draws[i].payloadGeneration, m_payloads.GetGeneration()) << i;
+    }
+
+    // Targets switch once per face; states and payloads only where they change
+    EXPECT_EQ(m_device.faceBegins, 6);
+    EXPECT_EQ(m_device.stateApplies, 2 * 6);
+    EXPECT_EQ(m_device.payloadBinds, 2 * 6);
+    EXPECT_TRUE(m_log.IsEmpty());
+    EXPECT_EQ(m_log.GetStats().flushes, 1u);
+
+    // An empty log issues nothing
+    m_log.Replay(m_device);
+    EXPECT_EQ(m_device.faceBegins, 6);
+    EXPECT_EQ(m_log.GetStats().flushes, 1u);
+}
+
+TEST_F(DrawLogTest, SkippedFacesGetNoDraws) {
+    m_device.faceMask = (1u << 0) | (1u << 3);
+    ASSERT_TRUE(Record(1));
+    ASSERT_TRUE(Record(2));
+    m_log.Replay(m_device);
+
+    ASSERT_EQ(m_device.draws.size(), 4u);
+    EXPECT_EQ(m_device.draws[0].face, 0u);
+    EXPECT_EQ(m_device.draws[1].face, 0u);
+    EXPECT_EQ(m_device.draws[2].face, 3u);
+    EXPECT_EQ(m_device.draws[3].face, 3u);
+}
+
+TEST_F(DrawLogTest, ReplayedDrawsSeeConstantsAsRecorded) {
+    // Draw n (vertex count n + 1) is issued with material = n and object = 100 + n
+    for (uint32_t n = 0; n < 4; ++n) {
+        Write(kMaterial, n);
+        Write(kObject, 100 + n);
+        ASSERT_TRUE(Record(n + 1));
+    }
+    EXPECT_EQ(m_log.GetStats().snapshots, 8u);
+
+    // The game moves on before the flush
+    Write(kMaterial, 50);
+    Write(kObject, 150);
+
+    m_log.Replay(m_device);
+    ASSERT_EQ(m_device.draws.size(), 4u * 6);
+    for (const MockDevice::ReplayedDraw& draw : m_device.draws) {
+        uint32_t n = draw.count - 1;
+        EXPECT_EQ(draw.constants.at({ 0, 1 }), n);
+        EXPECT_EQ(draw.constants.at({ 1, 2 }), n);
+        EXPECT_EQ(draw.constants.at({ 1, 3 }), 100 + n);
+    }
+}
+
+TEST_F(DrawLogTest, CameraSlotAndUnboundSlotsAreNotCopied) {
+    m_device.bound.snapshotBuffers[1][2] = 0; // Unbound or immutable
+    ASSERT_TRUE(Record(1));
+    EXPECT_EQ(m_device.copies, 2); // VS 1 and PS 3; the camera slot takes the face payload
+    EXPECT_EQ(m_log.GetStats().snapshots, 2u);
+}
+
+TEST_F(DrawLogTest, UnchangedConstantsAreCopiedOnceAndBoundOncePerFace) {
+    Write(kMaterial, 7);
+    Write(kObject, 8);
+    for (uint32_t n = 1; n <= 3; ++n) ASSERT_TRUE(Record(n));
+    EXPECT_EQ(m_log.GetStats().snapshots, 2u);
+
+    // VS 1 and PS 2 share the material's snapshot
+    m_log.Replay(m_device);
+    EXPECT_EQ(m_device.snapshotBinds, 3 * 6);
+    for (const MockDevice::ReplayedDraw& draw : m_device.draws) {
+        EXPECT_EQ(draw.constants.at({ 0, 1 }), 7u);
+        EXPECT_EQ(draw.constants.at({ 1, 3 }), 8u);
+    }
+
+    // Snapshots are taken again after a flush
+    ASSERT_TRUE(Record(1));
+    EXPECT_EQ(m_log.GetStats().snapshots, 4u);
+}
+
+TEST_F(DrawLogTest, WriteToRecordedVertexBufferRequestsFlush) {
+    m_device.bound.vertexBuffers[0] = 0x500;
+    m_device.bound.indexBuffer = 0x600;
+    ASSERT_TRUE(Record(3));
+
+    EXPECT_FALSE(m_log.OnBufferWrite(kObject)); // Snapshotted
+    EXPECT_TRUE(m_log.OnBufferWrite(0x500));
+    EXPECT_TRUE(m_log.OnBufferWrite(0x600));
+
+    // Deferred context commands from other threads reach the buffer only through ExecuteCommandList
+    bool fromWorker = true;
+    std::thread worker([&] { fromWorker = m_log.OnBufferWrite(0x500); });
+    worker.join();
+    EXPECT_FALSE(fromWorker);
+
+    m_log.Replay(m_device);
+    EXPECT_FALSE(m_log.OnBufferWrite(0x500));
+    EXPECT_EQ(m_log.GetStats().writeFlushes, 2u);
+}
+
+TEST_F(DrawLogTest, NonDeferrableStateIsNotRecorded) {
+    m_device.bound.deferrable = false;
+    EXPECT_FALSE(Record(3, 1));
+    EXPECT_FALSE(Record(3, 1)); // Same state, not captured again
+    EXPECT_EQ(m_device.captures, 1);
+    ASSERT_EQ(m_device.released.size(), 1u);
+    EXPECT_TRUE(m_log.IsEmpty());
+
+    // Its slot is reused by the next state
+    m_device.bound.deferrable = true;
+    EXPECT_TRUE(Record(3, 2));
+    EXPECT_EQ(m_device.released[0], 0u);
+    EXPECT_FALSE(m_log.IsEmpty());
+    EXPECT_EQ(m_log.GetStats().states, 1u);
+}
+
+TEST_F(DrawLogTest, FailedSnapshotDropsOnlyThatDraw) {
+    ASSERT_TRUE(Record(1));
+    m_log.OnBufferWrite(kObject);
+    m_device.failCopies = true;
+    EXPECT_FALSE(Record(2));
+    m_device.failCopies = false;
+    ASSERT_TRUE(Record(3));
+
+    m_log.Replay(m_device);
+    ASSERT_EQ(m_device.draws.size(), 2u * 6);
+    EXPECT_EQ(m_device.draws[0].count, 1u);
+    EXPECT_EQ(m_device.draws[1].count, 3u);
+}
+
+TEST_F(DrawLogTest, PayloadSetsFollowTheCameraGeneration) {
+    ASSERT_TRUE(Record(1));
+    ASSERT_TRUE(Record(2));
+    uint64_t first = m_payloads.GetGeneration();
+    UpdateCamera(6.0f);
+    ASSERT_NE(m_payloads.GetGeneration(), first);
+    ASSERT_TRUE(Record(3));
+    EXPECT_EQ(m_log.GetStats().payloadSets, 2u);
+
+    m_log.Replay(m_device);
+    for (const MockDevice::ReplayedDraw& draw : m_device.draws) {
+        EXPECT_EQ(draw.payloadGeneration, draw.count == 3 ? m_payloads.GetGeneration() : first) << draw.count;
+    }
+    EXPECT_EQ(m_device.payloadBinds, 2 * 6);
+}
+
+TEST_F(DrawLogTest, DrawsWithoutPayloadAreSkipped) {
+    ASSERT_TRUE(Record(1));
+    ASSERT_TRUE(Record(2));
+    m_device.failPayloads = true;
+    m_log.Replay(m_device);
+    EXPECT_TRUE(m_device.draws.empty());
+    EXPECT_TRUE(m_log.IsEmpty());
+}
+
+TEST_F(DrawLogTest, SRVSlotsCoverEveryLoggedState) {
+    m_device.bound.srvCount[1] = 101;
+    ASSERT_TRUE(Record(1, 1));
+    m_device.bound.srvCount[1] = 3;
+    m_device.bound.srvCount[0] = 9;
+    ASSERT_TRUE(Record(2, 2));
+    EXPECT_EQ(m_log.GetSRVSlots(0), 9u);
+    EXPECT_EQ(m_log.GetSRVSlots(1), 101u);
+
+    m_log.Replay(m_device);
+    EXPECT_EQ(m_log.GetSRVSlots(1), 0u);
+}
@@ -0,0 +1,251 @@
+#include "pch.h"
+#include "Graphics/DrawRecorder.h"
+#include "Support/CountingDeviceContext.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+using Testing::CountingDeviceContext;
+
+namespace {
+    constexpr UINT kCameraSlot = 0;
+    constexpr UINT kCameraBytes = 320;
+
+    // Recorder driving the counting double; buffers and views come from a WARP device, and the double's CPU copies
+    // of their contents stand in for the GPU memory
+    class DrawRecorderTest : public testing::Test {
+    protected:
+        void SetUp() override {
+            ASSERT_TRUE(SUCCEEDED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION,
+                                                    m_device.GetAddressOf(), nullptr, nullptr)));
+            m_context.device = m_device;
+            ASSERT_TRUE(m_ring.Initialize(m_device.Get()));
+
+            // 320-byte camera buffer with a row-major view at float 0 and a projection at float 16
+            std::vector<float> camera(kCameraBytes / sizeof(float), 0.0f);
+            camera[0] = camera[5] = camera[10] = camera[15] = 1.0f;
+            camera[14] = 5.0f;
+            camera[16] = 1.2f;
+            camera[21] = 2.1f;
+            camera[26] = 1.0001f;
+            camera[27] = 1.0f;
+            camera[30] = -0.1f;
+            m_controller.OnUpdateBuffer({ 0x1000 }, camera.data(), kCameraBytes);
+            ASSERT_TRUE(m_payloads.Refresh(m_controller));
+
+            m_camera = CreateBuffer(kCameraBytes, D3D11_USAGE_DEFAULT, D3D11_BIND_CONSTANT_BUFFER);
+            m_material = CreateBuffer(256, D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER);
+            m_object = CreateBuffer(256, D3D11_USAGE_DEFAULT, D3D11_BIND_CONSTANT_BUFFER);
+
+            // Camera at VS 0, the dynamic material buffer at VS 1 and PS 2, the per-object buffer at PS 3
+            m_context.VSSetConstantBuffers(kCameraSlot, 1, m_camera.GetAddressOf());
+            m_context.VSSetConstantBuffers(1, 1, m_material.GetAddressOf());
+            m_context.PSSetConstantBuffers(2, 1, m_material.GetAddressOf());
+            m_context.PSSetConstantBuffers(3, 1, m_object.GetAddressOf());
+
+            for (auto& face : m_faces) face.size = 16;
+        }
+
+        ComPtr<ID3D11Buffer> CreateBuffer(UINT bytes, D3D11_USAGE usage, UINT bindFlags) {
+            D3D11_BUFFER_DESC desc = { bytes, usage, bindFlags, usage == D3D11_USAGE_DYNAMIC ? (UINT)D3D11_CPU_ACCESS_WRITE : 0u };
+            ComPtr<ID3D11Buffer> buffer;
+            EXPECT_TRUE(SUCCEEDED(m_device->CreateBuffer(&desc, nullptr, buffer.GetAddressOf())));
+            return buffer;
+        }
+
+        ComPtr<ID3D11ShaderResourceView> CreateSRV() {
+            D3D11_TEXTURE2D_DESC desc = { 4, 4, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, { 1, 0 }, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE };
+            ComPtr<ID3D11Texture2D> texture;
+            ComPtr<ID3D11ShaderResourceView> srv;
+            if (SUCCEEDED(m_device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()))) {
+                m_device->CreateShaderResourceView(texture.Get(), nullptr, srv.GetAddressOf());
+            }
+            return srv;
+        }
+
+        // The game rewriting its buffers between draws, with the events the addon sees in the order ReShade sends
+        // them: map_buffer_region after the map, update_buffer_region before the update
+        void MapMaterial(uint32_t value) {
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            ASSERT_TRUE(SUCCEEDED(m_context.Map(m_material.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)));
+            EXPECT_FALSE(m_recorder.OnBufferWrite((uint64_t)m_material.Get()));
+            memcpy(mapped.pData, &value, sizeof(value));
+            m_context.Unmap(m_material.Get(), 0);
+        }
+
+        void UpdateObject(uint32_t value) {
+            EXPECT_FALSE(m_recorder.OnBufferWrite((uint64_t)m_object.Get()));
+            D3D11_BOX box = { 0, 0, 0, sizeof(value), 1, 1 };
+            m_context.UpdateSubresource(m_object.Get(), 0, &box, &value, 0, 0);
+        }
+
+        bool Record(UINT count, uint64_t stateSerial = 1) {
+            DrawRecorder::DrawArgs args;
+            args.count = count;
+            return m_recorder.Record(&m_context, m_ring.GetContext1(&m_context), stateSerial, args, kCameraSlot, kCameraBytes, m_payloads);
+        }
+
+        void Replay() {
+            m_recorder.Replay(&m_context, m_ring.GetContext1(&m_context), m_ring, m_faces);
+        }
+
+        uint32_t BoundValue(CountingDeviceContext::Stage stage, UINT slot) {
+            ID3D11Buffer* buffer = m_context.stages[stage].constantBuffers[slot].Get();
+            if (!buffer) return UINT32_MAX;
+            uint32_t value;
+            memcpy(&value, m_context.Contents(buffer).data(), sizeof(value));
+            return value;
+        }
+
+        ComPtr<ID3D11Device> m_device;
+        CountingDeviceContext m_context;
+        ConstantBufferRing m_ring;
+        Camera::CameraController m_controller;
+        Camera::FacePayloads m_payloads;
+        DrawRecorder m_recorder;
+        DrawRecorder::FaceTarget m_faces[Camera::FacePayloads::kFaceCount];
+
+        ComPtr<ID3D11Buffer> m_camera;
+        ComPtr<ID3D11Buffer> m_material;
+        ComPtr<ID3D11Buffer> m_object;
+    };
+}
+
+TEST_F(DrawRecorderTest, ReplayedDrawsSeeConstantsAsRecorded) {
+    // Draw n (vertex count n + 1) is issued with material = n and object = 100 + n
+    for (uint32_t n = 0; n < 4; ++n) {
+        MapMaterial(n);
+        UpdateObject(100 + n);
+        ASSERT_TRUE(Record(n + 1));
+    }
+    EXPECT_EQ(m_recorder.GetStats().snapshots, 8u);
+
+    // The game moves on before the flush
+    MapMaterial(50);
+    UpdateObject(150);
+
+    int checked = 0;
+    m_context.onDraw = [&](const CountingDeviceContext::DrawCall& draw) {
+        uint32_t n = draw.count - 1;
+        EXPECT_EQ(BoundValue(CountingDeviceContext::VS, 1), n);
+        EXPECT_EQ(BoundValue(CountingDeviceContext::PS, 2), n);
+        EXPECT_EQ(BoundValue(CountingDeviceContext::PS, 3), 100 + n);
+        EXPECT_NE(m_context.stages[CountingDeviceContext::VS].constantBuffers[kCameraSlot].Get(), m_camera.Get()) << "camera slot lost the face payload";
+        checked++;
+    };
+    Replay();
+    EXPECT_EQ(checked, 4 * 6);
+    EXPECT_TRUE(m_recorder.IsEmpty());
+
+    // The game's own bindings and contents are back
+    EXPECT_EQ(m_context.stages[CountingDeviceContext::VS].constantBuffers[kCameraSlot].Get(), m_camera.Get());
+    EXPECT_EQ(m_context.stages[CountingDeviceContext::VS].constantBuffers[1].Get(), m_material.Get());
+    EXPECT_EQ(m_context.stages[CountingDeviceContext::PS].constantBuffers[3].Get(), m_object.Get());
+    EXPECT_EQ(BoundValue(CountingDeviceContext::VS, 1), 50u);
+    EXPECT_EQ(BoundValue(CountingDeviceContext::PS, 3), 150u);
+}
+
+TEST_F(DrawRecorderTest, UnchangedConstantsAreCopiedOnce) {
+    MapMaterial(7);
+    UpdateObject(8);
+    for (UINT n = 1; n <= 3; ++n) ASSERT_TRUE(Record(n));
+    EXPECT_EQ(m_recorder.GetStats().snapshots, 2u);
+
+    int checked = 0;
+    m_context.onDraw = [&](const CountingDeviceContext::DrawCall&) {
+        EXPECT_EQ(BoundValue(CountingDeviceContext::VS, 1), 7u);
+        EXPECT_EQ(BoundValue(CountingDeviceContext::PS, 3), 8u);
+        checked++;
+    };
+    Replay();
+    EXPECT_EQ(checked, 3 * 6);
+
+    // Snapshot buffers are pooled across flushes
+    m_context.ResetCalls();
+    ASSERT_TRUE(Record(1));
+    EXPECT_EQ(m_context.Calls("CopyResource"), 2);
+    EXPECT_EQ(m_context.Calls("GetDevice"), 0);
+}
+
+TEST_F(DrawRecorderTest, ImmutableConstantsAreNotCopied) {
+    D3D11_BUFFER_DESC desc = { 256, D3D11_USAGE_IMMUTABLE, D3D11_BIND_CONSTANT_BUFFER };
+    std::vector<uint8_t> zeros(256);
+    D3D11_SUBRESOURCE_DATA data = { zeros.data() };
+    ComPtr<ID3D11Buffer> immutable;
+    ASSERT_TRUE(SUCCEEDED(m_device->CreateBuffer(&desc, &data, immutable.GetAddressOf())));
+    ID3D11Buffer* none = nullptr;
+    m_context.VSSetConstantBuffers(1, 1, &none);
+    m_context.PSSetConstantBuffers(2, 1, &none);
+    m_context.PSSetConstantBuffers(3, 1, immutable.GetAddressOf());
+
+    ASSERT_TRUE(Record(1));
+    EXPECT_EQ(m_recorder.GetStats().snapshots, 0u);
+}
+
+TEST_F(DrawRecorderTest, WriteToRecordedVertexBufferRequestsFlush) {
+    ComPtr<ID3D11Buffer> vertices = CreateBuffer(1024, D3D11_USAGE_DEFAULT, D3D11_BIND_VERTEX_BUFFER);
+    ComPtr<ID3D11Buffer> indices = CreateBuffer(1024, D3D11_USAGE_DEFAULT, D3D11_BIND_INDEX_BUFFER);
+    UINT stride = 16, offset = 0;
+    m_context.IASetVertexBuffers(0, 1, vertices.GetAddressOf(), &stride, &offset);
+    m_context.IASetIndexBuffer(indices.Get(), DXGI_FORMAT_R16_UINT, 0);
+    ASSERT_TRUE(Record(3));
+
+    EXPECT_FALSE(m_recorder.OnBufferWrite((uint64_t)m_object.Get())); // Snapshotted
+    EXPECT_TRUE(m_recorder.OnBufferWrite((uint64_t)vertices.Get()));
+    EXPECT_TRUE(m_recorder.OnBufferWrite((uint64_t)indices.Get()));
+
+    // Deferred context commands from other threads reach the buffer only through ExecuteCommandList
+    bool fromWorker = true;
+    std::thread worker([&] { fromWorker = m_recorder.OnBufferWrite((uint64_t)vertices.Get()); });
+    worker.join();
+    EXPECT_FALSE(fromWorker);
+
+    Replay();
+    EXPECT_FALSE(m_recorder.OnBufferWrite((uint64_t)vertices.Get()));
+    EXPECT_EQ(m_recorder.GetStats().writeFlushes, 2u);
+}
+
+TEST_F(DrawRecorderTest, DynamicVertexBufferIsNotDeferred) {
+    ComPtr<ID3D11Buffer> vertices = CreateBuffer(1024, D3D11_USAGE_DYNAMIC, D3D11_BIND_VERTEX_BUFFER);
+    UINT stride = 16, offset = 0;
+    m_context.IASetVertexBuffers(2, 1, vertices.GetAddressOf(), &stride, &offset);
+    EXPECT_FALSE(Record(3, 1));
+    EXPECT_FALSE(Record(3, 1)); // Same state, not captured again
+    EXPECT_TRUE(m_recorder.IsEmpty());
+
+    ID3D11Buffer* none = nullptr;
+    m_context.IASetVertexBuffers(2, 1, &none, &stride, &offset);
+    EXPECT_TRUE(Record(3, 2));
+    EXPECT_FALSE(m_recorder.IsEmpty());
+}
+
+TEST_F(DrawRecorderTest, ShaderResourcesAboveSlot32AreReplayed) {
+    ComPtr<ID3D11ShaderResourceView> recorded = CreateSRV();
+    ComPtr<ID3D11ShaderResourceView> high = CreateSRV();
+    ComPtr<ID3D11ShaderResourceView> later = CreateSRV();
+    m_context.PSSetShaderResources(100, 1, recorded.GetAddressOf());
+    ASSERT_TRUE(Record(1, 1));
+    m_context.PSSetShaderResources(120, 1, high.GetAddressOf());
+    ASSERT_TRUE(Record(2, 2));
+
+    // By the flush the game has bound something else at 100 and nothing at 120
+    ID3D11ShaderResourceView* none = nullptr;
+    m_context.PSSetShaderResources(100, 1, later.GetAddressOf());
+    m_context.PSSetShaderResources(120, 1, &none);
+
+    int checked = 0;
+    m_context.onDraw = [&](const CountingDeviceContext::DrawCall& draw) {
+        const auto& ps = m_context.stages[CountingDeviceContext::PS];
+        EXPECT_EQ(ps.srvs[100].Get(), recorded.Get());
+        EXPECT_EQ(ps.srvs[120].Get(), draw.count == 2 ? high.Get() : nullptr);
+        checked++;
+    };
+    Replay();
+    EXPECT_EQ(checked, 2 * 6);
+
+    const auto& ps = m_context.stages[CountingDeviceContext::PS];
+    EXPECT_EQ(ps.srvs[100].Get(), later.Get());
+    EXPECT_EQ(ps.srvs[120].Get(), nullptr);
+}
@@ -0,0 +1,352 @@
+#include "Graphics/MultiViewShader.h"
+#include "Graphics/ShaderSignature.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Graphics::MultiViewShader;
+using Graphics::PrimitiveClass;
+using Graphics::ShaderSignature;
+using Graphics::SignatureElement;
+
+namespace {
+    SignatureElement Element(const char* semantic, uint32_t index, uint32_t registerIndex, uint8_t mask,
+                             uint32_t componentType = Graphics::kComponentFloat32, uint32_t systemValue = Graphics::kSystemValueUndefined) {
+        SignatureElement e;
+        e.semanticName = semantic;
+        e.semanticIndex = index;
+        e.registerIndex = registerIndex;
+        e.mask = mask;
+        e.componentType = componentType;
+        e.systemValue = systemValue;
+        return e;
+    }
+
+    // A typical vertex shader output: position, a packed texcoord pair and a color
+    std::vector<SignatureElement> VertexOutputs() {
+        return {
+            Element("SV_Position", 0, 0, 0xF, Graphics::kComponentFloat32, Graphics::kSystemValuePosition),
+            Element("TEXCOORD", 0, 1, 0x3),
+            Element("TEXCOORD", 1, 1, 0xC),
+            Element("COLOR", 0, 2, 0xF),
+        };
+    }
+
+    void PutU32(std::vector<uint8_t>& bytes, size_t offset, uint32_t value) {
+        if (bytes.size() < offset + 4) bytes.resize(offset + 4);
+        std::memcpy(&bytes[offset], &value, 4);
+    }
+
+    uint32_t FourCC(const char* name) {
+        uint32_t value;
+        std::memcpy(&value, name, 4);
+        return value;
+    }
+
+    // Signature chunk data as fxc writes it: count, offset of the first element, the elements, then the names.
+    // ISGN/OSGN elements are 24 bytes, OSG5 prepends the stream (28), ISG1/OSG1 also append the min precision (32).
+    std::vector<uint8_t> SignatureChunk(const char* fourCC, const std::vector<SignatureElement>& elements) {
+        size_t elementBytes = 24;
+        bool hasStream = false, hasMinPrecision = false;
+        if (strcmp(fourCC, "OSG5") == 0) {
+            elementBytes = 28;
+            hasStream = true;
+        } else if (strcmp(fourCC, "ISG1") == 0 || strcmp(fourCC, "OSG1") == 0) {
+            elementBytes = 32;
+            hasStream = hasMinPrecision = true;
+        }
+
+        std::vector<uint8_t> chunk;
+        PutU32(chunk, 0, (uint32_t)elements.size());
+        PutU32(chunk, 4, 8);
+        size_t names = 8 + elements.size() * elementBytes;
+        chunk.resize(names);
+        for (size_t i = 0; i < elements.size(); ++i) {
+            const SignatureElement& e = elements[i];
+            size_t p = 8 + i * elementBytes;
+            if (hasStream) {
+                PutU32(chunk, p, e.stream);
+                p += 4;
+            }
+            PutU32(chunk, p, (uint32_t)chunk.size());
+            PutU32(chunk, p + 4, e.semanticIndex);
+            PutU32(chunk, p + 8, e.systemValue);
+            PutU32(chunk, p + 12, e.componentType);
+            PutU32(chunk, p + 16, e.registerIndex);
+            chunk[p + 20] = e.mask;
+            chunk[p + 21] = e.mask; // Read/write mask, not parsed
+            if (hasMinPrecision) PutU32(chunk, p + 24, e.minPrecision);
+            chunk.insert(chunk.end(), e.semanticName.begin(), e.semanticName.end());
+            chunk.push_back(0);
+        }
+        while (chunk.size() % 4) chunk.push_back(0xAB);
+        return chunk;
+    }
+
+    struct Chunk {
+        const char* fourCC;
+        std::vector<uint8_t> data;
+    };
+
+    // DXBC container: magic, checksum (not verified by the parser), version, total size, chunk count, chunk offsets,
+    // then each chunk as fourCC, size and data
+    std::vector<uint8_t> Container(const std::vector<Chunk>& chunks) {
+        std::vector<uint8_t> bytes(32 + chunks.size() * 4);
+        PutU32(bytes, 0, FourCC("DXBC"));
+        PutU32(bytes, 20, 1);
+        PutU32(bytes, 28, (uint32_t)chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            PutU32(bytes, 32 + i * 4, (uint32_t)bytes.size());
+            size_t offset = bytes.size();
+            PutU32(bytes, offset, FourCC(chunks[i].fourCC));
+            PutU32(bytes, offset + 4, (uint32_t)chunks[i].data.size());
+            bytes.insert(bytes.end(), chunks[i].data.begin(), chunks[i].data.end());
+        }
+        PutU32(bytes, 24, (uint32_t)bytes.size());
+        return bytes;
+    }
+
+    // Bytecode of a geometry shader that passes outputs through and adds the face routing, as fxc signs the
+    // generated source
+    std::vector<uint8_t> GeometryShader(const std::vector<SignatureElement>& inputs, const std::vector<SignatureElement>& outputs) {
+        std::vector<SignatureElement> routed = outputs;
+        uint32_t next = 0;
+        for (const SignatureElement& e : outputs) next = std::max(next, e.registerIndex + 1);
+        routed.push_back(Element("SV_RenderTargetArrayIndex", 0, next, 0x1, Graphics::kComponentUInt32,
+                                 Graphics::kSystemValueRenderTargetArrayIndex));
+        routed.push_back(Element("SV_ViewportArrayIndex", 0, next + 1, 0x1, Graphics::kComponentUInt32,
+                                 Graphics::kSystemValueViewportArrayIndex));
+        return Container({ { "RDEF", std::vector<uint8_t>(16, 0) }, { "ISGN", SignatureChunk("ISGN", inputs) },
+                           { "OSG5", SignatureChunk("OSG5", routed) }, { "SHEX", std::vector<uint8_t>(64, 0) } });
+    }
+
+    bool Parse(const std::vector<uint8_t>& bytes, ShaderSignature::Kind kind, std::vector<SignatureElement>* out) {
+        return ShaderSignature::Parse(bytes.data(), bytes.size(), kind, out);
+    }
+
+    void ExpectSameElements(const std::vector<SignatureElement>& actual, const std::vector<SignatureElement>& expected) {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            EXPECT_EQ(actual[i].semanticName, expected[i].semanticName) << i;
+            EXPECT_EQ(actual[i].semanticIndex, expected[i].semanticIndex) << i;
+            EXPECT_EQ(actual[i].systemValue, expected[i].systemValue) << i;
+            EXPECT_EQ(actual[i].componentType, expected[i].componentType) << i;
+            EXPECT_EQ(actual[i].registerIndex, expected[i].registerIndex) << i;
+            EXPECT_EQ(actual[i].mask, expected[i].mask) << i;
+            EXPECT_EQ(actual[i].stream, expected[i].stream) << i;
+            EXPECT_EQ(actual[i].minPrecision, expected[i].minPrecision) << i;
+        }
+    }
+}
+
+TEST(ShaderSignature, ParsesInputAndOutputChunks) {
+    std::vector<SignatureElement> inputs = { Element("POSITION", 0, 0, 0x7), Element("BLENDINDICES", 0, 1, 0xF, Graphics::kComponentUInt32) };
+    std::vector<SignatureElement> outputs = VertexOutputs();
+    std::vector<uint8_t> bytes = Container({ { "RDEF", std::vector<uint8_t>(8, 0) }, { "ISGN", SignatureChunk("ISGN", inputs) },
+                                             { "OSGN", SignatureChunk("OSGN", outputs) } });
+
+    std::vector<SignatureElement> parsed;
+    ASSERT_TRUE(Parse(bytes, ShaderSignature::Kind::Input, &parsed));
+    ExpectSameElements(parsed, inputs);
+    ASSERT_TRUE(Parse(bytes, ShaderSignature::Kind::Output, &parsed));
+    ExpectSameElements(parsed, outputs);
+    EXPECT_EQ(ShaderSignature::FindSystemValue(parsed, Graphics::kSystemValuePosition), &parsed[0]);
+    EXPECT_EQ(ShaderSignature::FindSystemValue(parsed, Graphics::kSystemValueClipDistance), nullptr);
+}
+
+TEST(ShaderSignature, ParsesStreamAndMinPrecisionVariants) {
+    std::vector<SignatureElement> outputs = VertexOutputs();
+    outputs[1].stream = 1;
+    outputs[3].minPrecision = 1;
+
+    std::vector<SignatureElement> parsed;
+    ASSERT_TRUE(Parse(Container({ { "OSG1", SignatureChunk("OSG1", outputs) } }), ShaderSignature::Kind::Output, &parsed));
+    ExpectSameElements(parsed, outputs);
+    ASSERT_TRUE(Parse(Container({ { "ISG1", SignatureChunk("ISG1", outputs) } }), ShaderSignature::Kind::Input, &parsed));
+    ExpectSameElements(parsed, outputs);
+
+    // OSG5 has streams but no min precision
+    outputs[3].minPrecision = 0;
+    ASSERT_TRUE(Parse(Container({ { "OSG5", SignatureChunk("OSG5", outputs) } }), ShaderSignature::Kind::Output, &parsed));
+    ExpectSameElements(parsed, outputs);
+
+    // An output chunk is not an input signature, and the other way round
+    EXPECT_FALSE(Parse(Container({ { "OSG5", SignatureChunk("OSG5", outputs) } }), ShaderSignature::Kind::Input, &parsed));
+    EXPECT_FALSE(Parse(Container({ { "ISGN", SignatureChunk("ISGN", outputs) } }), ShaderSignature::Kind::Output, &parsed));
+}
+
+TEST(ShaderSignature, RejectsMalformedContainers) {
+    std::vector<SignatureElement> parsed;
+    EXPECT_FALSE(ShaderSignature::Parse(nullptr, 64, ShaderSignature::Kind::Output, &parsed));
+
+    const std::vector<uint8_t> valid = Container({ { "OSGN", SignatureChunk("OSGN", VertexOutputs()) } });
+    ASSERT_TRUE(Parse(valid, ShaderSignature::Kind::Output, &parsed));
+
+    std::vector<uint8_t> bytes = valid;
+    bytes[0] = 'X';
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "magic";
+
+    bytes = valid;
+    PutU32(bytes, 28, 1000);
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "chunk count past the end";
+
+    bytes = valid;
+    PutU32(bytes, 32, (uint32_t)bytes.size() - 4);
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "chunk header past the end";
+
+    bytes = valid;
+    PutU32(bytes, 36 + 4, (uint32_t)bytes.size());
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "chunk size past the end";
+
+    bytes = valid;
+    PutU32(bytes, 36 + 8, 1000);
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "element count past the chunk";
+
+    bytes = valid;
+    PutU32(bytes, 36 + 12, 0xFFFFFFF0u);
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "first element past the chunk";
+
+    bytes = valid;
+    PutU32(bytes, 36 + 16, 0x10000);
+    EXPECT_FALSE(Parse(bytes, ShaderSignature::Kind::Output, &parsed)) << "name offset past the chunk";
+
+    // The last name runs into the end of the chunk without a terminator
+    std::vector<uint8_t> chunk = SignatureChunk("OSGN", { Element("COLOR", 0, 0, 0xF) });
+    while (chunk.back() != 'R') chunk.pop_back();
+    EXPECT_FALSE(Parse(Container({ { "OSGN", chunk } }), ShaderSignature::Kind::Output, &parsed)) << "unterminated name";
+
+    EXPECT_FALSE(Parse(Container({ { "SHEX", std::vector<uint8_t>(16, 0) } }), ShaderSignature::Kind::Output, &parsed)) << "no signature";
+}
+
+TEST(ShaderSignature, RejectsEveryTruncation) {
+    const std::vector<uint8_t> valid = GeometryShader(VertexOutputs(), VertexOutputs());
+    std::vector<SignatureElement> parsed;
+    ASSERT_TRUE(Parse(valid, ShaderSignature::Kind::Output, &parsed));
+
+    // Copies, so reads past the truncated size land outside the allocation (and show up under ASan)
+    size_t osgnEnd = valid.size() - 8 - 64;
+    for (size_t size = 0; size < osgnEnd; ++size) {
+        std::vector<uint8_t> truncated(valid.begin(), valid.begin() + size);
+        ASSERT_FALSE(ShaderSignature::Parse(truncated.data(), truncated.size(), ShaderSignature::Kind::Output, &parsed)) << size;
+    }
+}
+
+TEST(ShaderSignature, LinksMatchingSemanticsRegistersAndMasks) {
+    std::vector<SignatureElement> producer = VertexOutputs();
+    std::vector<SignatureElement> consumer = { Element("texcoord", 1, 1, 0xC), Element("COLOR", 0, 2, 0x7) };
+    EXPECT_TRUE(ShaderSignature::Links(producer, consumer)); // Case-insensitive, fewer components read
+    EXPECT_TRUE(ShaderSignature::Links(producer, {}));
+
+    std::vector<SignatureElement> wider = { Element("TEXCOORD", 0, 1, 0x7) };
+    EXPECT_FALSE(ShaderSignature::Links(producer, wider));
+    std::vector<SignatureElement> moved = { Element("COLOR", 0, 3, 0xF) };
+    EXPECT_FALSE(ShaderSignature::Links(producer, moved));
+    std::vector<SignatureElement> otherIndex = { Element("COLOR", 1, 2, 0xF) };
+    EXPECT_FALSE(ShaderSignature::Links(producer, otherIndex));
+    std::vector<SignatureElement> otherType = { Element("COLOR", 0, 2, 0xF, Graphics::kComponentUInt32) };
+    EXPECT_FALSE(ShaderSignature::Links(producer, otherType));
+
+    // Only stream 0 reaches the rasterizer
+    producer[3].stream = 1;
+    EXPECT_FALSE(ShaderSignature::Links(producer, consumer));
+}
+
+TEST(MultiViewShader, CanReplicateOnlyPlainPassThroughOutputs) {
+    EXPECT_TRUE(MultiViewShader::CanReplicate(VertexOutputs()));
+
+    auto without = [](auto change) {
+        std::vector<SignatureElement> outputs = VertexOutputs();
+        change(outputs);
+        return MultiViewShader::CanReplicate(outputs);
+    };
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o.erase(o.begin()); })) << "no position";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[0].mask = 0x7; })) << "partial position";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[0].componentType = Graphics::kComponentSInt32; })) << "integer position";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[3].mask = 0x5; })) << "mask with a gap";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[3].mask = 0; })) << "empty mask";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[3].minPrecision = 1; })) << "min precision";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[3].stream = 1; })) << "stream 1";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) { o[3].componentType = Graphics::kComponentUnknown; })) << "unknown type";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) {
+        o.push_back(Element("SV_RenderTargetArrayIndex", 0, 3, 0x1, Graphics::kComponentUInt32, Graphics::kSystemValueRenderTargetArrayIndex));
+    })) << "game routes its own slice";
+    EXPECT_FALSE(without([](std::vector<SignatureElement>& o) {
+        o.push_back(Element("SV_ViewportArrayIndex", 0, 3, 0x1, Graphics::kComponentUInt32, Graphics::kSystemValueViewportArrayIndex));
+    })) << "game routes its own viewport";
+}
+
+TEST(MultiViewShader, GeneratesMembersInRegisterOrder) {
+    // Listed out of register order, as a reflection API may return them
+    std::vector<SignatureElement> outputs = VertexOutputs();
+    std::swap(outputs[0], outputs[3]);
+    std::swap(outputs[1], outputs[2]);
+    outputs.push_back(Element("BLENDINDICES", 2, 3, 0x3, Graphics::kComponentSInt32));
+
+    std::string hlsl = MultiViewShader::GenerateGeometryShader(outputs, PrimitiveClass::Triangle);
+    const char* members =
+        "    float4 e0 : SV_Position;\n"
+        "    float2 e1 : TEXCOORD;\n"
+        "    float2 e2 : TEXCOORD1;\n"
+        "    float4 e3 : COLOR;\n"
+        "    int2 e4 : BLENDINDICES2;\n";
+    EXPECT_NE(hlsl.find(std::string("struct VertexData\n{\n") + members + "};"), std::string::npos) << hlsl;
+    EXPECT_NE(hlsl.find(std::string("struct FaceVertex\n{\n") + members + "    uint face : SV_RenderTargetArrayIndex;\n"
+                                    "    uint viewport : SV_ViewportArrayIndex;\n};"), std::string::npos) << hlsl;
+
+    // Position goes through the face transform, everything else passes through
+    EXPECT_NE(hlsl.find("float4 p = mul(input[i].e0, FaceClip[face]);"), std::string::npos);
+    EXPECT_NE(hlsl.find("o.e0 = position[v];"), std::string::npos);
+    for (const char* copy : { "o.e1 = input[v].e1;", "o.e3 = input[v].e3;", "o.e4 = input[v].e4;" }) {
+        EXPECT_NE(hlsl.find(copy), std::string::npos) << copy;
+    }
+    EXPECT_NE(hlsl.find("register(b" + std::to_string(MultiViewShader::kFaceTransformSlot) + ")"), std::string::npos);
+    EXPECT_NE(hlsl.find("[instance(6)]"), std::string::npos);
+    EXPECT_NE(hlsl.find("if ((FaceMask & (1u << face)) == 0) return;"), std::string::npos);
+}
+
+TEST(MultiViewShader, GeneratesEachPrimitiveClass) {
+    struct Case {
+        PrimitiveClass primitive;
+        const char* input;
+        const char* stream;
+        int vertices;
+    };
+    for (const Case& c : { Case{ PrimitiveClass::Triangle, "triangle", "TriangleStream", 3 }, Case{ PrimitiveClass::Line, "line", "LineStream", 2 },
+                           Case{ PrimitiveClass::Point, "point", "PointStream", 1 } }) {
+        std::string hlsl = MultiViewShader::GenerateGeometryShader(VertexOutputs(), c.primitive);
+        std::string count = std::to_string(c.vertices);
+        std::string entry = std::string("void main(") + c.input + " VertexData input[" + count + "], uint face : SV_GSInstanceID, inout " +
+                            c.stream + "<FaceVertex> stream)";
+        EXPECT_NE(hlsl.find(entry), std::string::npos) << hlsl;
+        EXPECT_NE(hlsl.find("[maxvertexcount(" + count + ")]"), std::string::npos) << hlsl;
+        EXPECT_NE(hlsl.find("for (uint v = 0; v < " + count + "; ++v)"), std::string::npos) << hlsl;
+    }
+}
+
+TEST(MultiViewShader, VerifiesGeneratedShaderSignatures) {
+    std::vector<SignatureElement> outputs = VertexOutputs();
+    std::vector<uint8_t> bytecode = GeometryShader(outputs, outputs);
+    EXPECT_TRUE(MultiViewShader::VerifyGeometryShader(outputs, bytecode.data(), bytecode.size()));
+
+    // The compiler packed a pass-through output differently: the pixel shader would no longer link
+    std::vector<SignatureElement> repacked = outputs;
+    repacked[2].registerIndex = 3;
+    repacked[2].mask = 0x3;
+    bytecode = GeometryShader(outputs, repacked);
+    EXPECT_FALSE(MultiViewShader::VerifyGeometryShader(outputs, bytecode.data(), bytecode.size()));
+
+    // An output dropped, or an input the VS does not write
+    std::vector<SignatureElement> fewer(outputs.begin(), outputs.end() - 1);
+    bytecode = GeometryShader(outputs, fewer);
+    EXPECT_FALSE(MultiViewShader::VerifyGeometryShader(outputs, bytecode.data(), bytecode.size()));
+    std::vector<SignatureElement> more = outputs;
+    more.push_back(Element("NORMAL", 0, 3, 0x7));
+    bytecode = GeometryShader(more, outputs);
+    EXPECT_FALSE(MultiViewShader::VerifyGeometryShader(outputs, bytecode.data(), bytecode.size()));
+
+    // No output signature at all
+    bytecode = Container({ { "ISGN", SignatureChunk("ISGN", outputs) } });
+    EXPECT_FALSE(MultiViewShader::VerifyGeometryShader(outputs, bytecode.data(), bytecode.size()));
+}
@@ -0,0 +1,189 @@
+#include "pch.h"
+#include "Graphics/StateGuard.h"
+#include "Support/CountingDeviceContext.h"
+#include <gtest/gtest.h>
+
+using namespace Graphics;
+using Microsoft::WRL::ComPtr;
+using Testing::CountingDeviceContext;
+
+namespace {
+    // Real views and buffers from a WARP device, bound on the counting double
+    class StateGuardTest : public testing::Test {
+    protected:
+        void SetUp() override {
+            ASSERT_TRUE(SUCCEEDED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION,
+                                                    m_device.GetAddressOf(), nullptr, nullptr)));
+            for (auto& buffer : m_buffers) buffer = CreateConstantBuffer();
+            for (auto& rtv : m_rtvs) rtv = CreateRenderTarget();
+
+            D3D11_TEXTURE2D_DESC desc = { 64, 64, 1, 1, DXGI_FORMAT_D24_UNORM_S8_UINT, { 1, 0 }, D3D11_USAGE_DEFAULT, D3D11_BIND_DEPTH_STENCIL };
+            ComPtr<ID3D11Texture2D> depth;
+            ASSERT_TRUE(SUCCEEDED(m_device->CreateTexture2D(&desc, nullptr, depth.GetAddressOf())));
+            ASSERT_TRUE(SUCCEEDED(m_device->CreateDepthStencilView(depth.Get(), nullptr, m_dsv.GetAddressOf())));
+        }
+
+        ComPtr<ID3D11Buffer> CreateConstantBuffer() {
+            D3D11_BUFFER_DESC desc = { 4096, D3D11_USAGE_DEFAULT, D3D11_BIND_CONSTANT_BUFFER };
+            ComPtr<ID3D11Buffer> buffer;
+            m_device->CreateBuffer(&desc, nullptr, buffer.GetAddressOf());
+            return buffer;
+        }
+
+        ComPtr<ID3D11RenderTargetView> CreateRenderTarget() {
+            D3D11_TEXTURE2D_DESC desc = { 64, 64, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, { 1, 0 }, D3D11_USAGE_DEFAULT, D3D11_BIND_RENDER_TARGET };
+            ComPtr<ID3D11Texture2D> texture;
+            ComPtr<ID3D11RenderTargetView> rtv;
+            if (SUCCEEDED(m_device->CreateTexture2D(&desc, nullptr, texture.GetAddressOf()))) {
+                m_device->CreateRenderTargetView(texture.Get(), nullptr, rtv.GetAddressOf());
+            }
+            return rtv;
+        }
+
+        static ULONG RefCount(IUnknown* object) {
+            object->AddRef();
+            return object->Release();
+        }
+
+        // Game state: camera buffer at VS slot 3 with a constant offset, two render targets, depth, two viewports
+        // and a scissor rect
+        void BindGameState() {
+            UINT first = 16, count = 32;
+            m_context.VSSetConstantBuffers1(3, 1, m_buffers[0].GetAddressOf(), &first, &count);
+            ID3D11RenderTargetView* rtvs[2] = { m_rtvs[0].Get(), m_rtvs[1].Get() };
+            m_context.OMSetRenderTargets(2, rtvs, m_dsv.Get());
+            D3D11_VIEWPORT viewports[2] = { { 0, 0, 64, 64, 0, 1 }, { 8, 8, 32, 32, 0, 1 } };
+            m_context.RSSetViewports(2, viewports);
+            D3D11_RECT scissor = { 1, 2, 3, 4 };
+            m_context.RSSetScissorRects(1, &scissor);
+            m_context.GSSetConstantBuffers(0, 1, m_buffers[1].GetAddressOf());
+            m_context.ResetCalls();
+        }
+
+        // What a face draw does inside the guard
+        void OverwriteState() {
+            UINT first = 0, count = 16;
+            m_context.VSSetConstantBuffers1(3, 1, m_buffers[2].GetAddressOf(), &first, &count);
+            m_context.OMSetRenderTargets(1, m_rtvs[2].GetAddressOf(), nullptr);
+            D3D11_VIEWPORT viewport = { 0, 0, 16, 16, 0, 1 };
+            m_context.RSSetViewports(1, &viewport);
+            D3D11_RECT scissor = { 0, 0, 16, 16 };
+            m_context.RSSetScissorRects(1, &scissor);
+            ID3D11Buffer* none = nullptr;
+            m_context.GSSetConstantBuffers(0, 1, &none);
+        }
+
+        void ExpectGameState(bool constantBuffer, bool targets, bool viewports, bool scissors, bool gs) {
+            const auto& vs = m_context.stages[CountingDeviceContext::VS];
+            EXPECT_EQ(vs.constantBuffers[3].Get() == m_buffers[0].Get(), constantBuffer);
+            if (constantBuffer) {
+                EXPECT_EQ(vs.firstConstant[3], 16u);
+                EXPECT_EQ(vs.numConstants[3], 32u);
+            }
+            EXPECT_EQ(m_context.renderTargets[0].Get() == m_rtvs[0].Get() && m_context.renderTargets[1].Get() == m_rtvs[1].Get() &&
+                      m_context.depthStencil.Get() == m_dsv.Get(), targets);
+            EXPECT_EQ(m_context.numViewports == 2 && m_context.viewports[1].TopLeftX == 8.0f, viewports);
+            EXPECT_EQ(m_context.numScissorRects == 1 && m_context.scissorRects[0].left == 1, scissors);
+            EXPECT_EQ(m_context.stages[CountingDeviceContext::GS].constantBuffers[0].Get() == m_buffers[1].Get(), gs);
+        }
+
+        ComPtr<ID3D11Device> m_device;
+        ComPtr<ID3D11Buffer> m_buffers[3];
+        ComPtr<ID3D11RenderTargetView> m_rtvs[3];
+        ComPtr<ID3D11DepthStencilView> m_dsv;
+        CountingDeviceContext m_context;
+    };
+}
+
+TEST_F(StateGuardTest, DrawReplicationGuardCostsFiveCalls) {
+    // The per-draw guard in CubemapManager: VS camera slot plus render targets, with the D3D11.1 interface supplied
+    BindGameState();
+    {
+        StateGuard<kStateVSConstantBuffer | kStateRenderTargets> guard(&m_context, 3, &m_context);
+        EXPECT_EQ(m_context.TotalCalls(), 2);
+        EXPECT_EQ(guard.GetDepthStencilView(), m_dsv.Get());
+        m_context.ResetCalls();
+        OverwriteState();
+        m_context.ResetCalls();
+    }
+    EXPECT_EQ(m_context.TotalCalls(), 3);
+    EXPECT_EQ(m_context.Calls("VSSetConstantBuffers"), 1); // Unbind before re-binding with offsets
+    EXPECT_EQ(m_context.Calls("VSSetConstantBuffers1"), 1);
+    EXPECT_EQ(m_context.Calls("OMSetRenderTargets"), 1);
+    ExpectGameState(true, true, false, false, false);
+}
+
+TEST_F(StateGuardTest, QueriesContext1OnlyWhenNotSupplied) {
+    BindGameState();
+    {
+        StateGuard<kStateVSConstantBuffer> guard(&m_context, 3);
+        EXPECT_EQ(m_context.Calls("QueryInterface"), 1);
+        EXPECT_EQ(m_context.Calls("VSGetConstantBuffers1"), 1);
+        OverwriteState();
+    }
+    ExpectGameState(true, false, false, false, false);
+}
+
+TEST_F(StateGuardTest, D3D11_0ContextRestoresWithoutOffsets) {
+    CountingDeviceContext context(D3D11_DEVICE_CONTEXT_IMMEDIATE, false);
+    context.VSSetConstantBuffers(1, 1, m_buffers[0].GetAddressOf());
+    context.ResetCalls();
+    {
+        StateGuard<kStateVSConstantBuffer> guard(&context, 1);
+        context.VSSetConstantBuffers(1, 1, m_buffers[1].GetAddressOf());
+    }
+    EXPECT_EQ(context.stages[CountingDeviceContext::VS].constantBuffers[1].Get(), m_buffers[0].Get());
+    EXPECT_EQ(context.Calls("VSGetConstantBuffers"), 1);
+    EXPECT_EQ(context.Calls("VSGetConstantBuffers1"), 0);
+    EXPECT_EQ(context.Calls("VSSetConstantBuffers1"), 0);
+}
+
+TEST_F(StateGuardTest, EachGroupTouchesOnlyItsOwnState) {
+    BindGameState();
+    {
+        StateGuard<kStateViewports> guard(&m_context);
+        OverwriteState();
+    }
+    ExpectGameState(false, false, true, false, false);
+
+    BindGameState();
+    {
+        StateGuard<kStateScissorRects> guard(&m_context);
+        OverwriteState();
+    }
+    ExpectGameState(false, false, false, true, false);
+
+    BindGameState();
+    {
+        StateGuard<kStateGeometryShader> guard(&m_context);
+        OverwriteState();
+    }
+    ExpectGameState(false, false, false, false, true);
+    EXPECT_EQ(m_context.Calls("GSGetShader"), 1);
+    EXPECT_EQ(m_context.Calls("GSSetShader"), 1);
+}
+
+TEST_F(StateGuardTest, ReplayGuardRestoresEverythingItSaved) {
+    // DrawRecorder's guard around a flush
+    BindGameState();
+    {
+        StateGuard<kStateRenderTargets | kStateViewports | kStateScissorRects> guard(&m_context);
+        OverwriteState();
+    }
+    EXPECT_EQ(m_context.TotalCalls(), 6 + 5); // 3 saves and 3 restores, plus the 5 overwrites
+    ExpectGameState(false, true, true, true, false);
+}
+
+TEST_F(StateGuardTest, ReferencesAreBalanced) {
+    BindGameState();
+    ULONG buffer = RefCount(m_buffers[0].Get());
+    ULONG rtv = RefCount(m_rtvs[0].Get());
+    ULONG dsv = RefCount(m_dsv.Get());
+    {
+        StateGuard<kStateVSConstantBuffer | kStateRenderTargets | kStateGeometryShader> guard(&m_context, 3, &m_context);
+        OverwriteState();
+    }
+    EXPECT_EQ(RefCount(m_buffers[0].Get()), buffer);
+    EXPECT_EQ(RefCount(m_rtvs[0].Get()), rtv);
+    EXPECT_EQ(RefCount(m_dsv.Get()), dsv);
+}
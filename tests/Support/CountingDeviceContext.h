@@ -0,0 +1,454 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Testing {
+    using Microsoft::WRL::ComPtr;
+
+    // ID3D11DeviceContext1 double: counts every call by method name and keeps the pipeline bindings the addon reads
+    // back (shaders, constant buffers with offsets, SRVs, samplers, IA, RS and OM state), holding a reference to each
+    // bound object like the runtime does. Map on a buffer hands out CPU memory kept per buffer, so the contents written
+    // through it can be inspected; UpdateSubresource writes and CopyResource copies that memory too. GetDevice returns
+    // `device` when one is set. Nothing is rendered; draws only invoke onDraw.
+    class CountingDeviceContext : public ID3D11DeviceContext1 {
+    public:
+        static constexpr UINT kCBSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+        static constexpr UINT kSRVSlots = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+        static constexpr UINT kSamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+        static constexpr UINT kVBSlots = D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT;
+        static constexpr UINT kRTSlots = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+        static constexpr UINT kViewportSlots = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+        static constexpr UINT kUAVSlots = D3D11_1_UAV_SLOT_COUNT;
+
+        enum Stage { VS, HS, DS, GS, PS, CS, kStageCount };
+
+        struct StageState {
+            ComPtr<ID3D11DeviceChild> shader;
+            ComPtr<ID3D11Buffer> constantBuffers[kCBSlots];
+            UINT firstConstant[kCBSlots] = {};
+            UINT numConstants[kCBSlots] = {};
+            ComPtr<ID3D11ShaderResourceView> srvs[kSRVSlots];
+            ComPtr<ID3D11SamplerState> samplers[kSamplerSlots];
+        };
+
+        struct DrawCall {
+            bool indexed = false;
+            UINT count = 0;
+            UINT instanceCount = 1;
+        };
+
+        explicit CountingDeviceContext(D3D11_DEVICE_CONTEXT_TYPE type = D3D11_DEVICE_CONTEXT_IMMEDIATE, bool supports11_1 = true)
+            : m_type(type), m_supports11_1(supports11_1) {}
+
+        int Calls(const std::string& method) const {
+            auto it = m_calls.find(method);
+            return it == m_calls.end() ? 0 : it->second;
+        }
+        int TotalCalls() const { return m_total; }
+        void ResetCalls() { m_calls.clear(); m_total = 0; }
+
+        // Bound state, readable (and writable to set up a scenario) without counting
+        StageState stages[kStageCount];
+        ComPtr<ID3D11RenderTargetView> renderTargets[kRTSlots];
+        ComPtr<ID3D11DepthStencilView> depthStencil;
+        D3D11_VIEWPORT viewports[kViewportSlots] = {};
+        UINT numViewports = 0;
+        D3D11_RECT scissorRects[kViewportSlots] = {};
+        UINT numScissorRects = 0;
+        ComPtr<ID3D11InputLayout> inputLayout;
+        D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+        ComPtr<ID3D11Buffer> indexBuffer;
+        DXGI_FORMAT indexFormat = DXGI_FORMAT_UNKNOWN;
+        UINT indexOffset = 0;
+        ComPtr<ID3D11Buffer> vertexBuffers[kVBSlots];
+        UINT vertexStrides[kVBSlots] = {};
+        UINT vertexOffsets[kVBSlots] = {};
+        ComPtr<ID3D11RasterizerState> rasterizerState;
+        ComPtr<ID3D11BlendState> blendState;
+        FLOAT blendFactor[4] = {};
+        UINT sampleMask = 0xFFFFFFFF;
+        ComPtr<ID3D11DepthStencilState> depthStencilState;
+        UINT stencilRef = 0;
+
+        std::vector<DrawCall> draws;
+        std::function<void(const DrawCall&)> onDraw;
+        ComPtr<ID3D11Device> device;
+
+        // CPU copy of a buffer's contents as last written through Map/UpdateSubresource
+        std::vector<uint8_t>& Contents(ID3D11Resource* resource) {
+            std::vector<uint8_t>& bytes = m_contents[resource];
+            ComPtr<ID3D11Buffer> buffer;
+            if (bytes.empty() && resource && SUCCEEDED(resource->QueryInterface(IID_PPV_ARGS(buffer.GetAddressOf())))) {
+                D3D11_BUFFER_DESC desc;
+                buffer->GetDesc(&desc);
+                bytes.assign(desc.ByteWidth, 0);
+            }
+            return bytes;
+        }
+
+        // IUnknown (the double lives on the stack; references are not tracked)
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override {
+            Count("QueryInterface");
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(ID3D11DeviceContext) ||
+                (m_supports11_1 && riid == __uuidof(ID3D11DeviceContext1))) {
+                *object = static_cast<ID3D11DeviceContext1*>(this);
+                return S_OK;
+            }
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+        ULONG STDMETHODCALLTYPE Release() override { return 1; }
+
+        // ID3D11DeviceChild
+        void STDMETHODCALLTYPE GetDevice(ID3D11Device** out) override {
+            Count("GetDevice");
+            *out = device.Get();
+            if (*out) (*out)->AddRef();
+        }
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override { Count("GetPrivateData"); return E_NOTIMPL; }
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override { Count("SetPrivateData"); return E_NOTIMPL; }
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override { Count("SetPrivateDataInterface"); return E_NOTIMPL; }
+
+        // Shader stages
+        void STDMETHODCALLTYPE VSSetConstantBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers) override { Count("VSSetConstantBuffers"); SetConstantBuffers(VS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE HSSetConstantBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers) override { Count("HSSetConstantBuffers"); SetConstantBuffers(HS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE DSSetConstantBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers) override { Count("DSSetConstantBuffers"); SetConstantBuffers(DS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE GSSetConstantBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers) override { Count("GSSetConstantBuffers"); SetConstantBuffers(GS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE PSSetConstantBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers) override { Count("PSSetConstantBuffers"); SetConstantBuffers(PS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE CSSetConstantBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers) override { Count("CSSetConstantBuffers"); SetConstantBuffers(CS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE VSGetConstantBuffers(UINT start, UINT num, ID3D11Buffer** buffers) override { Count("VSGetConstantBuffers"); GetConstantBuffers(VS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE HSGetConstantBuffers(UINT start, UINT num, ID3D11Buffer** buffers) override { Count("HSGetConstantBuffers"); GetConstantBuffers(HS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE DSGetConstantBuffers(UINT start, UINT num, ID3D11Buffer** buffers) override { Count("DSGetConstantBuffers"); GetConstantBuffers(DS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE GSGetConstantBuffers(UINT start, UINT num, ID3D11Buffer** buffers) override { Count("GSGetConstantBuffers"); GetConstantBuffers(GS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE PSGetConstantBuffers(UINT start, UINT num, ID3D11Buffer** buffers) override { Count("PSGetConstantBuffers"); GetConstantBuffers(PS, start, num, buffers, nullptr, nullptr); }
+        void STDMETHODCALLTYPE CSGetConstantBuffers(UINT start, UINT num, ID3D11Buffer** buffers) override { Count("CSGetConstantBuffers"); GetConstantBuffers(CS, start, num, buffers, nullptr, nullptr); }
+
+        void STDMETHODCALLTYPE VSSetConstantBuffers1(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) override { Count("VSSetConstantBuffers1"); SetConstantBuffers(VS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE HSSetConstantBuffers1(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) override { Count("HSSetConstantBuffers1"); SetConstantBuffers(HS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE DSSetConstantBuffers1(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) override { Count("DSSetConstantBuffers1"); SetConstantBuffers(DS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE GSSetConstantBuffers1(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) override { Count("GSSetConstantBuffers1"); SetConstantBuffers(GS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE PSSetConstantBuffers1(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) override { Count("PSSetConstantBuffers1"); SetConstantBuffers(PS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE CSSetConstantBuffers1(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) override { Count("CSSetConstantBuffers1"); SetConstantBuffers(CS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE VSGetConstantBuffers1(UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) override { Count("VSGetConstantBuffers1"); GetConstantBuffers(VS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE HSGetConstantBuffers1(UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) override { Count("HSGetConstantBuffers1"); GetConstantBuffers(HS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE DSGetConstantBuffers1(UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) override { Count("DSGetConstantBuffers1"); GetConstantBuffers(DS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE GSGetConstantBuffers1(UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) override { Count("GSGetConstantBuffers1"); GetConstantBuffers(GS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE PSGetConstantBuffers1(UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) override { Count("PSGetConstantBuffers1"); GetConstantBuffers(PS, start, num, buffers, first, count); }
+        void STDMETHODCALLTYPE CSGetConstantBuffers1(UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) override { Count("CSGetConstantBuffers1"); GetConstantBuffers(CS, start, num, buffers, first, count); }
+
+        void STDMETHODCALLTYPE VSSetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView* const* views) override { Count("VSSetShaderResources"); SetSlots(stages[VS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE HSSetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView* const* views) override { Count("HSSetShaderResources"); SetSlots(stages[HS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE DSSetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView* const* views) override { Count("DSSetShaderResources"); SetSlots(stages[DS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE GSSetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView* const* views) override { Count("GSSetShaderResources"); SetSlots(stages[GS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE PSSetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView* const* views) override { Count("PSSetShaderResources"); SetSlots(stages[PS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE CSSetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView* const* views) override { Count("CSSetShaderResources"); SetSlots(stages[CS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE VSGetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView** views) override { Count("VSGetShaderResources"); GetSlots(stages[VS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE HSGetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView** views) override { Count("HSGetShaderResources"); GetSlots(stages[HS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE DSGetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView** views) override { Count("DSGetShaderResources"); GetSlots(stages[DS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE GSGetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView** views) override { Count("GSGetShaderResources"); GetSlots(stages[GS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE PSGetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView** views) override { Count("PSGetShaderResources"); GetSlots(stages[PS].srvs, start, num, views); }
+        void STDMETHODCALLTYPE CSGetShaderResources(UINT start, UINT num, ID3D11ShaderResourceView** views) override { Count("CSGetShaderResources"); GetSlots(stages[CS].srvs, start, num, views); }
+
+        void STDMETHODCALLTYPE VSSetSamplers(UINT start, UINT num, ID3D11SamplerState* const* samplers) override { Count("VSSetSamplers"); SetSlots(stages[VS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE HSSetSamplers(UINT start, UINT num, ID3D11SamplerState* const* samplers) override { Count("HSSetSamplers"); SetSlots(stages[HS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE DSSetSamplers(UINT start, UINT num, ID3D11SamplerState* const* samplers) override { Count("DSSetSamplers"); SetSlots(stages[DS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE GSSetSamplers(UINT start, UINT num, ID3D11SamplerState* const* samplers) override { Count("GSSetSamplers"); SetSlots(stages[GS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE PSSetSamplers(UINT start, UINT num, ID3D11SamplerState* const* samplers) override { Count("PSSetSamplers"); SetSlots(stages[PS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE CSSetSamplers(UINT start, UINT num, ID3D11SamplerState* const* samplers) override { Count("CSSetSamplers"); SetSlots(stages[CS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE VSGetSamplers(UINT start, UINT num, ID3D11SamplerState** samplers) override { Count("VSGetSamplers"); GetSlots(stages[VS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE HSGetSamplers(UINT start, UINT num, ID3D11SamplerState** samplers) override { Count("HSGetSamplers"); GetSlots(stages[HS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE DSGetSamplers(UINT start, UINT num, ID3D11SamplerState** samplers) override { Count("DSGetSamplers"); GetSlots(stages[DS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE GSGetSamplers(UINT start, UINT num, ID3D11SamplerState** samplers) override { Count("GSGetSamplers"); GetSlots(stages[GS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE PSGetSamplers(UINT start, UINT num, ID3D11SamplerState** samplers) override { Count("PSGetSamplers"); GetSlots(stages[PS].samplers, start, num, samplers); }
+        void STDMETHODCALLTYPE CSGetSamplers(UINT start, UINT num, ID3D11SamplerState** samplers) override { Count("CSGetSamplers"); GetSlots(stages[CS].samplers, start, num, samplers); }
+
+        void STDMETHODCALLTYPE VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const*, UINT) override { Count("VSSetShader"); stages[VS].shader = shader; }
+        void STDMETHODCALLTYPE HSSetShader(ID3D11HullShader* shader, ID3D11ClassInstance* const*, UINT) override { Count("HSSetShader"); stages[HS].shader = shader; }
+        void STDMETHODCALLTYPE DSSetShader(ID3D11DomainShader* shader, ID3D11ClassInstance* const*, UINT) override { Count("DSSetShader"); stages[DS].shader = shader; }
+        void STDMETHODCALLTYPE GSSetShader(ID3D11GeometryShader* shader, ID3D11ClassInstance* const*, UINT) override { Count("GSSetShader"); stages[GS].shader = shader; }
+        void STDMETHODCALLTYPE PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const*, UINT) override { Count("PSSetShader"); stages[PS].shader = shader; }
+        void STDMETHODCALLTYPE CSSetShader(ID3D11ComputeShader* shader, ID3D11ClassInstance* const*, UINT) override { Count("CSSetShader"); stages[CS].shader = shader; }
+        void STDMETHODCALLTYPE VSGetShader(ID3D11VertexShader** shader, ID3D11ClassInstance**, UINT* count) override { Count("VSGetShader"); GetShader(VS, shader, count); }
+        void STDMETHODCALLTYPE HSGetShader(ID3D11HullShader** shader, ID3D11ClassInstance**, UINT* count) override { Count("HSGetShader"); GetShader(HS, shader, count); }
+        void STDMETHODCALLTYPE DSGetShader(ID3D11DomainShader** shader, ID3D11ClassInstance**, UINT* count) override { Count("DSGetShader"); GetShader(DS, shader, count); }
+        void STDMETHODCALLTYPE GSGetShader(ID3D11GeometryShader** shader, ID3D11ClassInstance**, UINT* count) override { Count("GSGetShader"); GetShader(GS, shader, count); }
+        void STDMETHODCALLTYPE PSGetShader(ID3D11PixelShader** shader, ID3D11ClassInstance**, UINT* count) override { Count("PSGetShader"); GetShader(PS, shader, count); }
+        void STDMETHODCALLTYPE CSGetShader(ID3D11ComputeShader** shader, ID3D11ClassInstance**, UINT* count) override { Count("CSGetShader"); GetShader(CS, shader, count); }
+
+        void STDMETHODCALLTYPE CSSetUnorderedAccessViews(UINT, UINT, ID3D11UnorderedAccessView* const*, const UINT*) override { Count("CSSetUnorderedAccessViews"); }
+        void STDMETHODCALLTYPE CSGetUnorderedAccessViews(UINT, UINT num, ID3D11UnorderedAccessView** views) override { Count("CSGetUnorderedAccessViews"); Zero(views, num); }
+
+        // Draws
+        void STDMETHODCALLTYPE DrawIndexed(UINT count, UINT, INT) override { Count("DrawIndexed"); RecordDraw(true, count, 1); }
+        void STDMETHODCALLTYPE Draw(UINT count, UINT) override { Count("Draw"); RecordDraw(false, count, 1); }
+        void STDMETHODCALLTYPE DrawIndexedInstanced(UINT count, UINT instances, UINT, INT, UINT) override { Count("DrawIndexedInstanced"); RecordDraw(true, count, instances); }
+        void STDMETHODCALLTYPE DrawInstanced(UINT count, UINT instances, UINT, UINT) override { Count("DrawInstanced"); RecordDraw(false, count, instances); }
+        void STDMETHODCALLTYPE DrawAuto() override { Count("DrawAuto"); }
+        void STDMETHODCALLTYPE DrawIndexedInstancedIndirect(ID3D11Buffer*, UINT) override { Count("DrawIndexedInstancedIndirect"); }
+        void STDMETHODCALLTYPE DrawInstancedIndirect(ID3D11Buffer*, UINT) override { Count("DrawInstancedIndirect"); }
+        void STDMETHODCALLTYPE Dispatch(UINT, UINT, UINT) override { Count("Dispatch"); }
+        void STDMETHODCALLTYPE DispatchIndirect(ID3D11Buffer*, UINT) override { Count("DispatchIndirect"); }
+
+        // Resources
+        HRESULT STDMETHODCALLTYPE Map(ID3D11Resource* resource, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE* mapped) override {
+            Count("Map");
+            std::vector<uint8_t>& bytes = Contents(resource);
+            if (bytes.empty()) return E_INVALIDARG;
+            mapped->pData = bytes.data();
+            mapped->RowPitch = mapped->DepthPitch = (UINT)bytes.size();
+            return S_OK;
+        }
+        void STDMETHODCALLTYPE Unmap(ID3D11Resource*, UINT) override { Count("Unmap"); }
+        void STDMETHODCALLTYPE UpdateSubresource(ID3D11Resource* resource, UINT, const D3D11_BOX* box, const void* data, UINT, UINT) override {
+            Count("UpdateSubresource");
+            WriteContents(resource, box, data);
+        }
+        void STDMETHODCALLTYPE UpdateSubresource1(ID3D11Resource* resource, UINT, const D3D11_BOX* box, const void* data, UINT, UINT, UINT) override {
+            Count("UpdateSubresource1");
+            WriteContents(resource, box, data);
+        }
+        void STDMETHODCALLTYPE CopySubresourceRegion(ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*) override { Count("CopySubresourceRegion"); }
+        void STDMETHODCALLTYPE CopySubresourceRegion1(ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*, UINT) override { Count("CopySubresourceRegion1"); }
+        void STDMETHODCALLTYPE CopyResource(ID3D11Resource* dst, ID3D11Resource* src) override {
+            Count("CopyResource");
+            std::vector<uint8_t> bytes = Contents(src);
+            Contents(dst) = bytes;
+        }
+        void STDMETHODCALLTYPE CopyStructureCount(ID3D11Buffer*, UINT, ID3D11UnorderedAccessView*) override { Count("CopyStructureCount"); }
+        void STDMETHODCALLTYPE ResolveSubresource(ID3D11Resource*, UINT, ID3D11Resource*, UINT, DXGI_FORMAT) override { Count("ResolveSubresource"); }
+        void STDMETHODCALLTYPE GenerateMips(ID3D11ShaderResourceView*) override { Count("GenerateMips"); }
+        void STDMETHODCALLTYPE SetResourceMinLOD(ID3D11Resource*, FLOAT) override { Count("SetResourceMinLOD"); }
+        FLOAT STDMETHODCALLTYPE GetResourceMinLOD(ID3D11Resource*) override { Count("GetResourceMinLOD"); return 0.0f; }
+        void STDMETHODCALLTYPE DiscardResource(ID3D11Resource*) override { Count("DiscardResource"); }
+        void STDMETHODCALLTYPE DiscardView(ID3D11View*) override { Count("DiscardView"); }
+        void STDMETHODCALLTYPE DiscardView1(ID3D11View*, const D3D11_RECT*, UINT) override { Count("DiscardView1"); }
+
+        // Clears
+        void STDMETHODCALLTYPE ClearRenderTargetView(ID3D11RenderTargetView*, const FLOAT[4]) override { Count("ClearRenderTargetView"); }
+        void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(ID3D11UnorderedAccessView*, const UINT[4]) override { Count("ClearUnorderedAccessViewUint"); }
+        void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(ID3D11UnorderedAccessView*, const FLOAT[4]) override { Count("ClearUnorderedAccessViewFloat"); }
+        void STDMETHODCALLTYPE ClearDepthStencilView(ID3D11DepthStencilView*, UINT, FLOAT, UINT8) override { Count("ClearDepthStencilView"); }
+        void STDMETHODCALLTYPE ClearView(ID3D11View*, const FLOAT[4], const D3D11_RECT*, UINT) override { Count("ClearView"); }
+
+        // Input assembler
+        void STDMETHODCALLTYPE IASetInputLayout(ID3D11InputLayout* layout) override { Count("IASetInputLayout"); inputLayout = layout; }
+        void STDMETHODCALLTYPE IAGetInputLayout(ID3D11InputLayout** layout) override { Count("IAGetInputLayout"); Get(inputLayout, layout); }
+        void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY value) override { Count("IASetPrimitiveTopology"); topology = value; }
+        void STDMETHODCALLTYPE IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY* value) override { Count("IAGetPrimitiveTopology"); *value = topology; }
+        void STDMETHODCALLTYPE IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) override {
+            Count("IASetIndexBuffer");
+            indexBuffer = buffer;
+            indexFormat = format;
+            indexOffset = offset;
+        }
+        void STDMETHODCALLTYPE IAGetIndexBuffer(ID3D11Buffer** buffer, DXGI_FORMAT* format, UINT* offset) override {
+            Count("IAGetIndexBuffer");
+            Get(indexBuffer, buffer);
+            if (format) *format = indexFormat;
+            if (offset) *offset = indexOffset;
+        }
+        void STDMETHODCALLTYPE IASetVertexBuffers(UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets) override {
+            Count("IASetVertexBuffers");
+            SetSlots(vertexBuffers, start, num, buffers);
+            for (UINT i = 0; i < num; ++i) {
+                vertexStrides[start + i] = strides ? strides[i] : 0;
+                vertexOffsets[start + i] = offsets ? offsets[i] : 0;
+            }
+        }
+        void STDMETHODCALLTYPE IAGetVertexBuffers(UINT start, UINT num, ID3D11Buffer** buffers, UINT* strides, UINT* offsets) override {
+            Count("IAGetVertexBuffers");
+            GetSlots(vertexBuffers, start, num, buffers);
+            for (UINT i = 0; i < num; ++i) {
+                if (strides) strides[i] = vertexStrides[start + i];
+                if (offsets) offsets[i] = vertexOffsets[start + i];
+            }
+        }
+
+        // Rasterizer
+        void STDMETHODCALLTYPE RSSetState(ID3D11RasterizerState* state) override { Count("RSSetState"); rasterizerState = state; }
+        void STDMETHODCALLTYPE RSGetState(ID3D11RasterizerState** state) override { Count("RSGetState"); Get(rasterizerState, state); }
+        void STDMETHODCALLTYPE RSSetViewports(UINT num, const D3D11_VIEWPORT* values) override {
+            Count("RSSetViewports");
+            numViewports = num;
+            for (UINT i = 0; i < num; ++i) viewports[i] = values[i];
+        }
+        void STDMETHODCALLTYPE RSGetViewports(UINT* num, D3D11_VIEWPORT* values) override {
+            Count("RSGetViewports");
+            if (values) {
+                for (UINT i = 0; i < *num; ++i) values[i] = i < numViewports ? viewports[i] : D3D11_VIEWPORT{};
+            }
+            *num = numViewports;
+        }
+        void STDMETHODCALLTYPE RSSetScissorRects(UINT num, const D3D11_RECT* values) override {
+            Count("RSSetScissorRects");
+            numScissorRects = num;
+            for (UINT i = 0; i < num; ++i) scissorRects[i] = values[i];
+        }
+        void STDMETHODCALLTYPE RSGetScissorRects(UINT* num, D3D11_RECT* values) override {
+            Count("RSGetScissorRects");
+            if (values) {
+                for (UINT i = 0; i < *num; ++i) values[i] = i < numScissorRects ? scissorRects[i] : D3D11_RECT{};
+            }
+            *num = numScissorRects;
+        }
+
+        // Output merger
+        void STDMETHODCALLTYPE OMSetRenderTargets(UINT num, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth) override {
+            Count("OMSetRenderTargets");
+            for (UINT i = 0; i < kRTSlots; ++i) renderTargets[i] = (views && i < num) ? views[i] : nullptr;
+            depthStencil = depth;
+        }
+        void STDMETHODCALLTYPE OMGetRenderTargets(UINT num, ID3D11RenderTargetView** views, ID3D11DepthStencilView** depth) override {
+            Count("OMGetRenderTargets");
+            if (views) GetSlots(renderTargets, 0, num, views);
+            if (depth) Get(depthStencil, depth);
+        }
+        void STDMETHODCALLTYPE OMSetRenderTargetsAndUnorderedAccessViews(UINT num, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth,
+                                                                          UINT, UINT, ID3D11UnorderedAccessView* const*, const UINT*) override {
+            Count("OMSetRenderTargetsAndUnorderedAccessViews");
+            if (num != D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL) {
+                for (UINT i = 0; i < kRTSlots; ++i) renderTargets[i] = (views && i < num) ? views[i] : nullptr;
+                depthStencil = depth;
+            }
+        }
+        void STDMETHODCALLTYPE OMGetRenderTargetsAndUnorderedAccessViews(UINT num, ID3D11RenderTargetView** views, ID3D11DepthStencilView** depth,
+                                                                          UINT, UINT numUAVs, ID3D11UnorderedAccessView** uavs) override {
+            Count("OMGetRenderTargetsAndUnorderedAccessViews");
+            if (views) GetSlots(renderTargets, 0, num, views);
+            if (depth) Get(depthStencil, depth);
+            if (uavs) Zero(uavs, numUAVs);
+        }
+        void STDMETHODCALLTYPE OMSetBlendState(ID3D11BlendState* state, const FLOAT factor[4], UINT mask) override {
+            Count("OMSetBlendState");
+            blendState = state;
+            for (int i = 0; i < 4; ++i) blendFactor[i] = factor ? factor[i] : 1.0f;
+            sampleMask = mask;
+        }
+        void STDMETHODCALLTYPE OMGetBlendState(ID3D11BlendState** state, FLOAT factor[4], UINT* mask) override {
+            Count("OMGetBlendState");
+            if (state) Get(blendState, state);
+            if (factor) for (int i = 0; i < 4; ++i) factor[i] = blendFactor[i];
+            if (mask) *mask = sampleMask;
+        }
+        void STDMETHODCALLTYPE OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT ref) override {
+            Count("OMSetDepthStencilState");
+            depthStencilState = state;
+            stencilRef = ref;
+        }
+        void STDMETHODCALLTYPE OMGetDepthStencilState(ID3D11DepthStencilState** state, UINT* ref) override {
+            Count("OMGetDepthStencilState");
+            if (state) Get(depthStencilState, state);
+            if (ref) *ref = stencilRef;
+        }
+
+        // Stream output, queries, predication
+        void STDMETHODCALLTYPE SOSetTargets(UINT, ID3D11Buffer* const*, const UINT*) override { Count("SOSetTargets"); }
+        void STDMETHODCALLTYPE SOGetTargets(UINT num, ID3D11Buffer** buffers) override { Count("SOGetTargets"); Zero(buffers, num); }
+        void STDMETHODCALLTYPE Begin(ID3D11Asynchronous*) override { Count("Begin"); }
+        void STDMETHODCALLTYPE End(ID3D11Asynchronous*) override { Count("End"); }
+        HRESULT STDMETHODCALLTYPE GetData(ID3D11Asynchronous*, void*, UINT, UINT) override { Count("GetData"); return S_FALSE; }
+        void STDMETHODCALLTYPE SetPredication(ID3D11Predicate*, BOOL) override { Count("SetPredication"); }
+        void STDMETHODCALLTYPE GetPredication(ID3D11Predicate** predicate, BOOL* value) override {
+            Count("GetPredication");
+            if (predicate) *predicate = nullptr;
+            if (value) *value = FALSE;
+        }
+
+        // Context
+        void STDMETHODCALLTYPE ExecuteCommandList(ID3D11CommandList*, BOOL) override { Count("ExecuteCommandList"); }
+        HRESULT STDMETHODCALLTYPE FinishCommandList(BOOL, ID3D11CommandList** list) override { Count("FinishCommandList"); *list = nullptr; return E_NOTIMPL; }
+        void STDMETHODCALLTYPE ClearState() override { Count("ClearState"); }
+        void STDMETHODCALLTYPE Flush() override { Count("Flush"); }
+        D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE GetType() override { Count("GetType"); return m_type; }
+        UINT STDMETHODCALLTYPE GetContextFlags() override { Count("GetContextFlags"); return 0; }
+        void STDMETHODCALLTYPE SwapDeviceContextState(ID3DDeviceContextState*, ID3DDeviceContextState** previous) override {
+            Count("SwapDeviceContextState");
+            if (previous) *previous = nullptr;
+        }
+
+    private:
+        void Count(const char* method) {
+            m_calls[method]++;
+            m_total++;
+        }
+
+        template<typename T, size_t N>
+        static void SetSlots(ComPtr<T> (&slots)[N], UINT start, UINT num, T* const* values) {
+            for (UINT i = 0; i < num && start + i < N; ++i) slots[start + i] = values ? values[i] : nullptr;
+        }
+
+        template<typename T, size_t N>
+        static void GetSlots(const ComPtr<T> (&slots)[N], UINT start, UINT num, T** values) {
+            for (UINT i = 0; i < num; ++i) {
+                values[i] = start + i < N ? slots[start + i].Get() : nullptr;
+                if (values[i]) values[i]->AddRef();
+            }
+        }
+
+        template<typename T>
+        static void Get(const ComPtr<T>& slot, T** value) {
+            *value = slot.Get();
+            if (*value) (*value)->AddRef();
+        }
+
+        template<typename T>
+        static void Zero(T** values, UINT num) {
+            for (UINT i = 0; i < num; ++i) values[i] = nullptr;
+        }
+
+        template<typename T>
+        void GetShader(Stage stage, T** shader, UINT* count) {
+            *shader = static_cast<T*>(stages[stage].shader.Get());
+            if (*shader) (*shader)->AddRef();
+            if (count) *count = 0;
+        }
+
+        void SetConstantBuffers(Stage stage, UINT start, UINT num, ID3D11Buffer* const* buffers, const UINT* first, const UINT* count) {
+            StageState& s = stages[stage];
+            SetSlots(s.constantBuffers, start, num, buffers);
+            for (UINT i = 0; i < num && start + i < kCBSlots; ++i) {
+                s.firstConstant[start + i] = first ? first[i] : 0;
+                s.numConstants[start + i] = count ? count[i] : D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT;
+            }
+        }
+
+        void GetConstantBuffers(Stage stage, UINT start, UINT num, ID3D11Buffer** buffers, UINT* first, UINT* count) {
+            const StageState& s = stages[stage];
+            if (buffers) GetSlots(s.constantBuffers, start, num, buffers);
+            for (UINT i = 0; i < num; ++i) {
+                bool bound = start + i < kCBSlots && s.constantBuffers[start + i];
+                if (first) first[i] = bound ? s.firstConstant[start + i] : 0;
+                if (count) count[i] = bound ? s.numConstants[start + i] : 0;
+            }
+        }
+
+        void WriteContents(ID3D11Resource* resource, const D3D11_BOX* box, const void* data) {
+            std::vector<uint8_t>& bytes = Contents(resource);
+            size_t begin = box ? box->left : 0;
+            size_t end = box ? box->right : bytes.size();
+            if (end > bytes.size() || begin > end) return;
+            memcpy(bytes.data() + begin, data, end - begin);
+        }
+
+        void RecordDraw(bool indexed, UINT count, UINT instances) {
+            DrawCall draw;
+            draw.indexed = indexed;
+            draw.count = count;
+            draw.instanceCount = instances;
+            draws.push_back(draw);
+            if (onDraw) onDraw(draw);
+        }
+
+        D3D11_DEVICE_CONTEXT_TYPE m_type;
+        bool m_supports11_1;
+        std::map<std::string, int> m_calls;
+        int m_total = 0;
+        std::map<ID3D11Resource*, std::vector<uint8_t>> m_contents;
+    };
+}
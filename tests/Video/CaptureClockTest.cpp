@@ -0,0 +1,138 @@
+#include "Video/CaptureClock.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using Video::CaptureClock;
+
+namespace {
+    constexpr int64_t kSecond = 1000000000;
+
+    // Time set by the test before each BeginFrame
+    class ManualTimeSource : public Video::TimeSource {
+    public:
+        explicit ManualTimeSource(int64_t* now) : m_now(now) {}
+        int64_t Now() override { return *m_now; }
+
+    private:
+        int64_t* m_now;
+    };
+
+    struct Capture {
+        uint64_t frame;
+        int64_t timestamp;
+    };
+
+    // Runs frames at the given times and returns the captured ones
+    std::vector<Capture> RunFrames(CaptureClock& clock, int64_t& now, const std::vector<int64_t>& times) {
+        std::vector<Capture> captures;
+        for (size_t i = 0; i < times.size(); ++i) {
+            now = times[i];
+            if (clock.BeginFrame()) captures.push_back({ i, clock.GetTimestamp() });
+        }
+        return captures;
+    }
+
+    std::vector<int64_t> Steady(int64_t start, int64_t step, size_t count) {
+        std::vector<int64_t> times(count);
+        for (size_t i = 0; i < count; ++i) times[i] = start + (int64_t)i * step;
+        return times;
+    }
+}
+
+TEST(CaptureClock, DecimatesFastGameToCaptureRate) {
+    int64_t now = 0;
+    CaptureClock clock;
+    clock.Configure(std::make_unique<ManualTimeSource>(&now), 60, false);
+
+    // 144 fps for 10 seconds
+    std::vector<Capture> captures = RunFrames(clock, now, Steady(5 * kSecond, kSecond / 144, 1440));
+    ASSERT_GE(captures.size(), 599u);
+    ASSERT_LE(captures.size(), 601u);
+    for (size_t i = 0; i < captures.size(); ++i) EXPECT_EQ(captures[i].timestamp, (int64_t)i) << i;
+    EXPECT_EQ(clock.GetStats().frames, 1440u);
+    EXPECT_EQ(clock.GetStats().captures, captures.size());
+    EXPECT_EQ(clock.GetStats().skippedSlots, 0u);
+}
+
+TEST(CaptureClock, SlowGameLeavesSlotsEmpty) {
+    int64_t now = 0;
+    CaptureClock clock;
+    clock.Configure(std::make_unique<ManualTimeSource>(&now), 60, false);
+
+    // 30 fps: every frame is captured, on every other slot
+    std::vector<Capture> captures = RunFrames(clock, now, Steady(0, kSecond / 30, 300));
+    ASSERT_EQ(captures.size(), 300u);
+    for (size_t i = 0; i < captures.size(); ++i) EXPECT_EQ(captures[i].timestamp, (int64_t)i * 2) << i;
+    EXPECT_EQ(clock.GetStats().skippedSlots, 299u);
+}
+
+TEST(CaptureClock, SlotGridDoesNotDrift) {
+    int64_t now = 0;
+    CaptureClock clock;
+    clock.Configure(std::make_unique<ManualTimeSource>(&now), 60, false);
+
+    // A game at the capture rate with 2 ms of jitter for an hour; 1/60 s is not a whole number of nanoseconds
+    std::vector<int64_t> times;
+    for (int64_t i = 0; i < 60 * 3600; ++i) times.push_back(i * kSecond / 60 + ((i % 3) - 1) * 2000000);
+    times[0] = 0;
+    std::vector<Capture> captures = RunFrames(clock, now, times);
+
+    ASSERT_FALSE(captures.empty());
+    for (const Capture& capture : captures) {
+        // Each captured frame sits on the slot nearest to its time
+        int64_t slot = (times[capture.frame] * 60 + kSecond / 2) / kSecond;
+        ASSERT_EQ(capture.timestamp, slot) << "frame " << capture.frame;
+    }
+    EXPECT_GE(captures.size(), (size_t)(60 * 3600 - 1));
+}
+
+TEST(CaptureClock, VariableFrameRateTimestampsPastOverflowRange) {
+    int64_t now = 0;
+    CaptureClock clock;
+    clock.Configure(std::make_unique<ManualTimeSource>(&now), 30, true);
+    EXPECT_EQ(clock.GetTimeBase(), CaptureClock::kVariableTimeBase);
+
+    // 30 hours: elapsed nanoseconds times 90000 no longer fit in 64 bits
+    const int64_t hours30 = 30 * 3600 * kSecond;
+    std::vector<Capture> captures = RunFrames(clock, now, { 0, kSecond / 20, hours30, hours30 + kSecond / 20 });
+    ASSERT_EQ(captures.size(), 4u);
+    EXPECT_EQ(captures[0].timestamp, 0);
+    EXPECT_EQ(captures[1].timestamp, 4500);
+    EXPECT_EQ(captures[2].timestamp, 30LL * 3600 * 90000);
+    EXPECT_EQ(captures[3].timestamp, 30LL * 3600 * 90000 + 4500);
+    EXPECT_EQ(clock.GetStats().skippedSlots, (uint64_t)(30 * 3600 * 30 - 1));
+}
+
+TEST(CaptureClock, GameTimeCapturesEveryNthFrame) {
+    CaptureClock clock;
+
+    // A fixed 120 fps timestep captured at 30: frames 0, 4, 8, ... whatever the wall clock does
+    clock.Configure(std::make_unique<Video::GameTimeSource>(kSecond / 120), 30, false);
+    for (uint64_t frame = 0; frame < 1200; ++frame) {
+        bool captured = clock.BeginFrame();
+        ASSERT_EQ(captured, frame % 4 == 0) << frame;
+        if (captured) {
+            EXPECT_EQ(clock.GetTimestamp(), (int64_t)(frame / 4));
+        }
+    }
+
+    // Same rate: every frame
+    clock.Configure(std::make_unique<Video::GameTimeSource>(kSecond / 30), 30, false);
+    for (int64_t frame = 0; frame < 100; ++frame) {
+        ASSERT_TRUE(clock.BeginFrame()) << frame;
+        EXPECT_EQ(clock.GetTimestamp(), frame);
+    }
+}
+
+TEST(CaptureClock, RestartBeginsAtZero) {
+    int64_t now = 0;
+    CaptureClock clock;
+    clock.Configure(std::make_unique<ManualTimeSource>(&now), 60, false);
+    RunFrames(clock, now, Steady(0, kSecond / 60, 100));
+    EXPECT_GT(clock.GetTimestamp(), 90);
+
+    clock.Restart();
+    now += kSecond;
+    ASSERT_TRUE(clock.BeginFrame());
+    EXPECT_EQ(clock.GetTimestamp(), 0);
+}
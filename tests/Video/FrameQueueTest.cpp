@@ -0,0 +1,195 @@
+#include "Video/FrameQueue.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using Video::FrameQueue;
+using Video::QueuePolicy;
+
+namespace {
+    // Long enough for a thread that is not blocked to have returned
+    constexpr auto kSettle = std::chrono::milliseconds(50);
+
+    bool Push(FrameQueue<int>& queue, int value) {
+        int* slot = queue.BeginPush();
+        if (!slot) return false;
+        *slot = value;
+        queue.EndPush();
+        return true;
+    }
+
+    int Pop(FrameQueue<int>& queue) {
+        int* slot = queue.BeginPop();
+        if (!slot) return -1;
+        int value = *slot;
+        queue.EndPop();
+        return value;
+    }
+}
+
+TEST(FrameQueue, BlockWaitsForConsumer) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(2), QueuePolicy::Block);
+    ASSERT_TRUE(Push(queue, 1));
+    ASSERT_TRUE(Push(queue, 2));
+
+    std::atomic<bool> pushed{ false };
+    std::thread producer([&] {
+        Push(queue, 3);
+        pushed = true;
+    });
+    std::this_thread::sleep_for(kSettle);
+    EXPECT_FALSE(pushed);
+
+    // Freeing a slot lets the producer through; nothing is lost
+    EXPECT_EQ(Pop(queue), 1);
+    producer.join();
+    EXPECT_TRUE(pushed);
+    EXPECT_EQ(Pop(queue), 2);
+    EXPECT_EQ(Pop(queue), 3);
+
+    Video::FrameQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.submitted, 3u);
+    EXPECT_EQ(stats.completed, 3u);
+    EXPECT_EQ(stats.blocks, 1u);
+    EXPECT_EQ(stats.droppedOldest + stats.droppedNewest, 0u);
+    EXPECT_EQ(stats.depth, 0u);
+    EXPECT_EQ(stats.maxDepth, 2u);
+}
+
+TEST(FrameQueue, DropOldestReplacesOldestQueuedFrame) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(3), QueuePolicy::DropOldest);
+    for (int i = 1; i <= 3; ++i) ASSERT_TRUE(Push(queue, i));
+
+    // The dropped frame's slot comes back still filled
+    int* slot = queue.BeginPush();
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(*slot, 1);
+    *slot = 4;
+    queue.EndPush();
+
+    EXPECT_EQ(Pop(queue), 2);
+    EXPECT_EQ(Pop(queue), 3);
+    EXPECT_EQ(Pop(queue), 4);
+    EXPECT_EQ(queue.GetStats().droppedOldest, 1u);
+    EXPECT_EQ(queue.GetStats().blocks, 0u);
+}
+
+TEST(FrameQueue, DropOldestBlocksWhileConsumerHoldsEverySlot) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(1), QueuePolicy::DropOldest);
+    ASSERT_TRUE(Push(queue, 1));
+    int* active = queue.BeginPop();
+    ASSERT_NE(active, nullptr);
+
+    std::atomic<bool> pushed{ false };
+    std::thread producer([&] {
+        Push(queue, 2);
+        pushed = true;
+    });
+    std::this_thread::sleep_for(kSettle);
+    EXPECT_FALSE(pushed); // The frame being encoded is never taken away
+
+    queue.EndPop();
+    producer.join();
+    EXPECT_EQ(Pop(queue), 2);
+    EXPECT_EQ(queue.GetStats().droppedOldest, 0u);
+    EXPECT_EQ(queue.GetStats().blocks, 1u);
+}
+
+TEST(FrameQueue, DropNewestRejectsFramesWhileFull) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(2), QueuePolicy::DropNewest);
+    ASSERT_TRUE(Push(queue, 1));
+    ASSERT_TRUE(Push(queue, 2));
+    EXPECT_FALSE(Push(queue, 3));
+    queue.EndPush(); // Harmless after a dropped frame
+
+    EXPECT_EQ(Pop(queue), 1);
+    ASSERT_TRUE(Push(queue, 4));
+    EXPECT_EQ(Pop(queue), 2);
+    EXPECT_EQ(Pop(queue), 4);
+
+    Video::FrameQueueStats stats = queue.GetStats();
+    EXPECT_EQ(stats.submitted, 4u);
+    EXPECT_EQ(stats.completed, 3u);
+    EXPECT_EQ(stats.droppedNewest, 1u);
+    EXPECT_EQ(stats.blocks, 0u);
+}
+
+TEST(FrameQueue, UncommittedPushReturnsTheSlot) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(1), QueuePolicy::DropNewest);
+    ASSERT_NE(queue.BeginPush(), nullptr);
+    queue.EndPush(false);
+    EXPECT_TRUE(Push(queue, 5));
+    EXPECT_EQ(Pop(queue), 5);
+}
+
+TEST(FrameQueue, CloseWakesBlockedProducer) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(1), QueuePolicy::Block);
+    ASSERT_TRUE(Push(queue, 1));
+
+    std::atomic<int> result{ -1 };
+    std::thread producer([&] { result = Push(queue, 2) ? 1 : 0; });
+    std::this_thread::sleep_for(kSettle);
+    EXPECT_EQ(result, -1);
+
+    queue.Close();
+    producer.join();
+    EXPECT_EQ(result, 0);
+
+    // What was queued before the close still drains
+    EXPECT_EQ(Pop(queue), 1);
+    EXPECT_EQ(queue.BeginPop(), nullptr);
+    EXPECT_FALSE(Push(queue, 3));
+}
+
+TEST(FrameQueue, CloseWakesBlockedConsumer) {
+    FrameQueue<int> queue;
+    queue.Reset(std::vector<int>(2), QueuePolicy::Block);
+
+    std::atomic<bool> done{ false };
+    int unset = 0;
+    int* popped = &unset;
+    std::thread consumer([&] {
+        popped = queue.BeginPop();
+        done = true;
+    });
+    std::this_thread::sleep_for(kSettle);
+    EXPECT_FALSE(done);
+
+    queue.Close();
+    consumer.join();
+    EXPECT_EQ(popped, nullptr);
+}
+
+TEST(FrameQueue, ConcurrentFramesArriveInOrder) {
+    for (QueuePolicy policy : { QueuePolicy::Block, QueuePolicy::DropOldest, QueuePolicy::DropNewest }) {
+        FrameQueue<int> queue;
+        queue.Reset(std::vector<int>(3), policy);
+
+        const int frames = 20000;
+        std::vector<int> received;
+        std::thread consumer([&] {
+            for (int value; (value = Pop(queue)) >= 0;) received.push_back(value);
+        });
+        for (int i = 0; i < frames; ++i) Push(queue, i);
+        queue.Close();
+        consumer.join();
+
+        // Drops may leave gaps, never reorder; Block loses nothing
+        for (size_t i = 1; i < received.size(); ++i) ASSERT_LT(received[i - 1], received[i]) << (int)policy;
+        Video::FrameQueueStats stats = queue.GetStats();
+        EXPECT_EQ(stats.submitted, (uint64_t)frames);
+        EXPECT_EQ(received.size() + stats.droppedOldest + stats.droppedNewest, (size_t)frames) << (int)policy;
+        if (policy == QueuePolicy::Block) {
+            EXPECT_EQ(received.size(), (size_t)frames);
+        }
+        EXPECT_LE(stats.maxDepth, 3u);
+    }
+}
@@ -0,0 +1,196 @@
+#include "Video/ReplayBuffer.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using Video::ReplayBuffer;
+using Video::ReplayPacket;
+
+namespace {
+    // Every byte derives from the packet's stream and timestamp, so an overwritten packet shows up as a mismatch
+    uint8_t Fill(uint32_t stream, int64_t pts) {
+        return (uint8_t)(pts * 7 + stream * 101 + 1);
+    }
+
+    void Append(ReplayBuffer& buffer, uint32_t stream, int64_t pts, bool keyframe, size_t size) {
+        std::vector<uint8_t> bytes(size, Fill(stream, pts));
+        ReplayPacket packet;
+        packet.stream = stream;
+        packet.pts = pts;
+        packet.dts = pts;
+        packet.duration = 1;
+        packet.keyframe = keyframe;
+        packet.data = bytes.data();
+        packet.size = size;
+        buffer.Append(packet);
+    }
+
+    // count frames of one stream from first on, a keyframe every gop frames
+    void AppendFrames(ReplayBuffer& buffer, int64_t first, int64_t count, int64_t gop, size_t size) {
+        for (int64_t pts = first; pts < first + count; ++pts) Append(buffer, 0, pts, pts % gop == 0, size);
+    }
+
+    bool IsIntact(const ReplayPacket& packet) {
+        for (size_t i = 0; i < packet.size; ++i) {
+            if (packet.data[i] != Fill(packet.stream, packet.pts)) return false;
+        }
+        return true;
+    }
+
+    // Pins, copies out the packets and unpins
+    std::vector<ReplayPacket> Pinned(ReplayBuffer& buffer) {
+        std::vector<ReplayPacket> packets;
+        uint32_t count = 0;
+        if (!buffer.Pin(&count)) return packets;
+        for (uint32_t i = 0; i < count; ++i) {
+            packets.push_back(buffer.GetPinned(i));
+            EXPECT_TRUE(IsIntact(packets.back())) << "pts " << packets.back().pts;
+        }
+        buffer.Unpin();
+        return packets;
+    }
+
+    // Starts on a keyframe and has every frame from there on
+    void ExpectDecodable(const std::vector<ReplayPacket>& packets, int64_t last) {
+        ASSERT_FALSE(packets.empty());
+        EXPECT_TRUE(packets.front().keyframe);
+        for (size_t i = 0; i < packets.size(); ++i) ASSERT_EQ(packets[i].pts, packets.front().pts + (int64_t)i);
+        EXPECT_EQ(packets.back().pts, last);
+    }
+}
+
+TEST(ReplayBuffer, WaitsForFirstKeyframe) {
+    ReplayBuffer buffer;
+    buffer.Reset(4096, 64, 100);
+    Append(buffer, 0, 0, false, 10);
+    Append(buffer, 0, 1, false, 10);
+    EXPECT_EQ(buffer.GetStats().packets, 0u);
+    EXPECT_EQ(buffer.GetStats().dropped, 2u);
+
+    uint32_t count = 0;
+    EXPECT_FALSE(buffer.Pin(&count)); // Nothing to save yet
+
+    AppendFrames(buffer, 2, 4, 2, 10);
+    ExpectDecodable(Pinned(buffer), 5);
+}
+
+TEST(ReplayBuffer, DropsOldestGopOutsideWindow) {
+    ReplayBuffer buffer;
+    buffer.Reset(1 << 20, 1024, 60);
+    AppendFrames(buffer, 0, 200, 30, 100);
+
+    // The newest GOP starting at or before the window's edge (pts 139) is kept, nothing older
+    std::vector<ReplayPacket> packets = Pinned(buffer);
+    ExpectDecodable(packets, 199);
+    EXPECT_EQ(packets.front().pts, 120);
+
+    Video::ReplayStats stats = buffer.GetStats();
+    EXPECT_EQ(stats.packets, 80u);
+    EXPECT_EQ(stats.duration, 79);
+    EXPECT_EQ(stats.bytes, 80u * 100);
+    EXPECT_EQ(stats.dropped, 0u);
+}
+
+TEST(ReplayBuffer, WrapsAroundBytesAndRecords) {
+    ReplayBuffer buffer;
+    // Room for a few GOPs of odd-sized packets: bytes and records both wrap many times, at changing offsets
+    buffer.Reset(1000, 40, 1 << 30);
+    for (int64_t pts = 0; pts < 5000; ++pts) {
+        Append(buffer, 0, pts, pts % 5 == 0, 13 + (size_t)(pts * 7919 % 61));
+
+        Video::ReplayStats stats = buffer.GetStats();
+        ASSERT_LE(stats.bytes, 1000u) << pts;
+        ASSERT_LE(stats.packets, 40u) << pts;
+        if (pts % 97 == 0) ExpectDecodable(Pinned(buffer), pts);
+    }
+    std::vector<ReplayPacket> packets = Pinned(buffer);
+    ExpectDecodable(packets, 4999);
+    EXPECT_GE(packets.size(), 10u); // Only the oldest GOPs made room
+    EXPECT_EQ(buffer.GetStats().dropped, 0u);
+}
+
+TEST(ReplayBuffer, PinnedPacketsAreNeverOverwritten) {
+    ReplayBuffer buffer;
+    buffer.Reset(2000, 64, 1 << 30);
+    AppendFrames(buffer, 0, 40, 10, 40);
+
+    uint32_t count = 0;
+    ASSERT_TRUE(buffer.Pin(&count));
+    std::vector<ReplayPacket> pinned;
+    for (uint32_t i = 0; i < count; ++i) pinned.push_back(buffer.GetPinned(i));
+
+    // Many times the capacity arrives while the reader holds the window
+    AppendFrames(buffer, 40, 500, 10, 40);
+    for (uint32_t i = 0; i < count; ++i) {
+        ReplayPacket packet = buffer.GetPinned(i);
+        ASSERT_EQ(packet.pts, pinned[i].pts);
+        ASSERT_EQ(packet.data, pinned[i].data);
+        ASSERT_TRUE(IsIntact(packet)) << "pts " << packet.pts;
+    }
+    EXPECT_GT(buffer.GetStats().dropped, 0u);
+    buffer.Unpin();
+
+    // Recording resumes at the next keyframe
+    AppendFrames(buffer, 540, 75, 10, 40);
+    ExpectDecodable(Pinned(buffer), 614);
+}
+
+TEST(ReplayBuffer, PinningTwiceFails) {
+    ReplayBuffer buffer;
+    buffer.Reset(4096, 64, 100);
+    AppendFrames(buffer, 0, 10, 5, 10);
+    uint32_t count = 0;
+    ASSERT_TRUE(buffer.Pin(&count));
+    EXPECT_EQ(count, 10u);
+    EXPECT_FALSE(buffer.Pin(&count));
+    buffer.Unpin();
+    EXPECT_TRUE(buffer.Pin(&count));
+    buffer.Unpin();
+}
+
+TEST(ReplayBuffer, OversizedGopEndsEarly) {
+    ReplayBuffer buffer;
+    buffer.Reset(1000, 64, 1 << 30);
+
+    // A GOP of 30 packets of 100 bytes: the buffer holds its start, the rest waits for the next keyframe
+    AppendFrames(buffer, 0, 30, 30, 100);
+    std::vector<ReplayPacket> packets = Pinned(buffer);
+    ASSERT_FALSE(packets.empty());
+    EXPECT_TRUE(packets.front().keyframe);
+    EXPECT_EQ(packets.size(), 10u); // Exactly full
+    EXPECT_EQ(buffer.GetStats().dropped, 30u - packets.size());
+
+    AppendFrames(buffer, 30, 5, 30, 100);
+    ExpectDecodable(Pinned(buffer), 34);
+}
+
+TEST(ReplayBuffer, TrackKeyframesOfOneFrameShareAGop) {
+    ReplayBuffer buffer;
+    buffer.Reset(1 << 16, 256, 20);
+
+    // Two tile tracks with keyframes on the same frames
+    for (int64_t pts = 0; pts < 100; ++pts) {
+        for (uint32_t stream = 0; stream < 2; ++stream) Append(buffer, stream, pts, pts % 10 == 0, 50);
+    }
+    std::vector<ReplayPacket> packets = Pinned(buffer);
+    ASSERT_EQ(packets.size() % 2, 0u);
+    ASSERT_GE(packets.size(), 2u);
+
+    // Both tracks start at the same keyframe and keep every frame after it
+    EXPECT_TRUE(packets[0].keyframe && packets[1].keyframe);
+    EXPECT_EQ(packets[0].pts, packets[1].pts);
+    EXPECT_NE(packets[0].stream, packets[1].stream);
+    EXPECT_EQ(packets[0].pts, 70);
+    EXPECT_EQ(packets.back().pts, 99);
+    EXPECT_EQ(packets.size(), 60u);
+}
+
+TEST(ReplayBuffer, ReleaseFreesAndIgnoresAppends) {
+    ReplayBuffer buffer;
+    buffer.Reset(4096, 64, 100);
+    AppendFrames(buffer, 0, 10, 5, 10);
+    buffer.Release();
+    AppendFrames(buffer, 10, 10, 5, 10);
+    EXPECT_EQ(buffer.GetStats().packets, 0u);
+    uint32_t count = 0;
+    EXPECT_FALSE(buffer.Pin(&count));
+}
@@ -0,0 +1,463 @@
+#include "Video/SoftwareBackend.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/video_enc_params.h>
+}
+
+using Video::EncoderConfig;
+using Video::FrameDesc;
+using Video::OutputMode;
+using Video::OutputOptions;
+using Video::QueuePolicy;
+using Video::SoftwareBackend;
+
+namespace {
+    constexpr int kWidth = 320;
+    constexpr int kHeight = 160; // 2:1, an equirect frame
+    constexpr int kFps = 30; // GOPs are 2 s, 60 frames
+
+    bool HaveSoftwareEncoder() {
+        for (const char* name : { "libx264", "libx265", "libsvtav1" }) {
+            if (avcodec_find_encoder_by_name(name)) return true;
+        }
+        return false;
+    }
+
+    std::string TempFile(const std::string& name) {
+        std::string path = testing::TempDir() + "widecapture_" + name;
+        std::remove(path.c_str());
+        return path;
+    }
+
+    EncoderConfig Config(const std::string& path, int width = kWidth, int height = kHeight) {
+        EncoderConfig config;
+        config.width = width;
+        config.height = height;
+        config.fps = kFps;
+        config.timeBase = kFps;
+        config.bitRate = 2000000;
+        config.filename = path;
+        return config;
+    }
+
+    // NV12 frames of a moving gradient with noise, so every frame costs bits
+    class TestPattern {
+    public:
+        TestPattern(int width, int height) : m_width(width), m_height(height), m_y((size_t)width * height), m_uv((size_t)width * height / 2) {}
+
+        FrameDesc Frame(int index) {
+            uint32_t noise = (uint32_t)index * 2654435761u + 1;
+            for (int y = 0; y < m_height; ++y) {
+                for (int x = 0; x < m_width; ++x) {
+                    noise = noise * 1664525u + 1013904223u;
+                    m_y[(size_t)y * m_width + x] = (uint8_t)(x + y + index * 4 + (noise >> 28));
+                }
+            }
+            for (int y = 0; y < m_height / 2; ++y) {
+                for (int x = 0; x < m_width; ++x) m_uv[(size_t)y * m_width + x] = (uint8_t)(128 + ((x / 2 + y + index) & 15));
+            }
+
+            FrameDesc frame;
+            frame.format = Video::PixelFormat::NV12;
+            frame.width = m_width;
+            frame.height = m_height;
+            frame.planes[0] = m_y.data();
+            frame.planes[1] = m_uv.data();
+            frame.strides[0] = (size_t)m_width;
+            frame.strides[1] = (size_t)m_width;
+            return frame;
+        }
+
+    private:
+        int m_width, m_height;
+        std::vector<uint8_t> m_y, m_uv;
+    };
+
+    void EncodeFrames(Video::Encoder& encoder, int width, int height, int count) {
+        TestPattern pattern(width, height);
+        for (int i = 0; i < count; ++i) encoder.EncodeFrame(pattern.Frame(i), i);
+    }
+
+    struct TrackInfo {
+        int width = 0;
+        int height = 0;
+        int frames = 0; // Decoded
+    };
+
+    struct FileInfo {
+        bool opened = false;
+        std::vector<TrackInfo> tracks;
+    };
+
+    // Decoded frame of a track, with the encoder's quantizers attached (AV_FRAME_DATA_VIDEO_ENC_PARAMS)
+    using FrameCallback = std::function<void(unsigned track, const AVFrame* frame)>;
+    // Packet of a track as stored in the file
+    using PacketCallback = std::function<void(unsigned track, const AVPacket* packet)>;
+
+    // Demuxes and decodes every track of the file
+    FileInfo Probe(const std::string& path, const FrameCallback& onFrame = nullptr, const PacketCallback& onPacket = nullptr) {
+        FileInfo info;
+        AVFormatContext* fmtCtx = nullptr;
+        if (avformat_open_input(&fmtCtx, path.c_str(), nullptr, nullptr) < 0) return info;
+        if (avformat_find_stream_info(fmtCtx, nullptr) < 0) {
+            avformat_close_input(&fmtCtx);
+            return info;
+        }
+        info.opened = true;
+
+        std::vector<AVCodecContext*> decoders(fmtCtx->nb_streams, nullptr);
+        info.tracks.resize(fmtCtx->nb_streams);
+        for (unsigned i = 0; i < fmtCtx->nb_streams; ++i) {
+            const AVCodecParameters* params = fmtCtx->streams[i]->codecpar;
+            info.tracks[i].width = params->width;
+            info.tracks[i].height = params->height;
+
+            const AVCodec* codec = avcodec_find_decoder(params->codec_id);
+            decoders[i] = avcodec_alloc_context3(codec);
+            AVDictionary* options = nullptr;
+            if (onFrame) av_dict_set(&options, "export_side_data", "venc_params", 0);
+            if (!decoders[i] || avcodec_parameters_to_context(decoders[i], params) < 0 || avcodec_open2(decoders[i], codec, &options) < 0) {
+                avcodec_free_context(&decoders[i]);
+            }
+            av_dict_free(&options);
+        }
+
+        AVPacket* packet = av_packet_alloc();
+        AVFrame* frame = av_frame_alloc();
+        auto receive = [&](unsigned stream) {
+            while (avcodec_receive_frame(decoders[stream], frame) >= 0) {
+                info.tracks[stream].frames++;
+                if (onFrame) onFrame(stream, frame);
+                av_frame_unref(frame);
+            }
+        };
+        while (av_read_frame(fmtCtx, packet) >= 0) {
+            unsigned stream = (unsigned)packet->stream_index;
+            if (onPacket) onPacket(stream, packet);
+            if (decoders[stream] && avcodec_send_packet(decoders[stream], packet) >= 0) receive(stream);
+            av_packet_unref(packet);
+        }
+        for (unsigned i = 0; i < fmtCtx->nb_streams; ++i) {
+            if (!decoders[i]) continue;
+            avcodec_send_packet(decoders[i], nullptr);
+            receive(i);
+            avcodec_free_context(&decoders[i]);
+        }
+
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        avformat_close_input(&fmtCtx);
+        return info;
+    }
+
+    // x264 with one slice per two macroblock rows, so the bytes each band costs can be read off the slice NAL units
+    class SlicedBackend : public SoftwareBackend {
+    public:
+        SlicedBackend() : SoftwareBackend(Video::SoftwareCodec::X264) {}
+
+    protected:
+        void ConfigureCodec(AVCodecContext* codecCtx, uint32_t tile, AVDictionary** options) override {
+            SoftwareBackend::ConfigureCodec(codecCtx, tile, options);
+            av_dict_set_int(options, "slices", kHeight / 32, 0);
+        }
+    };
+
+    // The polar rows (beyond 60 degrees of latitude) and the equatorial rows of an equirect encode, each measured by
+    // the mean quantizer of its macroblocks, the bytes of its slices and the luma PSNR against the source frames
+    struct LatitudeStats {
+        double qp[2] = {};      // [0] equator, [1] polar
+        int64_t bytes[2] = {};
+        double psnr[2] = {};
+        int64_t totalBytes = 0;
+    };
+
+    LatitudeStats EncodeEquirect(const std::string& path, const Video::RoiProfile& profile) {
+        SlicedBackend encoder;
+        Video::SphericalMetadata spherical;
+        spherical.projection = Video::SphericalMetadata::Projection::Equirectangular;
+        encoder.SetSphericalMetadata(spherical);
+        encoder.SetRoiProfile(profile);
+        encoder.SetQueue(0, QueuePolicy::Block);
+        LatitudeStats stats;
+        if (!encoder.Initialize(Config(path))) return stats;
+        EncodeFrames(encoder, kWidth, kHeight, 60);
+        encoder.Finish();
+
+        // 60 degrees of latitude is a sixth of the height from either edge, which the encoder rounds to whole
+        // macroblock rows: the first and last of the five slices
+        const int polarRows = 32;
+        auto polar = [&](int row) { return row < polarRows || row >= kHeight - polarRows; };
+
+        double qpSums[2] = {}, qpCounts[2] = {};
+        double squaredErrors[2] = {}, samples[2] = {};
+        int decoded = 0;
+        TestPattern pattern(kWidth, kHeight);
+        auto onFrame = [&](unsigned, const AVFrame* frame) {
+            const AVFrameSideData* data = av_frame_get_side_data(frame, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+            if (data) {
+                const AVVideoEncParams* params = (const AVVideoEncParams*)data->data;
+                for (unsigned i = 0; i < params->nb_blocks; ++i) {
+                    const AVVideoBlockParams* block = av_video_enc_params_block(const_cast<AVVideoEncParams*>(params), i);
+                    bool band = polar(block->src_y + block->h / 2);
+                    qpSums[band] += params->qp + block->delta_qp;
+                    qpCounts[band] += 1.0;
+                }
+            }
+
+            // No B-frames: frames decode in the order they were encoded
+            FrameDesc source = pattern.Frame(decoded++);
+            for (int y = 0; y < kHeight; ++y) {
+                const uint8_t* a = source.planes[0] + y * source.strides[0];
+                const uint8_t* b = frame->data[0] + y * frame->linesize[0];
+                for (int x = 0; x < kWidth; ++x) squaredErrors[polar(y)] += (double)((a[x] - b[x]) * (a[x] - b[x]));
+                samples[polar(y)] += kWidth;
+            }
+        };
+
+        // Length-prefixed NAL units; slices come in frame order, top to bottom
+        auto onPacket = [&](unsigned, const AVPacket* packet) {
+            stats.totalBytes += packet->size;
+            int slice = 0;
+            for (int offset = 0; offset + 4 < packet->size;) {
+                const uint8_t* nal = packet->data + offset;
+                int size = (int)((uint32_t)nal[0] << 24 | (uint32_t)nal[1] << 16 | (uint32_t)nal[2] << 8 | nal[3]);
+                int type = nal[4] & 31;
+                if (type == 1 || type == 5) stats.bytes[polar(slice++ * 32)] += size;
+                offset += 4 + size;
+            }
+        };
+        Probe(path, onFrame, onPacket);
+
+        for (int band = 0; band < 2; ++band) {
+            if (qpCounts[band] > 0.0) stats.qp[band] = qpSums[band] / qpCounts[band];
+            if (squaredErrors[band] > 0.0) stats.psnr[band] = 10.0 * std::log10(255.0 * 255.0 * samples[band] / squaredErrors[band]);
+        }
+        return stats;
+    }
+}
+
+TEST(SoftwareEncoder, EncodesEveryFrame) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+
+    // On the caller's thread and through the queue to the encoding thread
+    for (uint32_t depth : { 0u, 3u }) {
+        std::string path = TempFile("every_frame_" + std::to_string(depth) + ".mp4");
+        SoftwareBackend encoder;
+        encoder.SetQueue(depth, QueuePolicy::Block);
+        ASSERT_TRUE(encoder.Initialize(Config(path)));
+        EncodeFrames(encoder, kWidth, kHeight, 90);
+        EXPECT_EQ(encoder.GetQueueStats().submitted, 90u);
+        encoder.Finish();
+
+        FileInfo info = Probe(path);
+        ASSERT_TRUE(info.opened) << depth;
+        ASSERT_EQ(info.tracks.size(), 1u);
+        EXPECT_EQ(info.tracks[0].width, kWidth);
+        EXPECT_EQ(info.tracks[0].height, kHeight);
+        EXPECT_EQ(info.tracks[0].frames, 90) << depth;
+    }
+}
+
+TEST(SoftwareEncoder, SegmentsAreListedInTheIndex) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+    std::string path = TempFile("segmented.mp4");
+    std::string base = path.substr(0, path.size() - 4);
+
+    // 2 s segments: 5 s of frames is two full segments and a short one. A segment ends at the first keyframe after
+    // its time is up, which scene cuts can move by a frame or two.
+    SoftwareBackend encoder;
+    encoder.SetQueue(0, QueuePolicy::Block);
+    OutputOptions output;
+    output.mode = OutputMode::Segmented;
+    output.segmentSeconds = 2;
+    encoder.SetOutput(output);
+    ASSERT_TRUE(encoder.Initialize(Config(path)));
+    EncodeFrames(encoder, kWidth, kHeight, 150);
+    encoder.Finish();
+
+    std::ifstream index(base + ".ffconcat");
+    ASSERT_TRUE(index.is_open());
+    std::vector<std::string> listed;
+    for (std::string line; std::getline(index, line);) {
+        if (line.rfind("file ", 0) == 0) listed.push_back(line.substr(5));
+    }
+
+    ASSERT_EQ(listed.size(), 3u);
+    int frames = 0;
+    for (size_t i = 0; i < listed.size(); ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "_%05d.mp4", (int)i);
+        EXPECT_EQ(listed[i].substr(listed[i].size() - strlen(name)), name);
+
+        // Each segment plays on its own
+        FileInfo info = Probe(base + name);
+        ASSERT_TRUE(info.opened) << name;
+        ASSERT_EQ(info.tracks.size(), 1u);
+        EXPECT_GE(info.tracks[0].frames, 20) << name;
+        frames += info.tracks[0].frames;
+        std::remove((base + name).c_str());
+    }
+    EXPECT_EQ(frames, 150);
+}
+
+TEST(SoftwareEncoder, AcquiredSurfacesAreEncodedAndReleasedOnesDropped) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+    std::string path = TempFile("acquired.mp4");
+
+    SoftwareBackend encoder;
+    ASSERT_TRUE(encoder.Initialize(Config(path)));
+    TestPattern pattern(kWidth, kHeight);
+    for (int i = 0; i < 40; ++i) {
+        FrameDesc surface;
+        ASSERT_TRUE(encoder.AcquireSurface(&surface));
+        ASSERT_FALSE(surface.IsHardware());
+        ASSERT_EQ(surface.width, kWidth);
+        ASSERT_EQ(surface.height, kHeight);
+
+        // Written in place, as the readback does
+        FrameDesc frame = pattern.Frame(i);
+        for (int plane = 0; plane < 2; ++plane) {
+            for (int y = 0; y < (plane ? kHeight / 2 : kHeight); ++y) {
+                memcpy(surface.planes[plane] + y * surface.strides[plane], frame.planes[plane] + y * frame.strides[plane], kWidth);
+            }
+        }
+        if (i % 4 == 3) encoder.ReleaseSurface();
+        else encoder.SubmitSurface(i);
+    }
+    encoder.Finish();
+
+    FileInfo info = Probe(path);
+    ASSERT_TRUE(info.opened);
+    ASSERT_EQ(info.tracks.size(), 1u);
+    EXPECT_EQ(info.tracks[0].frames, 30);
+}
+
+TEST(SoftwareEncoder, RejectsFramesOfAnotherSize) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+    std::string path = TempFile("mismatch.mp4");
+
+    SoftwareBackend encoder;
+    encoder.SetQueue(0, QueuePolicy::Block);
+    ASSERT_TRUE(encoder.Initialize(Config(path)));
+    TestPattern pattern(kWidth, kHeight), other(kWidth / 2, kHeight);
+    for (int i = 0; i < 20; ++i) encoder.EncodeFrame(i % 2 ? other.Frame(i) : pattern.Frame(i), i);
+    encoder.Finish();
+
+    FileInfo info = Probe(path);
+    ASSERT_TRUE(info.opened);
+    EXPECT_EQ(info.tracks[0].frames, 10);
+}
+
+TEST(SoftwareEncoder, PolarRowsGetCoarserQp) {
+    if (!avcodec_find_encoder_by_name("libx264")) GTEST_SKIP() << "FFmpeg has no libx264";
+
+    // Same content with and without the band: the difference is the offset (x264 keeps its adaptive quantization)
+    Video::RoiProfile uniform;
+    Video::RoiProfile poles = { { { 60.0f, 8 } } };
+    LatitudeStats plain = EncodeEquirect(TempFile("qp_uniform.mp4"), uniform);
+    LatitudeStats banded = EncodeEquirect(TempFile("qp_poles.mp4"), poles);
+    ASSERT_GT(plain.qp[0], 0.0);
+    ASSERT_GT(banded.qp[0], 0.0);
+    ASSERT_GT(plain.bytes[1], 0);
+    ASSERT_GT(banded.bytes[1], 0);
+    std::string measured = "polar QP " + std::to_string(banded.qp[1]) + " equator QP " + std::to_string(banded.qp[0]) +
+                           ", polar bytes " + std::to_string(plain.bytes[1]) + " -> " + std::to_string(banded.bytes[1]) +
+                           ", equator bytes " + std::to_string(plain.bytes[0]) + " -> " + std::to_string(banded.bytes[0]) +
+                           ", polar PSNR " + std::to_string(plain.psnr[1]) + " -> " + std::to_string(banded.psnr[1]) +
+                           ", equator PSNR " + std::to_string(plain.psnr[0]) + " -> " + std::to_string(banded.psnr[0]);
+
+    EXPECT_NEAR(plain.qp[1], plain.qp[0], 3.0);
+    EXPECT_GT(banded.qp[1] - banded.qp[0], plain.qp[1] - plain.qp[0] + 5.0) << measured;
+
+    // The rate is held, so the offset moves bits from the poles to the equator: the polar slices shrink and lose
+    // quality, the equatorial ones grow and gain it
+    EXPECT_NEAR((double)banded.totalBytes, (double)plain.totalBytes, plain.totalBytes * 0.15) << measured;
+    EXPECT_LT(banded.bytes[1], plain.bytes[1] * 3 / 4) << measured;
+    EXPECT_GT(banded.bytes[0], plain.bytes[0]) << measured;
+    EXPECT_LT(banded.psnr[1], plain.psnr[1] - 1.0) << measured;
+    EXPECT_GT(banded.psnr[0], plain.psnr[0]) << measured;
+}
+
+TEST(SoftwareEncoder, TilesBecomeOneTrackEach) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+
+    struct Case {
+        uint32_t columns, rows;
+        int width, height;
+        std::vector<int> widths, heights; // Expected columns and rows: edges on 16-pixel boundaries
+    };
+    const Case cases[] = {
+        { 3, 2, kWidth, kHeight, { 96, 112, 112 }, { 80, 80 } },
+        { 1, 1, kWidth, kHeight, { kWidth }, { kHeight } },
+        { 8, 8, 64, 32, { 16, 16, 16, 16 }, { 16, 16 } }, // No tile below a macroblock
+    };
+    for (const Case& c : cases) {
+        std::string path = TempFile("tiles_" + std::to_string(c.columns) + "x" + std::to_string(c.rows) + ".mp4");
+        SoftwareBackend encoder;
+        encoder.SetTiles(c.columns, c.rows);
+        ASSERT_TRUE(encoder.Initialize(Config(path, c.width, c.height)));
+        EncodeFrames(encoder, c.width, c.height, 30);
+        encoder.Finish();
+
+        // Row-major tracks, each with every frame
+        FileInfo info = Probe(path);
+        ASSERT_TRUE(info.opened);
+        ASSERT_EQ(info.tracks.size(), c.widths.size() * c.heights.size()) << c.columns << "x" << c.rows;
+        for (size_t i = 0; i < info.tracks.size(); ++i) {
+            EXPECT_EQ(info.tracks[i].width, c.widths[i % c.widths.size()]) << c.columns << "x" << c.rows << " track " << i;
+            EXPECT_EQ(info.tracks[i].height, c.heights[i / c.widths.size()]) << c.columns << "x" << c.rows << " track " << i;
+            EXPECT_EQ(info.tracks[i].frames, 30) << c.columns << "x" << c.rows << " track " << i;
+        }
+    }
+}
+
+// Runs the encoder in a child process that exits mid-recording without Finish or any destructor, as when the game
+// crashes or is killed
+TEST(SoftwareEncoderDeathTest, KilledWriterLeavesPlayableFragments) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+    std::string path = TempFile("killed_fragmented.mp4");
+
+    EXPECT_EXIT({
+        SoftwareBackend encoder;
+        encoder.SetQueue(0, QueuePolicy::Block);
+        if (!encoder.Initialize(Config(path))) std::_Exit(1);
+        EncodeFrames(encoder, kWidth, kHeight, 300);
+        std::_Exit(0);
+    }, testing::ExitedWithCode(0), "");
+
+    // Every GOP that ended before the kill is a finished fragment; the encoder still held the last few dozen frames
+    // and the fragment after the last keyframe was never closed
+    FileInfo info = Probe(path);
+    ASSERT_TRUE(info.opened);
+    ASSERT_EQ(info.tracks.size(), 1u);
+    EXPECT_GE(info.tracks[0].frames, 180);
+    EXPECT_LT(info.tracks[0].frames, 300);
+}
+
+TEST(SoftwareEncoderDeathTest, KilledFaststartWriterLeavesNothingPlayable) {
+    if (!HaveSoftwareEncoder()) GTEST_SKIP() << "FFmpeg has no software encoder";
+    std::string path = TempFile("killed_faststart.mp4");
+
+    // What the fragmented default avoids: the moov is only written at Finish
+    EXPECT_EXIT({
+        SoftwareBackend encoder;
+        encoder.SetQueue(0, QueuePolicy::Block);
+        OutputOptions output;
+        output.mode = OutputMode::Faststart;
+        encoder.SetOutput(output);
+        if (!encoder.Initialize(Config(path))) std::_Exit(1);
+        EncodeFrames(encoder, kWidth, kHeight, 300);
+        std::_Exit(0);
+    }, testing::ExitedWithCode(0), "");
+
+    EXPECT_FALSE(Probe(path).opened);
+}